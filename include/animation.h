@@ -0,0 +1,61 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "config.h"
+#include "renderer.h"
+#include "thread_pool.h"
+
+/**
+ * The number of iteration fields of an animation. While a frame is computed into one field, the previous frame is read from
+ * the second field and an older frame is shaded and written from the third one.
+ */
+#define ANIMATION_NUM_FIELDS 3
+
+/**
+ * A keyframe of a zoom or pan animation. The viewport is given by its center and its width,
+ * the height follows from the aspect ratio of the image. Rotation is not supported.
+ */
+typedef struct {
+    size_t frame;
+    double center_real;
+    double center_imag;
+    double width;
+} Keyframe;
+
+/**
+ * Calculates the viewport of a frame between two keyframes. The width changes exponentially, so the zoom speed is constant,
+ * and the center moves so that it travels the same distance on the screen in every frame.
+ * Frames before the first or after the last keyframe get the viewport of that keyframe.
+ *
+ * @param keyframes The keyframes, sorted by strictly increasing frame numbers.
+ * @param num_keyframes The number of keyframes. Must be at least 1.
+ * @param frame The frame number.
+ * @param aspect_ratio The height of the image divided by its width.
+ * @return The viewport of the frame.
+ */
+Viewport get_keyframe_viewport(const Keyframe *keyframes, size_t num_keyframes, size_t frame, double aspect_ratio);
+
+/**
+ * Renders every frame from the first to the last keyframe and saves it as <output_prefix>_<frame>.bmp, with the frame number
+ * padded to 5 digits. The frames are computed with compute_frame_field, so pixels that lie on a pixel of the previous frame are reused.
+ * The frames are pipelined: while a frame is computed on the thread pool, a writer thread shades and writes the previous frames.
+ * With a frame stream, the frames are written to it as a YUV4MPEG2 stream in order instead, see write_y4m_frame.
+ *
+ * @param config The configuration struct. Its viewport is only used for the aspect ratio, deep zoom is not supported.
+ * @param p_thread_pool The thread pool to compute the frames with, or NULL to compute them on the calling thread.
+ * @param keyframes The keyframes, sorted by strictly increasing frame numbers.
+ * @param num_keyframes The number of keyframes. Must be at least 1.
+ * @param size The size of every frame in pixels.
+ * @param output_prefix The path of the frames without the frame number and the extension. Unused with a frame stream.
+ * @param frame_stream The stream to write the frames to, or NULL to save them as BMP files.
+ * @param progress_callback A callback function to output the progress, or NULL. It is always called on the calling thread.
+ * @param p_statistics A pointer to store statistics summed over all frames, or NULL.
+ * @return Status code.
+ */
+int render_animation(Configuration config, ThreadPool *p_thread_pool, const Keyframe *keyframes, size_t num_keyframes, ImageSize size,
+                     const char *output_prefix, FILE *frame_stream, void (*progress_callback)(double), RenderStatistics *p_statistics);
+
+#endif  // ANIMATION_H
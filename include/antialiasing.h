@@ -0,0 +1,40 @@
+#ifndef ANTIALIASING_H
+#define ANTIALIASING_H
+
+#include <stddef.h>
+
+#include "config.h"
+#include "image_manager.h"
+#include "iteration_field.h"
+#include "thread_pool.h"
+
+/**
+ * The largest number of samples per side of the grid of a supersampled pixel, which limits it to 64 samples.
+ */
+#define MAX_SUPERSAMPLING 8
+
+/**
+ * Supersamples the pixels at the edges of a shaded image or band, so they get the average color of the area they cover.
+ * Flat regions cost nothing extra, which makes it much cheaper than rendering the whole image at a higher resolution.
+ *
+ * A pixel is at an edge if it differs from one of its four neighbors in the image: either one of them is inside of the set and the other
+ * is not, or one of their color channels differs by more than the supersampling threshold of the configuration. The pixels on the top and
+ * bottom row of a band are compared with the rows next to the band, so a band gives the same pixels as the whole image. Such a pixel is
+ * iterated again on a jittered grid of supersampling x supersampling points: every point lies at a random position in its cell of the
+ * area of the pixel. The jitter only depends on the position of the pixel in the image, so every render of an image is the same.
+ *
+ * @param p_config A pointer to the configuration. Its supersampling must be at least 2.
+ * @param p_thread_pool The thread pool to supersample the pixels with, or NULL to supersample them on the calling thread.
+ * @param p_field A pointer to the iteration field of the band.
+ * @param first_row The row of the image that is the first row of the band.
+ * @param p_image_data A pointer to the image data of the band. Must already be shaded from the field.
+ * @param p_row_above A pointer to an iteration field of a single row with the row of the image above the band, or NULL at the top of the image.
+ * @param p_row_below A pointer to an iteration field of a single row with the row of the image below the band, or NULL at the bottom of the image.
+ * @param p_num_pixels A pointer to store the number of supersampled pixels.
+ * @param p_num_samples A pointer to store the number of samples of the supersampled pixels.
+ * @return Status code. ERROR_INCOMPATIBLE_OPTIONS if the samples would need perturbation, see select_precision.
+ */
+int supersample_edges(const Configuration *p_config, ThreadPool *p_thread_pool, const IterationField *p_field, size_t first_row, ImageData *p_image_data,
+                      const IterationField *p_row_above, const IterationField *p_row_below, size_t *p_num_pixels, size_t *p_num_samples);
+
+#endif  // ANTIALIASING_H
@@ -0,0 +1,107 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "thread_pool.h"
+
+/**
+ * The number of scenes of the benchmark, see run_benchmark.
+ */
+#define BENCHMARK_NUM_SCENES 5
+
+/**
+ * The number of image widths and iteration depths every scene is rendered with.
+ */
+#define BENCHMARK_NUM_WIDTHS 2
+#define BENCHMARK_NUM_DEPTHS 2
+
+/**
+ * The number of runs of the benchmark, one for every combination of scene, width and iteration depth.
+ */
+#define BENCHMARK_NUM_RUNS (BENCHMARK_NUM_SCENES * BENCHMARK_NUM_WIDTHS * BENCHMARK_NUM_DEPTHS)
+
+/**
+ * The maximum length of the name of a scene, including the terminating null character.
+ */
+#define BENCHMARK_MAX_NAME_LENGTH 32
+
+/**
+ * The result of a single run of the benchmark. A run is identified by its scene, width and iteration depth.
+ */
+typedef struct {
+    char scene[BENCHMARK_MAX_NAME_LENGTH];
+    size_t width;
+    size_t height;
+    size_t iteration_depth;
+    // The shortest wall clock time of the repetitions of the run in seconds.
+    double wall_time;
+    double pixels_per_second;
+    // The sum of the numbers of iterations of all pixels, where pixels inside of the set count with the iteration depth,
+    // whether they were iterated or detected by the interior checks. It is the same for every build, so it measures the work of the image.
+    uint64_t num_iterations;
+    double iterations_per_second;
+    // The largest resident set size of the process during the run in bytes, or 0 if it is not known.
+    // On platforms where it can not be reset, it is the largest resident set size since the start of the process.
+    size_t peak_rss;
+} BenchmarkResult;
+
+/**
+ * Renders a fixed set of scenes at every width and iteration depth of the benchmark and measures every run.
+ * The scenes are the full set, Seahorse Valley, the interior of a mini-brot, a boundary view full of filaments and a view deep inside
+ * of the main cardioid and the period-2 bulb. Every run is repeated, and the fastest repetition counts, which filters out
+ * disturbances by other processes. The images are rendered in brute force mode with all interior checks and are not saved.
+ *
+ * @param p_thread_pool The thread pool to render with, or NULL to render on the calling thread.
+ * @param num_repetitions The number of repetitions of every run. Must be at least 1.
+ * @param results An array of BENCHMARK_NUM_RUNS results to store the results of the runs.
+ * @param progress_callback A callback function to output the progress, or NULL.
+ * @return Status code.
+ */
+int run_benchmark(ThreadPool *p_thread_pool, size_t num_repetitions, BenchmarkResult *results, void (*progress_callback)(double));
+
+/**
+ * Saves benchmark results as a JSON file. Every run is written on its own line, so the file can also be compared with line based tools.
+ *
+ * @param path The path of the file.
+ * @param results The results.
+ * @param num_results The number of results.
+ * @param num_threads The number of threads the results were measured with.
+ * @return Status code.
+ */
+int save_benchmark_results(const char *path, const BenchmarkResult *results, size_t num_results, size_t num_threads);
+
+/**
+ * Loads benchmark results from a JSON file that was written by save_benchmark_results.
+ * The results must be freed with free.
+ *
+ * @param path The path of the file.
+ * @param p_p_results A pointer to store the results.
+ * @param p_num_results A pointer to store the number of results.
+ * @return Status code.
+ */
+int load_benchmark_results(const char *path, BenchmarkResult **p_p_results, size_t *p_num_results);
+
+/**
+ * Finds the result of the same run in other results.
+ *
+ * @param p_result A pointer to the result.
+ * @param results The results to search.
+ * @param num_results The number of results to search.
+ * @return A pointer to the result with the same scene, width and iteration depth, or NULL.
+ */
+const BenchmarkResult *find_benchmark_result(const BenchmarkResult *p_result, const BenchmarkResult *results, size_t num_results);
+
+/**
+ * Checks whether a run is slower than the same run of a baseline by more than a tolerance.
+ *
+ * @param p_result A pointer to the result of the run.
+ * @param p_baseline A pointer to the result of the same run in the baseline.
+ * @param tolerance The tolerated slowdown as a fraction of the wall time of the baseline, e.g. 0.05 for 5%.
+ * @return True if the run is a regression.
+ */
+bool is_benchmark_regression(const BenchmarkResult *p_result, const BenchmarkResult *p_baseline, double tolerance);
+
+#endif  // BENCHMARK_H
@@ -1,12 +1,12 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 #include "complex_utilities.h"
-
-#define MAX_NUM_COLORS 100
+#include "fixed_point.h"
 
 /**
  * Represents a viewport in the complex plane. Both corners are complex numbers.
@@ -16,17 +16,100 @@ typedef struct {
     Complex upper_right;
 } Viewport;
 
+/**
+ * The algorithm that decides which pixels are iterated.
+ */
+typedef enum {
+    // Every pixel is iterated.
+    RENDER_MODE_BRUTE_FORCE,
+    // Only the border of a rectangle is iterated. If the whole border has the same number of iterations, the inside is filled
+    // with it, otherwise the rectangle is split and both halves are processed the same way (Mariani-Silver algorithm).
+    RENDER_MODE_SUBDIVISION
+} RenderMode;
+
+/**
+ * The number type the pixels are iterated with.
+ */
+typedef enum {
+    // The cheapest of the types below that resolves the pixel spacing of the image, see select_precision.
+    PRECISION_AUTO,
+    // Single precision, which iterates twice as many points per vector instruction as double precision.
+    PRECISION_FLOAT,
+    PRECISION_DOUBLE,
+    // About 106 bits as the sum of two doubles, which resolves pixel spacings down to about 1e-28 without a reference orbit.
+    PRECISION_DOUBLE_DOUBLE,
+    // Deep zoom mode only. A reference orbit with fixed point precision and the differences of the pixels to it in double precision.
+    PRECISION_PERTURBATION
+} Precision;
+
+/**
+ * The function whose iteration is visualized. Every formula iterates z -> f(z)^power + c, with the power from the configuration.
+ */
+typedef enum {
+    // z_0 = 0 and c is the pixel. With a power above 2, this is the Multibrot set.
+    FORMULA_MANDELBROT,
+    // z_0 is the pixel and c is the constant julia_c of the configuration.
+    FORMULA_JULIA,
+    // Like the Mandelbrot set, but the absolute values of the real and imaginary part of z are taken before every step.
+    FORMULA_BURNING_SHIP,
+    NUM_FORMULAS
+} Formula;
+
+/**
+ * The largest power of the formulas. Every power from 2 up to it has its own kernels.
+ */
+#define MAX_FORMULA_POWER 8
+
+/**
+ * The color difference above which neighboring pixels are supersampled, if the configuration file does not set it.
+ */
+#define DEFAULT_SUPERSAMPLING_THRESHOLD 16
+
 /**
  * Represents the configuration for the visualization as read from the configuration file.
  * The configuration includes the viewport, the maximum iteration depth, the inner color, the outer colors and the number of outer colors.
  * This includes every information about how the image will look like. Only the resolution of the image is not included here.
+ *
+ * In deep zoom mode, the viewport is relative to a center that is given with fixed point precision,
+ * because the corners of deep viewports cannot be distinguished in double precision.
+ * Otherwise, the center is 0 and the viewport is absolute.
  */
 typedef struct {
     Viewport viewport;
+    bool deep_zoom;
+    FixedPoint center_real;
+    FixedPoint center_imag;
     size_t iteration_depth;
+    // The enabled interior checks, a combination of the INTERIOR_CHECK_* flags. All are enabled by default.
+    unsigned int interior_checks;
+    RenderMode render_mode;
     uint32_t inner_color;
     size_t num_outer_colors;
-    uint32_t outer_colors[MAX_NUM_COLORS];
+    // The outer colors are allocated by the parser, so a gradient can have any number of colors.
+    uint32_t *outer_colors;
+    // Whether the pixels are colored by their fractional number of iterations, which removes the bands between the colors.
+    bool smooth_coloring;
+    // The number of samples per side of the jittered grid of pixels at edges, or 0 or 1 for one sample per pixel, see supersample_edges.
+    size_t supersampling;
+    // The largest difference of a color channel between neighboring pixels that is not treated as an edge.
+    unsigned int supersampling_threshold;
+    // The number type of the iteration. PRECISION_AUTO unless the configuration file sets it.
+    Precision precision;
+    // The formula and its power, 2 by default. Deep zoom mode, double-doubles and the analytic interior checks need the Mandelbrot set with power 2.
+    Formula formula;
+    unsigned int power;
+    // The constant c of the Julia set.
+    Complex julia_c;
+    // The parts of the corners that are lost when they are rounded to the doubles of the viewport. Only used while parsing,
+    // corners that need them are turned into a center with fixed point precision, see parse_ini_file.
+    Viewport viewport_low;
 } Configuration;
 
+/**
+ * Frees the memory of a configuration that was allocated by the parser. Copies of the configuration become invalid.
+ *
+ * @param p_config A pointer to the configuration.
+ */
+void free_configuration(Configuration *p_config);
+
 #endif  // CONFIG_H
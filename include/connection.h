@@ -0,0 +1,158 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include <stddef.h>
+
+/**
+ * The line that ends the configuration file that follows a command, see read_configuration_text.
+ */
+#define END_OF_CONFIGURATION "END"
+
+/**
+ * A stream socket that accepts connections, either a local Unix domain socket or a TCP socket.
+ * On Windows, Unix domain sockets are supported since Windows 10.
+ */
+typedef struct Listener Listener;
+
+/**
+ * A connected stream socket. Received bytes are buffered, so lines and binary data can be read from the same connection.
+ * Reading and writing may happen on different threads, but only one thread may read and one thread may write at the same time.
+ */
+typedef struct Connection Connection;
+
+/**
+ * Creates a Unix domain socket at the given path and listens on it. A socket file that is left over from a process
+ * that has exited is replaced, but a socket that is still accepting connections is not.
+ *
+ * @param path The path of the socket file.
+ * @param p_p_listener A pointer to store the listener.
+ * @return Status code.
+ */
+int open_unix_listener(const char *path, Listener **p_p_listener);
+
+/**
+ * Creates a TCP socket that listens on a port on all IPv4 addresses of the machine.
+ *
+ * @param port The port number.
+ * @param p_p_listener A pointer to store the listener.
+ * @return Status code.
+ */
+int open_tcp_listener(const char *port, Listener **p_p_listener);
+
+/**
+ * Connects to a TCP socket. Small messages are sent without delay, because they are usually requests that are waited for.
+ *
+ * @param address The host and the port, separated by a colon, like "localhost:7000" or "[::1]:7000".
+ * @param timeout_seconds The time to wait for each address of the host, or 0 to wait as long as the system does.
+ * @param p_p_connection A pointer to store the connection.
+ * @return Status code. ERROR_SOCKET if the host can not be found, nobody listens on the port or the timeout elapsed.
+ */
+int connect_tcp(const char *address, unsigned int timeout_seconds, Connection **p_p_connection);
+
+/**
+ * Waits for the next connection.
+ *
+ * @param p_listener A pointer to the listener.
+ * @param p_p_connection A pointer to store the connection.
+ * @return Status code. ERROR_SOCKET after interrupt_listener was called.
+ */
+int accept_connection(Listener *p_listener, Connection **p_p_connection);
+
+/**
+ * Makes accept_connection return, even if it is waiting on another thread. No more connections are accepted afterwards.
+ *
+ * @param p_listener A pointer to the listener.
+ */
+void interrupt_listener(Listener *p_listener);
+
+/**
+ * Closes the listener, removes the socket file of a Unix domain socket and frees it.
+ *
+ * @param p_listener A pointer to the listener, or NULL.
+ */
+void close_listener(Listener *p_listener);
+
+/**
+ * Reads a line of arbitrary length. The line buffer is grown as needed and keeps its size for the next line.
+ * The line break, and a carriage return before it, are removed.
+ *
+ * @param p_connection A pointer to the connection.
+ * @param p_p_line A pointer to the line buffer. Must point to NULL or a buffer allocated with malloc.
+ * @param p_capacity A pointer to the size of the line buffer.
+ * @return 1 if a line was read, 0 if the other side closed the connection, or a negative status code.
+ */
+int read_line(Connection *p_connection, char **p_p_line, size_t *p_capacity);
+
+/**
+ * Reads the lines of a configuration file that follow a command, until a line END_OF_CONFIGURATION.
+ *
+ * @param p_connection A pointer to the connection.
+ * @param p_p_text A pointer to store the lines, each one followed by a line break. Must be freed with free.
+ * @return Status code. ERROR_SOCKET if the other side closed the connection before the end of the configuration.
+ */
+int read_configuration_text(Connection *p_connection, char **p_p_text);
+
+/**
+ * Writes the lines of a configuration file, followed by a line END_OF_CONFIGURATION, so the other side can read them with
+ * read_configuration_text.
+ *
+ * @param p_connection A pointer to the connection.
+ * @param path The path of the configuration file.
+ * @return Status code.
+ */
+int write_configuration_file(Connection *p_connection, const char *path);
+
+/**
+ * Reads a number of bytes, for example binary data that was announced by a line.
+ *
+ * @param p_connection A pointer to the connection.
+ * @param buffer The buffer to store the bytes.
+ * @param size The number of bytes.
+ * @return Status code. ERROR_SOCKET if the other side closed the connection before all bytes were received.
+ */
+int read_bytes(Connection *p_connection, void *buffer, size_t size);
+
+/**
+ * Writes all bytes of a buffer.
+ *
+ * @param p_connection A pointer to the connection.
+ * @param buffer The bytes to write.
+ * @param size The number of bytes.
+ * @return Status code.
+ */
+int write_bytes(Connection *p_connection, const void *buffer, size_t size);
+
+/**
+ * Writes a line that is formatted like by printf, followed by a line break.
+ *
+ * @param p_connection A pointer to the connection.
+ * @param format The format string.
+ * @return Status code.
+ */
+int write_line(Connection *p_connection, const char *format, ...);
+
+/**
+ * Makes reads and writes fail with ERROR_SOCKET when the other side does not send or receive anything for some time,
+ * so a side that stopped responding is noticed like one that disconnected.
+ *
+ * @param p_connection A pointer to the connection.
+ * @param timeout_seconds The time to wait for each read or write, or 0 to wait forever.
+ * @return Status code.
+ */
+int set_connection_timeout(Connection *p_connection, unsigned int timeout_seconds);
+
+/**
+ * Makes a read that is waiting on another thread return 0, so the thread that serves the connection stops.
+ *
+ * @param p_connection A pointer to the connection.
+ */
+void interrupt_connection(Connection *p_connection);
+
+/**
+ * Closes the connection and frees it.
+ *
+ * @param p_connection A pointer to the connection, or NULL.
+ */
+void close_connection(Connection *p_connection);
+
+#endif  // CONNECTION_H
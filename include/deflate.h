@@ -0,0 +1,74 @@
+#ifndef DEFLATE_H
+#define DEFLATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The largest distance of a match in a deflate stream. A segment can refer to at most this many bytes before it.
+ */
+#define DEFLATE_WINDOW_SIZE 32768
+
+/**
+ * A growing array of bytes. An empty buffer has no data and must be initialized with zeros.
+ */
+typedef struct {
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+} ByteBuffer;
+
+/**
+ * Appends bytes to a buffer. The capacity is doubled whenever it is exceeded.
+ *
+ * @param p_buffer A pointer to the buffer.
+ * @param bytes The bytes to append.
+ * @param count The number of bytes.
+ * @return Status code.
+ */
+int append_to_byte_buffer(ByteBuffer *p_buffer, const void *bytes, size_t count);
+
+/**
+ * Frees the data of a buffer and empties it.
+ *
+ * @param p_buffer A pointer to the buffer.
+ */
+void free_byte_buffer(ByteBuffer *p_buffer);
+
+/**
+ * Compresses a segment of a deflate stream (RFC 1951) with dynamic Huffman codes. Segments of the same stream can be compressed
+ * independently and concatenated afterwards: every segment but the last one ends with an empty stored block, so it ends on a byte boundary,
+ * and the last one sets the final flag. Matches may refer to the dictionary, the bytes before the segment, so splitting a stream
+ * into segments costs almost no compression as long as every segment gets the end of the previous one as its dictionary.
+ *
+ * @param data The dictionary followed by the bytes of the segment.
+ * @param dictionary_size The number of bytes of the dictionary. At most DEFLATE_WINDOW_SIZE.
+ * @param size The number of bytes of the segment.
+ * @param last Whether the segment is the last one of the stream.
+ * @param p_output A pointer to the buffer to append the compressed segment to.
+ * @return Status code.
+ */
+int deflate_segment(const unsigned char *data, size_t dictionary_size, size_t size, bool last, ByteBuffer *p_output);
+
+/**
+ * Updates the Adler-32 checksum of a zlib stream (RFC 1950) with more bytes.
+ *
+ * @param adler The checksum of the bytes so far, 1 for no bytes.
+ * @param data The bytes.
+ * @param size The number of bytes.
+ * @return The checksum including the bytes.
+ */
+uint32_t update_adler32(uint32_t adler, const unsigned char *data, size_t size);
+
+/**
+ * Combines the Adler-32 checksums of two consecutive parts of a stream, so the parts can be checksummed in parallel.
+ *
+ * @param adler_first The checksum of the first part.
+ * @param adler_second The checksum of the second part.
+ * @param size_second The number of bytes of the second part.
+ * @return The checksum of both parts.
+ */
+uint32_t combine_adler32(uint32_t adler_first, uint32_t adler_second, uint64_t size_second);
+
+#endif  // DEFLATE_H
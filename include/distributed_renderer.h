@@ -0,0 +1,75 @@
+#ifndef DISTRIBUTED_RENDERER_H
+#define DISTRIBUTED_RENDERER_H
+
+#include <stddef.h>
+
+#include "config.h"
+#include "connection.h"
+#include "image_manager.h"
+#include "iteration_field.h"
+#include "renderer.h"
+#include "thread_pool.h"
+
+/**
+ * The number of rows of a band of a distributed render, which is the unit of work that is handed to a worker.
+ * Bands are a multiple of TILE_SIZE high, so they are computed exactly like the whole image, and small enough that a band
+ * of a slow worker can be computed again by another worker without losing much time.
+ */
+#define DISTRIBUTED_BAND_HEIGHT (2 * TILE_SIZE)
+
+/**
+ * The number of workers that may compute the same band at the same time. A band is only handed to another worker
+ * when no band is left that nobody computes, so the bands of a slow worker are computed again by the workers that are done.
+ */
+#define DISTRIBUTED_MAX_ASSIGNMENTS 2
+
+/**
+ * The number of seconds to wait for a worker to accept a connection.
+ */
+#define DISTRIBUTED_CONNECT_TIMEOUT 10
+
+/**
+ * The number of seconds that a worker and a coordinator wait for each other before they give up the connection.
+ * A worker must compute a band within this time, or it is dropped like a worker that disconnected.
+ */
+#define DISTRIBUTED_TIMEOUT 300
+
+/**
+ * Computes the iteration field of an image on worker processes, see run_render_worker, and shades it on the calling machine.
+ * The image is divided into bands of DISTRIBUTED_BAND_HEIGHT rows. Every worker is served by its own thread, which sends it
+ * the configuration file once and then asks it for one band after another until all bands are computed. Workers that can not be reached,
+ * disconnect or do not answer within DISTRIBUTED_TIMEOUT are dropped and their bands are handed to the others. When no band is left, the bands that are still computed are
+ * handed to a second worker, and the first result is taken, so a slow worker does not hold up the render.
+ * Apart from the reference orbits of deep zoom renders, which are chosen for every band on its own, the image is the same as if it was
+ * rendered with render_to_image. The iteration results are sent as little-endian, so the machines may have different byte orders.
+ *
+ * Protocol: the coordinator sends commands as lines of text and gets a line as the answer to every command,
+ * which is "ERROR <status code> <message>" if it fails:
+ * - CONFIGURE <image_width>, followed by the lines of a configuration file and a line "END". Answer: "OK <image_width> <image_height>".
+ * - BAND <first_row> <num_rows>. Answer: "FIELD <num_iterated_pixels>", followed by the iterations of the pixels of the band as
+ *   little-endian 32 bit unsigned integers and their magnitudes as little-endian 32 bit IEEE 754 floats, both row by row from the top to the bottom.
+ *
+ * @param config The configuration struct, which is used to shade the field.
+ * @param config_path The path of the configuration file, which is sent to the workers as it is.
+ * @param worker_addresses The addresses of the workers, separated by commas, like "node1:7000,node2:7000".
+ * @param p_thread_pool The thread pool to shade the image with, or NULL to shade it on the calling thread.
+ * @param p_field A pointer to the iteration field of the whole image. Must have the iteration depth of the configuration.
+ * @param p_image_data A pointer to the image data of the whole image. Must have the same size as the field.
+ * @param progress_callback A callback function to output the progress. It is always called on the calling thread.
+ * @param p_statistics A pointer to store statistics about the render, or NULL. The compute time is the time spent waiting for the workers.
+ * @return Status code. ERROR_NO_WORKERS if all workers are gone before all bands are computed.
+ */
+int render_distributed(Configuration config, const char *config_path, const char *worker_addresses, ThreadPool *p_thread_pool, IterationField *p_field,
+                       ImageData *p_image_data, void (*progress_callback)(double), RenderStatistics *p_statistics);
+
+/**
+ * Computes bands of iteration fields for the coordinators of distributed renders, see render_distributed, until the process is stopped.
+ * Coordinators are served one after another, each one with the whole thread pool.
+ *
+ * @param p_listener A pointer to the listener to accept the coordinators from.
+ * @param p_thread_pool The thread pool to compute the bands with, or NULL to compute them on a single thread.
+ * @return Status code.
+ */
+int run_render_worker(Listener *p_listener, ThreadPool *p_thread_pool);
+
+#endif  // DISTRIBUTED_RENDERER_H
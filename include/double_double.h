@@ -0,0 +1,49 @@
+#ifndef DOUBLE_DOUBLE_H
+#define DOUBLE_DOUBLE_H
+
+/**
+ * Represents a real number as the unevaluated sum of two doubles, which gives about 106 bits of precision.
+ * The low part is at most half a unit in the last place of the high part, so the high part is the number rounded to a double.
+ */
+typedef struct {
+    double hi;
+    double lo;
+} DoubleDouble;
+
+/**
+ * Adds two doubles exactly.
+ *
+ * @param a The first summand.
+ * @param b The second summand.
+ * @return The exact sum.
+ */
+DoubleDouble double_double_from_sum(double a, double b);
+
+/**
+ * Multiplies two doubles exactly. The product must not overflow.
+ *
+ * @param a The first factor.
+ * @param b The second factor.
+ * @return The exact product.
+ */
+DoubleDouble double_double_from_product(double a, double b);
+
+/**
+ * Adds two double-double numbers.
+ *
+ * @param a The first summand.
+ * @param b The second summand.
+ * @return The sum, rounded to double-double precision.
+ */
+DoubleDouble add_double_double(DoubleDouble a, DoubleDouble b);
+
+/**
+ * Subtracts a double-double number from another.
+ *
+ * @param a The minuend.
+ * @param b The subtrahend.
+ * @return The difference, rounded to double-double precision.
+ */
+DoubleDouble subtract_double_double(DoubleDouble a, DoubleDouble b);
+
+#endif  // DOUBLE_DOUBLE_H
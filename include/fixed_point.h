@@ -0,0 +1,117 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "double_double.h"
+
+/**
+ * The maximum number of 32 bit limbs of a fixed point number. The first limb holds the integer part,
+ * the other limbs hold the fractional part. 36 limbs give 1120 fractional bits, which is enough for zoom levels down to about 1e-300.
+ */
+#define FIXED_POINT_MAX_LIMBS 36
+
+/**
+ * Represents a real number with arbitrary but fixed precision as sign and magnitude.
+ * The magnitude is sum(limbs[i] * 2^(-32 * i)) for i < num_limbs. The limbs beyond num_limbs are always 0.
+ * A struct with all members set to 0 represents the number 0.
+ */
+typedef struct {
+    bool negative;
+    size_t num_limbs;
+    uint32_t limbs[FIXED_POINT_MAX_LIMBS];
+} FixedPoint;
+
+/**
+ * Parses a decimal number like "-0.7436438870371587047521915061147" or "1.5e-3" with the maximum precision.
+ *
+ * @param str The string to parse.
+ * @param p_result A pointer to store the parsed number.
+ * @return Status code.
+ */
+int parse_fixed_point(const char *str, FixedPoint *p_result);
+
+/**
+ * Converts a double to a fixed point number. The conversion is exact if the precision is high enough.
+ * The magnitude of the value must be less than 2^32.
+ *
+ * @param value The value to convert.
+ * @param num_limbs The precision of the result in limbs.
+ * @param p_result A pointer to store the result.
+ */
+void double_to_fixed_point(double value, size_t num_limbs, FixedPoint *p_result);
+
+/**
+ * Converts a fixed point number to the nearest double.
+ *
+ * @param p_value A pointer to the number to convert.
+ * @return The number as double.
+ */
+double fixed_point_to_double(const FixedPoint *p_value);
+
+/**
+ * Converts a fixed point number to the nearest double-double number.
+ *
+ * @param p_value A pointer to the number to convert.
+ * @return The number as double-double.
+ */
+DoubleDouble fixed_point_to_double_double(const FixedPoint *p_value);
+
+/**
+ * Converts a double-double number to a fixed point number. The conversion is exact if the precision is high enough.
+ * The magnitude of the value must be less than 2^32.
+ *
+ * @param value The value to convert.
+ * @param num_limbs The precision of the result in limbs.
+ * @param p_result A pointer to store the result.
+ */
+void double_double_to_fixed_point(DoubleDouble value, size_t num_limbs, FixedPoint *p_result);
+
+/**
+ * Changes the precision of a fixed point number. Limbs that are dropped are truncated.
+ *
+ * @param p_value A pointer to the number to change.
+ * @param num_limbs The new precision in limbs. Must not be greater than FIXED_POINT_MAX_LIMBS.
+ */
+void set_fixed_point_precision(FixedPoint *p_value, size_t num_limbs);
+
+/**
+ * Returns the number of limbs that are needed to resolve the given distance between two pixels,
+ * including guard bits for the rounding errors that accumulate during the iteration.
+ *
+ * @param pixel_spacing The distance between two neighbouring pixels in the complex plane. Must be greater than 0.
+ * @return The number of limbs. May be greater than FIXED_POINT_MAX_LIMBS.
+ */
+size_t get_fixed_point_limbs_for_spacing(double pixel_spacing);
+
+/**
+ * Adds two fixed point numbers a and b and stores the result in p_result. p_result may point to a or b.
+ *
+ * @param p_a A pointer to the first number.
+ * @param p_b A pointer to the second number.
+ * @param p_result A pointer to store the result.
+ */
+void add_fixed_point(const FixedPoint *p_a, const FixedPoint *p_b, FixedPoint *p_result);
+
+/**
+ * Subtracts the fixed point number b from a and stores the result in p_result. p_result may point to a or b.
+ *
+ * @param p_a A pointer to the minuend.
+ * @param p_b A pointer to the subtrahend.
+ * @param p_result A pointer to store the result.
+ */
+void subtract_fixed_point(const FixedPoint *p_a, const FixedPoint *p_b, FixedPoint *p_result);
+
+/**
+ * Multiplies two fixed point numbers a and b and stores the result in p_result. p_result may point to a or b.
+ * The result is truncated to the higher precision of both numbers.
+ *
+ * @param p_a A pointer to the first number.
+ * @param p_b A pointer to the second number.
+ * @param p_result A pointer to store the result.
+ */
+void multiply_fixed_point(const FixedPoint *p_a, const FixedPoint *p_b, FixedPoint *p_result);
+
+#endif  // FIXED_POINT_H
@@ -1,7 +1,9 @@
 #ifndef IMAGE_MANAGER_H
 #define IMAGE_MANAGER_H
 
+#include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 
 #include "config.h"
 
@@ -10,11 +12,42 @@ typedef struct {
     size_t height;
 } ImageSize;
 
+/**
+ * The pixels of an image, 3 bytes per pixel in the order blue, green, red.
+ * The rows are stored like in the pixel array of a BMP file: from the bottom to the top and padded to a multiple of 4 bytes,
+ * so the image data can be written to a file without reordering it. Use get_row_in_image_data to access a row.
+ */
 typedef struct {
     ImageSize size;
     unsigned char* data;
+    // The number of bytes between the starts of two consecutive rows.
+    size_t stride;
+
+    // The memory mapping of the output file if the pixels are written directly to it, or NULL if they were allocated.
+    void* p_mapping;
+    size_t mapping_size;
 } ImageData;
 
+/**
+ * The largest number of colors of indexed image data, which is the number of colors of a BMP file with 8 bits per pixel.
+ */
+#define MAX_INDEXED_COLORS 256
+
+/**
+ * The pixels of an image as indices into a table of at most MAX_INDEXED_COLORS colors, 1 byte per pixel, which takes a third
+ * of the memory of ImageData. The rows are stored like in the pixel array of a BMP file with 8 bits per pixel: from the bottom
+ * to the top and padded to a multiple of 4 bytes. Use get_row_in_indexed_image_data to access a row.
+ */
+typedef struct {
+    ImageSize size;
+    unsigned char* data;
+    // The number of bytes between the starts of two consecutive rows.
+    size_t stride;
+    // The colors of the indices: blue, green and red followed by an unused byte, like the color table of a BMP file.
+    uint32_t colors[MAX_INDEXED_COLORS];
+    size_t num_colors;
+} IndexedImageData;
+
 // Ensure the following structure is packed with 1-byte alignment to match the exact layout of the BMP file format.
 // This prevents the compiler from adding any padding between the structure members.
 #pragma pack(push, 1)
@@ -56,6 +89,61 @@ typedef struct
 // Restore the previous packing alignment to avoid affecting other parts of the code.
 #pragma pack(pop)
 
+/**
+ * Calculates the number of bytes of a row of a BMP file with 24 bits per pixel. Rows are padded to a multiple of 4 bytes.
+ *
+ * @param width The width of the image in pixels. Must not be greater than (SIZE_MAX - 3) / 3.
+ * @return The number of bytes of a row.
+ */
+size_t get_bmp_row_size(size_t width);
+
+/**
+ * Calculates the number of bytes of a BMP file with 24 bits per pixel, including its headers.
+ *
+ * @param size The size of the image in pixels. The width must not be greater than (SIZE_MAX - 3) / 3.
+ * @return The number of bytes of the file.
+ */
+uint64_t get_bmp_file_size(ImageSize size);
+
+/**
+ * Returns a pointer to the first byte of a row of the image data.
+ *
+ * @param p_image_data A pointer to the image data.
+ * @param y The y-coordinate of the row, counted from the top.
+ * @return A pointer to the first byte of the row.
+ */
+unsigned char* get_row_in_image_data(const ImageData* p_image_data, size_t y);
+
+/**
+ * Returns a pointer to the first index of a row of indexed image data.
+ *
+ * @param p_image_data A pointer to the indexed image data.
+ * @param y The y-coordinate of the row, counted from the top.
+ * @return A pointer to the first index of the row.
+ */
+unsigned char* get_row_in_indexed_image_data(const IndexedImageData* p_image_data, size_t y);
+
+/**
+ * Fills the file header and the information header of a BMP file with 24 bits per pixel.
+ *
+ * @param size The size of the image in pixels.
+ * @param p_file_header A pointer to store the file header.
+ * @param p_info_header A pointer to store the information header.
+ * @param p_file_size A pointer to store the size of the whole file in bytes.
+ * @return Status code.
+ */
+int build_bmp_header(ImageSize size, BitmapFileHeader* p_file_header, BitmapInfoHeader* p_info_header, uint64_t* p_file_size);
+
+/**
+ * Writes the file header and the information header of a BMP file with 24 bits per pixel. The pixel array follows directly after them.
+ * The size fields of the headers are set to 0 if the file is too large for them, which is allowed for uncompressed images.
+ *
+ * @param file The file to write to.
+ * @param size The size of the image in pixels.
+ * @return Status code.
+ */
+int write_bmp_header(FILE* file, ImageSize size);
+
 /**
  * Sets the pixel at the given position in the image data.
  *
@@ -67,8 +155,32 @@ typedef struct
  */
 int set_pixel_in_image_data(size_t x, size_t y, uint32_t color, ImageData* p_image_data);
 
+/**
+ * Saves the image data as a BMP file.
+ * The image data is already stored in the layout of the pixel array, so it is written with a single call.
+ *
+ * @param output_path The path of the file to save.
+ * @param p_image_data A pointer to the image data.
+ * @return Status code.
+ */
+int save_bmp(const char* output_path, const ImageData* p_image_data);
+
+/**
+ * Saves indexed image data as a BMP file with 8 bits per pixel and its colors as the color table.
+ * With RLE8 compression, every row is stored as runs of equal indices, and indices that do not repeat are stored as they are.
+ * Renders with few colors have long runs, so the file is often much smaller than the pixel array.
+ *
+ * @param output_path The path of the file to save.
+ * @param p_image_data A pointer to the indexed image data.
+ * @param rle Whether the rows are compressed with RLE8.
+ * @param p_num_bytes_written A pointer to store the size of the file in bytes.
+ * @return Status code.
+ */
+int save_indexed_bmp(const char* output_path, const IndexedImageData* p_image_data, bool rle, uint64_t* p_num_bytes_written);
+
 /**
  * Saves the image data to a file and frees the memory.
+ * Must not be used for image data that is mapped to its file, which is complete as soon as the pixels are written.
  *
  * @param p_image_data The image data to save.
  * @param output_path The path to save the image to.
@@ -76,6 +188,18 @@ int set_pixel_in_image_data(size_t x, size_t y, uint32_t color, ImageData* p_ima
  */
 int export_and_free(ImageData* p_image_data, const char* output_path);
 
+/**
+ * Maps the viewport size to the image size. The aspect ratio is kept.
+ * Calculates the image size based on the width and the viewport.
+ * It keeps the aspect ratio and calculates the height.
+ *
+ * @param viewport The viewport of the complex plane
+ * @param image_width The width of the image in pixels
+ * @param p_image_size The pointer to store the calculated image size
+ * @return Status code
+ */
+int calc_image_size(Viewport viewport, size_t image_width, ImageSize* p_image_size);
+
 /**
  * Calculates the size of the image and then allocates memory for the image data.
  * The image size is calculated based on the viewport and the width of the image so that the aspect ratio is preserved.
@@ -88,4 +212,50 @@ int export_and_free(ImageData* p_image_data, const char* output_path);
  */
 int create_image_data(Viewport viewport, size_t width, ImageData** p_p_image_data);
 
+/**
+ * Allocates memory for the image data of an image with the given size.
+ * The memory must be freed by the caller.
+ *
+ * @param size The size of the image in pixels.
+ * @param p_p_image_data A pointer to the pointer to where the image data should be stored.
+ * @return Status code.
+ */
+int create_image_data_with_size(ImageSize size, ImageData** p_p_image_data);
+
+/**
+ * Allocates memory for indexed image data of an image with the given size. The color table is empty.
+ * The image data must be freed with free_indexed_image_data.
+ *
+ * @param size The size of the image in pixels.
+ * @param p_p_image_data A pointer to the pointer to where the indexed image data should be stored.
+ * @return Status code.
+ */
+int create_indexed_image_data(ImageSize size, IndexedImageData** p_p_image_data);
+
+/**
+ * Frees the memory of indexed image data.
+ *
+ * @param p_image_data A pointer to the indexed image data.
+ */
+void free_indexed_image_data(IndexedImageData* p_image_data);
+
+/**
+ * Creates a BMP file at its final size, writes its headers and maps it into memory. The pixel array of the file becomes the image data,
+ * so the pixels are written directly to the file without another copy. If the program stops before all pixels are written,
+ * the file is still a valid BMP file. The image data must be freed with free_image_data.
+ *
+ * @param size The size of the image in pixels.
+ * @param output_path The path of the BMP file. An existing file is replaced.
+ * @param p_p_image_data A pointer to the pointer to where the image data should be stored.
+ * @return Status code.
+ */
+int create_mapped_image_data(ImageSize size, const char* output_path, ImageData** p_p_image_data);
+
+/**
+ * Frees the memory of the image data, or unmaps the file of mapped image data without saving anything else.
+ *
+ * @param p_image_data A pointer to the image data.
+ */
+void free_image_data(ImageData* p_image_data);
+
 #endif  // IMAGE_MANAGER_H
\ No newline at end of file
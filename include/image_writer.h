@@ -0,0 +1,75 @@
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "image_manager.h"
+#include "metrics.h"
+#include "thread_pool.h"
+
+/**
+ * The formats of image files. The format of a file is given by the extension of its path, see get_image_format.
+ */
+typedef enum {
+    IMAGE_FORMAT_BMP,
+    IMAGE_FORMAT_PNG,
+    // Tiled BigTIFF, see tiff_writer.h.
+    IMAGE_FORMAT_TIFF,
+    NUM_IMAGE_FORMATS
+} ImageFormat;
+
+/**
+ * The time spent saving an image file and its size.
+ */
+typedef struct {
+    // Converting the image data into the format of the file, which is 0 for BMP files. TIFF tiles are written while they are encoded,
+    // so for TIFF files this is all of the time.
+    StageTime encode_time;
+    StageTime write_time;
+    uint64_t num_bytes_written;
+} ImageFileStatistics;
+
+/**
+ * Returns the extension of the files of a format, including the dot.
+ *
+ * @param format The format.
+ * @return The extension.
+ */
+const char *get_image_format_extension(ImageFormat format);
+
+/**
+ * Finds the format of an image file by the extension of its path.
+ *
+ * @param path The path of the file.
+ * @param p_format A pointer to store the format.
+ * @return Whether the path ends with the extension of a format.
+ */
+bool get_image_format(const char *path, ImageFormat *p_format);
+
+/**
+ * Saves the image data as a PNG file with 8 bits per channel. Every row gets the filter that predicts it best, and the filtered rows
+ * are compressed into one zlib stream. The rows are cut into segments of about 256 KiB, which are filtered and compressed in parallel
+ * and then concatenated in order, like pigz does. Every segment gets the last 32 KiB of the rows before it as its dictionary,
+ * so the file is hardly larger than with a single segment. Only a few segments per thread are held in memory at once.
+ *
+ * @param output_path The path of the file to save.
+ * @param p_image_data A pointer to the image data.
+ * @param p_thread_pool The thread pool or NULL to compress the segments one after another.
+ * @param p_statistics A pointer to add the time spent and the size of the file to, or NULL.
+ * @return Status code.
+ */
+int save_png(const char *output_path, const ImageData *p_image_data, ThreadPool *p_thread_pool, ImageFileStatistics *p_statistics);
+
+/**
+ * Saves the image data in the format given by the extension of the path. Paths without a known extension are saved as BMP files.
+ *
+ * @param output_path The path of the file to save.
+ * @param p_image_data A pointer to the image data.
+ * @param p_thread_pool The thread pool or NULL. Only used for formats that are compressed.
+ * @param p_statistics A pointer to add the time spent and the size of the file to, or NULL.
+ * @return Status code.
+ */
+int save_image(const char *output_path, const ImageData *p_image_data, ThreadPool *p_thread_pool, ImageFileStatistics *p_statistics);
+
+#endif  // IMAGE_WRITER_H
@@ -3,12 +3,21 @@
 
 #include <stdint.h>
 
+#include "animation.h"
 #include "config.h"
+#include "pyramid.h"
 
+// The initial size of the line buffer. Longer lines make the buffer grow, so a line may be arbitrarily long.
 #define MAX_LINE_LENGTH 256
 
 /**
  * Parses the ini file and extracts the values for the viewport, the maximum iteration depth, the inner color, the outer colors and the number of outer colors.
+ * The viewport is either given by its corners or, in deep zoom mode, by a center with arbitrary precision and its width and height.
+ * Corners are read with more than double precision. If rounding them to doubles would move them noticeably at the width of the viewport,
+ * the configuration is turned into deep zoom mode with their center, so narrow views given by corners keep their digits.
+ * This only applies to the Mandelbrot set with power 2, the other formulas can not be rendered in deep zoom mode.
+ * Keys that are missing in the file are set to 0, except for the power of the formula, which is 2. The outer colors are allocated on the heap, so the configuration must be freed
+ * with free_configuration. If parsing fails, nothing has to be freed.
  *
  * @param path The path to the ini file.
  * @param p_config A pointer to the configuration struct to store the values.
@@ -16,6 +25,26 @@
  */
 int parse_ini_file(const char *path, Configuration *p_config);
 
+/**
+ * Parses the content of an ini file that is given as a string instead of a path, see parse_ini_file.
+ *
+ * @param text The content of the ini file. Lines are separated by line breaks.
+ * @param p_config A pointer to the configuration struct to store the values.
+ * @return Status code.
+ */
+int parse_ini_string(const char *text, Configuration *p_config);
+
+/**
+ * Parses a keyframe file. Every line that is not empty or a comment holds a keyframe: the frame number, the real and the imaginary
+ * part of the center and the width of the viewport, separated by spaces or commas. The frame numbers must increase strictly.
+ *
+ * @param path The path to the keyframe file.
+ * @param p_p_keyframes A pointer to store the keyframes. Must be freed by the caller.
+ * @param p_num_keyframes A pointer to store the number of keyframes, which is at least 1.
+ * @return Status code.
+ */
+int parse_keyframe_file(const char *path, Keyframe **p_p_keyframes, size_t *p_num_keyframes);
+
 /**
  * Parses a the image width from a string.
  *
@@ -25,4 +54,76 @@ int parse_ini_file(const char *path, Configuration *p_config);
  */
 int parse_image_width(const char *str, size_t *p_value);
 
+/**
+ * Parses the number of worker threads from a string.
+ *
+ * @param str The string to parse.
+ * @param p_value The pointer to store the parsed value.
+ * @return Status code.
+ */
+int parse_thread_count(const char *str, size_t *p_value);
+
+/**
+ * Parses a memory budget in bytes from a string. The number may be followed by one of the binary units K, M and G.
+ *
+ * @param str The string to parse.
+ * @param p_value The pointer to store the parsed value.
+ * @return Status code.
+ */
+int parse_memory_budget(const char *str, size_t *p_value);
+
+/**
+ * Parses the size limit of a tile cache in bytes from a string. The number may be followed by one of the binary units K, M and G.
+ *
+ * @param str The string to parse.
+ * @param p_value The pointer to store the parsed value.
+ * @return Status code.
+ */
+int parse_cache_size(const char *str, size_t *p_value);
+
+/**
+ * Parses the largest zoom level of a pyramid from a string. The zoom level must not be greater than PYRAMID_MAX_ZOOM_LEVEL.
+ *
+ * @param str The string to parse.
+ * @param p_value The pointer to store the parsed value.
+ * @return Status code.
+ */
+int parse_zoom_level(const char *str, size_t *p_value);
+
+/**
+ * Parses the directory layout of a pyramid from a string, which is either "xyz" or "dzi".
+ *
+ * @param str The string to parse.
+ * @param p_format The pointer to store the parsed format.
+ * @return Status code.
+ */
+int parse_pyramid_format(const char *str, PyramidFormat *p_format);
+
+/**
+ * Parses the deadline of a progressive render in seconds from a string. The deadline must be a positive number.
+ *
+ * @param str The string to parse.
+ * @param p_value The pointer to store the parsed value.
+ * @return Status code.
+ */
+int parse_deadline(const char *str, double *p_value);
+
+/**
+ * Parses the number of repetitions of the benchmark runs from a string. The number must be positive.
+ *
+ * @param str The string to parse.
+ * @param p_value The pointer to store the parsed value.
+ * @return Status code.
+ */
+int parse_repetition_count(const char *str, size_t *p_value);
+
+/**
+ * Parses the tolerance of a benchmark comparison from a percentage, e.g. "5" or "5%", and stores it as a fraction.
+ *
+ * @param str The string to parse.
+ * @param p_value The pointer to store the parsed value.
+ * @return Status code.
+ */
+int parse_tolerance(const char *str, double *p_value);
+
 #endif  // INPUT_PARSER_H
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef ITERATION_FIELD_H
+#define ITERATION_FIELD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "image_manager.h"
+
+/**
+ * The result of the compute stage of a render: the number of iterations and the magnitude of the last computed term
+ * of every pixel, row by row starting in the upper left corner. The shading stage turns the field into image data,
+ * so a field can be shaded again with other colors without iterating a single pixel.
+ *
+ * A field is either allocated with create_iteration_field or mapped from a file with load_iteration_field.
+ * In both cases it must be freed with free_iteration_field.
+ */
+typedef struct {
+    ImageSize size;
+    // The iteration depth the field was computed with. Pixels with this number of iterations are inside of the Mandelbrot set.
+    size_t iteration_depth;
+    uint32_t *iterations;
+    float *magnitudes;
+
+    // The memory mapping of a loaded field, or NULL if the buffers were allocated.
+    void *p_mapping;
+    size_t mapping_size;
+} IterationField;
+
+/**
+ * Allocates an iteration field for an image of the given size. The values of the pixels are not initialized.
+ *
+ * @param size The size of the image in pixels.
+ * @param iteration_depth The iteration depth. Must fit into the 32 bits of a stored number of iterations.
+ * @param p_field A pointer to store the field.
+ * @return Status code.
+ */
+int create_iteration_field(ImageSize size, size_t iteration_depth, IterationField *p_field);
+
+/**
+ * Frees the buffers of an iteration field or unmaps a loaded field. Does nothing for a field that is already freed.
+ *
+ * @param p_field A pointer to the field.
+ */
+void free_iteration_field(IterationField *p_field);
+
+/**
+ * Saves an iteration field to a binary file. The file consists of a header of 64 bytes, followed by the numbers of iterations
+ * as 32 bit unsigned integers and the magnitudes as 32 bit floats, both row by row in the byte order of the machine.
+ * Both arrays start at offsets that are stored in the header and are aligned to 64 bytes, so the file can be memory mapped.
+ *
+ * @param path The path of the file.
+ * @param p_field A pointer to the field.
+ * @return Status code.
+ */
+int save_iteration_field(const char *path, const IterationField *p_field);
+
+/**
+ * Maps an iteration field file that was written by save_iteration_field into memory. The file is opened read only,
+ * so the buffers of the field must not be modified.
+ *
+ * @param path The path of the file.
+ * @param p_field A pointer to store the field.
+ * @return Status code.
+ */
+int load_iteration_field(const char *path, IterationField *p_field);
+
+#endif  // ITERATION_FIELD_H
@@ -0,0 +1,166 @@
+#ifndef ITERATION_KERNEL_H
+#define ITERATION_KERNEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "config.h"
+#include "double_double.h"
+
+/**
+ * The escape radius for the Mandelbrot function.
+ * If the magnitude of a term of the mandelbrot sequence is greater than the escape radius, the sequence is considered to be unbounded.
+ * It is proven that an escape radius of 2 is sufficient.
+ */
+#define ESCAPE_RADIUS 2
+
+/**
+ * Flags for the shortcuts that detect points inside of the Mandelbrot set without iterating them up to the iteration depth.
+ * The periodicity check never changes the result. The analytic checks can only change the result of points
+ * within rounding distance of the boundary of the cardioid or the bulb.
+ */
+// Points inside of the main cardioid are detected analytically.
+#define INTERIOR_CHECK_CARDIOID 0x1
+// Points inside of the period-2 bulb left of the main cardioid are detected analytically.
+#define INTERIOR_CHECK_BULB 0x2
+// The iteration stops when the sequence repeats a term exactly (Brent's cycle detection).
+// A sequence of doubles that repeats a term is periodic and never escapes.
+#define INTERIOR_CHECK_PERIODICITY 0x4
+#define INTERIOR_CHECK_ALL (INTERIOR_CHECK_CARDIOID | INTERIOR_CHECK_BULB | INTERIOR_CHECK_PERIODICITY)
+
+/**
+ * The largest iteration depth of the single precision kernels, which count the iterations in floats.
+ */
+#define FLOAT_MAX_ITERATION_DEPTH ((size_t)1 << 24)
+
+/**
+ * Iterates the function of a formula for a batch of points. For the Mandelbrot set, the points are c:
+ * z_0 = 0, z_1 = z_0^2 + c = c, z_2 = z_1^2 + c, ...
+ * Every kernel is compiled for a fixed formula and power, see Formula.
+ * For every point, the number of iterations for which the Mandelbrot function remained within the ESCAPE_RADIUS is stored in p_iterations.
+ * For example, if |z_5| <= 2 but |z_6| > ESCAPE_RADIUS, the number of iterations is 5. Because of z_0 = 0, the minimum value is 0.
+ * If the algorithm reaches z_{iteration_depth} and |z_{iteration_depth}| <= ESCAPE_RADIUS, the number of iterations is iteration_depth.
+ *
+ * @param c_real The real parts of the points.
+ * @param c_imag The imaginary parts of the points.
+ * @param count The number of points.
+ * @param iteration_depth The maximum number of iterations. Must be greater than 0.
+ * @param periodicity_check Whether the iteration of a point stops as soon as its sequence is periodic.
+ * @param julia_c The constant c of the Julia set. Unused by the other formulas.
+ * @param p_iterations A pointer to an array of count elements to store the number of iterations.
+ * @param p_magnitudes A pointer to an array of count elements to store the magnitude of the last computed term,
+ *                     which is the first term outside of the ESCAPE_RADIUS for points that escaped. Used for smooth coloring.
+ */
+typedef void (*IterationKernel)(const double *c_real, const double *c_imag, size_t count, size_t iteration_depth, bool periodicity_check, Complex julia_c,
+                                size_t *p_iterations, double *p_magnitudes);
+
+/**
+ * Iterates the Mandelbrot function with power 2 for a batch of points c in double-double precision. See IterationKernel.
+ */
+typedef void (*DoubleDoubleKernel)(const DoubleDouble *c_real, const DoubleDouble *c_imag, size_t count, size_t iteration_depth, bool periodicity_check,
+                                   size_t *p_iterations, double *p_magnitudes);
+
+/**
+ * Selects the fastest iteration kernels that are supported by the processor. All variants are part of the build:
+ * AVX-512 (8 points at once in double precision), AVX2 (4 points), SSE2 (2 points) and a portable scalar kernel.
+ * Every variant exists for floats, which iterate twice as many points at once, for doubles and for double-doubles.
+ * The float and double variants exist for every formula and power up to MAX_FORMULA_POWER.
+ * The kernels of all number types are generated from the same code, so they only differ in the arithmetic.
+ * Must be called once at startup, before any thread calls iterate_points. Until then, the scalar kernel is used.
+ */
+void select_iteration_kernel(void);
+
+/**
+ * Returns the name of the selected iteration kernel.
+ *
+ * @return The name of the kernel.
+ */
+const char *get_iteration_kernel_name(void);
+
+/**
+ * Checks whether a configuration shows the Mandelbrot set with power 2. Only this formula can be rendered in deep zoom mode,
+ * with double-doubles and with the analytic interior checks.
+ *
+ * @param p_config A pointer to the configuration.
+ * @return True if the formula is FORMULA_MANDELBROT with power 2.
+ */
+bool is_quadratic_mandelbrot(const Configuration *p_config);
+
+/**
+ * Chooses the cheapest number type that tells neighboring pixels apart, with some guard bits for the rounding errors of the iteration.
+ * Floats resolve pixel spacings down to about 5e-4, which is an image of the whole set with 6000 pixels per row, doubles down to about 1e-12
+ * and double-doubles down to about 1e-28. Deeper views need perturbation.
+ *
+ * @param magnitude The largest magnitude of the real and imaginary parts of the pixels. The terms of the sequences reach the ESCAPE_RADIUS,
+ *                  so smaller magnitudes count as the ESCAPE_RADIUS.
+ * @param pixel_spacing The distance between two neighboring pixels. Must be greater than 0.
+ * @param iteration_depth The iteration depth. Floats are only chosen up to FLOAT_MAX_ITERATION_DEPTH.
+ * @param perturbation Whether the view can be rendered with perturbation. Otherwise, double-double is the most precise type.
+ * @return The precision. Never PRECISION_AUTO.
+ */
+Precision get_precision_for_spacing(double magnitude, double pixel_spacing, size_t iteration_depth, bool perturbation);
+
+/**
+ * Selects the number type of a render. PRECISION_AUTO is resolved with get_precision_for_spacing, other precisions are checked
+ * against it, so a number type that is too coarse for the pixel spacing is not used.
+ * Formulas other than the Mandelbrot set with power 2 are iterated in double precision at most, so deeper views of them are rejected.
+ *
+ * @param p_config A pointer to the configuration.
+ * @param width The number of pixels per row. Supersampled renders pass the number of samples per row.
+ * @param p_precision A pointer to store the precision. Never PRECISION_AUTO.
+ * @return Status code. ERROR_INCOMPATIBLE_OPTIONS if floats are requested for an iteration depth above FLOAT_MAX_ITERATION_DEPTH,
+ *         perturbation outside of deep zoom mode, or double-doubles or perturbation for another formula.
+ *         ERROR_ZOOM_TOO_DEEP if the requested precision, or double precision for another formula, can not resolve the pixel spacing.
+ */
+int select_precision(const Configuration *p_config, size_t width, Precision *p_precision);
+
+/**
+ * Returns the name of a precision as it is written in a configuration file.
+ *
+ * @param precision The precision.
+ * @return The name of the precision.
+ */
+const char *get_precision_name(Precision precision);
+
+/**
+ * Returns the name of a formula as it is written in a configuration file.
+ *
+ * @param formula The formula.
+ * @return The name of the formula.
+ */
+const char *get_formula_name(Formula formula);
+
+/**
+ * Iterates the formula of a configuration for a batch of points with the selected kernel. See IterationKernel.
+ * Points that are detected by the enabled analytic interior checks are not iterated at all. These checks only apply to the Mandelbrot set with power 2.
+ * Every kernel of a precision computes bit-identical results, so the image does not depend on the processor.
+ *
+ * @param c_real The real parts of the points.
+ * @param c_imag The imaginary parts of the points.
+ * @param count The number of points.
+ * @param p_config A pointer to the configuration with the formula, its power, the iteration depth and the enabled interior checks.
+ *                 The iteration depth must be greater than 0, and not greater than FLOAT_MAX_ITERATION_DEPTH for floats.
+ * @param precision PRECISION_FLOAT to round the points to floats and iterate them in single precision, otherwise they are iterated in double precision.
+ * @param p_iterations A pointer to an array of count elements to store the number of iterations.
+ * @param p_magnitudes A pointer to an array of count elements to store the magnitude of the last computed term.
+ *                     Is 0 for points that are detected by the analytic interior checks.
+ */
+void iterate_points(const double *c_real, const double *c_imag, size_t count, const Configuration *p_config, Precision precision, size_t *p_iterations,
+                    double *p_magnitudes);
+
+/**
+ * Iterates the Mandelbrot function with power 2 for a batch of points in double-double precision with the selected kernel. See IterationKernel.
+ * The analytic interior checks are skipped, because the views that need double-doubles are far smaller than the rounding errors
+ * of the checks in double precision. The periodicity check compares both parts of the terms.
+ *
+ * @param c_real The real parts of the points.
+ * @param c_imag The imaginary parts of the points.
+ * @param count The number of points.
+ * @param p_config A pointer to the configuration with the iteration depth and the enabled interior checks. Only INTERIOR_CHECK_PERIODICITY is used.
+ * @param p_iterations A pointer to an array of count elements to store the number of iterations.
+ * @param p_magnitudes A pointer to an array of count elements to store the magnitude of the last computed term.
+ */
+void iterate_double_double_points(const DoubleDouble *c_real, const DoubleDouble *c_imag, size_t count, const Configuration *p_config, size_t *p_iterations,
+                                  double *p_magnitudes);
+
+#endif  // ITERATION_KERNEL_H
@@ -0,0 +1,35 @@
+#ifndef LOG_POLAR_H
+#define LOG_POLAR_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "animation.h"
+#include "config.h"
+#include "renderer.h"
+#include "thread_pool.h"
+
+/**
+ * Renders a zoom into a fixed point from a single exponential map around it, instead of rendering every frame, see LogPolarMap.
+ * The map reaches from the corners of the widest frame down to half a pixel of the narrowest frame, and its columns are as dense
+ * as the pixels in the corners of the frames, so no frame is undersampled. After the map is computed and shaded, every frame is
+ * resampled from it with bilinear interpolation and saved as <output_prefix>_<frame>.bmp, like by render_animation.
+ * With a frame stream, the frames are resampled in batches of one frame per thread and written to it in order as a YUV4MPEG2 stream.
+ * For square frames, the map costs about as much as pi * ln(1.4 * width * zoom factor) frames, so it pays off for zooms with many frames.
+ * The pixels of the frames are interpolated, so they are not exactly the ones of a direct render.
+ *
+ * @param config The configuration struct. Its viewport is only used for the aspect ratio, deep zoom is not supported.
+ * @param p_thread_pool The thread pool to compute the map and the frames with, or NULL to compute them on the calling thread.
+ * @param keyframes The keyframes, sorted by strictly increasing frame numbers. All keyframes must have the same center.
+ * @param num_keyframes The number of keyframes. Must be at least 1.
+ * @param size The size of every frame in pixels.
+ * @param output_prefix The path of the frames without the frame number and the extension. Unused with a frame stream.
+ * @param frame_stream The stream to write the frames to, or NULL to save them as BMP files.
+ * @param progress_callback A callback function to output the progress, or NULL. It is always called on the calling thread.
+ * @param p_statistics A pointer to store statistics about the computation of the map, or NULL.
+ * @return Status code.
+ */
+int render_log_polar_zoom(Configuration config, ThreadPool *p_thread_pool, const Keyframe *keyframes, size_t num_keyframes, ImageSize size,
+                          const char *output_prefix, FILE *frame_stream, void (*progress_callback)(double), RenderStatistics *p_statistics);
+
+#endif  // LOG_POLAR_H
@@ -0,0 +1,153 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "image_manager.h"
+#include "iteration_field.h"
+
+/**
+ * The stages of rendering an image on the command line, in the order they run.
+ * Parse reads the command line, the configuration and the width. Allocate creates the image data, the iteration field and the thread pool.
+ * Compute iterates the pixels, including the extra samples of supersampling. Shade turns the iteration field into colors.
+ * Encode converts the image data into the format of the file, and write stores the file.
+ */
+typedef enum {
+    STAGE_PARSE,
+    STAGE_ALLOCATE,
+    STAGE_COMPUTE,
+    STAGE_SHADE,
+    STAGE_ENCODE,
+    STAGE_WRITE,
+    NUM_STAGES
+} Stage;
+
+/**
+ * The time spent in a stage. The wall time is measured with a monotonic clock, so it does not jump when the system time is changed.
+ * The CPU time is the time of all threads of the process, so it is larger than the wall time if the stage ran on several threads.
+ */
+typedef struct {
+    double wall_time;
+    double cpu_time;
+} StageTime;
+
+/**
+ * The start of a measurement of a stage, see start_stage_clock.
+ */
+typedef struct {
+    double wall_start;
+    double cpu_start;
+} StageClock;
+
+/**
+ * The number of bins of an iteration histogram. Bin 0 counts the pixels with 0 or 1 iterations,
+ * and bin k > 0 counts the pixels with 2^k to 2^(k + 1) - 1 iterations, so every number of iterations of an iteration field has a bin.
+ */
+#define ITERATION_HISTOGRAM_SIZE 32
+
+/**
+ * The distribution of the numbers of iterations of the pixels of an image.
+ */
+typedef struct {
+    size_t num_pixels;
+    // The sum of the numbers of iterations of all pixels, where pixels inside of the set count with the iteration depth.
+    uint64_t num_iterations;
+    // The number of pixels inside of the set. They are not counted in the bins.
+    size_t num_interior_pixels;
+    size_t bins[ITERATION_HISTOGRAM_SIZE];
+} IterationHistogram;
+
+/**
+ * The metrics of rendering an image on the command line, see save_render_metrics.
+ */
+typedef struct {
+    StageTime stages[NUM_STAGES];
+    IterationHistogram histogram;
+    // The number of bytes of the image file.
+    uint64_t num_bytes_written;
+} RenderMetrics;
+
+/**
+ * Returns the time of a monotonic clock.
+ *
+ * @return The time in seconds since an arbitrary point in the past.
+ */
+double get_monotonic_time(void);
+
+/**
+ * Returns the CPU time the process has used.
+ *
+ * @return The sum of the user and system time of all threads of the process in seconds.
+ */
+double get_process_cpu_time(void);
+
+/**
+ * Returns the CPU time the calling thread has used.
+ *
+ * @return The sum of the user and system time of the calling thread in seconds.
+ */
+double get_thread_cpu_time(void);
+
+/**
+ * Starts measuring a stage.
+ *
+ * @param p_clock A pointer to store the start of the measurement.
+ */
+void start_stage_clock(StageClock *p_clock);
+
+/**
+ * Adds the time since the start of a measurement to the time of a stage, so a stage can be measured in several parts.
+ *
+ * @param p_clock A pointer to the start of the measurement.
+ * @param p_time A pointer to the time of the stage.
+ */
+void stop_stage_clock(const StageClock *p_clock, StageTime *p_time);
+
+/**
+ * Adds the time of a stage to another time.
+ *
+ * @param p_sum A pointer to the time to add to.
+ * @param p_time A pointer to the time to add.
+ */
+void add_stage_time(StageTime *p_sum, const StageTime *p_time);
+
+/**
+ * Returns the name of a stage as used in the JSON file of save_render_metrics.
+ *
+ * @param stage The stage.
+ * @return The name of the stage.
+ */
+const char *get_stage_name(Stage stage);
+
+/**
+ * Counts the pixels of an iteration field in a histogram.
+ *
+ * @param p_field A pointer to the iteration field.
+ * @param p_histogram A pointer to the histogram to add the pixels to.
+ */
+void add_field_to_iteration_histogram(const IterationField *p_field, IterationHistogram *p_histogram);
+
+/**
+ * Adds the pixels of a histogram to another histogram.
+ *
+ * @param p_sum A pointer to the histogram to add to.
+ * @param p_histogram A pointer to the histogram to add.
+ */
+void add_iteration_histogram(IterationHistogram *p_sum, const IterationHistogram *p_histogram);
+
+/**
+ * Saves the metrics of a render as a JSON file, so they can be collected by monitoring tools.
+ * The file contains the size of the image, the number of threads, the wall and CPU time of every stage, the number of iterations,
+ * the fraction of pixels inside of the set, the iteration histogram and the number of bytes written.
+ *
+ * @param path The path of the JSON file.
+ * @param output_path The path of the image file.
+ * @param size The size of the image in pixels.
+ * @param num_threads The number of threads the image was rendered with.
+ * @param p_metrics A pointer to the metrics.
+ * @return Status code.
+ */
+int save_render_metrics(const char *path, const char *output_path, ImageSize size, size_t num_threads, const RenderMetrics *p_metrics);
+
+#endif  // METRICS_H
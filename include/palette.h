@@ -0,0 +1,61 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+
+/**
+ * A palette compiled for a fixed iteration depth. It maps the number of iterations of a pixel to its color with a single lookup.
+ *
+ * The lookup table samples the gradient of outer colors at num_entries evenly spaced positions between 0 and iteration_depth - 1
+ * iterations. For integer coloring, there is one entry per number of iterations unless the iteration depth exceeds MAX_PALETTE_ENTRIES.
+ * For smooth coloring, there are SMOOTH_PALETTE_STEPS entries per iteration, so fractional numbers of iterations get their own colors.
+ * The entry after the last one holds the inner color.
+ *
+ * Every entry holds blue, green and red in the byte order of the image data, followed by an unused byte,
+ * so the first three bytes of an entry can be copied to the image directly.
+ */
+typedef struct {
+    uint32_t *entries;
+    size_t num_entries;
+    size_t iteration_depth;
+    bool smooth;
+    // The number of entries per iteration. Is exactly 1 if the table has one entry per number of iterations.
+    double entries_per_iteration;
+    // 1 / log2 of the power of the formula, which scales the fractional part of smooth coloring to one iteration. Is exactly 1 for power 2.
+    float smooth_scale;
+} Palette;
+
+/**
+ * The maximum number of entries of a lookup table, which limits its size to 4 MiB.
+ */
+#define MAX_PALETTE_ENTRIES ((size_t)1 << 20)
+
+/**
+ * The number of entries per iteration for smooth coloring.
+ */
+#define SMOOTH_PALETTE_STEPS 16
+
+/**
+ * Compiles the colors of a configuration into a palette for the given iteration depth.
+ * The colors of the entries are the same as if the gradient was evaluated for every pixel on its own.
+ * The palette must be freed with free_palette.
+ *
+ * @param p_config A pointer to the configuration with the inner color, the outer colors and the coloring mode.
+ * @param iteration_depth The iteration depth of the pixels that are shaded with the palette.
+ * @param p_palette A pointer to store the palette.
+ * @return Status code.
+ */
+int compile_palette(const Configuration *p_config, size_t iteration_depth, Palette *p_palette);
+
+/**
+ * Frees the lookup table of a palette.
+ *
+ * @param p_palette A pointer to the palette.
+ */
+void free_palette(Palette *p_palette);
+
+#endif  // PALETTE_H
@@ -0,0 +1,59 @@
+#ifndef PERTURBATION_H
+#define PERTURBATION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "fixed_point.h"
+
+/**
+ * The orbit Z_0 = 0, Z_1, Z_2, ... of a reference point C. The orbit is computed with fixed point precision,
+ * but the terms are stored as doubles. This is sufficient, because the pixels only iterate their difference to the orbit.
+ */
+typedef struct {
+    double *z_real;
+    double *z_imag;
+    // The number of stored terms. Is iteration_depth + 1 if the reference point did not escape.
+    size_t length;
+} ReferenceOrbit;
+
+/**
+ * Computes the reference orbit of the point C = c_real + c_imag * i with the precision of c_real and c_imag.
+ * The orbit ends after iteration_depth iterations or after the first term outside of the ESCAPE_RADIUS.
+ * The orbit must be freed with free_reference_orbit.
+ *
+ * @param p_c_real A pointer to the real part of the reference point.
+ * @param p_c_imag A pointer to the imaginary part of the reference point.
+ * @param iteration_depth The maximum number of iterations.
+ * @param p_orbit A pointer to store the orbit.
+ * @return Status code.
+ */
+int compute_reference_orbit(const FixedPoint *p_c_real, const FixedPoint *p_c_imag, size_t iteration_depth, ReferenceOrbit *p_orbit);
+
+/**
+ * Frees the memory of a reference orbit.
+ *
+ * @param p_orbit A pointer to the orbit.
+ */
+void free_reference_orbit(ReferenceOrbit *p_orbit);
+
+/**
+ * Iterates the Mandelbrot function for the point C + dc, where C is the reference point of the orbit.
+ * Only the difference d_n = z_n - Z_n is iterated in double precision: d_{n+1} = 2 * Z_n * d_n + d_n^2 + dc.
+ * The number of iterations has the same meaning as for IterationKernel.
+ *
+ * The result is unreliable (a glitch) if |z_n| becomes much smaller than |Z_n|, because d_n then loses all significant bits,
+ * or if the reference orbit escaped before the point. In these cases, p_glitched is set to true and the point must be iterated
+ * again with another reference point.
+ *
+ * @param p_orbit A pointer to the reference orbit.
+ * @param dc_real The real part of the difference to the reference point.
+ * @param dc_imag The imaginary part of the difference to the reference point.
+ * @param iteration_depth The maximum number of iterations.
+ * @param p_magnitude A pointer to store the magnitude of the last computed term |Z_n + d_n|.
+ * @param p_glitched A pointer to store whether the result is a glitch.
+ * @return The number of iterations for which the Mandelbrot function remained within the ESCAPE_RADIUS.
+ */
+size_t iterate_perturbed_point(const ReferenceOrbit *p_orbit, double dc_real, double dc_imag, size_t iteration_depth, double *p_magnitude, bool *p_glitched);
+
+#endif  // PERTURBATION_H
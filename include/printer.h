@@ -1,23 +1,42 @@
 #ifndef PRINTER_H
 #define PRINTER_H
 
+#include "benchmark.h"
 #include "image_manager.h"
 #include "input_parser.h"
+#include "metrics.h"
+#include "renderer.h"
 
 #define PROGRESS_BAR_WIDTH 20
 #define PROGRESS_STEP 0.05
 
 /**
  * Prints information about the image building process to the console.
- * That includes the config path, the output path, the image size, the maximum number of iterations, the viewport, the inner color, the gradient, the gradient length and the build time.
+ * That includes the config path, the output path, the image size, the maximum number of iterations, the viewport, the inner color, the gradient, the gradient length,
+ * the number of threads, the render statistics, the number of iterations, the fraction of interior pixels, the time of every stage
+ * and the number of bytes written.
  *
  * @param config_path The path to the configuration file.
  * @param output_path The path to the output file.
  * @param size The size of the image in pixels.
  * @param config The configuration struct.
- * @param build_time The time it took to build the image.
+ * @param num_threads The number of threads the image was built with.
+ * @param p_statistics A pointer to the statistics of the render.
+ * @param p_metrics A pointer to the metrics of the render.
  */
-void print_info(const char *config_path, const char *output_path, ImageSize size, Configuration config, double build_time);
+void print_info(const char *config_path, const char *output_path, ImageSize size, Configuration config, size_t num_threads, const RenderStatistics *p_statistics, const RenderMetrics *p_metrics);
+
+/**
+ * Prints the results of a benchmark as a table. If a baseline is given, the change of the wall time of every run is printed as well,
+ * and runs that are slower than their baseline by more than the tolerance are marked as regressions.
+ *
+ * @param results The results.
+ * @param num_results The number of results.
+ * @param baseline The results of the baseline, or NULL.
+ * @param num_baseline_results The number of results of the baseline.
+ * @param tolerance The tolerated slowdown as a fraction of the wall time of the baseline.
+ */
+void print_benchmark_results(const BenchmarkResult *results, size_t num_results, const BenchmarkResult *baseline, size_t num_baseline_results, double tolerance);
 
 /**
  * Prints a progress bar to the console. The progress bar is a horizontal bar that shows the progress of a process.
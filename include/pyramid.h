@@ -0,0 +1,65 @@
+#ifndef PYRAMID_H
+#define PYRAMID_H
+
+#include <stddef.h>
+#include <time.h>
+
+#include "config.h"
+#include "thread_pool.h"
+
+/**
+ * The edge length of the square tiles of a pyramid in pixels.
+ */
+#define PYRAMID_TILE_SIZE 256
+
+/**
+ * The largest zoom level of a pyramid. The image of the largest zoom level is PYRAMID_TILE_SIZE * 2^zoom pixels wide,
+ * which must fit into the 32 bit width of a BMP file.
+ */
+#define PYRAMID_MAX_ZOOM_LEVEL 22
+
+/**
+ * The directory layout of the tiles of a pyramid.
+ */
+typedef enum {
+    // <output>/<z>/<x>/<y>.bmp, the layout of web map tiles. Level z is 2^z tiles wide, every tile is complete.
+    PYRAMID_FORMAT_XYZ,
+    // <output>.dzi and <output>_files/<level>/<column>_<row>.bmp, the layout of Deep Zoom images. The levels go down
+    // to a single pixel and the tiles at the right and bottom border of a level are cropped to the image.
+    PYRAMID_FORMAT_DZI
+} PyramidFormat;
+
+/**
+ * Statistics about a pyramid.
+ */
+typedef struct {
+    // The number of tiles whose pixels were iterated.
+    size_t num_rendered_tiles;
+    // The number of tiles that were built from the iteration fields of the tiles of the next zoom level.
+    size_t num_downsampled_tiles;
+    // The number of tiles that were up to date and not built again.
+    size_t num_skipped_tiles;
+} PyramidStatistics;
+
+/**
+ * Renders the viewport of a configuration into a pyramid of tiles for every zoom level from 0 to max_zoom_level.
+ * The pixel spacing halves from one level to the next, so every pixel of a level is at the same point as a pixel of the next level.
+ * The tiles of the largest level are iterated, tiles of smaller levels take every second pixel of the iteration fields
+ * of the four tiles below them. Only if one of these tiles was skipped, the tile is iterated itself.
+ * Tile files that are newer than source_time are up to date and skipped.
+ * The tiles of the largest zoom levels are built in parallel, every worker builds a whole subtree of tiles.
+ *
+ * @param config The configuration struct.
+ * @param p_thread_pool The thread pool to build the tiles with, or NULL to build them on the calling thread.
+ * @param max_zoom_level The largest zoom level. Must not be greater than PYRAMID_MAX_ZOOM_LEVEL.
+ * @param format The directory layout of the tiles.
+ * @param output_path The directory of the tiles, or the path of the descriptor file without extension for Deep Zoom images.
+ * @param source_time The time of the last modification of the configuration. Tiles that were written later are up to date.
+ * @param progress_callback A callback function to output the progress. It is always called on the calling thread.
+ * @param p_statistics A pointer to store statistics about the pyramid, or NULL.
+ * @return Status code.
+ */
+int render_pyramid(Configuration config, ThreadPool *p_thread_pool, size_t max_zoom_level, PyramidFormat format, const char *output_path,
+                   time_t source_time, void (*progress_callback)(double), PyramidStatistics *p_statistics);
+
+#endif  // PYRAMID_H
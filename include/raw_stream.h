@@ -0,0 +1,68 @@
+#ifndef RAW_STREAM_H
+#define RAW_STREAM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "image_manager.h"
+
+/**
+ * The output path that writes the image to the standard output instead of a file, so it can be piped into an encoder.
+ */
+#define STDOUT_PATH "-"
+
+/**
+ * The frame rate written to the header of a YUV4MPEG2 stream. Encoders can override it, like ffmpeg with -framerate before -i.
+ */
+#define Y4M_FRAME_RATE 30
+
+/**
+ * Returns whether an output path stands for the standard output, see STDOUT_PATH.
+ *
+ * @param path The output path.
+ * @return Whether the path is STDOUT_PATH.
+ */
+bool is_stdout_path(const char *path);
+
+/**
+ * Opens a stream to the standard output for binary image data and redirects everything else that is printed to the standard output,
+ * like the progress bar and the render info, to the standard error, so it does not end up in the image data.
+ * The stream is fully buffered with a large buffer. Must be called before any worker thread prints.
+ *
+ * @param p_stream A pointer to store the stream. It must be closed with fclose.
+ * @return Status code.
+ */
+int open_stdout_stream(FILE **p_stream);
+
+/**
+ * Writes the image data as a binary PPM image (P6), which is read by ffmpeg and most image tools without any options.
+ * The rows are converted to red, green, blue from the top to the bottom in chunks of about 1 MiB.
+ *
+ * @param stream The stream to write to.
+ * @param p_image_data A pointer to the image data.
+ * @param p_num_bytes_written A pointer to store the number of bytes written, or NULL.
+ * @return Status code.
+ */
+int write_ppm(FILE *stream, const ImageData *p_image_data, uint64_t *p_num_bytes_written);
+
+/**
+ * Writes the header of a YUV4MPEG2 stream of frames of the given size, see write_y4m_frame.
+ *
+ * @param stream The stream to write to.
+ * @param size The size of every frame in pixels.
+ * @return Status code.
+ */
+int write_y4m_header(FILE *stream, ImageSize size);
+
+/**
+ * Writes the image data as the next frame of a YUV4MPEG2 stream. The pixels are converted to limited range BT.601 YCbCr
+ * with 4:2:0 chroma subsampling, the input format of most video encoders. The chroma of every 2 x 2 block is the mean of its pixels.
+ *
+ * @param stream The stream to write to.
+ * @param p_image_data A pointer to the image data of the frame. It must have the size given to write_y4m_header.
+ * @return Status code.
+ */
+int write_y4m_frame(FILE *stream, const ImageData *p_image_data);
+
+#endif  // RAW_STREAM_H
@@ -0,0 +1,47 @@
+#ifndef RENDER_DAEMON_H
+#define RENDER_DAEMON_H
+
+#include "connection.h"
+#include "renderer.h"
+#include "thread_pool.h"
+
+/**
+ * The number of rows of a band of a daemon job. Jobs are rendered band by band, so a running job can be cancelled
+ * after every band and its progress can be polled. Bands are a multiple of TILE_SIZE high, so they are rendered exactly like the whole image.
+ */
+#define DAEMON_BAND_HEIGHT (4 * TILE_SIZE)
+
+/**
+ * The number of image buffers that are kept for the next jobs after their jobs are done.
+ */
+#define DAEMON_MAX_POOLED_IMAGES 8
+
+/**
+ * The number of finished jobs that are kept for status requests. When more jobs are finished, the oldest ones are forgotten.
+ */
+#define DAEMON_MAX_FINISHED_JOBS 1024
+
+/**
+ * Serves render jobs until a client sends the SHUTDOWN command. The daemon avoids the overhead of starting a process for every render:
+ * the thread pool is created once, and the image buffers of finished jobs are reused by the next jobs of the same or a smaller size.
+ * Jobs are rendered one after another on the whole thread pool, the job with the highest priority first and jobs with the same priority
+ * in the order they were submitted. Every client connection is served by its own thread, so a client can wait for a result while
+ * other clients submit jobs.
+ *
+ * A client sends commands as lines of text and gets a line as the answer to every command, which is "ERROR <message>" if it fails:
+ * - RENDER <priority> <image_width> <output_path>, followed by the lines of a configuration file and a line "END". The output path is
+ *   "-" to keep the image in memory until it is fetched with RESULT. Paths ending with .png are saved as PNG files, all others as BMP files.
+ *   Answer: "OK <job_id>".
+ * - STATUS <job_id>. Answer: "QUEUED", "RUNNING <percent>", "DONE", "CANCELLED" or "FAILED <message>".
+ * - CANCEL <job_id>. Cancels a queued job, or a running job after its current band. Answer: "OK".
+ * - RESULT <job_id>. Waits until the job is finished. Answer: "DONE <output_path>", or "DATA <size>" followed by the bytes of the
+ *   BMP file if the image was kept in memory. Such a job is forgotten afterwards. Cancelled and failed jobs are answered like by STATUS.
+ * - SHUTDOWN. Cancels all jobs and stops the daemon. Answer: "OK".
+ *
+ * @param p_listener A pointer to the listener to accept the clients from.
+ * @param p_thread_pool The thread pool to render the jobs with, or NULL to render them on a single thread.
+ * @return Status code.
+ */
+int run_render_daemon(Listener *p_listener, ThreadPool *p_thread_pool);
+
+#endif  // RENDER_DAEMON_H
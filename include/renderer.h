@@ -2,20 +2,229 @@
 #ifndef RENDERER_H
 #define RENDERER_H
 
+#include <stdint.h>
+
 #include "config.h"
 #include "image_manager.h"
+#include "iteration_field.h"
+#include "metrics.h"
+#include "thread_pool.h"
+#include "tile_cache.h"
+
+/**
+ * The edge length of the square tiles the image is divided into, in pixels.
+ * Every tile is rendered as one task, so the tiles must be small enough to balance the load between the threads
+ * but large enough to keep the scheduling overhead low.
+ */
+#define TILE_SIZE 64
 
 /**
- * Builds the image data. The function iterates over all pixels and calculates
- * the color for each pixel. The color is determined by the number of iterations
- * needed to escape the ESCAPE_RADIUS. The color is then stored in the image data.
- * The memory for p_image_data must be allocated before calling this function. The function does not free the memory.
+ * A grid of pixels in the complex plane. Pixel (x, y) of an image on the grid lies exactly on the point
+ * ((grid.x + x) * spacing, -(grid.y + y) * spacing), so images on the same grid share the points of their overlapping pixels.
+ */
+typedef struct {
+    // The position of the upper left pixel of the image on the grid.
+    int64_t x;
+    int64_t y;
+    // The distance between two neighboring pixels.
+    double spacing;
+} PixelGrid;
+
+/**
+ * An exponential map of the complex plane around a center. Column x of a field with this map lies at the angle x * step,
+ * counterclockwise from the positive real axis, and row y lies at the radius exp(log_max_radius - y * step).
+ * So the pixels are approximately square, the columns cover a full circle if the width of the field is 2 * pi / step,
+ * and every row zooms in by the same factor exp(step).
+ */
+typedef struct {
+    Complex center;
+    // The natural logarithm of the radius of the first row.
+    double log_max_radius;
+    // The angle between two neighboring columns, which is also the difference of the logarithms of the radii of two neighboring rows.
+    double step;
+} LogPolarMap;
+
+/**
+ * Statistics about a render.
+ */
+typedef struct {
+    // The number of pixels whose number of iterations was computed. In subdivision mode, the other pixels were filled.
+    // Pixels that are iterated again relative to another reference orbit in deep zoom mode are only counted once.
+    size_t num_iterated_pixels;
+    // The number of pixels that were copied from the previous animation frame.
+    size_t num_reused_pixels;
+    // The number of tiles that were loaded from the tile cache and the number of tiles that had to be computed, if a cache was used.
+    size_t num_cache_hits;
+    size_t num_cache_misses;
+    // The number of tiles of a progressive render that were skipped because the deadline had passed.
+    size_t num_skipped_tiles;
+    // The number of pixels at edges that were supersampled, and the number of samples that were iterated for them in addition to the pixels.
+    size_t num_supersampled_pixels;
+    size_t num_extra_samples;
+    // The distribution of the numbers of iterations of the rendered image. Fields that are only computed, like animation frames, are not counted.
+    IterationHistogram histogram;
+    // The time of the compute and shading stages. Supersampling counts as computing, because most of its time is spent iterating samples.
+    StageTime compute_time;
+    StageTime shade_time;
+    // The time spent writing the image file and the number of bytes written, if the render writes the file itself while it renders.
+    StageTime write_time;
+    uint64_t num_bytes_written;
+} RenderStatistics;
+
+/**
+ * The step of the first pass of a progressive render. Every pass halves the step until it is 1.
+ */
+#define PROGRESSIVE_FIRST_STEP 8
+
+/**
+ * Receives the image after every pass of a progressive render, see render_progressive.
+ *
+ * @param p_image_data A pointer to the image data of the whole image.
+ * @param step The step of the pass. Every step-th pixel in both directions has been computed, unless the deadline passed during the pass.
+ * @param p_context The context that was given to render_progressive.
+ */
+typedef void (*ProgressiveFrameCallback)(const ImageData *p_image_data, size_t step, void *p_context);
+
+/**
+ * Builds the image data in two stages. The compute stage divides the image into tiles and stores the number of iterations needed
+ * to escape the ESCAPE_RADIUS and the magnitude of the last term of every pixel in the iteration field. The iterations are computed
+ * row by row with the selected iteration kernel. The shading stage then calculates the color of every pixel from the field.
+ * The field can be saved afterwards to shade it again with other colors, see shade_iteration_field.
+ * In subdivision mode, only a part of the pixels of a tile is iterated, see RenderMode.
+ * If a thread pool is given, the tiles are rendered in parallel. The result does not depend on the number of threads.
+ * If a tile cache is given, the pixels are snapped to the pixel grid of the viewport, see get_pixel_grid, and the tiles are aligned to the grid.
+ * Tiles that were computed by an earlier render on the same grid are loaded from the cache instead.
+ * The memory for p_field and p_image_data must be allocated before calling this function. The function does not free the memory.
  *
  * @param config The configuration struct.
+ * @param p_thread_pool The thread pool to render the tiles with, or NULL to render on the calling thread.
+ * @param p_tile_cache The cache to load and store the tiles, or NULL. Deep zoom renders are not cached.
+ * @param p_field A pointer to the iteration field. Must have the size of the image and the iteration depth of the configuration.
+ * @param p_image_data A pointer to the image data.
+ * @param progress_callback A callback function to output the progress. It is always called on the calling thread. May be NULL.
+ * @param p_statistics A pointer to store statistics about the render, or NULL.
+ * @return Status code.
+ */
+int render_to_image(Configuration config, ThreadPool *p_thread_pool, TileCache *p_tile_cache, IterationField *p_field, ImageData* p_image_data,
+                    void (*progress_callback)(double), RenderStatistics *p_statistics);
+
+/**
+ * Builds indexed image data like render_to_image builds image data: the pixels are shaded to the indices of the distinct colors
+ * of the palette, see shade_iteration_field_to_indices. Supersampling mixes colors, so it is not supported.
+ *
+ * @param config The configuration struct. Must not use supersampling.
+ * @param p_thread_pool The thread pool to render the tiles with, or NULL to render on the calling thread.
+ * @param p_tile_cache The cache to load and store the tiles, or NULL. Deep zoom renders are not cached.
+ * @param p_field A pointer to the iteration field. Must have the size of the image and the iteration depth of the configuration.
+ * @param p_image_data A pointer to the indexed image data.
+ * @param progress_callback A callback function to output the progress. It is always called on the calling thread. May be NULL.
+ * @param p_statistics A pointer to store statistics about the render, or NULL.
+ * @return Status code. ERROR_TOO_MANY_COLORS if the palette has more than MAX_INDEXED_COLORS colors.
+ */
+int render_to_indexed_image(Configuration config, ThreadPool *p_thread_pool, TileCache *p_tile_cache, IterationField *p_field, IndexedImageData *p_image_data,
+                            void (*progress_callback)(double), RenderStatistics *p_statistics);
+
+/**
+ * Builds the image data of a band of consecutive rows of a larger image, see render_to_image. The field and the image data only cover the band.
+ * If the band starts at a multiple of TILE_SIZE, its pixels are exactly the same as the pixels of the same rows of the whole image.
+ * In deep zoom mode, the reference orbits are chosen for every band on its own.
+ *
+ * @param config The configuration struct.
+ * @param p_thread_pool The thread pool to render the tiles with, or NULL to render on the calling thread.
+ * @param p_tile_cache The cache to load and store the tiles, or NULL.
+ * @param first_row The row of the whole image that is the first row of the band.
+ * @param p_field A pointer to the iteration field of the band. Must have the width of the image and the iteration depth of the configuration.
+ * @param p_image_data A pointer to the image data of the band. Must have the same size as the field.
+ * @param progress_callback A callback function to output the progress. It is always called on the calling thread.
+ * @param progress_start The overall progress before the band is rendered.
+ * @param progress_end The overall progress after the band is rendered.
+ * @param p_statistics A pointer to store statistics about the band, or NULL.
+ * @return Status code.
+ */
+int render_band_to_image(Configuration config, ThreadPool *p_thread_pool, TileCache *p_tile_cache, size_t first_row, IterationField *p_field, ImageData *p_image_data,
+                         void (*progress_callback)(double), double progress_start, double progress_end, RenderStatistics *p_statistics);
+
+/**
+ * Computes the iteration field of a band like render_band_to_image, but shades nothing, so the field can be shaded later
+ * together with the other bands of the image. Used by the workers of a distributed render, see run_render_worker.
+ *
+ * @param config The configuration struct.
+ * @param p_thread_pool The thread pool to compute the tiles with, or NULL to compute them on the calling thread.
+ * @param first_row The row of the whole image that is the first row of the band.
+ * @param p_field A pointer to the iteration field of the band. Must have the width of the image and the iteration depth of the configuration.
+ * @param p_statistics A pointer to store statistics about the band, or NULL.
+ * @return Status code.
+ */
+int compute_band_field(Configuration config, ThreadPool *p_thread_pool, size_t first_row, IterationField *p_field, RenderStatistics *p_statistics);
+
+/**
+ * Snaps the viewport of an image to a pixel grid. The spacing is rounded to 32 significant bits, so viewports whose width differs
+ * only by rounding errors get the same spacing, and the upper left corner of the viewport is rounded to the nearest point of the grid.
+ * The image moves by less than half a pixel. Grids whose spacings differ by a power of two share every second point.
+ *
+ * @param viewport The viewport of the image. Must not be relative to a deep zoom center.
+ * @param size The size of the image in pixels.
+ * @param p_grid A pointer to store the grid.
+ * @return Status code. ERROR_ZOOM_TOO_DEEP if the positions of the pixels do not fit into the precision of a double.
+ */
+int get_pixel_grid(Viewport viewport, ImageSize size, PixelGrid *p_grid);
+
+/**
+ * Computes the iteration field of a frame of an animation, snapped to the pixel grid of its viewport, see get_pixel_grid.
+ * Pixels that lie exactly on a pixel of the previous frame are copied instead of iterated. This is the case if the previous
+ * frame has the same spacing and is moved by whole pixels, or if the spacing is half or twice the previous spacing.
+ * Nothing is shaded. Deep zoom configurations are not supported.
+ *
+ * @param config The configuration struct with the viewport of the frame.
+ * @param p_thread_pool The thread pool to compute the tiles with, or NULL to compute them on the calling thread.
+ * @param p_previous_field A pointer to the iteration field of the previous frame, or NULL. It is only read.
+ * @param previous_viewport The viewport of the previous frame.
+ * @param p_field A pointer to the iteration field of the frame. Must have the iteration depth of the configuration.
+ * @param p_statistics A pointer to store statistics about the frame, or NULL.
+ * @return Status code.
+ */
+int compute_frame_field(Configuration config, ThreadPool *p_thread_pool, const IterationField *p_previous_field, Viewport previous_viewport,
+                        IterationField *p_field, RenderStatistics *p_statistics);
+
+/**
+ * Computes the iteration field of an exponential map instead of a rectangular viewport, see LogPolarMap.
+ * Every frame of a zoom into the center of the map can be resampled from this single field, see render_log_polar_zoom.
+ * The viewport of the configuration is not used. Deep zoom is not supported.
+ *
+ * @param config The configuration struct.
+ * @param p_thread_pool The thread pool to compute the tiles with, or NULL to compute them on the calling thread.
+ * @param map The exponential map of the field.
+ * @param p_field A pointer to the iteration field. Must have the iteration depth of the configuration.
+ * @param progress_callback A callback function to output the progress, or NULL. It is always called on the calling thread.
+ * @param progress_start The overall progress when the computation starts.
+ * @param progress_end The overall progress when the computation is done.
+ * @param p_statistics A pointer to store statistics about the render, or NULL.
+ * @return Status code.
+ */
+int compute_log_polar_field(Configuration config, ThreadPool *p_thread_pool, LogPolarMap map, IterationField *p_field,
+                            void (*progress_callback)(double), double progress_start, double progress_end, RenderStatistics *p_statistics);
+
+/**
+ * Builds the image data in passes from coarse to fine, so a usable preview is available long before the image is done.
+ * The first pass computes every PROGRESSIVE_FIRST_STEP-th pixel in both directions, every further pass halves the step and only
+ * computes the pixels that earlier passes have not computed, until the step is 1. After every pass, every pixel that has not been computed
+ * yet gets the values of the computed pixel at the upper left corner of its block, the field is shaded and the frame callback is called.
+ * Every pixel is iterated like in brute force mode, so the last pass is the same image as a brute force render_to_image.
+ * If a time budget is given, the tiles that start after the deadline are skipped and no more passes are started. The skipped tiles keep
+ * the pixels of the previous pass, so the image is still complete, just coarser. The first pass is always computed completely.
+ *
+ * @param config The configuration struct. Deep zoom is not supported.
+ * @param p_thread_pool The thread pool to render the tiles with, or NULL to render on the calling thread.
+ * @param p_field A pointer to the iteration field. Must have the size of the image and the iteration depth of the configuration.
  * @param p_image_data A pointer to the image data.
- * @param progress_callback A callback function to output the progress.
+ * @param time_budget The wall clock time in seconds after which the render is stopped, or 0 for no limit.
+ * @param frame_callback The callback that receives the image after every pass, or NULL. It is always called on the calling thread.
+ * @param p_callback_context The context that is passed to the frame callback.
+ * @param p_final_step A pointer to store the step of the last pass that was completed, which is 1 if the image is done, or NULL.
+ * @param p_statistics A pointer to store statistics about the render, or NULL.
  * @return Status code.
  */
-int render_to_image(Configuration config, ImageData* p_image_data, void (*progress_callback)(double));
+int render_progressive(Configuration config, ThreadPool *p_thread_pool, IterationField *p_field, ImageData *p_image_data, double time_budget,
+                       ProgressiveFrameCallback frame_callback, void *p_callback_context, size_t *p_final_step, RenderStatistics *p_statistics);
 
-#endif  // RENDERER_H
\ No newline at end of file
+#endif  // RENDERER_H
@@ -0,0 +1,62 @@
+#ifndef SHADING_H
+#define SHADING_H
+
+#include "config.h"
+#include "image_manager.h"
+#include "iteration_field.h"
+#include "palette.h"
+#include "thread_pool.h"
+
+/**
+ * Shades an iteration field with the colors of a configuration and stores the colors in the image data.
+ * Pixels with the iteration depth of the field get the inner color, all other pixels get a color of the gradient of outer colors.
+ * Only the colors of the configuration are used, so a field can be shaded with any number of palettes after it was computed once.
+ *
+ * @param p_field A pointer to the iteration field.
+ * @param p_config A pointer to the configuration with the inner color and the outer colors.
+ * @param p_thread_pool The thread pool to shade the rows with, or NULL to shade on the calling thread.
+ * @param p_image_data A pointer to the image data. Must have the same size as the field.
+ * @return Status code.
+ */
+int shade_iteration_field(const IterationField *p_field, const Configuration *p_config, ThreadPool *p_thread_pool, ImageData *p_image_data);
+
+/**
+ * Shades an iteration field like shade_iteration_field, but stores the index of the color of every pixel instead of the color.
+ * The distinct colors of the palette become the color table of the indexed image data, in the order of their first use in the palette.
+ *
+ * @param p_field A pointer to the iteration field.
+ * @param p_config A pointer to the configuration with the inner color and the outer colors.
+ * @param p_thread_pool The thread pool to shade the rows with, or NULL to shade on the calling thread.
+ * @param p_image_data A pointer to the indexed image data. Must have the same size as the field.
+ * @return Status code. ERROR_TOO_MANY_COLORS if the palette has more than MAX_INDEXED_COLORS colors.
+ */
+int shade_iteration_field_to_indices(const IterationField *p_field, const Configuration *p_config, ThreadPool *p_thread_pool, IndexedImageData *p_image_data);
+
+/**
+ * Finds the distinct colors of the palette of a configuration and stores them as the color table of indexed image data,
+ * like shade_iteration_field_to_indices does. Allows to reject a palette with too many colors before the field is computed.
+ *
+ * @param p_config A pointer to the configuration with the inner color and the outer colors.
+ * @param iteration_depth The iteration depth of the field.
+ * @param p_image_data A pointer to the indexed image data.
+ * @return Status code. ERROR_TOO_MANY_COLORS if the palette has more than MAX_INDEXED_COLORS colors.
+ */
+int find_indexed_colors(const Configuration *p_config, size_t iteration_depth, IndexedImageData *p_image_data);
+
+/**
+ * The largest number of points that are shaded by shade_points at once.
+ */
+#define SHADING_MAX_POINTS 256
+
+/**
+ * Shades single points with a compiled palette, exactly like shade_iteration_field shades the pixels of a field.
+ *
+ * @param p_palette A pointer to the palette.
+ * @param p_iterations The numbers of iterations of the points.
+ * @param p_magnitudes The magnitudes of the last terms of the points.
+ * @param count The number of points. Must be at most SHADING_MAX_POINTS.
+ * @param p_pixels A pointer to store the blue, green and red bytes of the points.
+ */
+void shade_points(const Palette *p_palette, const uint32_t *p_iterations, const float *p_magnitudes, size_t count, unsigned char *p_pixels);
+
+#endif  // SHADING_H
@@ -22,6 +22,27 @@
 
 #define ERROR_INVALID_IMAGE_WIDTH -16
 #define ERROR_INVALID_NUM_CL_ARG -17
+#define ERROR_INVALID_THREAD_COUNT -18
+#define ERROR_THREAD_CREATE -19
+#define ERROR_ZOOM_TOO_DEEP -20
+#define ERROR_INVALID_CONFIG_VALUE -21
+#define ERROR_INVALID_FIELD_FILE -22
+#define ERROR_INVALID_MEMORY_BUDGET -23
+#define ERROR_INCOMPATIBLE_OPTIONS -24
+#define ERROR_INVALID_ZOOM_LEVEL -25
+#define ERROR_INVALID_PYRAMID_FORMAT -26
+#define ERROR_INVALID_CACHE_SIZE -27
+#define ERROR_INVALID_KEYFRAMES -28
+#define ERROR_MOVING_CENTER -29
+#define ERROR_SOCKET -30
+#define ERROR_UNKNOWN_JOB -31
+#define ERROR_INVALID_DAEMON_COMMAND -32
+#define ERROR_INVALID_DEADLINE -33
+#define ERROR_BENCHMARK_REGRESSION -34
+#define ERROR_INVALID_BENCHMARK_FILE -35
+#define ERROR_INVALID_BENCHMARK_OPTION -36
+#define ERROR_TOO_MANY_COLORS -37
+#define ERROR_NO_WORKERS -38
 
 /**
  * Returns the status message for a given status code.
@@ -0,0 +1,87 @@
+#ifndef STREAM_RENDERER_H
+#define STREAM_RENDERER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "config.h"
+#include "image_manager.h"
+#include "renderer.h"
+#include "thread_pool.h"
+
+/**
+ * The number of band buffers of a streaming render. While one band is written to the file, the next one is rendered.
+ */
+#define NUM_STREAM_BUFFERS 2
+
+/**
+ * Calculates the number of rows of a band of a streaming render, so that the iteration field and the image data
+ * of all bands that are held at the same time fit into the memory budget.
+ * Bands are a multiple of TILE_SIZE high if the budget allows it, so they are rendered exactly like the whole image.
+ * Buffers whose size does not depend on the image size, like the palette and the reference orbits, are not counted.
+ *
+ * @param config The configuration struct.
+ * @param size The size of the whole image in pixels.
+ * @param memory_budget The memory budget in bytes.
+ * @param mapped Whether the bands are rendered directly into mapped image data, so no band buffers are needed.
+ * @param p_band_height A pointer to store the number of rows of a band.
+ * @return Status code.
+ */
+int get_stream_band_height(Configuration config, ImageSize size, size_t memory_budget, bool mapped, size_t *p_band_height);
+
+/**
+ * Renders an image band by band and writes it to a BMP file while it is rendered, so the image never has to fit into memory.
+ * The bands are rendered from the bottom to the top of the image, which is the order of the rows in a BMP file.
+ * A writer thread writes every finished band to the file while the next band is rendered on the thread pool.
+ * Apart from the reference orbits of deep zoom renders, the image is the same as if it was rendered with render_to_image.
+ *
+ * @param config The configuration struct.
+ * @param p_thread_pool The thread pool to render the tiles with, or NULL to render on the calling thread.
+ * @param p_tile_cache The cache to load and store the tiles, or NULL.
+ * @param size The size of the image in pixels.
+ * @param memory_budget The maximum number of bytes of the per pixel buffers, see get_stream_band_height.
+ * @param output_path The path of the BMP file.
+ * @param progress_callback A callback function to output the progress. It is always called on the calling thread.
+ * @param p_statistics A pointer to store statistics about the render, or NULL.
+ * @return Status code.
+ */
+int render_to_bmp_stream(Configuration config, ThreadPool *p_thread_pool, TileCache *p_tile_cache, ImageSize size, size_t memory_budget,
+                         const char *output_path, void (*progress_callback)(double), RenderStatistics *p_statistics);
+
+/**
+ * Renders an image band by band and writes it to a tiled BigTIFF file while it is rendered, like render_to_bmp_stream.
+ * Every band is a row of whole tiles of the file, see TIFF_TILE_SIZE, so the band height of the memory budget is rounded down
+ * to a multiple of TIFF_TILE_SIZE. The writer thread encodes and writes the tiles of a band while the next band is rendered,
+ * and the directory of the tiles is written after the last band.
+ *
+ * @param config The configuration struct.
+ * @param p_thread_pool The thread pool to render the tiles with, or NULL to render on the calling thread.
+ * @param p_tile_cache The cache to load and store the tiles, or NULL.
+ * @param size The size of the image in pixels.
+ * @param memory_budget The maximum number of bytes of the per pixel buffers, see get_stream_band_height.
+ * @param output_path The path of the TIFF file.
+ * @param progress_callback A callback function to output the progress. It is always called on the calling thread.
+ * @param p_statistics A pointer to store statistics about the render, or NULL. The write time includes encoding the tiles.
+ * @return Status code.
+ */
+int render_to_tiff_stream(Configuration config, ThreadPool *p_thread_pool, TileCache *p_tile_cache, ImageSize size, size_t memory_budget,
+                          const char *output_path, void (*progress_callback)(double), RenderStatistics *p_statistics);
+
+/**
+ * Renders an image band by band directly into image data that is mapped to its file, see create_mapped_image_data.
+ * Only the iteration field of a single band is held in memory. The bands are rendered from the bottom to the top,
+ * so the operating system can write the pages of the file in order.
+ *
+ * @param config The configuration struct.
+ * @param p_thread_pool The thread pool to render the tiles with, or NULL to render on the calling thread.
+ * @param p_tile_cache The cache to load and store the tiles, or NULL.
+ * @param p_image_data A pointer to the mapped image data of the whole image.
+ * @param memory_budget The maximum number of bytes of the per pixel buffers, see get_stream_band_height.
+ * @param progress_callback A callback function to output the progress. It is always called on the calling thread.
+ * @param p_statistics A pointer to store statistics about the render, or NULL.
+ * @return Status code.
+ */
+int render_to_mapped_image(Configuration config, ThreadPool *p_thread_pool, TileCache *p_tile_cache, ImageData *p_image_data, size_t memory_budget,
+                           void (*progress_callback)(double), RenderStatistics *p_statistics);
+
+#endif  // STREAM_RENDERER_H
@@ -0,0 +1,77 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stddef.h>
+
+/**
+ * A task that is executed by the thread pool.
+ *
+ * @param task_index The index of the task within the current batch.
+ * @param worker_index The index of the worker thread that executes the task.
+ * @param p_context The context pointer that was passed to run_thread_pool.
+ * @return Status code. If a task fails, the remaining tasks of the batch are skipped.
+ */
+typedef int (*TaskFunction)(size_t task_index, size_t worker_index, void *p_context);
+
+/**
+ * Is called on the thread that started a batch whenever tasks of the batch have been completed.
+ *
+ * @param num_completed The number of completed tasks.
+ * @param num_tasks The total number of tasks in the batch.
+ * @param p_context The context pointer that was passed to run_thread_pool.
+ */
+typedef void (*TaskProgressFunction)(size_t num_completed, size_t num_tasks, void *p_context);
+
+/**
+ * A pool of worker threads. Every worker owns a deque of tasks. It takes tasks from the back of its own deque
+ * and steals tasks from the front of the deques of other workers once its own deque is empty.
+ */
+typedef struct ThreadPool ThreadPool;
+
+/**
+ * Returns the number of processors that are currently online. Returns 1 if the number cannot be determined.
+ *
+ * @return The number of processors.
+ */
+size_t get_num_processors(void);
+
+/**
+ * Creates a thread pool and starts its worker threads. The pool must be freed with free_thread_pool.
+ *
+ * @param num_threads The number of worker threads. Must be greater than 0.
+ * @param p_p_pool A pointer to the pointer where the thread pool should be stored.
+ * @return Status code.
+ */
+int create_thread_pool(size_t num_threads, ThreadPool **p_p_pool);
+
+/**
+ * Returns the number of worker threads of the thread pool.
+ *
+ * @param p_pool The thread pool.
+ * @return The number of worker threads.
+ */
+size_t get_thread_pool_size(const ThreadPool *p_pool);
+
+/**
+ * Runs a batch of tasks on the thread pool and blocks until all tasks have been executed.
+ * The tasks are distributed in contiguous blocks over the workers, idle workers steal tasks from busy ones.
+ * The progress function is called on the calling thread, never concurrently.
+ * Batches that are started from different threads are executed one after another.
+ *
+ * @param p_pool The thread pool.
+ * @param num_tasks The number of tasks in the batch.
+ * @param task The function that executes a single task.
+ * @param p_context The context pointer that is passed to the task and progress functions.
+ * @param progress A function that is called whenever tasks have been completed. May be NULL.
+ * @return Status code. The status code of the first failed task or SUCCESS.
+ */
+int run_thread_pool(ThreadPool *p_pool, size_t num_tasks, TaskFunction task, void *p_context, TaskProgressFunction progress);
+
+/**
+ * Stops the worker threads and frees the thread pool.
+ *
+ * @param p_pool The thread pool. May be NULL.
+ */
+void free_thread_pool(ThreadPool *p_pool);
+
+#endif  // THREAD_POOL_H
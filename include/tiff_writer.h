@@ -0,0 +1,67 @@
+#ifndef TIFF_WRITER_H
+#define TIFF_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "image_manager.h"
+#include "thread_pool.h"
+
+/**
+ * The edge length of the square tiles of a TIFF file in pixels. A multiple of the TILE_SIZE of the renderer,
+ * so bands of tile rows of the file are rendered exactly like the whole image.
+ */
+#define TIFF_TILE_SIZE 256
+
+/**
+ * Writes an RGB image with 8 bits per channel as a tiled BigTIFF file, whose 64 bit offsets allow files far beyond 4 GiB.
+ * Every tile is compressed with deflate on its own and appended to the file as soon as it is done, so tiles can be encoded
+ * in parallel and written in any order. The offsets and sizes of the tiles are collected and written in the directory of the image
+ * at the end of the file, see close_tiff_writer.
+ */
+typedef struct TiffWriter TiffWriter;
+
+/**
+ * Creates a BigTIFF file and writes its header. The offset of the directory in the header is filled in by close_tiff_writer.
+ *
+ * @param output_path The path of the file. An existing file is replaced.
+ * @param size The size of the image in pixels.
+ * @param p_p_writer A pointer to store the writer.
+ * @return Status code.
+ */
+int open_tiff_writer(const char *output_path, ImageSize size, TiffWriter **p_p_writer);
+
+/**
+ * Encodes and writes all tiles that are covered by a band of rows of the image. Tiles at the right and the bottom edge of the image
+ * are padded with black. Bands may be written in any order, but every band must start at a multiple of TIFF_TILE_SIZE and end at
+ * a multiple of TIFF_TILE_SIZE or at the bottom of the image. The function may be called from any thread.
+ *
+ * @param p_writer A pointer to the writer.
+ * @param p_band A pointer to the image data of the band.
+ * @param first_row The row of the whole image that is the first row of the band.
+ * @param p_thread_pool The thread pool to encode the tiles with, or NULL to encode them on the calling thread.
+ * @return Status code.
+ */
+int write_tiff_band(TiffWriter *p_writer, const ImageData *p_band, size_t first_row, ThreadPool *p_thread_pool);
+
+/**
+ * Writes the directory of the image, closes the file and frees the writer. All tiles must have been written.
+ *
+ * @param p_writer A pointer to the writer.
+ * @param p_num_bytes_written A pointer to store the size of the file in bytes, or NULL.
+ * @return Status code.
+ */
+int close_tiff_writer(TiffWriter *p_writer, uint64_t *p_num_bytes_written);
+
+/**
+ * Saves the image data as a tiled BigTIFF file. The tiles are encoded in parallel and written in the order they are finished.
+ *
+ * @param output_path The path of the file to save.
+ * @param p_image_data A pointer to the image data.
+ * @param p_thread_pool The thread pool or NULL to encode the tiles one after another.
+ * @param p_num_bytes_written A pointer to store the size of the file in bytes, or NULL.
+ * @return Status code.
+ */
+int save_tiff(const char *output_path, const ImageData *p_image_data, ThreadPool *p_thread_pool, uint64_t *p_num_bytes_written);
+
+#endif  // TIFF_WRITER_H
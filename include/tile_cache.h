@@ -0,0 +1,94 @@
+#ifndef TILE_CACHE_H
+#define TILE_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The default size limit of a tile cache in bytes.
+ */
+#define TILE_CACHE_DEFAULT_MAX_SIZE ((size_t)1 << 30)
+
+/**
+ * The identity of a cached tile. Two tiles with the same key have the same iteration data.
+ * The pixels of a cached render lie on a global grid: the point of pixel (x, y) is exactly (x * spacing, -y * spacing),
+ * so overlapping renders at the same scale share their tiles, no matter where their viewports start.
+ */
+typedef struct {
+    // The position of the upper left pixel of the tile on the grid.
+    int64_t x;
+    int64_t y;
+    // The distance between two neighboring pixels in the complex plane.
+    double spacing;
+    size_t width;
+    size_t height;
+    size_t iteration_depth;
+    // The RenderMode and the interior checks of the configuration.
+    unsigned int render_mode;
+    unsigned int interior_checks;
+    // The Precision the tile was iterated with.
+    unsigned int precision;
+    // The Formula, its power and the constant of the Julia set.
+    unsigned int formula;
+    unsigned int power;
+    double julia_real;
+    double julia_imag;
+    // The name of the iteration kernel, because kernels may round differently.
+    const char *kernel_name;
+} TileKey;
+
+/**
+ * A directory of cached tiles that may be shared by several processes at the same time.
+ * Every tile is a file whose name is the hash of its key. A tile is written to a temporary file first and renamed afterwards,
+ * so other processes either see the complete tile or none. The key is stored in the file, so hash collisions are detected.
+ */
+typedef struct TileCache TileCache;
+
+/**
+ * Opens a tile cache. The directory is created if it does not exist.
+ *
+ * @param directory The directory of the cache.
+ * @param max_size The size limit of all tile files in bytes, see close_tile_cache.
+ * @param p_p_cache A pointer to store the cache.
+ * @return Status code.
+ */
+int open_tile_cache(const char *directory, size_t max_size, TileCache **p_p_cache);
+
+/**
+ * Trims the cache to its size limit and frees it. The least recently used tiles are deleted first.
+ * The limit is only enforced here, so the cache may grow beyond it while a render is running.
+ *
+ * @param p_cache A pointer to the cache, or NULL.
+ */
+void close_tile_cache(TileCache *p_cache);
+
+/**
+ * Loads the iteration data of a tile from the cache and marks the tile as recently used.
+ * The magnitudes of pixels inside of the Mandelbrot set are not stored and are loaded as 0.
+ * May be called by several threads at the same time.
+ *
+ * @param p_cache A pointer to the cache.
+ * @param p_key A pointer to the key of the tile.
+ * @param iterations A pointer to store the numbers of iterations of the tile, row by row.
+ * @param magnitudes A pointer to store the magnitudes of the tile, row by row.
+ * @param stride The distance between two rows of iterations and magnitudes in elements.
+ * @return True if the tile was found.
+ */
+bool load_cached_tile(TileCache *p_cache, const TileKey *p_key, uint32_t *iterations, float *magnitudes, size_t stride);
+
+/**
+ * Stores the iteration data of a tile in the cache. The numbers of iterations are run length encoded
+ * and only the magnitudes of pixels outside of the Mandelbrot set are stored, so tiles inside of the set take only a few bytes.
+ * May be called by several threads at the same time.
+ *
+ * @param p_cache A pointer to the cache.
+ * @param p_key A pointer to the key of the tile.
+ * @param iterations The numbers of iterations of the tile, row by row.
+ * @param magnitudes The magnitudes of the tile, row by row.
+ * @param stride The distance between two rows of iterations and magnitudes in elements.
+ * @return Status code.
+ */
+int store_cached_tile(TileCache *p_cache, const TileKey *p_key, const uint32_t *iterations, const float *magnitudes, size_t stride);
+
+#endif  // TILE_CACHE_H
@@ -0,0 +1,236 @@
+#include "../include/animation.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/image_manager.h"
+#include "../include/iteration_field.h"
+#include "../include/raw_stream.h"
+#include "../include/shading.h"
+#include "../include/status_manager.h"
+
+/**
+ * The number of characters that a frame path may have in addition to the output prefix.
+ */
+#define FRAME_PATH_SUFFIX_LENGTH 32
+
+/**
+ * The state shared by the thread that computes the frames and the writer thread that shades and writes them.
+ * Frame i is computed into the field i % ANIMATION_NUM_FIELDS.
+ */
+typedef struct {
+    const Configuration *p_config;
+    IterationField *fields;
+    size_t first_frame;
+    const char *output_prefix;
+    // The stream the frames are written to instead of files, or NULL.
+    FILE *frame_stream;
+    // Protects all members below.
+    pthread_mutex_t lock;
+    // Signaled when a frame has been computed, a frame has been written or no more frames will be computed.
+    pthread_cond_t changed;
+    // The number of frames that have been computed and written, counted from the first frame.
+    size_t num_computed;
+    size_t num_written;
+    bool finished;
+    // The status of the first failed write or SUCCESS.
+    int status;
+} FrameWriter;
+
+Viewport get_keyframe_viewport(const Keyframe *keyframes, size_t num_keyframes, size_t frame, double aspect_ratio) {
+    size_t k = 0;
+    while (k + 1 < num_keyframes && keyframes[k + 1].frame <= frame) {
+        k++;
+    }
+    const Keyframe *p_from = &keyframes[k];
+    const Keyframe *p_to = k + 1 < num_keyframes ? &keyframes[k + 1] : p_from;
+    double center_real = p_from->center_real;
+    double center_imag = p_from->center_imag;
+    double width = p_from->width;
+
+    if (p_to != p_from && frame > p_from->frame) {
+        double t = (double)(frame - p_from->frame) / (double)(p_to->frame - p_from->frame);
+        double ratio = p_to->width / p_from->width;
+        width = p_from->width * pow(ratio, t);
+        // The screen moves with the width, so the center covers the fraction (1 - ratio^t) / (1 - ratio) of its way,
+        // which makes its speed on the screen constant.
+        double fraction = fabs(1.0 - ratio) > 1e-12 ? (1.0 - pow(ratio, t)) / (1.0 - ratio) : t;
+        center_real += (p_to->center_real - p_from->center_real) * fraction;
+        center_imag += (p_to->center_imag - p_from->center_imag) * fraction;
+    }
+
+    double height = width * aspect_ratio;
+    Viewport viewport = {{center_real - width / 2, center_imag - height / 2}, {center_real + width / 2, center_imag + height / 2}};
+    return viewport;
+}
+
+/**
+ * The main function of the writer thread. Shades and writes the computed frames in order until no more frames will be computed.
+ *
+ * @param p_argument A pointer to the FrameWriter.
+ * @return NULL.
+ */
+void *_run_frame_writer(void *p_argument) {
+    FrameWriter *p_writer = (FrameWriter *)p_argument;
+    size_t length = strlen(p_writer->output_prefix) + FRAME_PATH_SUFFIX_LENGTH;
+    char *path = (char *)malloc(length);
+
+    pthread_mutex_lock(&p_writer->lock);
+    if (path == NULL) {
+        p_writer->status = ERROR_MEMORY_ALLOC;
+    }
+    while (true) {
+        while (p_writer->num_written == p_writer->num_computed && !p_writer->finished) {
+            pthread_cond_wait(&p_writer->changed, &p_writer->lock);
+        }
+        if (p_writer->num_written == p_writer->num_computed || p_writer->status != SUCCESS) {
+            break;
+        }
+        size_t index = p_writer->num_written;
+        pthread_mutex_unlock(&p_writer->lock);
+
+        // The frame is shaded on this thread, because the thread pool is busy with the next frame.
+        const IterationField *p_field = &p_writer->fields[index % ANIMATION_NUM_FIELDS];
+        ImageData *p_image_data;
+        int status = create_image_data_with_size(p_field->size, &p_image_data);
+        if (status == SUCCESS) {
+            status = shade_iteration_field(p_field, p_writer->p_config, NULL, p_image_data);
+            if (status == SUCCESS && p_writer->frame_stream != NULL) {
+                status = write_y4m_frame(p_writer->frame_stream, p_image_data);
+                free_image_data(p_image_data);
+            } else if (status == SUCCESS) {
+                snprintf(path, length, "%s_%05zu.bmp", p_writer->output_prefix, p_writer->first_frame + index);
+                status = export_and_free(p_image_data, path);
+            } else {
+                free_image_data(p_image_data);
+            }
+        }
+
+        pthread_mutex_lock(&p_writer->lock);
+        p_writer->status = status;
+        p_writer->num_written++;
+        pthread_cond_broadcast(&p_writer->changed);
+    }
+    pthread_cond_broadcast(&p_writer->changed);
+    pthread_mutex_unlock(&p_writer->lock);
+    free(path);
+    return NULL;
+}
+
+/**
+ * Computes all frames one after another and hands them to the writer thread. A field is only reused when the frame
+ * that was computed into it has been written.
+ *
+ * @param p_writer A pointer to the FrameWriter whose thread is running.
+ * @param config The configuration struct.
+ * @param p_thread_pool The thread pool or NULL.
+ * @param keyframes The keyframes.
+ * @param num_keyframes The number of keyframes.
+ * @param num_frames The number of frames.
+ * @param progress_callback A callback function to output the progress, or NULL.
+ * @param p_statistics A pointer to store statistics summed over all frames, or NULL.
+ * @return Status code.
+ */
+int _compute_frames(FrameWriter *p_writer, Configuration config, ThreadPool *p_thread_pool, const Keyframe *keyframes, size_t num_keyframes,
+                    size_t num_frames, void (*progress_callback)(double), RenderStatistics *p_statistics) {
+    ImageSize size = p_writer->fields[0].size;
+    double aspect_ratio = (double)size.height / (double)size.width;
+    Viewport previous_viewport = config.viewport;
+    RenderStatistics frame_statistics;
+    int status = SUCCESS;
+
+    for (size_t i = 0; i < num_frames && status == SUCCESS; i++) {
+        pthread_mutex_lock(&p_writer->lock);
+        while (p_writer->num_written + ANIMATION_NUM_FIELDS <= i && p_writer->status == SUCCESS) {
+            pthread_cond_wait(&p_writer->changed, &p_writer->lock);
+        }
+        status = p_writer->status;
+        size_t num_written = p_writer->num_written;
+        pthread_mutex_unlock(&p_writer->lock);
+        if (status != SUCCESS) break;
+        if (progress_callback != NULL) {
+            progress_callback((double)num_written / (double)num_frames);
+        }
+
+        config.viewport = get_keyframe_viewport(keyframes, num_keyframes, p_writer->first_frame + i, aspect_ratio);
+        const IterationField *p_previous_field = i > 0 ? &p_writer->fields[(i - 1) % ANIMATION_NUM_FIELDS] : NULL;
+        status = compute_frame_field(config, p_thread_pool, p_previous_field, previous_viewport, &p_writer->fields[i % ANIMATION_NUM_FIELDS],
+                                     &frame_statistics);
+        if (status != SUCCESS) break;
+        previous_viewport = config.viewport;
+        if (p_statistics != NULL) {
+            p_statistics->num_iterated_pixels += frame_statistics.num_iterated_pixels;
+            p_statistics->num_reused_pixels += frame_statistics.num_reused_pixels;
+        }
+
+        pthread_mutex_lock(&p_writer->lock);
+        p_writer->num_computed++;
+        pthread_cond_broadcast(&p_writer->changed);
+        pthread_mutex_unlock(&p_writer->lock);
+    }
+    return status;
+}
+
+int render_animation(Configuration config, ThreadPool *p_thread_pool, const Keyframe *keyframes, size_t num_keyframes, ImageSize size,
+                     const char *output_prefix, FILE *frame_stream, void (*progress_callback)(double), RenderStatistics *p_statistics) {
+    if (num_keyframes == 0) return GENERIC_ERROR;
+    if (config.deep_zoom) return ERROR_INCOMPATIBLE_OPTIONS;
+    if (p_statistics != NULL) {
+        memset(p_statistics, 0, sizeof(RenderStatistics));
+    }
+
+    IterationField fields[ANIMATION_NUM_FIELDS];
+    memset(fields, 0, sizeof(fields));
+    int status = SUCCESS;
+    for (size_t i = 0; i < ANIMATION_NUM_FIELDS && status == SUCCESS; i++) {
+        status = create_iteration_field(size, config.iteration_depth, &fields[i]);
+    }
+
+    FrameWriter writer;
+    memset(&writer, 0, sizeof(FrameWriter));
+    writer.p_config = &config;
+    writer.fields = fields;
+    writer.first_frame = keyframes[0].frame;
+    writer.output_prefix = output_prefix;
+    writer.frame_stream = frame_stream;
+    size_t num_frames = keyframes[num_keyframes - 1].frame - keyframes[0].frame + 1;
+
+    if (status == SUCCESS && frame_stream != NULL) {
+        status = write_y4m_header(frame_stream, size);
+    }
+
+    pthread_t writer_thread;
+    if (status == SUCCESS) {
+        pthread_mutex_init(&writer.lock, NULL);
+        pthread_cond_init(&writer.changed, NULL);
+        if (pthread_create(&writer_thread, NULL, _run_frame_writer, &writer) != 0) {
+            status = ERROR_THREAD_CREATE;
+        } else {
+            status = _compute_frames(&writer, config, p_thread_pool, keyframes, num_keyframes, num_frames, progress_callback, p_statistics);
+
+            // Let the writer thread write the remaining frames and wait for it.
+            pthread_mutex_lock(&writer.lock);
+            writer.finished = true;
+            pthread_cond_broadcast(&writer.changed);
+            pthread_mutex_unlock(&writer.lock);
+            pthread_join(writer_thread, NULL);
+            if (status == SUCCESS) {
+                status = writer.status;
+            }
+        }
+        pthread_cond_destroy(&writer.changed);
+        pthread_mutex_destroy(&writer.lock);
+    }
+
+    for (size_t i = 0; i < ANIMATION_NUM_FIELDS; i++) {
+        free_iteration_field(&fields[i]);
+    }
+    if (status == SUCCESS && progress_callback != NULL) {
+        progress_callback(1.0);
+    }
+    return status;
+}
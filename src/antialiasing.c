@@ -0,0 +1,329 @@
+#include "../include/antialiasing.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/iteration_kernel.h"
+#include "../include/palette.h"
+#include "../include/shading.h"
+#include "../include/status_manager.h"
+
+/**
+ * The number of rows that are searched for edges or supersampled as one task.
+ */
+#define SUPERSAMPLING_BAND_HEIGHT 16
+
+/**
+ * The state shared by the tasks of a supersampling pass.
+ */
+typedef struct {
+    const Configuration *p_config;
+    const IterationField *p_field;
+    ImageData *p_image_data;
+    size_t first_row;
+    // The number type of the samples, and the center in double-double precision, which is 0 unless the render is in deep zoom mode.
+    Precision precision;
+    DoubleDouble center_real;
+    DoubleDouble center_imag;
+    Palette palette;
+    // The rows next to the band and their colors, or NULL at the top and the bottom of the image.
+    const IterationField *p_row_above;
+    const IterationField *p_row_below;
+    ImageData *p_colors_above;
+    ImageData *p_colors_below;
+    // One byte per pixel of the band, which is 1 if the pixel is at an edge.
+    unsigned char *edges;
+    // The number of supersampled pixels of every worker thread.
+    size_t *worker_num_pixels;
+} SupersamplingContext;
+
+/**
+ * Mixes the bits of a number, so consecutive numbers give unrelated results (the finalizer of SplitMix64).
+ *
+ * @param x The number.
+ * @return The mixed bits.
+ */
+uint64_t _mix_bits(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/**
+ * Looks up the number of iterations and the color of a pixel of the band or of one of the rows next to it.
+ *
+ * @param p_context A pointer to the SupersamplingContext.
+ * @param x The x-coordinate of the pixel.
+ * @param y The y-coordinate of the pixel in the band, -1 for the row above the band or the height of the band for the row below.
+ * @param p_iterations A pointer to store the number of iterations.
+ * @return A pointer to the color of the pixel, or NULL if the pixel is outside of the image.
+ */
+const unsigned char *_get_neighbor_pixel(const SupersamplingContext *p_context, size_t x, ptrdiff_t y, uint32_t *p_iterations) {
+    const IterationField *p_field = p_context->p_field;
+    if (y < 0) {
+        if (p_context->p_row_above == NULL) return NULL;
+        *p_iterations = p_context->p_row_above->iterations[x];
+        return get_row_in_image_data(p_context->p_colors_above, 0) + 3 * x;
+    }
+    if ((size_t)y >= p_field->size.height) {
+        if (p_context->p_row_below == NULL) return NULL;
+        *p_iterations = p_context->p_row_below->iterations[x];
+        return get_row_in_image_data(p_context->p_colors_below, 0) + 3 * x;
+    }
+    *p_iterations = p_field->iterations[(size_t)y * p_field->size.width + x];
+    return get_row_in_image_data(p_context->p_image_data, (size_t)y) + 3 * x;
+}
+
+/**
+ * Checks whether a pixel of the band and one of its neighbors are different enough to be supersampled.
+ *
+ * @param p_context A pointer to the SupersamplingContext.
+ * @param x0 The x-coordinate of the pixel in the band.
+ * @param y0 The y-coordinate of the pixel in the band.
+ * @param x1 The x-coordinate of the neighbor.
+ * @param y1 The y-coordinate of the neighbor, which may be one of the rows next to the band, see _get_neighbor_pixel.
+ * @return True if one pixel is inside of the set and the other is not, or if a color channel differs by more than the threshold.
+ *         False if the neighbor is outside of the image.
+ */
+bool _is_edge(const SupersamplingContext *p_context, size_t x0, size_t y0, size_t x1, ptrdiff_t y1) {
+    uint32_t iterations0, iterations1;
+    const unsigned char *p_pixel0 = _get_neighbor_pixel(p_context, x0, (ptrdiff_t)y0, &iterations0);
+    const unsigned char *p_pixel1 = _get_neighbor_pixel(p_context, x1, y1, &iterations1);
+    if (p_pixel1 == NULL) return false;
+    size_t iteration_depth = p_context->p_field->iteration_depth;
+    if ((iterations0 >= iteration_depth) != (iterations1 >= iteration_depth)) return true;
+    for (size_t channel = 0; channel < 3; channel++) {
+        if ((unsigned int)abs(p_pixel0[channel] - p_pixel1[channel]) > p_context->p_config->supersampling_threshold) return true;
+    }
+    return false;
+}
+
+/**
+ * Shades a row next to the band, so its colors can be compared with the colors of the band.
+ *
+ * @param p_config A pointer to the configuration.
+ * @param p_row A pointer to the iteration field of the row, or NULL.
+ * @param p_p_colors A pointer to store the image data of the shaded row, or NULL if there is no row.
+ * @return Status code.
+ */
+int _shade_neighbor_row(const Configuration *p_config, const IterationField *p_row, ImageData **p_p_colors) {
+    *p_p_colors = NULL;
+    if (p_row == NULL) return SUCCESS;
+    int status = create_image_data_with_size(p_row->size, p_p_colors);
+    if (status < 0) return status;
+    return shade_iteration_field(p_row, p_config, NULL, *p_p_colors);
+}
+
+/**
+ * Marks the pixels of a band of SUPERSAMPLING_BAND_HEIGHT rows that differ from one of their four neighbors.
+ * Every task only writes the marks of its own rows, so the tasks do not need to be synchronized.
+ *
+ * @param band_index The index of the band.
+ * @param worker_index The index of the worker thread. Unused.
+ * @param p_context A pointer to the SupersamplingContext.
+ * @return Status code.
+ */
+int _find_edges(size_t band_index, size_t worker_index, void *p_context) {
+    (void)worker_index;
+    SupersamplingContext *p_supersampling_context = (SupersamplingContext *)p_context;
+    ImageSize size = p_supersampling_context->p_field->size;
+    size_t y_start = band_index * SUPERSAMPLING_BAND_HEIGHT;
+    size_t y_end = y_start + SUPERSAMPLING_BAND_HEIGHT < size.height ? y_start + SUPERSAMPLING_BAND_HEIGHT : size.height;
+    for (size_t y = y_start; y < y_end; y++) {
+        for (size_t x = 0; x < size.width; x++) {
+            bool edge = (x > 0 && _is_edge(p_supersampling_context, x, y, x - 1, (ptrdiff_t)y)) ||
+                        (x + 1 < size.width && _is_edge(p_supersampling_context, x, y, x + 1, (ptrdiff_t)y)) ||
+                        _is_edge(p_supersampling_context, x, y, x, (ptrdiff_t)y - 1) || _is_edge(p_supersampling_context, x, y, x, (ptrdiff_t)y + 1);
+            p_supersampling_context->edges[y * size.width + x] = edge;
+        }
+    }
+    return SUCCESS;
+}
+
+/**
+ * Iterates a pixel at supersampling x supersampling jittered points and stores the average color of the points.
+ * Pixel (x, y) of the image lies at the point that is mapped to it by the renderer, and its area reaches half a pixel in every direction.
+ * The viewport of a deep zoom render is relative to its center, so its samples are computed in double-double precision.
+ *
+ * @param p_context A pointer to the SupersamplingContext.
+ * @param x The x-coordinate of the pixel in the band.
+ * @param y The y-coordinate of the pixel in the band.
+ */
+void _supersample_pixel(const SupersamplingContext *p_context, size_t x, size_t y) {
+    double c_real[MAX_SUPERSAMPLING * MAX_SUPERSAMPLING] = {0};
+    double c_imag[MAX_SUPERSAMPLING * MAX_SUPERSAMPLING] = {0};
+    DoubleDouble dd_real[MAX_SUPERSAMPLING * MAX_SUPERSAMPLING];
+    DoubleDouble dd_imag[MAX_SUPERSAMPLING * MAX_SUPERSAMPLING];
+    size_t iterations[MAX_SUPERSAMPLING * MAX_SUPERSAMPLING];
+    double magnitudes[MAX_SUPERSAMPLING * MAX_SUPERSAMPLING];
+    uint32_t sample_iterations[MAX_SUPERSAMPLING * MAX_SUPERSAMPLING];
+    float sample_magnitudes[MAX_SUPERSAMPLING * MAX_SUPERSAMPLING];
+    unsigned char colors[3 * MAX_SUPERSAMPLING * MAX_SUPERSAMPLING];
+
+    const Configuration *p_config = p_context->p_config;
+    Viewport viewport = p_config->viewport;
+    size_t width = p_context->p_field->size.width;
+    size_t n = p_config->supersampling;
+    size_t num_samples = n * n;
+    size_t row = p_context->first_row + y;
+    double spacing = fabs(viewport.upper_right.real - viewport.lower_left.real) / (double)width;
+    uint64_t seed = ((uint64_t)row * width + x) * MAX_SUPERSAMPLING * MAX_SUPERSAMPLING;
+
+    for (size_t i = 0; i < num_samples; i++) {
+        uint64_t random = _mix_bits(seed + i);
+        double jitter_x = (double)(random & 0xFFFFFFFF) / 4294967296.0;
+        double jitter_y = (double)(random >> 32) / 4294967296.0;
+        double offset_x = ((double)(i % n) + jitter_x) / (double)n - 0.5;
+        double offset_y = ((double)(i / n) + jitter_y) / (double)n - 0.5;
+        double sample_x = ((double)x + offset_x) * spacing;
+        double sample_y = ((double)row + offset_y) * spacing;
+        if (p_context->precision == PRECISION_DOUBLE_DOUBLE || p_config->deep_zoom) {
+            dd_real[i] = add_double_double(p_context->center_real, double_double_from_sum(viewport.lower_left.real, sample_x));
+            dd_imag[i] = add_double_double(p_context->center_imag, double_double_from_sum(viewport.upper_right.imag, -sample_y));
+            c_real[i] = dd_real[i].hi;
+            c_imag[i] = dd_imag[i].hi;
+        } else {
+            c_real[i] = viewport.lower_left.real + sample_x;
+            c_imag[i] = viewport.upper_right.imag - sample_y;
+        }
+    }
+    if (p_context->precision == PRECISION_DOUBLE_DOUBLE) {
+        iterate_double_double_points(dd_real, dd_imag, num_samples, p_config, iterations, magnitudes);
+    } else {
+        iterate_points(c_real, c_imag, num_samples, p_config, p_context->precision, iterations, magnitudes);
+    }
+    for (size_t i = 0; i < num_samples; i++) {
+        sample_iterations[i] = (uint32_t)iterations[i];
+        sample_magnitudes[i] = (float)magnitudes[i];
+    }
+    shade_points(&p_context->palette, sample_iterations, sample_magnitudes, num_samples, colors);
+
+    unsigned char *p_pixel = get_row_in_image_data(p_context->p_image_data, y) + 3 * x;
+    for (size_t channel = 0; channel < 3; channel++) {
+        size_t sum = 0;
+        for (size_t i = 0; i < num_samples; i++) {
+            sum += colors[3 * i + channel];
+        }
+        p_pixel[channel] = (unsigned char)((sum + num_samples / 2) / num_samples);
+    }
+}
+
+/**
+ * Supersamples the marked pixels of a band of SUPERSAMPLING_BAND_HEIGHT rows.
+ *
+ * @param band_index The index of the band.
+ * @param worker_index The index of the worker thread.
+ * @param p_context A pointer to the SupersamplingContext.
+ * @return Status code.
+ */
+int _supersample_band(size_t band_index, size_t worker_index, void *p_context) {
+    SupersamplingContext *p_supersampling_context = (SupersamplingContext *)p_context;
+    ImageSize size = p_supersampling_context->p_field->size;
+    size_t y_start = band_index * SUPERSAMPLING_BAND_HEIGHT;
+    size_t y_end = y_start + SUPERSAMPLING_BAND_HEIGHT < size.height ? y_start + SUPERSAMPLING_BAND_HEIGHT : size.height;
+    size_t num_pixels = 0;
+    for (size_t y = y_start; y < y_end; y++) {
+        for (size_t x = 0; x < size.width; x++) {
+            if (!p_supersampling_context->edges[y * size.width + x]) continue;
+            _supersample_pixel(p_supersampling_context, x, y);
+            num_pixels++;
+        }
+    }
+    p_supersampling_context->worker_num_pixels[worker_index] += num_pixels;
+    return SUCCESS;
+}
+
+/**
+ * Runs a task for every band of the image, on the thread pool if there is one.
+ *
+ * @param p_context A pointer to the SupersamplingContext.
+ * @param p_thread_pool The thread pool, or NULL.
+ * @param num_bands The number of bands.
+ * @param task The task.
+ * @return Status code.
+ */
+int _run_band_tasks(SupersamplingContext *p_context, ThreadPool *p_thread_pool, size_t num_bands, TaskFunction task) {
+    if (p_thread_pool != NULL) {
+        return run_thread_pool(p_thread_pool, num_bands, task, p_context, NULL);
+    }
+    int status = SUCCESS;
+    for (size_t band_index = 0; band_index < num_bands && status == SUCCESS; band_index++) {
+        status = task(band_index, 0, p_context);
+    }
+    return status;
+}
+
+int supersample_edges(const Configuration *p_config, ThreadPool *p_thread_pool, const IterationField *p_field, size_t first_row, ImageData *p_image_data,
+                      const IterationField *p_row_above, const IterationField *p_row_below, size_t *p_num_pixels, size_t *p_num_samples) {
+    if (p_config->supersampling < 2 || p_config->supersampling > MAX_SUPERSAMPLING) return GENERIC_ERROR;
+    if (p_field->size.width != p_image_data->size.width || p_field->size.height != p_image_data->size.height) return GENERIC_ERROR;
+    if ((p_row_above != NULL && (p_row_above->size.width != p_field->size.width || p_row_above->size.height != 1)) ||
+        (p_row_below != NULL && (p_row_below->size.width != p_field->size.width || p_row_below->size.height != 1))) {
+        return GENERIC_ERROR;
+    }
+
+    SupersamplingContext context;
+    memset(&context, 0, sizeof(SupersamplingContext));
+    context.p_config = p_config;
+    context.p_field = p_field;
+    context.p_image_data = p_image_data;
+    context.first_row = first_row;
+    context.p_row_above = p_row_above;
+    context.p_row_below = p_row_below;
+    // The samples are as close as the pixels of an image that is supersampling times as wide. Perturbation is not supported,
+    // because its reference orbits belong to the pixels of the whole image.
+    int status = select_precision(p_config, p_field->size.width * p_config->supersampling, &context.precision);
+    if (status < 0) return status;
+    if (context.precision == PRECISION_PERTURBATION) return ERROR_INCOMPATIBLE_OPTIONS;
+    if (p_config->deep_zoom) {
+        context.center_real = fixed_point_to_double_double(&p_config->center_real);
+        context.center_imag = fixed_point_to_double_double(&p_config->center_imag);
+    }
+    status = compile_palette(p_config, p_field->iteration_depth, &context.palette);
+    if (status < 0) return status;
+    size_t num_workers = p_thread_pool != NULL ? get_thread_pool_size(p_thread_pool) : 1;
+    context.edges = (unsigned char *)calloc(p_field->size.width * p_field->size.height, 1);
+    context.worker_num_pixels = (size_t *)calloc(num_workers, sizeof(size_t));
+    if (context.edges == NULL || context.worker_num_pixels == NULL) {
+        status = ERROR_MEMORY_ALLOC;
+    }
+    if (status == SUCCESS) {
+        status = _shade_neighbor_row(p_config, p_row_above, &context.p_colors_above);
+    }
+    if (status == SUCCESS) {
+        status = _shade_neighbor_row(p_config, p_row_below, &context.p_colors_below);
+    }
+
+    // All edges are found before any pixel is changed, because the search compares the colors of the first sample of every pixel.
+    size_t num_bands = (p_field->size.height + SUPERSAMPLING_BAND_HEIGHT - 1) / SUPERSAMPLING_BAND_HEIGHT;
+    if (status == SUCCESS) {
+        status = _run_band_tasks(&context, p_thread_pool, num_bands, _find_edges);
+    }
+    if (status == SUCCESS) {
+        status = _run_band_tasks(&context, p_thread_pool, num_bands, _supersample_band);
+    }
+    if (status == SUCCESS) {
+        size_t num_pixels = 0;
+        for (size_t i = 0; i < num_workers; i++) {
+            num_pixels += context.worker_num_pixels[i];
+        }
+        *p_num_pixels = num_pixels;
+        *p_num_samples = num_pixels * p_config->supersampling * p_config->supersampling;
+    }
+    free(context.edges);
+    free(context.worker_num_pixels);
+    if (context.p_colors_above != NULL) {
+        free_image_data(context.p_colors_above);
+    }
+    if (context.p_colors_below != NULL) {
+        free_image_data(context.p_colors_below);
+    }
+    free_palette(&context.palette);
+    return status;
+}
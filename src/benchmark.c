@@ -0,0 +1,355 @@
+#include "../include/benchmark.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "../include/config.h"
+#include "../include/image_manager.h"
+#include "../include/iteration_field.h"
+#include "../include/iteration_kernel.h"
+#include "../include/renderer.h"
+#include "../include/status_manager.h"
+
+/**
+ * The version of the JSON files. Files of another version are not compared.
+ */
+#define BENCHMARK_FILE_VERSION 1
+
+/**
+ * The time in seconds that every run is at least repeated for, so short runs are measured often enough to be stable.
+ */
+#define BENCHMARK_MIN_RUN_TIME 0.25
+
+/**
+ * The maximum length of a line of a JSON file that is loaded.
+ */
+#define BENCHMARK_MAX_LINE_LENGTH 1024
+
+/**
+ * A scene of the benchmark. The viewport is a square around the center.
+ */
+typedef struct {
+    const char *name;
+    double center_real;
+    double center_imag;
+    double width;
+    // The smallest iteration depth the scene is rendered with. The other depths are multiples of it.
+    size_t iteration_depth;
+} BenchmarkScene;
+
+static const BenchmarkScene SCENES[BENCHMARK_NUM_SCENES] = {
+    {"full_set", -0.75, 0.0, 3.0, 256},
+    {"seahorse_valley", -0.7453, 0.1127, 0.01, 1024},
+    {"minibrot_interior", -1.7548776662, 0.0, 0.02, 1024},
+    {"filament_boundary", -0.1011, 0.9563, 0.01, 1024},
+    // Inside of the period-3 bulb, which is only detected by the periodicity check.
+    {"deep_interior", -0.1225, 0.7449, 0.05, 4096},
+};
+
+static const size_t WIDTHS[BENCHMARK_NUM_WIDTHS] = {256, 768};
+
+static const size_t DEPTH_FACTORS[BENCHMARK_NUM_DEPTHS] = {1, 4};
+
+/**
+ * The outer colors of the scenes. Shading is part of every run, so the colors only need to be a usual gradient.
+ */
+static uint32_t OUTER_COLORS[] = {0x000764, 0x206BCB, 0xEDFFFF, 0xFFAA00, 0x000200};
+
+/**
+ * Returns the wall clock time in seconds.
+ *
+ * @return The time in seconds since an arbitrary point in the past.
+ */
+double _get_benchmark_time(void) {
+    struct timeval time;
+    gettimeofday(&time, NULL);
+    return (double)time.tv_sec + (double)time.tv_usec / 1e6;
+}
+
+/**
+ * Resets the peak resident set size of the process to its current resident set size, if the platform supports it.
+ * On Linux, this is done by writing 5 to /proc/self/clear_refs.
+ */
+void _reset_peak_rss(void) {
+#ifdef __linux__
+    FILE *file = fopen("/proc/self/clear_refs", "w");
+    if (file != NULL) {
+        fputs("5", file);
+        fclose(file);
+    }
+#endif
+}
+
+/**
+ * Returns the peak resident set size of the process.
+ *
+ * @return The peak resident set size in bytes, or 0 if it is not known.
+ */
+size_t _get_peak_rss(void) {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return (size_t)counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return (size_t)usage.ru_maxrss;
+#else
+    return (size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+/**
+ * Creates the configuration of a scene.
+ *
+ * @param p_scene A pointer to the scene.
+ * @param iteration_depth The iteration depth.
+ * @param p_config A pointer to store the configuration. Its outer colors are static and must not be freed.
+ */
+void _create_scene_configuration(const BenchmarkScene *p_scene, size_t iteration_depth, Configuration *p_config) {
+    memset(p_config, 0, sizeof(Configuration));
+    p_config->viewport.lower_left.real = p_scene->center_real - p_scene->width / 2;
+    p_config->viewport.lower_left.imag = p_scene->center_imag - p_scene->width / 2;
+    p_config->viewport.upper_right.real = p_scene->center_real + p_scene->width / 2;
+    p_config->viewport.upper_right.imag = p_scene->center_imag + p_scene->width / 2;
+    p_config->iteration_depth = iteration_depth;
+    p_config->interior_checks = INTERIOR_CHECK_ALL;
+    p_config->power = 2;
+    p_config->render_mode = RENDER_MODE_BRUTE_FORCE;
+    p_config->inner_color = 0x000000;
+    p_config->outer_colors = OUTER_COLORS;
+    p_config->num_outer_colors = sizeof(OUTER_COLORS) / sizeof(OUTER_COLORS[0]);
+}
+
+/**
+ * Renders a single run of the benchmark as often as requested, and at least for BENCHMARK_MIN_RUN_TIME, and measures it.
+ * The buffers are allocated in every repetition, so the peak resident set size includes them.
+ *
+ * @param p_thread_pool The thread pool, or NULL.
+ * @param config The configuration of the run.
+ * @param num_repetitions The number of repetitions.
+ * @param p_result A pointer to the result, whose scene, width and iteration depth are already set.
+ * @return Status code.
+ */
+int _run_benchmark_run(ThreadPool *p_thread_pool, Configuration config, size_t num_repetitions, BenchmarkResult *p_result) {
+    ImageSize size;
+    int status = calc_image_size(config.viewport, p_result->width, &size);
+    if (status != SUCCESS) return status;
+    p_result->height = size.height;
+    p_result->wall_time = 0;
+    p_result->peak_rss = 0;
+    _reset_peak_rss();
+
+    double run_start = _get_benchmark_time();
+    for (size_t repetition = 0; repetition < num_repetitions || _get_benchmark_time() - run_start < BENCHMARK_MIN_RUN_TIME; repetition++) {
+        double start = _get_benchmark_time();
+        ImageData *p_image_data;
+        status = create_image_data_with_size(size, &p_image_data);
+        if (status != SUCCESS) break;
+        IterationField field;
+        status = create_iteration_field(size, config.iteration_depth, &field);
+        if (status == SUCCESS) {
+            RenderStatistics statistics;
+            status = render_to_image(config, p_thread_pool, NULL, &field, p_image_data, NULL, &statistics);
+            double wall_time = _get_benchmark_time() - start;
+            if (repetition == 0 || wall_time < p_result->wall_time) {
+                p_result->wall_time = wall_time;
+            }
+            p_result->num_iterations = statistics.histogram.num_iterations;
+            free_iteration_field(&field);
+        }
+        free_image_data(p_image_data);
+        if (status != SUCCESS) return status;
+    }
+
+    p_result->peak_rss = _get_peak_rss();
+    // A run that is faster than the timer still gets finite rates.
+    double wall_time = p_result->wall_time > 1e-6 ? p_result->wall_time : 1e-6;
+    p_result->pixels_per_second = (double)(size.width * size.height) / wall_time;
+    p_result->iterations_per_second = (double)p_result->num_iterations / wall_time;
+    return SUCCESS;
+}
+
+int run_benchmark(ThreadPool *p_thread_pool, size_t num_repetitions, BenchmarkResult *results, void (*progress_callback)(double)) {
+    if (num_repetitions == 0) return GENERIC_ERROR;
+    size_t run = 0;
+    for (size_t s = 0; s < BENCHMARK_NUM_SCENES; s++) {
+        for (size_t d = 0; d < BENCHMARK_NUM_DEPTHS; d++) {
+            for (size_t w = 0; w < BENCHMARK_NUM_WIDTHS; w++) {
+                BenchmarkResult *p_result = &results[run];
+                memset(p_result, 0, sizeof(BenchmarkResult));
+                snprintf(p_result->scene, BENCHMARK_MAX_NAME_LENGTH, "%s", SCENES[s].name);
+                p_result->width = WIDTHS[w];
+                p_result->iteration_depth = SCENES[s].iteration_depth * DEPTH_FACTORS[d];
+
+                Configuration config;
+                _create_scene_configuration(&SCENES[s], p_result->iteration_depth, &config);
+                int status = _run_benchmark_run(p_thread_pool, config, num_repetitions, p_result);
+                if (status != SUCCESS) return status;
+                run++;
+                if (progress_callback != NULL) {
+                    progress_callback((double)run / BENCHMARK_NUM_RUNS);
+                }
+            }
+        }
+    }
+    return SUCCESS;
+}
+
+int save_benchmark_results(const char *path, const BenchmarkResult *results, size_t num_results, size_t num_threads) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) return ERROR_FILE_ACCESS;
+    fprintf(file, "{\n");
+    fprintf(file, "  \"version\": %d,\n", BENCHMARK_FILE_VERSION);
+    fprintf(file, "  \"threads\": %zu,\n", num_threads);
+    fprintf(file, "  \"iteration_kernel\": \"%s\",\n", get_iteration_kernel_name());
+    fprintf(file, "  \"runs\": [\n");
+    for (size_t i = 0; i < num_results; i++) {
+        const BenchmarkResult *p_result = &results[i];
+        fprintf(file,
+                "    {\"scene\": \"%s\", \"width\": %zu, \"height\": %zu, \"iteration_depth\": %zu, \"wall_time\": %.6f, "
+                "\"pixels_per_second\": %.1f, \"iterations\": %llu, \"iterations_per_second\": %.1f, \"peak_rss\": %zu}%s\n",
+                p_result->scene, p_result->width, p_result->height, p_result->iteration_depth, p_result->wall_time, p_result->pixels_per_second,
+                (unsigned long long)p_result->num_iterations, p_result->iterations_per_second, p_result->peak_rss, i + 1 < num_results ? "," : "");
+    }
+    fprintf(file, "  ]\n");
+    fprintf(file, "}\n");
+    return fclose(file) == 0 ? SUCCESS : ERROR_FILE_ACCESS;
+}
+
+/**
+ * Finds the value of a key in a line of a JSON file.
+ *
+ * @param line The line.
+ * @param key The key without quotes.
+ * @return A pointer to the first character of the value, or NULL if the line does not contain the key.
+ */
+const char *_find_json_value(const char *line, const char *key) {
+    char pattern[BENCHMARK_MAX_NAME_LENGTH + 4];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *p_value = strstr(line, pattern);
+    if (p_value == NULL) return NULL;
+    p_value += strlen(pattern);
+    while (*p_value == ' ') {
+        p_value++;
+    }
+    return p_value;
+}
+
+/**
+ * Parses a number of a line of a JSON file.
+ *
+ * @param line The line.
+ * @param key The key of the number.
+ * @param p_value A pointer to store the number.
+ * @return Status code.
+ */
+int _parse_json_number(const char *line, const char *key, double *p_value) {
+    const char *p_value_str = _find_json_value(line, key);
+    if (p_value_str == NULL) return ERROR_INVALID_BENCHMARK_FILE;
+    char *p_end;
+    *p_value = strtod(p_value_str, &p_end);
+    return p_end != p_value_str ? SUCCESS : ERROR_INVALID_BENCHMARK_FILE;
+}
+
+/**
+ * Parses a run of a JSON file, which is written on a single line.
+ *
+ * @param line The line.
+ * @param p_result A pointer to store the result of the run.
+ * @return Status code.
+ */
+int _parse_benchmark_result(const char *line, BenchmarkResult *p_result) {
+    memset(p_result, 0, sizeof(BenchmarkResult));
+    const char *p_scene = _find_json_value(line, "scene");
+    if (p_scene == NULL || *p_scene != '"') return ERROR_INVALID_BENCHMARK_FILE;
+    p_scene++;
+    const char *p_scene_end = strchr(p_scene, '"');
+    if (p_scene_end == NULL || p_scene_end - p_scene >= BENCHMARK_MAX_NAME_LENGTH) return ERROR_INVALID_BENCHMARK_FILE;
+    memcpy(p_result->scene, p_scene, (size_t)(p_scene_end - p_scene));
+
+    double width, height, iteration_depth, num_iterations, peak_rss;
+    int status = _parse_json_number(line, "width", &width);
+    if (status == SUCCESS) status = _parse_json_number(line, "height", &height);
+    if (status == SUCCESS) status = _parse_json_number(line, "iteration_depth", &iteration_depth);
+    if (status == SUCCESS) status = _parse_json_number(line, "wall_time", &p_result->wall_time);
+    if (status == SUCCESS) status = _parse_json_number(line, "pixels_per_second", &p_result->pixels_per_second);
+    if (status == SUCCESS) status = _parse_json_number(line, "iterations", &num_iterations);
+    if (status == SUCCESS) status = _parse_json_number(line, "iterations_per_second", &p_result->iterations_per_second);
+    if (status == SUCCESS) status = _parse_json_number(line, "peak_rss", &peak_rss);
+    if (status != SUCCESS) return status;
+    p_result->width = (size_t)width;
+    p_result->height = (size_t)height;
+    p_result->iteration_depth = (size_t)iteration_depth;
+    p_result->num_iterations = (uint64_t)num_iterations;
+    p_result->peak_rss = (size_t)peak_rss;
+    return SUCCESS;
+}
+
+int load_benchmark_results(const char *path, BenchmarkResult **p_p_results, size_t *p_num_results) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) return ERROR_FILE_ACCESS;
+
+    char line[BENCHMARK_MAX_LINE_LENGTH];
+    BenchmarkResult *results = NULL;
+    size_t num_results = 0;
+    size_t capacity = 0;
+    bool has_version = false;
+    int status = SUCCESS;
+    while (status == SUCCESS && fgets(line, sizeof(line), file) != NULL) {
+        double version;
+        if (_parse_json_number(line, "version", &version) == SUCCESS) {
+            has_version = true;
+            if (version != BENCHMARK_FILE_VERSION) status = ERROR_INVALID_BENCHMARK_FILE;
+            continue;
+        }
+        if (_find_json_value(line, "scene") == NULL) continue;
+        if (num_results == capacity) {
+            capacity = capacity == 0 ? BENCHMARK_NUM_RUNS : 2 * capacity;
+            BenchmarkResult *grown = (BenchmarkResult *)realloc(results, capacity * sizeof(BenchmarkResult));
+            if (grown == NULL) {
+                status = ERROR_MEMORY_ALLOC;
+                break;
+            }
+            results = grown;
+        }
+        status = _parse_benchmark_result(line, &results[num_results]);
+        num_results++;
+    }
+    fclose(file);
+    if (status == SUCCESS && !has_version) {
+        status = ERROR_INVALID_BENCHMARK_FILE;
+    }
+    if (status != SUCCESS) {
+        free(results);
+        return status;
+    }
+    *p_p_results = results;
+    *p_num_results = num_results;
+    return SUCCESS;
+}
+
+const BenchmarkResult *find_benchmark_result(const BenchmarkResult *p_result, const BenchmarkResult *results, size_t num_results) {
+    for (size_t i = 0; i < num_results; i++) {
+        if (strcmp(results[i].scene, p_result->scene) == 0 && results[i].width == p_result->width &&
+            results[i].iteration_depth == p_result->iteration_depth) {
+            return &results[i];
+        }
+    }
+    return NULL;
+}
+
+bool is_benchmark_regression(const BenchmarkResult *p_result, const BenchmarkResult *p_baseline, double tolerance) {
+    return p_result->wall_time > p_baseline->wall_time * (1.0 + tolerance);
+}
@@ -1,3 +1,9 @@
 #include "../include/config.h"
 
-#include "../include/status_manager.h"
+#include <stdlib.h>
+
+void free_configuration(Configuration *p_config) {
+    free(p_config->outer_colors);
+    p_config->outer_colors = NULL;
+    p_config->num_outer_colors = 0;
+}
@@ -0,0 +1,548 @@
+#include "../include/connection.h"
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <afunix.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "../include/status_manager.h"
+
+#ifdef _WIN32
+typedef SOCKET SocketHandle;
+#define INVALID_SOCKET_HANDLE INVALID_SOCKET
+#define SHUT_RDWR SD_BOTH
+#define close_socket closesocket
+#else
+typedef int SocketHandle;
+#define INVALID_SOCKET_HANDLE (-1)
+#define close_socket close
+#endif
+
+// Writing to a connection that was closed by the other side must fail instead of raising SIGPIPE.
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+/**
+ * The number of bytes that are received at once.
+ */
+#define RECEIVE_BUFFER_SIZE 4096
+
+/**
+ * The initial size of a line buffer. Longer lines make the buffer grow.
+ */
+#define INITIAL_LINE_CAPACITY 256
+
+/**
+ * The host that a TCP listener connects to, to make accept_connection return.
+ */
+#define LOOPBACK_HOST "127.0.0.1"
+
+struct Listener {
+    SocketHandle socket;
+    // The path of the socket file of a Unix domain socket, or NULL.
+    char *path;
+    // The port of a TCP socket, or NULL.
+    char *port;
+    // Protects the interrupted flag, which is set by another thread than the one that accepts the connections.
+    pthread_mutex_t lock;
+    bool interrupted;
+};
+
+struct Connection {
+    SocketHandle socket;
+    // The received bytes that have not been read yet are buffer[start] to buffer[end - 1].
+    char buffer[RECEIVE_BUFFER_SIZE];
+    size_t start;
+    size_t end;
+};
+
+/**
+ * Initializes the socket library. Only needed on Windows, where it may be called any number of times.
+ *
+ * @return Status code.
+ */
+int _init_sockets(void) {
+#ifdef _WIN32
+    WSADATA data;
+    if (WSAStartup(MAKEWORD(2, 2), &data) != 0) return ERROR_SOCKET;
+#endif
+    return SUCCESS;
+}
+
+/**
+ * Fills the address of a Unix domain socket.
+ *
+ * @param path The path of the socket file.
+ * @param p_address A pointer to store the address.
+ * @return Status code.
+ */
+int _get_unix_address(const char *path, struct sockaddr_un *p_address) {
+    memset(p_address, 0, sizeof(struct sockaddr_un));
+    p_address->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(p_address->sun_path)) return ERROR_SOCKET;
+    strcpy(p_address->sun_path, path);
+    return SUCCESS;
+}
+
+/**
+ * Connects a new socket to a Unix domain socket.
+ *
+ * @param path The path of the socket file.
+ * @return The connected socket, or INVALID_SOCKET_HANDLE if nobody is listening.
+ */
+SocketHandle _connect_unix_socket(const char *path) {
+    struct sockaddr_un address;
+    if (_get_unix_address(path, &address) != SUCCESS) return INVALID_SOCKET_HANDLE;
+    SocketHandle handle = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (handle == INVALID_SOCKET_HANDLE) return INVALID_SOCKET_HANDLE;
+    if (connect(handle, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        close_socket(handle);
+        return INVALID_SOCKET_HANDLE;
+    }
+    return handle;
+}
+
+/**
+ * Switches a socket between blocking and non-blocking mode.
+ *
+ * @param handle The socket.
+ * @param blocking Whether calls on the socket wait until they can be completed.
+ * @return Status code.
+ */
+int _set_blocking(SocketHandle handle, bool blocking) {
+#ifdef _WIN32
+    u_long non_blocking = blocking ? 0 : 1;
+    if (ioctlsocket(handle, FIONBIO, &non_blocking) != 0) return ERROR_SOCKET;
+#else
+    int flags = fcntl(handle, F_GETFL, 0);
+    if (flags < 0) return ERROR_SOCKET;
+    flags = blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK;
+    if (fcntl(handle, F_SETFL, flags) != 0) return ERROR_SOCKET;
+#endif
+    return SUCCESS;
+}
+
+/**
+ * Connects a socket to an address, but gives up after a timeout.
+ *
+ * @param handle The socket.
+ * @param p_address A pointer to the address.
+ * @param address_length The size of the address.
+ * @param timeout_seconds The time to wait for the other side, or 0 to wait as long as the system does.
+ * @return Status code. ERROR_SOCKET if the connection was refused or the timeout elapsed.
+ */
+int _connect_with_timeout(SocketHandle handle, const struct sockaddr *p_address, size_t address_length, unsigned int timeout_seconds) {
+    if (timeout_seconds == 0) return connect(handle, p_address, (int)address_length) == 0 ? SUCCESS : ERROR_SOCKET;
+
+    if (_set_blocking(handle, false) != SUCCESS) return ERROR_SOCKET;
+    if (connect(handle, p_address, (int)address_length) != 0) {
+#ifdef _WIN32
+        if (WSAGetLastError() != WSAEWOULDBLOCK) return ERROR_SOCKET;
+#else
+        if (errno != EINPROGRESS) return ERROR_SOCKET;
+#endif
+        // The socket becomes writable when the connection is established or has failed.
+        fd_set sockets;
+        FD_ZERO(&sockets);
+        FD_SET(handle, &sockets);
+        struct timeval timeout = {(long)timeout_seconds, 0};
+        if (select((int)handle + 1, NULL, &sockets, NULL, &timeout) != 1) return ERROR_SOCKET;
+        int error = 0;
+        socklen_t error_length = sizeof(error);
+        if (getsockopt(handle, SOL_SOCKET, SO_ERROR, (char *)&error, &error_length) != 0 || error != 0) return ERROR_SOCKET;
+    }
+    return _set_blocking(handle, true);
+}
+
+/**
+ * Connects a new socket to a TCP port. All addresses of the host are tried until one accepts the connection.
+ * Small messages are sent right away, because the other side usually waits for them before it answers.
+ *
+ * @param host The name or the address of the host.
+ * @param port The port number.
+ * @param timeout_seconds The time to wait for each address, or 0 to wait as long as the system does.
+ * @return The connected socket, or INVALID_SOCKET_HANDLE if the host can not be reached.
+ */
+SocketHandle _connect_tcp_socket(const char *host, const char *port, unsigned int timeout_seconds) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *addresses;
+    if (getaddrinfo(host, port, &hints, &addresses) != 0) return INVALID_SOCKET_HANDLE;
+
+    SocketHandle handle = INVALID_SOCKET_HANDLE;
+    for (struct addrinfo *p_address = addresses; p_address != NULL && handle == INVALID_SOCKET_HANDLE; p_address = p_address->ai_next) {
+        handle = socket(p_address->ai_family, p_address->ai_socktype, p_address->ai_protocol);
+        if (handle != INVALID_SOCKET_HANDLE && _connect_with_timeout(handle, p_address->ai_addr, p_address->ai_addrlen, timeout_seconds) != SUCCESS) {
+            close_socket(handle);
+            handle = INVALID_SOCKET_HANDLE;
+        }
+    }
+    freeaddrinfo(addresses);
+    if (handle != INVALID_SOCKET_HANDLE) {
+        int no_delay = 1;
+        setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, (const char *)&no_delay, sizeof(no_delay));
+    }
+    return handle;
+}
+
+/**
+ * Creates a connection for a connected socket.
+ *
+ * @param handle The connected socket. It is closed if the connection can not be created.
+ * @param p_p_connection A pointer to store the connection.
+ * @return Status code.
+ */
+int _create_connection(SocketHandle handle, Connection **p_p_connection) {
+    Connection *p_connection = (Connection *)malloc(sizeof(Connection));
+    if (p_connection == NULL) {
+        close_socket(handle);
+        return ERROR_MEMORY_ALLOC;
+    }
+    p_connection->socket = handle;
+    p_connection->start = 0;
+    p_connection->end = 0;
+    *p_p_connection = p_connection;
+    return SUCCESS;
+}
+
+int open_unix_listener(const char *path, Listener **p_p_listener) {
+    struct sockaddr_un address;
+    int status = _init_sockets();
+    if (status == SUCCESS) {
+        status = _get_unix_address(path, &address);
+    }
+    if (status != SUCCESS) return status;
+
+    // A socket file stays behind when a process exits without closing its listener. It is only removed if nobody listens on it.
+    SocketHandle other = _connect_unix_socket(path);
+    if (other != INVALID_SOCKET_HANDLE) {
+        close_socket(other);
+        return ERROR_SOCKET;
+    }
+    remove(path);
+
+    Listener *p_listener = (Listener *)calloc(1, sizeof(Listener));
+    if (p_listener == NULL) return ERROR_MEMORY_ALLOC;
+    p_listener->path = (char *)malloc(strlen(path) + 1);
+    p_listener->socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (p_listener->path == NULL || p_listener->socket == INVALID_SOCKET_HANDLE) {
+        status = p_listener->path == NULL ? ERROR_MEMORY_ALLOC : ERROR_SOCKET;
+    } else if (bind(p_listener->socket, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(p_listener->socket, SOMAXCONN) != 0) {
+        status = ERROR_SOCKET;
+    }
+    if (status != SUCCESS) {
+        if (p_listener->socket != INVALID_SOCKET_HANDLE) close_socket(p_listener->socket);
+        free(p_listener->path);
+        free(p_listener);
+        return status;
+    }
+    strcpy(p_listener->path, path);
+    pthread_mutex_init(&p_listener->lock, NULL);
+    *p_p_listener = p_listener;
+    return SUCCESS;
+}
+
+int open_tcp_listener(const char *port, Listener **p_p_listener) {
+    int status = _init_sockets();
+    if (status != SUCCESS) return status;
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+    struct addrinfo *p_address;
+    if (getaddrinfo(NULL, port, &hints, &p_address) != 0) return ERROR_SOCKET;
+
+    Listener *p_listener = (Listener *)calloc(1, sizeof(Listener));
+    if (p_listener == NULL) {
+        freeaddrinfo(p_address);
+        return ERROR_MEMORY_ALLOC;
+    }
+    p_listener->port = (char *)malloc(strlen(port) + 1);
+    p_listener->socket = socket(p_address->ai_family, p_address->ai_socktype, p_address->ai_protocol);
+    if (p_listener->port == NULL || p_listener->socket == INVALID_SOCKET_HANDLE) {
+        status = p_listener->port == NULL ? ERROR_MEMORY_ALLOC : ERROR_SOCKET;
+    } else {
+        // A restarted process can listen on the port again while connections of the previous one are still closing.
+        int reuse = 1;
+        setsockopt(p_listener->socket, SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse, sizeof(reuse));
+        if (bind(p_listener->socket, p_address->ai_addr, (int)p_address->ai_addrlen) != 0 || listen(p_listener->socket, SOMAXCONN) != 0) {
+            status = ERROR_SOCKET;
+        }
+    }
+    freeaddrinfo(p_address);
+    if (status != SUCCESS) {
+        if (p_listener->socket != INVALID_SOCKET_HANDLE) close_socket(p_listener->socket);
+        free(p_listener->port);
+        free(p_listener);
+        return status;
+    }
+    strcpy(p_listener->port, port);
+    pthread_mutex_init(&p_listener->lock, NULL);
+    *p_p_listener = p_listener;
+    return SUCCESS;
+}
+
+int connect_tcp(const char *address, unsigned int timeout_seconds, Connection **p_p_connection) {
+    int status = _init_sockets();
+    if (status != SUCCESS) return status;
+    // The port follows the last colon, so the host may be an IPv6 address in brackets.
+    const char *p_colon = strrchr(address, ':');
+    if (p_colon == NULL || p_colon == address || p_colon[1] == 0) return ERROR_SOCKET;
+    size_t host_length = (size_t)(p_colon - address);
+    if (address[0] == '[' && address[host_length - 1] == ']') {
+        address++;
+        host_length -= 2;
+    }
+    char *host = (char *)malloc(host_length + 1);
+    if (host == NULL) return ERROR_MEMORY_ALLOC;
+    memcpy(host, address, host_length);
+    host[host_length] = 0;
+    SocketHandle handle = _connect_tcp_socket(host, p_colon + 1, timeout_seconds);
+    free(host);
+    if (handle == INVALID_SOCKET_HANDLE) return ERROR_SOCKET;
+    return _create_connection(handle, p_p_connection);
+}
+
+int accept_connection(Listener *p_listener, Connection **p_p_connection) {
+    SocketHandle handle = accept(p_listener->socket, NULL, NULL);
+    pthread_mutex_lock(&p_listener->lock);
+    bool interrupted = p_listener->interrupted;
+    pthread_mutex_unlock(&p_listener->lock);
+    if (handle == INVALID_SOCKET_HANDLE) return ERROR_SOCKET;
+    if (interrupted) {
+        close_socket(handle);
+        return ERROR_SOCKET;
+    }
+
+    if (p_listener->port != NULL) {
+        int no_delay = 1;
+        setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, (const char *)&no_delay, sizeof(no_delay));
+    }
+    return _create_connection(handle, p_p_connection);
+}
+
+void interrupt_listener(Listener *p_listener) {
+    pthread_mutex_lock(&p_listener->lock);
+    p_listener->interrupted = true;
+    pthread_mutex_unlock(&p_listener->lock);
+    // Closing or shutting down a listening socket does not wake up accept on every platform, but a connection does.
+    SocketHandle handle = p_listener->path != NULL ? _connect_unix_socket(p_listener->path) : _connect_tcp_socket(LOOPBACK_HOST, p_listener->port, 0);
+    if (handle != INVALID_SOCKET_HANDLE) {
+        close_socket(handle);
+    }
+}
+
+void close_listener(Listener *p_listener) {
+    if (p_listener == NULL) return;
+    close_socket(p_listener->socket);
+    if (p_listener->path != NULL) {
+        remove(p_listener->path);
+    }
+    pthread_mutex_destroy(&p_listener->lock);
+    free(p_listener->path);
+    free(p_listener->port);
+    free(p_listener);
+}
+
+int read_line(Connection *p_connection, char **p_p_line, size_t *p_capacity) {
+    size_t length = 0;
+    while (true) {
+        if (p_connection->start == p_connection->end) {
+            int received = recv(p_connection->socket, p_connection->buffer, RECEIVE_BUFFER_SIZE, 0);
+            if (received < 0) return ERROR_SOCKET;
+            if (received == 0) {
+                // The last line may end without a line break.
+                if (length == 0) return 0;
+                break;
+            }
+            p_connection->start = 0;
+            p_connection->end = (size_t)received;
+        }
+
+        char *p_start = p_connection->buffer + p_connection->start;
+        size_t available = p_connection->end - p_connection->start;
+        char *p_line_break = (char *)memchr(p_start, '\n', available);
+        size_t count = p_line_break != NULL ? (size_t)(p_line_break - p_start) : available;
+        if (*p_capacity < length + count + 1) {
+            size_t capacity = *p_capacity < INITIAL_LINE_CAPACITY ? INITIAL_LINE_CAPACITY : *p_capacity;
+            while (capacity < length + count + 1) {
+                capacity *= 2;
+            }
+            char *p_line = (char *)realloc(*p_p_line, capacity);
+            if (p_line == NULL) return ERROR_MEMORY_ALLOC;
+            *p_p_line = p_line;
+            *p_capacity = capacity;
+        }
+        memcpy(*p_p_line + length, p_start, count);
+        length += count;
+        p_connection->start += count;
+        if (p_line_break != NULL) {
+            p_connection->start++;
+            break;
+        }
+    }
+
+    if (length > 0 && (*p_p_line)[length - 1] == '\r') {
+        length--;
+    }
+    (*p_p_line)[length] = 0;
+    return 1;
+}
+
+int read_configuration_text(Connection *p_connection, char **p_p_text) {
+    char *text = (char *)calloc(1, 1);
+    if (text == NULL) return ERROR_MEMORY_ALLOC;
+    size_t length = 0;
+    char *line = NULL;
+    size_t capacity = 0;
+    int status;
+    while ((status = read_line(p_connection, &line, &capacity)) > 0 && strcmp(line, END_OF_CONFIGURATION) != 0) {
+        size_t line_length = strlen(line);
+        char *p_text = (char *)realloc(text, length + line_length + 2);
+        if (p_text == NULL) {
+            status = ERROR_MEMORY_ALLOC;
+            break;
+        }
+        text = p_text;
+        memcpy(text + length, line, line_length);
+        length += line_length;
+        text[length++] = '\n';
+        text[length] = 0;
+    }
+    free(line);
+    if (status <= 0) {
+        free(text);
+        return status < 0 ? status : ERROR_SOCKET;
+    }
+    *p_p_text = text;
+    return SUCCESS;
+}
+
+int write_configuration_file(Connection *p_connection, const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return ERROR_FILE_NOT_FOUND;
+    int status = SUCCESS;
+    bool line_ended = true;
+    char chunk[RECEIVE_BUFFER_SIZE];
+    size_t count;
+    while (status == SUCCESS && (count = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        status = write_bytes(p_connection, chunk, count);
+        line_ended = chunk[count - 1] == '\n';
+    }
+    if (status == SUCCESS && ferror(file)) {
+        status = ERROR_FILE_ACCESS;
+    }
+    fclose(file);
+    // The last line of the file may end without a line break.
+    if (status == SUCCESS && !line_ended) {
+        status = write_bytes(p_connection, "\n", 1);
+    }
+    if (status == SUCCESS) {
+        status = write_line(p_connection, END_OF_CONFIGURATION);
+    }
+    return status;
+}
+
+int read_bytes(Connection *p_connection, void *buffer, size_t size) {
+    char *p_bytes = (char *)buffer;
+    // Bytes that were received together with the last line come first.
+    size_t buffered = p_connection->end - p_connection->start;
+    size_t count = buffered < size ? buffered : size;
+    memcpy(p_bytes, p_connection->buffer + p_connection->start, count);
+    p_connection->start += count;
+    p_bytes += count;
+    size -= count;
+    while (size > 0) {
+        // recv takes an int on Windows, so large buffers are received in chunks.
+        int chunk = size < (1 << 30) ? (int)size : (1 << 30);
+        int received = recv(p_connection->socket, p_bytes, chunk, 0);
+        if (received <= 0) return ERROR_SOCKET;
+        p_bytes += received;
+        size -= (size_t)received;
+    }
+    return SUCCESS;
+}
+
+int write_bytes(Connection *p_connection, const void *buffer, size_t size) {
+    const char *p_bytes = (const char *)buffer;
+    while (size > 0) {
+        // send takes an int on Windows, so large buffers are sent in chunks.
+        int chunk = size < (1 << 30) ? (int)size : (1 << 30);
+        int sent = send(p_connection->socket, p_bytes, chunk, SEND_FLAGS);
+        if (sent <= 0) return ERROR_SOCKET;
+        p_bytes += sent;
+        size -= (size_t)sent;
+    }
+    return SUCCESS;
+}
+
+int write_line(Connection *p_connection, const char *format, ...) {
+    va_list arguments;
+    va_start(arguments, format);
+    va_list copy;
+    va_copy(copy, arguments);
+    int length = vsnprintf(NULL, 0, format, copy);
+    va_end(copy);
+    if (length < 0) {
+        va_end(arguments);
+        return GENERIC_ERROR;
+    }
+
+    char *line = (char *)malloc((size_t)length + 2);
+    if (line == NULL) {
+        va_end(arguments);
+        return ERROR_MEMORY_ALLOC;
+    }
+    vsnprintf(line, (size_t)length + 1, format, arguments);
+    va_end(arguments);
+    line[length] = '\n';
+    int status = write_bytes(p_connection, line, (size_t)length + 1);
+    free(line);
+    return status;
+}
+
+int set_connection_timeout(Connection *p_connection, unsigned int timeout_seconds) {
+#ifdef _WIN32
+    DWORD timeout = (DWORD)timeout_seconds * 1000;
+#else
+    struct timeval timeout = {(long)timeout_seconds, 0};
+#endif
+    if (setsockopt(p_connection->socket, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout)) != 0) return ERROR_SOCKET;
+    if (setsockopt(p_connection->socket, SOL_SOCKET, SO_SNDTIMEO, (const char *)&timeout, sizeof(timeout)) != 0) return ERROR_SOCKET;
+    return SUCCESS;
+}
+
+void interrupt_connection(Connection *p_connection) {
+    shutdown(p_connection->socket, SHUT_RDWR);
+}
+
+void close_connection(Connection *p_connection) {
+    if (p_connection == NULL) return;
+    close_socket(p_connection->socket);
+    free(p_connection);
+}
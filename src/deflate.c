@@ -0,0 +1,542 @@
+#include "../include/deflate.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/status_manager.h"
+
+/**
+ * The shortest and the longest match of a deflate stream.
+ */
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+
+/**
+ * The hash table of the match finder has 2^HASH_BITS entries. Every entry is the start of a chain of earlier positions
+ * with the same hash of their first MIN_MATCH bytes. At most MAX_CHAIN_LENGTH positions of a chain are compared,
+ * which bounds the time per byte. Long runs of the same bytes find a match of MAX_MATCH bytes at the first position anyway.
+ */
+#define HASH_BITS 15
+#define HASH_SIZE (1 << HASH_BITS)
+#define MAX_CHAIN_LENGTH 32
+
+/**
+ * The number of literals and matches of a block. Every block gets its own Huffman codes, so they adapt to the data.
+ */
+#define MAX_BLOCK_TOKENS 16384
+
+/**
+ * The number of symbols of the three Huffman codes of a dynamic block and the longest codes they may have.
+ */
+#define NUM_LITERAL_LENGTH_SYMBOLS 286
+#define NUM_DISTANCE_SYMBOLS 30
+#define NUM_CODE_LENGTH_SYMBOLS 19
+#define MAX_CODE_LENGTH 15
+#define MAX_CODE_LENGTH_CODE_LENGTH 7
+#define END_OF_BLOCK 256
+
+/**
+ * The largest number of bytes of a token: a length code with its extra bits and a distance code with its extra bits,
+ * and of the header of a dynamic block.
+ */
+#define MAX_TOKEN_BYTES 6
+#define MAX_BLOCK_HEADER_BYTES 1024
+
+static const uint16_t LENGTH_BASES[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                          31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t LENGTH_EXTRA_BITS[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t DISTANCE_BASES[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                            193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t DISTANCE_EXTRA_BITS[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+// The order in which the lengths of the code length code are stored, so the rarely used lengths at the end can be left out.
+static const uint8_t CODE_LENGTH_ORDER[NUM_CODE_LENGTH_SYMBOLS] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+/**
+ * A literal or a match of the LZ77 stage. The distance is 0 for literals.
+ */
+typedef struct {
+    uint16_t literal_or_length;
+    uint16_t distance;
+} Token;
+
+/**
+ * Writes bits to a byte buffer, least significant bit first. The buffer must have enough capacity, see _reserve_byte_buffer.
+ */
+typedef struct {
+    ByteBuffer *p_buffer;
+    uint64_t bits;
+    unsigned int num_bits;
+} BitWriter;
+
+/**
+ * Makes sure that a buffer can take a number of further bytes without growing.
+ *
+ * @param p_buffer A pointer to the buffer.
+ * @param count The number of further bytes.
+ * @return Status code.
+ */
+int _reserve_byte_buffer(ByteBuffer *p_buffer, size_t count) {
+    if (count > SIZE_MAX - p_buffer->size) return ERROR_ARITHMETIC_OVERFLOW;
+    if (p_buffer->size + count <= p_buffer->capacity) return SUCCESS;
+    size_t capacity = p_buffer->capacity > 0 ? p_buffer->capacity : 256;
+    while (capacity < p_buffer->size + count) {
+        capacity = capacity <= SIZE_MAX / 2 ? capacity * 2 : p_buffer->size + count;
+    }
+    unsigned char *data = (unsigned char *)realloc(p_buffer->data, capacity);
+    if (data == NULL) return ERROR_MEMORY_ALLOC;
+    p_buffer->data = data;
+    p_buffer->capacity = capacity;
+    return SUCCESS;
+}
+
+int append_to_byte_buffer(ByteBuffer *p_buffer, const void *bytes, size_t count) {
+    int status = _reserve_byte_buffer(p_buffer, count);
+    if (status < 0) return status;
+    memcpy(p_buffer->data + p_buffer->size, bytes, count);
+    p_buffer->size += count;
+    return SUCCESS;
+}
+
+void free_byte_buffer(ByteBuffer *p_buffer) {
+    free(p_buffer->data);
+    memset(p_buffer, 0, sizeof(ByteBuffer));
+}
+
+/**
+ * Writes up to 16 bits.
+ *
+ * @param p_writer A pointer to the bit writer.
+ * @param value The bits.
+ * @param count The number of bits.
+ */
+static inline void _write_bits(BitWriter *p_writer, uint32_t value, unsigned int count) {
+    p_writer->bits |= (uint64_t)value << p_writer->num_bits;
+    p_writer->num_bits += count;
+    while (p_writer->num_bits >= 8) {
+        p_writer->p_buffer->data[p_writer->p_buffer->size++] = (unsigned char)p_writer->bits;
+        p_writer->bits >>= 8;
+        p_writer->num_bits -= 8;
+    }
+}
+
+/**
+ * Pads the written bits with zeros to the next byte boundary.
+ *
+ * @param p_writer A pointer to the bit writer.
+ */
+void _align_to_byte(BitWriter *p_writer) {
+    if (p_writer->num_bits > 0) {
+        _write_bits(p_writer, 0, 8 - p_writer->num_bits);
+    }
+}
+
+/**
+ * Computes the lengths of a Huffman code with a limited code length. The frequencies are flattened until the longest code fits,
+ * which costs little, because only rare symbols get codes that long. Every code with at least two symbols is complete.
+ *
+ * @param frequencies The frequencies of the symbols.
+ * @param num_symbols The number of symbols. At most NUM_LITERAL_LENGTH_SYMBOLS.
+ * @param max_length The longest allowed code length.
+ * @param lengths A pointer to store the code length of every symbol, 0 for unused symbols.
+ */
+void _build_code_lengths(const uint32_t *frequencies, size_t num_symbols, unsigned int max_length, uint8_t *lengths) {
+    uint32_t weights[NUM_LITERAL_LENGTH_SYMBOLS];
+    uint16_t symbols[NUM_LITERAL_LENGTH_SYMBOLS];
+    uint64_t node_weights[2 * NUM_LITERAL_LENGTH_SYMBOLS];
+    uint16_t parents[2 * NUM_LITERAL_LENGTH_SYMBOLS];
+    uint8_t depths[2 * NUM_LITERAL_LENGTH_SYMBOLS];
+    memcpy(weights, frequencies, num_symbols * sizeof(uint32_t));
+    memset(lengths, 0, num_symbols);
+
+    for (;;) {
+        // The leaves sorted by their weights, with insertion sort, because there are only a few hundred of them.
+        size_t num_leaves = 0;
+        for (size_t symbol = 0; symbol < num_symbols; symbol++) {
+            if (weights[symbol] == 0) continue;
+            size_t i = num_leaves++;
+            while (i > 0 && weights[symbols[i - 1]] > weights[symbol]) {
+                symbols[i] = symbols[i - 1];
+                i--;
+            }
+            symbols[i] = (uint16_t)symbol;
+        }
+        if (num_leaves == 0) return;
+        if (num_leaves == 1) {
+            lengths[symbols[0]] = 1;
+            return;
+        }
+
+        // The two-queue construction: the inner nodes are created in the order of their weights,
+        // so the two lightest nodes are always at the fronts of the queue of leaves and the queue of inner nodes.
+        for (size_t i = 0; i < num_leaves; i++) {
+            node_weights[i] = weights[symbols[i]];
+        }
+        size_t next_leaf = 0;
+        size_t next_inner = num_leaves;
+        for (size_t node = num_leaves; node < 2 * num_leaves - 1; node++) {
+            for (int child = 0; child < 2; child++) {
+                size_t lightest;
+                if (next_leaf < num_leaves && (next_inner >= node || node_weights[next_leaf] <= node_weights[next_inner])) {
+                    lightest = next_leaf++;
+                } else {
+                    lightest = next_inner++;
+                }
+                node_weights[node] = child == 0 ? node_weights[lightest] : node_weights[node] + node_weights[lightest];
+                parents[lightest] = (uint16_t)node;
+            }
+        }
+
+        // Parents are created after their children, so the depths are computed from the root downwards.
+        unsigned int longest = 0;
+        depths[2 * num_leaves - 2] = 0;
+        for (size_t node = 2 * num_leaves - 2; node-- > 0;) {
+            depths[node] = depths[parents[node]] + 1;
+            if (node < num_leaves && depths[node] > longest) {
+                longest = depths[node];
+            }
+        }
+        if (longest <= max_length) {
+            for (size_t i = 0; i < num_leaves; i++) {
+                lengths[symbols[i]] = depths[i];
+            }
+            return;
+        }
+        for (size_t symbol = 0; symbol < num_symbols; symbol++) {
+            weights[symbol] = (weights[symbol] + 1) / 2;
+        }
+    }
+}
+
+/**
+ * Computes the canonical Huffman codes for code lengths. The codes are bit-reversed, because deflate writes them starting with their
+ * most significant bit, while the bit writer starts with the least significant bit.
+ *
+ * @param lengths The code lengths of the symbols.
+ * @param num_symbols The number of symbols.
+ * @param codes A pointer to store the code of every symbol.
+ */
+void _build_codes(const uint8_t *lengths, size_t num_symbols, uint16_t *codes) {
+    uint16_t num_codes[MAX_CODE_LENGTH + 1] = {0};
+    uint16_t next_codes[MAX_CODE_LENGTH + 1] = {0};
+    for (size_t symbol = 0; symbol < num_symbols; symbol++) {
+        num_codes[lengths[symbol]]++;
+    }
+    num_codes[0] = 0;
+    uint16_t code = 0;
+    for (unsigned int length = 1; length <= MAX_CODE_LENGTH; length++) {
+        code = (uint16_t)((code + num_codes[length - 1]) << 1);
+        next_codes[length] = code;
+    }
+    for (size_t symbol = 0; symbol < num_symbols; symbol++) {
+        unsigned int length = lengths[symbol];
+        if (length == 0) continue;
+        uint16_t canonical = next_codes[length]++;
+        uint16_t reversed = 0;
+        for (unsigned int bit = 0; bit < length; bit++) {
+            reversed = (uint16_t)((reversed << 1) | ((canonical >> bit) & 1));
+        }
+        codes[symbol] = reversed;
+    }
+}
+
+/**
+ * Gives a code at least two symbols, so it is complete. Some decoders reject codes with a single symbol.
+ *
+ * @param frequencies The frequencies of the symbols. Unused symbols get a frequency of 1.
+ * @param num_symbols The number of symbols.
+ */
+void _use_two_symbols(uint32_t *frequencies, size_t num_symbols) {
+    size_t num_used = 0;
+    for (size_t symbol = 0; symbol < num_symbols; symbol++) {
+        num_used += frequencies[symbol] > 0;
+    }
+    for (size_t symbol = 0; symbol < num_symbols && num_used < 2; symbol++) {
+        if (frequencies[symbol] == 0) {
+            frequencies[symbol] = 1;
+            num_used++;
+        }
+    }
+}
+
+/**
+ * Finds the symbol of a length or a distance, whose base is the largest one that is not greater than the value.
+ *
+ * @param bases The ascending bases of the symbols.
+ * @param num_bases The number of symbols.
+ * @param value The length or the distance.
+ * @return The index of the symbol.
+ */
+static inline unsigned int _find_symbol(const uint16_t *bases, unsigned int num_bases, unsigned int value) {
+    unsigned int symbol = num_bases - 1;
+    while (bases[symbol] > value) {
+        symbol--;
+    }
+    return symbol;
+}
+
+/**
+ * Writes the tokens as a block with dynamic Huffman codes.
+ *
+ * @param tokens The tokens.
+ * @param num_tokens The number of tokens.
+ * @param final Whether the block is the last one of the stream.
+ * @param p_writer A pointer to the bit writer. Its buffer must have room for the block.
+ */
+void _write_dynamic_block(const Token *tokens, size_t num_tokens, bool final, BitWriter *p_writer) {
+    uint32_t literal_frequencies[NUM_LITERAL_LENGTH_SYMBOLS] = {0};
+    uint32_t distance_frequencies[NUM_DISTANCE_SYMBOLS] = {0};
+    for (size_t i = 0; i < num_tokens; i++) {
+        if (tokens[i].distance == 0) {
+            literal_frequencies[tokens[i].literal_or_length]++;
+        } else {
+            literal_frequencies[257 + _find_symbol(LENGTH_BASES, 29, tokens[i].literal_or_length)]++;
+            distance_frequencies[_find_symbol(DISTANCE_BASES, 30, tokens[i].distance)]++;
+        }
+    }
+    literal_frequencies[END_OF_BLOCK] = 1;
+    _use_two_symbols(literal_frequencies, NUM_LITERAL_LENGTH_SYMBOLS);
+    _use_two_symbols(distance_frequencies, NUM_DISTANCE_SYMBOLS);
+
+    uint8_t lengths[NUM_LITERAL_LENGTH_SYMBOLS + NUM_DISTANCE_SYMBOLS];
+    uint16_t literal_codes[NUM_LITERAL_LENGTH_SYMBOLS];
+    uint16_t distance_codes[NUM_DISTANCE_SYMBOLS];
+    _build_code_lengths(literal_frequencies, NUM_LITERAL_LENGTH_SYMBOLS, MAX_CODE_LENGTH, lengths);
+    _build_code_lengths(distance_frequencies, NUM_DISTANCE_SYMBOLS, MAX_CODE_LENGTH, lengths + NUM_LITERAL_LENGTH_SYMBOLS);
+    _build_codes(lengths, NUM_LITERAL_LENGTH_SYMBOLS, literal_codes);
+    _build_codes(lengths + NUM_LITERAL_LENGTH_SYMBOLS, NUM_DISTANCE_SYMBOLS, distance_codes);
+
+    // Unused symbols at the end of both codes are left out of the header.
+    size_t num_literal_lengths = NUM_LITERAL_LENGTH_SYMBOLS;
+    while (num_literal_lengths > 257 && lengths[num_literal_lengths - 1] == 0) {
+        num_literal_lengths--;
+    }
+    size_t num_distance_lengths = NUM_DISTANCE_SYMBOLS;
+    while (num_distance_lengths > 1 && lengths[NUM_LITERAL_LENGTH_SYMBOLS + num_distance_lengths - 1] == 0) {
+        num_distance_lengths--;
+    }
+    uint8_t all_lengths[NUM_LITERAL_LENGTH_SYMBOLS + NUM_DISTANCE_SYMBOLS];
+    memcpy(all_lengths, lengths, num_literal_lengths);
+    memcpy(all_lengths + num_literal_lengths, lengths + NUM_LITERAL_LENGTH_SYMBOLS, num_distance_lengths);
+    size_t num_lengths = num_literal_lengths + num_distance_lengths;
+
+    // The code lengths are run length encoded: 16 repeats the previous length 3 to 6 times, 17 and 18 write 3 to 10 and 11 to 138 zeros.
+    uint8_t length_symbols[NUM_LITERAL_LENGTH_SYMBOLS + NUM_DISTANCE_SYMBOLS];
+    uint8_t length_extra[NUM_LITERAL_LENGTH_SYMBOLS + NUM_DISTANCE_SYMBOLS];
+    size_t num_length_symbols = 0;
+    for (size_t i = 0; i < num_lengths;) {
+        uint8_t length = all_lengths[i];
+        size_t run = 1;
+        while (i + run < num_lengths && all_lengths[i + run] == length) {
+            run++;
+        }
+        if (length == 0 && run >= 3) {
+            size_t count = run < 138 ? run : 138;
+            length_symbols[num_length_symbols] = count >= 11 ? 18 : 17;
+            length_extra[num_length_symbols++] = (uint8_t)(count >= 11 ? count - 11 : count - 3);
+            i += count;
+        } else if (length != 0 && run >= 4) {
+            // The first length is written on its own, the repetitions refer to it.
+            size_t count = run - 1 < 6 ? run - 1 : 6;
+            length_symbols[num_length_symbols] = length;
+            length_extra[num_length_symbols++] = 0;
+            length_symbols[num_length_symbols] = 16;
+            length_extra[num_length_symbols++] = (uint8_t)(count - 3);
+            i += 1 + count;
+        } else {
+            length_symbols[num_length_symbols] = length;
+            length_extra[num_length_symbols++] = 0;
+            i++;
+        }
+    }
+
+    uint32_t code_length_frequencies[NUM_CODE_LENGTH_SYMBOLS] = {0};
+    for (size_t i = 0; i < num_length_symbols; i++) {
+        code_length_frequencies[length_symbols[i]]++;
+    }
+    _use_two_symbols(code_length_frequencies, NUM_CODE_LENGTH_SYMBOLS);
+    uint8_t code_length_lengths[NUM_CODE_LENGTH_SYMBOLS];
+    uint16_t code_length_codes[NUM_CODE_LENGTH_SYMBOLS];
+    _build_code_lengths(code_length_frequencies, NUM_CODE_LENGTH_SYMBOLS, MAX_CODE_LENGTH_CODE_LENGTH, code_length_lengths);
+    _build_codes(code_length_lengths, NUM_CODE_LENGTH_SYMBOLS, code_length_codes);
+    size_t num_code_length_lengths = NUM_CODE_LENGTH_SYMBOLS;
+    while (num_code_length_lengths > 4 && code_length_lengths[CODE_LENGTH_ORDER[num_code_length_lengths - 1]] == 0) {
+        num_code_length_lengths--;
+    }
+
+    // The header: the final flag, block type 2, the numbers of lengths and the three codes.
+    _write_bits(p_writer, final ? 1 : 0, 1);
+    _write_bits(p_writer, 2, 2);
+    _write_bits(p_writer, (uint32_t)(num_literal_lengths - 257), 5);
+    _write_bits(p_writer, (uint32_t)(num_distance_lengths - 1), 5);
+    _write_bits(p_writer, (uint32_t)(num_code_length_lengths - 4), 4);
+    for (size_t i = 0; i < num_code_length_lengths; i++) {
+        _write_bits(p_writer, code_length_lengths[CODE_LENGTH_ORDER[i]], 3);
+    }
+    for (size_t i = 0; i < num_length_symbols; i++) {
+        uint8_t symbol = length_symbols[i];
+        _write_bits(p_writer, code_length_codes[symbol], code_length_lengths[symbol]);
+        if (symbol >= 16) {
+            _write_bits(p_writer, length_extra[i], symbol == 16 ? 2 : symbol == 17 ? 3 : 7);
+        }
+    }
+
+    for (size_t i = 0; i < num_tokens; i++) {
+        if (tokens[i].distance == 0) {
+            uint16_t literal = tokens[i].literal_or_length;
+            _write_bits(p_writer, literal_codes[literal], lengths[literal]);
+            continue;
+        }
+        unsigned int length = tokens[i].literal_or_length;
+        unsigned int length_symbol = _find_symbol(LENGTH_BASES, 29, length);
+        _write_bits(p_writer, literal_codes[257 + length_symbol], lengths[257 + length_symbol]);
+        _write_bits(p_writer, length - LENGTH_BASES[length_symbol], LENGTH_EXTRA_BITS[length_symbol]);
+        unsigned int distance = tokens[i].distance;
+        unsigned int distance_symbol = _find_symbol(DISTANCE_BASES, 30, distance);
+        _write_bits(p_writer, distance_codes[distance_symbol], lengths[NUM_LITERAL_LENGTH_SYMBOLS + distance_symbol]);
+        _write_bits(p_writer, distance - DISTANCE_BASES[distance_symbol], DISTANCE_EXTRA_BITS[distance_symbol]);
+    }
+    _write_bits(p_writer, literal_codes[END_OF_BLOCK], lengths[END_OF_BLOCK]);
+}
+
+/**
+ * Computes the hash of the MIN_MATCH bytes at a position.
+ *
+ * @param p_bytes A pointer to the bytes.
+ * @return The hash.
+ */
+static inline uint32_t _hash(const unsigned char *p_bytes) {
+    return (((uint32_t)p_bytes[0] << 10) ^ ((uint32_t)p_bytes[1] << 5) ^ p_bytes[2]) & (HASH_SIZE - 1);
+}
+
+int deflate_segment(const unsigned char *data, size_t dictionary_size, size_t size, bool last, ByteBuffer *p_output) {
+    if (dictionary_size > DEFLATE_WINDOW_SIZE || size > INT32_MAX - dictionary_size) return ERROR_ARITHMETIC_OVERFLOW;
+    size_t total_size = dictionary_size + size;
+    int32_t *heads = (int32_t *)malloc(HASH_SIZE * sizeof(int32_t));
+    int32_t *previous = (int32_t *)malloc((total_size > 0 ? total_size : 1) * sizeof(int32_t));
+    Token *tokens = (Token *)malloc(MAX_BLOCK_TOKENS * sizeof(Token));
+    if (heads == NULL || previous == NULL || tokens == NULL) {
+        free(heads);
+        free(previous);
+        free(tokens);
+        return ERROR_MEMORY_ALLOC;
+    }
+    // Every position is inserted into the chain of its hash, so the following positions find it.
+    memset(heads, 0xFF, HASH_SIZE * sizeof(int32_t));
+#define INSERT_POSITION(position)                                  \
+    do {                                                           \
+        if ((position) + MIN_MATCH <= total_size) {                \
+            uint32_t hash_ = _hash(data + (position));             \
+            previous[position] = heads[hash_];                     \
+            heads[hash_] = (int32_t)(position);                    \
+        }                                                          \
+    } while (0)
+    for (size_t position = 0; position < dictionary_size; position++) {
+        INSERT_POSITION(position);
+    }
+
+    BitWriter writer = {p_output, 0, 0};
+    int status = SUCCESS;
+    size_t num_tokens = 0;
+    size_t position = dictionary_size;
+    for (;;) {
+        if (position < total_size) {
+            size_t max_length = total_size - position < MAX_MATCH ? total_size - position : MAX_MATCH;
+            size_t best_length = 0;
+            size_t best_distance = 0;
+            if (max_length >= MIN_MATCH) {
+                int32_t candidate = heads[_hash(data + position)];
+                for (int chain = 0; candidate >= 0 && position - (size_t)candidate <= DEFLATE_WINDOW_SIZE && chain < MAX_CHAIN_LENGTH; chain++) {
+                    const unsigned char *p_candidate = data + candidate;
+                    // A candidate can only be longer if it matches the byte after the current best length.
+                    if (p_candidate[best_length] == data[position + best_length]) {
+                        size_t length = 0;
+                        while (length < max_length && p_candidate[length] == data[position + length]) {
+                            length++;
+                        }
+                        if (length > best_length) {
+                            best_length = length;
+                            best_distance = position - (size_t)candidate;
+                            if (length == max_length) break;
+                        }
+                    }
+                    candidate = previous[candidate];
+                }
+            }
+            if (best_length >= MIN_MATCH) {
+                tokens[num_tokens].literal_or_length = (uint16_t)best_length;
+                tokens[num_tokens++].distance = (uint16_t)best_distance;
+                for (size_t i = 0; i < best_length; i++) {
+                    INSERT_POSITION(position + i);
+                }
+                position += best_length;
+            } else {
+                tokens[num_tokens].literal_or_length = data[position];
+                tokens[num_tokens++].distance = 0;
+                INSERT_POSITION(position);
+                position++;
+            }
+        }
+        bool end = position == total_size;
+        if (num_tokens == MAX_BLOCK_TOKENS || (end && (num_tokens > 0 || last))) {
+            status = _reserve_byte_buffer(p_output, num_tokens * MAX_TOKEN_BYTES + MAX_BLOCK_HEADER_BYTES);
+            if (status < 0) break;
+            _write_dynamic_block(tokens, num_tokens, last && end, &writer);
+            num_tokens = 0;
+        }
+        if (end) break;
+    }
+#undef INSERT_POSITION
+
+    if (status == SUCCESS && !last) {
+        // An empty stored block ends the segment on a byte boundary, so the next segment can be appended (like a zlib sync flush).
+        status = _reserve_byte_buffer(p_output, 8);
+        if (status == SUCCESS) {
+            _write_bits(&writer, 0, 3);
+            _align_to_byte(&writer);
+            _write_bits(&writer, 0x0000, 16);
+            _write_bits(&writer, 0xFFFF, 16);
+        }
+    } else if (status == SUCCESS) {
+        status = _reserve_byte_buffer(p_output, 1);
+        if (status == SUCCESS) {
+            _align_to_byte(&writer);
+        }
+    }
+    free(heads);
+    free(previous);
+    free(tokens);
+    return status;
+}
+
+/**
+ * The modulus of the Adler-32 checksum and the number of bytes after which the sums must be reduced, so they do not overflow.
+ */
+#define ADLER_MODULUS 65521
+#define ADLER_MAX_RUN 5552
+
+uint32_t update_adler32(uint32_t adler, const unsigned char *data, size_t size) {
+    uint32_t low = adler & 0xFFFF;
+    uint32_t high = adler >> 16;
+    while (size > 0) {
+        size_t run = size < ADLER_MAX_RUN ? size : ADLER_MAX_RUN;
+        size -= run;
+        for (size_t i = 0; i < run; i++) {
+            low += data[i];
+            high += low;
+        }
+        data += run;
+        low %= ADLER_MODULUS;
+        high %= ADLER_MODULUS;
+    }
+    return (high << 16) | low;
+}
+
+uint32_t combine_adler32(uint32_t adler_first, uint32_t adler_second, uint64_t size_second) {
+    // The low sum of the second part is added to the one of the first part. Every byte of the second part
+    // additionally adds the low sum of the first part to the high sum, which adds size_second times the low sum of the first part.
+    uint32_t remainder = (uint32_t)(size_second % ADLER_MODULUS);
+    uint32_t low_first = adler_first & 0xFFFF;
+    uint32_t low = (low_first + (adler_second & 0xFFFF) + ADLER_MODULUS - 1) % ADLER_MODULUS;
+    uint64_t high = ((uint64_t)remainder * low_first + (adler_first >> 16) + (adler_second >> 16) + ADLER_MODULUS - remainder) % ADLER_MODULUS;
+    return ((uint32_t)high << 16) | low;
+}
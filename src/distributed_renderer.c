@@ -0,0 +1,579 @@
+#include "../include/distributed_renderer.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <signal.h>
+#endif
+
+#include "../include/antialiasing.h"
+#include "../include/input_parser.h"
+#include "../include/metrics.h"
+#include "../include/shading.h"
+#include "../include/status_manager.h"
+
+/**
+ * The character that separates the addresses of the workers.
+ */
+#define WORKER_ADDRESS_SEPARATOR ','
+
+/**
+ * The state of a band of a distributed render.
+ */
+typedef enum {
+    BAND_PENDING,
+    BAND_RUNNING,
+    BAND_DONE
+} BandState;
+
+/**
+ * A band of rows of the image, which is computed by a worker as a whole.
+ */
+typedef struct {
+    size_t first_row;
+    size_t num_rows;
+    BandState state;
+    // The number of workers that compute the band right now.
+    size_t num_assignments;
+} DistributedBand;
+
+/**
+ * The state of a distributed render, which is shared by the calling thread and the threads that serve the workers.
+ */
+typedef struct {
+    const char *config_path;
+    IterationField *p_field;
+    DistributedBand *bands;
+    size_t num_bands;
+    // Protects all members below.
+    pthread_mutex_t lock;
+    // Signaled when a band is computed or given back, or a worker is dropped.
+    pthread_cond_t changed;
+    size_t num_done_bands;
+    // The number of workers whose threads are still running.
+    size_t num_active_workers;
+    // The connection of every worker, or NULL while it is not connected. Connections are interrupted when the image is done.
+    Connection **connections;
+    bool finished;
+    // The first error that a worker was dropped for, apart from connection errors, or SUCCESS.
+    int worker_status;
+    size_t num_iterated_pixels;
+} Coordinator;
+
+/**
+ * The argument of a thread that serves a worker.
+ */
+typedef struct {
+    Coordinator *p_coordinator;
+    // The index of the worker in the connections of the coordinator.
+    size_t index;
+    const char *address;
+} WorkerSession;
+
+/**
+ * The state of a worker while it serves a coordinator.
+ */
+typedef struct {
+    bool configured;
+    Configuration config;
+    ImageSize size;
+    // The iteration field of a band and the number of pixels it can hold.
+    IterationField field;
+    size_t field_capacity;
+} WorkerState;
+
+/**
+ * Converts 32 bit values between the byte order of the machine and little-endian, which is the byte order of the iteration results
+ * that are sent to the coordinator. The conversion is the same in both directions.
+ *
+ * @param values The values, which are converted in place.
+ * @param count The number of values.
+ */
+void _convert_little_endian(void *values, size_t count) {
+    const uint32_t probe = 1;
+    if (*(const unsigned char *)&probe == 1) return;
+    unsigned char *p_bytes = (unsigned char *)values;
+    for (size_t i = 0; i < count; i++, p_bytes += 4) {
+        unsigned char byte = p_bytes[0];
+        p_bytes[0] = p_bytes[3];
+        p_bytes[3] = byte;
+        byte = p_bytes[1];
+        p_bytes[1] = p_bytes[2];
+        p_bytes[2] = byte;
+    }
+}
+
+/**
+ * Reads the answer of a worker to a command.
+ *
+ * @param p_connection A pointer to the connection of the worker.
+ * @param p_p_line A pointer to the line buffer.
+ * @param p_capacity A pointer to the size of the line buffer.
+ * @return Status code. The status code that the worker sent if it answered with an error, ERROR_SOCKET if it disconnected.
+ */
+int _read_worker_answer(Connection *p_connection, char **p_p_line, size_t *p_capacity) {
+    int result = read_line(p_connection, p_p_line, p_capacity);
+    if (result <= 0) return result < 0 ? result : ERROR_SOCKET;
+    if (strncmp(*p_p_line, "ERROR ", 6) == 0) {
+        long status = strtol(*p_p_line + 6, NULL, 10);
+        return status < 0 ? (int)status : GENERIC_ERROR;
+    }
+    return SUCCESS;
+}
+
+/**
+ * Sends the configuration to a worker and checks that it calculates the same image size.
+ *
+ * @param p_connection A pointer to the connection of the worker.
+ * @param config_path The path of the configuration file.
+ * @param size The size of the image in pixels.
+ * @param p_p_line A pointer to the line buffer.
+ * @param p_capacity A pointer to the size of the line buffer.
+ * @return Status code.
+ */
+int _configure_worker(Connection *p_connection, const char *config_path, ImageSize size, char **p_p_line, size_t *p_capacity) {
+    int status = write_line(p_connection, "CONFIGURE %zu", size.width);
+    if (status == SUCCESS) {
+        status = write_configuration_file(p_connection, config_path);
+    }
+    if (status == SUCCESS) {
+        status = _read_worker_answer(p_connection, p_p_line, p_capacity);
+    }
+    if (status != SUCCESS) return status;
+
+    size_t width, height;
+    if (sscanf(*p_p_line, "OK %zu %zu", &width, &height) != 2 || width != size.width || height != size.height) return ERROR_SOCKET;
+    return SUCCESS;
+}
+
+/**
+ * Lets a worker compute a band and receives its iteration results.
+ *
+ * @param p_connection A pointer to the connection of the worker.
+ * @param p_band A pointer to the band.
+ * @param width The width of the image in pixels.
+ * @param iterations A buffer for the iterations of the pixels of the band.
+ * @param magnitudes A buffer for the magnitudes of the pixels of the band.
+ * @param p_p_line A pointer to the line buffer.
+ * @param p_capacity A pointer to the size of the line buffer.
+ * @param p_num_iterated_pixels A pointer to store the number of pixels the worker iterated.
+ * @return Status code.
+ */
+int _compute_band_on_worker(Connection *p_connection, const DistributedBand *p_band, size_t width, uint32_t *iterations, float *magnitudes,
+                            char **p_p_line, size_t *p_capacity, size_t *p_num_iterated_pixels) {
+    int status = write_line(p_connection, "BAND %zu %zu", p_band->first_row, p_band->num_rows);
+    if (status == SUCCESS) {
+        status = _read_worker_answer(p_connection, p_p_line, p_capacity);
+    }
+    if (status != SUCCESS) return status;
+    if (sscanf(*p_p_line, "FIELD %zu", p_num_iterated_pixels) != 1) return ERROR_SOCKET;
+
+    size_t num_pixels = width * p_band->num_rows;
+    status = read_bytes(p_connection, iterations, num_pixels * sizeof(uint32_t));
+    if (status == SUCCESS) {
+        status = read_bytes(p_connection, magnitudes, num_pixels * sizeof(float));
+    }
+    if (status == SUCCESS) {
+        _convert_little_endian(iterations, num_pixels);
+        _convert_little_endian(magnitudes, num_pixels);
+    }
+    return status;
+}
+
+/**
+ * Hands the next band to a worker. Bands that nobody computes come first, then the band that the fewest workers compute,
+ * as long as it is computed by less than DISTRIBUTED_MAX_ASSIGNMENTS workers. The lock must be held.
+ *
+ * @param p_coordinator A pointer to the coordinator.
+ * @return A pointer to the band, or NULL if there is no band for the worker right now.
+ */
+DistributedBand *_take_band(Coordinator *p_coordinator) {
+    DistributedBand *p_best = NULL;
+    for (size_t i = 0; i < p_coordinator->num_bands; i++) {
+        DistributedBand *p_band = &p_coordinator->bands[i];
+        if (p_band->state == BAND_PENDING) {
+            p_best = p_band;
+            break;
+        }
+        if (p_band->state == BAND_RUNNING && p_band->num_assignments < DISTRIBUTED_MAX_ASSIGNMENTS &&
+            (p_best == NULL || p_band->num_assignments < p_best->num_assignments)) {
+            p_best = p_band;
+        }
+    }
+    if (p_best != NULL) {
+        p_best->state = BAND_RUNNING;
+        p_best->num_assignments++;
+    }
+    return p_best;
+}
+
+/**
+ * The main function of a thread that serves a worker. Connects to the worker, configures it and lets it compute one band after another
+ * until all bands are done. The worker is dropped when it fails, and the band it was computing is given back.
+ *
+ * @param p_argument A pointer to the WorkerSession.
+ * @return NULL.
+ */
+void *_run_worker_session(void *p_argument) {
+    WorkerSession *p_session = (WorkerSession *)p_argument;
+    Coordinator *p_coordinator = p_session->p_coordinator;
+    ImageSize size = p_coordinator->p_field->size;
+    size_t band_height = size.height < DISTRIBUTED_BAND_HEIGHT ? size.height : DISTRIBUTED_BAND_HEIGHT;
+    uint32_t *iterations = (uint32_t *)malloc(size.width * band_height * sizeof(uint32_t));
+    float *magnitudes = (float *)malloc(size.width * band_height * sizeof(float));
+    char *line = NULL;
+    size_t capacity = 0;
+    Connection *p_connection = NULL;
+
+    int status = iterations != NULL && magnitudes != NULL ? SUCCESS : ERROR_MEMORY_ALLOC;
+    if (status == SUCCESS) {
+        status = connect_tcp(p_session->address, DISTRIBUTED_CONNECT_TIMEOUT, &p_connection);
+    }
+    // A worker that stops answering is dropped like one that disconnected, so its band is handed to another worker.
+    if (status == SUCCESS) {
+        status = set_connection_timeout(p_connection, DISTRIBUTED_TIMEOUT);
+    }
+    if (status == SUCCESS) {
+        pthread_mutex_lock(&p_coordinator->lock);
+        p_coordinator->connections[p_session->index] = p_connection;
+        status = p_coordinator->finished ? ERROR_SOCKET : SUCCESS;
+        pthread_mutex_unlock(&p_coordinator->lock);
+    }
+    if (status == SUCCESS) {
+        status = _configure_worker(p_connection, p_coordinator->config_path, size, &line, &capacity);
+    }
+
+    while (status == SUCCESS) {
+        pthread_mutex_lock(&p_coordinator->lock);
+        DistributedBand *p_band = NULL;
+        while (!p_coordinator->finished && p_coordinator->num_done_bands < p_coordinator->num_bands && (p_band = _take_band(p_coordinator)) == NULL) {
+            pthread_cond_wait(&p_coordinator->changed, &p_coordinator->lock);
+        }
+        pthread_mutex_unlock(&p_coordinator->lock);
+        if (p_band == NULL) break;
+
+        size_t num_iterated_pixels;
+        status = _compute_band_on_worker(p_connection, p_band, size.width, iterations, magnitudes, &line, &capacity, &num_iterated_pixels);
+
+        // The first result of a band is taken. A band whose worker failed is given back if no other worker computes it.
+        pthread_mutex_lock(&p_coordinator->lock);
+        if (status == SUCCESS && p_band->state != BAND_DONE) {
+            size_t offset = p_band->first_row * size.width;
+            size_t num_pixels = p_band->num_rows * size.width;
+            memcpy(p_coordinator->p_field->iterations + offset, iterations, num_pixels * sizeof(uint32_t));
+            memcpy(p_coordinator->p_field->magnitudes + offset, magnitudes, num_pixels * sizeof(float));
+            p_band->state = BAND_DONE;
+            p_coordinator->num_done_bands++;
+            p_coordinator->num_iterated_pixels += num_iterated_pixels;
+        }
+        p_band->num_assignments--;
+        if (p_band->state == BAND_RUNNING && p_band->num_assignments == 0) {
+            p_band->state = BAND_PENDING;
+        }
+        pthread_cond_broadcast(&p_coordinator->changed);
+        pthread_mutex_unlock(&p_coordinator->lock);
+    }
+
+    pthread_mutex_lock(&p_coordinator->lock);
+    p_coordinator->connections[p_session->index] = NULL;
+    if (status != SUCCESS && status != ERROR_SOCKET && p_coordinator->worker_status == SUCCESS) {
+        p_coordinator->worker_status = status;
+    }
+    p_coordinator->num_active_workers--;
+    pthread_cond_broadcast(&p_coordinator->changed);
+    pthread_mutex_unlock(&p_coordinator->lock);
+    close_connection(p_connection);
+    free(line);
+    free(iterations);
+    free(magnitudes);
+    return NULL;
+}
+
+/**
+ * Computes the iteration field on the workers. Returns when all bands are done or all workers are gone.
+ *
+ * @param p_coordinator A pointer to the coordinator, whose bands are set up.
+ * @param addresses The addresses of the workers, separated by commas. They are split in place.
+ * @param progress_callback A callback function to output the progress.
+ * @return Status code.
+ */
+int _run_coordinator(Coordinator *p_coordinator, char *addresses, void (*progress_callback)(double)) {
+    size_t num_workers = 1;
+    for (const char *p_char = addresses; *p_char != 0; p_char++) {
+        if (*p_char == WORKER_ADDRESS_SEPARATOR) num_workers++;
+    }
+    WorkerSession *sessions = (WorkerSession *)calloc(num_workers, sizeof(WorkerSession));
+    pthread_t *threads = (pthread_t *)calloc(num_workers, sizeof(pthread_t));
+    bool *started = (bool *)calloc(num_workers, sizeof(bool));
+    p_coordinator->connections = (Connection **)calloc(num_workers, sizeof(Connection *));
+    if (sessions == NULL || threads == NULL || started == NULL || p_coordinator->connections == NULL) {
+        free(sessions);
+        free(threads);
+        free(started);
+        free(p_coordinator->connections);
+        return ERROR_MEMORY_ALLOC;
+    }
+
+    p_coordinator->num_active_workers = num_workers;
+    char *address = addresses;
+    for (size_t i = 0; i < num_workers; i++) {
+        char *p_separator = strchr(address, WORKER_ADDRESS_SEPARATOR);
+        if (p_separator != NULL) {
+            *p_separator = 0;
+        }
+        sessions[i].p_coordinator = p_coordinator;
+        sessions[i].index = i;
+        sessions[i].address = address;
+        started[i] = pthread_create(&threads[i], NULL, _run_worker_session, &sessions[i]) == 0;
+        if (!started[i]) {
+            pthread_mutex_lock(&p_coordinator->lock);
+            p_coordinator->num_active_workers--;
+            pthread_mutex_unlock(&p_coordinator->lock);
+        }
+        address = p_separator != NULL ? p_separator + 1 : address + strlen(address);
+    }
+
+    pthread_mutex_lock(&p_coordinator->lock);
+    while (p_coordinator->num_done_bands < p_coordinator->num_bands && p_coordinator->num_active_workers > 0) {
+        pthread_cond_wait(&p_coordinator->changed, &p_coordinator->lock);
+        double progress = (double)p_coordinator->num_done_bands / (double)p_coordinator->num_bands;
+        pthread_mutex_unlock(&p_coordinator->lock);
+        progress_callback(progress);
+        pthread_mutex_lock(&p_coordinator->lock);
+    }
+    // Workers that still compute a band that is already done are not waited for.
+    p_coordinator->finished = true;
+    for (size_t i = 0; i < num_workers; i++) {
+        if (p_coordinator->connections[i] != NULL) {
+            interrupt_connection(p_coordinator->connections[i]);
+        }
+    }
+    pthread_cond_broadcast(&p_coordinator->changed);
+    pthread_mutex_unlock(&p_coordinator->lock);
+    for (size_t i = 0; i < num_workers; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    int status = SUCCESS;
+    if (p_coordinator->num_done_bands < p_coordinator->num_bands) {
+        status = p_coordinator->worker_status != SUCCESS ? p_coordinator->worker_status : ERROR_NO_WORKERS;
+    }
+    free(sessions);
+    free(threads);
+    free(started);
+    free(p_coordinator->connections);
+    return status;
+}
+
+int render_distributed(Configuration config, const char *config_path, const char *worker_addresses, ThreadPool *p_thread_pool, IterationField *p_field,
+                       ImageData *p_image_data, void (*progress_callback)(double), RenderStatistics *p_statistics) {
+    if (config.iteration_depth == 0 || config.iteration_depth != p_field->iteration_depth) return ERROR_INVALID_ITERATION_DEPTH;
+    if (p_statistics != NULL) {
+        memset(p_statistics, 0, sizeof(RenderStatistics));
+    }
+#ifndef _WIN32
+    // A worker that disconnects while it is sent a command must not terminate the coordinator.
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    Coordinator coordinator;
+    memset(&coordinator, 0, sizeof(Coordinator));
+    coordinator.p_field = p_field;
+    coordinator.config_path = config_path;
+    char *addresses = (char *)malloc(strlen(worker_addresses) + 1);
+    if (addresses == NULL) return ERROR_MEMORY_ALLOC;
+    strcpy(addresses, worker_addresses);
+
+    ImageSize size = p_field->size;
+    coordinator.num_bands = (size.height + DISTRIBUTED_BAND_HEIGHT - 1) / DISTRIBUTED_BAND_HEIGHT;
+    coordinator.bands = (DistributedBand *)calloc(coordinator.num_bands, sizeof(DistributedBand));
+    int status = coordinator.bands != NULL ? SUCCESS : ERROR_MEMORY_ALLOC;
+    for (size_t i = 0; i < coordinator.num_bands && status == SUCCESS; i++) {
+        coordinator.bands[i].first_row = i * DISTRIBUTED_BAND_HEIGHT;
+        coordinator.bands[i].num_rows = size.height - coordinator.bands[i].first_row < DISTRIBUTED_BAND_HEIGHT ? size.height - coordinator.bands[i].first_row
+                                                                                                              : DISTRIBUTED_BAND_HEIGHT;
+        coordinator.bands[i].state = BAND_PENDING;
+    }
+
+    // Compute stage on the workers.
+    RenderStatistics statistics;
+    memset(&statistics, 0, sizeof(RenderStatistics));
+    StageClock compute_clock, shade_clock;
+    if (status == SUCCESS) {
+        pthread_mutex_init(&coordinator.lock, NULL);
+        pthread_cond_init(&coordinator.changed, NULL);
+        progress_callback(0.0);
+        start_stage_clock(&compute_clock);
+        status = _run_coordinator(&coordinator, addresses, progress_callback);
+        stop_stage_clock(&compute_clock, &statistics.compute_time);
+        pthread_cond_destroy(&coordinator.changed);
+        pthread_mutex_destroy(&coordinator.lock);
+        statistics.num_iterated_pixels = coordinator.num_iterated_pixels;
+    }
+    free(coordinator.bands);
+    free(addresses);
+    if (status != SUCCESS) return status;
+    add_field_to_iteration_histogram(p_field, &statistics.histogram);
+
+    // Shading stage on the calling machine, so the image is shaded exactly like a local render.
+    start_stage_clock(&shade_clock);
+    status = shade_iteration_field(p_field, &config, p_thread_pool, p_image_data);
+    if (status < 0) return status;
+    stop_stage_clock(&shade_clock, &statistics.shade_time);
+    if (config.supersampling >= 2) {
+        start_stage_clock(&compute_clock);
+        status = supersample_edges(&config, p_thread_pool, p_field, 0, p_image_data, NULL, NULL, &statistics.num_supersampled_pixels, &statistics.num_extra_samples);
+        if (status < 0) return status;
+        stop_stage_clock(&compute_clock, &statistics.compute_time);
+    }
+    if (p_statistics != NULL) {
+        *p_statistics = statistics;
+    }
+    progress_callback(1.0);
+    return SUCCESS;
+}
+
+/**
+ * Handles the CONFIGURE command: reads the configuration that follows the command and calculates the size of the image.
+ *
+ * @param p_state A pointer to the state of the worker.
+ * @param p_connection A pointer to the connection of the coordinator.
+ * @param argument The image width.
+ * @return Status code.
+ */
+int _configure_worker_state(WorkerState *p_state, Connection *p_connection, const char *argument) {
+    // The configuration is read first, so the next command is read correctly even if the width is invalid.
+    char *text;
+    int status = read_configuration_text(p_connection, &text);
+    if (status != SUCCESS) return status;
+
+    if (p_state->configured) {
+        free_configuration(&p_state->config);
+        p_state->configured = false;
+    }
+    size_t image_width;
+    status = parse_image_width(argument, &image_width);
+    if (status == SUCCESS) {
+        status = parse_ini_string(text, &p_state->config);
+    }
+    free(text);
+    if (status != SUCCESS) return status;
+    status = calc_image_size(p_state->config.viewport, image_width, &p_state->size);
+    if (status == SUCCESS && p_state->config.iteration_depth > UINT32_MAX) {
+        status = ERROR_INVALID_ITERATION_DEPTH;
+    }
+    if (status != SUCCESS) {
+        free_configuration(&p_state->config);
+        return status;
+    }
+    p_state->configured = true;
+    return write_line(p_connection, "OK %zu %zu", p_state->size.width, p_state->size.height);
+}
+
+/**
+ * Handles the BAND command: computes the iteration field of the band and sends it.
+ *
+ * @param p_state A pointer to the state of the worker.
+ * @param p_connection A pointer to the connection of the coordinator.
+ * @param p_thread_pool The thread pool or NULL.
+ * @param arguments The first row and the number of rows of the band.
+ * @return Status code.
+ */
+int _compute_worker_band(WorkerState *p_state, Connection *p_connection, ThreadPool *p_thread_pool, const char *arguments) {
+    size_t first_row, num_rows;
+    if (!p_state->configured || sscanf(arguments, "%zu %zu", &first_row, &num_rows) != 2 || num_rows == 0 ||
+        first_row >= p_state->size.height || num_rows > p_state->size.height - first_row) {
+        return ERROR_INVALID_DAEMON_COMMAND;
+    }
+
+    // The iteration field is reused by all bands that fit into it.
+    size_t width = p_state->size.width;
+    if (width > SIZE_MAX / num_rows) return ERROR_ARITHMETIC_OVERFLOW;
+    if (p_state->field_capacity < width * num_rows) {
+        free_iteration_field(&p_state->field);
+        p_state->field_capacity = 0;
+        ImageSize field_size = {width, num_rows};
+        int status = create_iteration_field(field_size, p_state->config.iteration_depth, &p_state->field);
+        if (status != SUCCESS) return status;
+        p_state->field_capacity = width * num_rows;
+    }
+    p_state->field.size.width = width;
+    p_state->field.size.height = num_rows;
+    p_state->field.iteration_depth = p_state->config.iteration_depth;
+
+    RenderStatistics statistics;
+    int status = compute_band_field(p_state->config, p_thread_pool, first_row, &p_state->field, &statistics);
+    if (status == SUCCESS) {
+        status = write_line(p_connection, "FIELD %zu", statistics.num_iterated_pixels);
+    }
+    // The field is converted in place, because it is computed again for the next band anyway.
+    _convert_little_endian(p_state->field.iterations, width * num_rows);
+    _convert_little_endian(p_state->field.magnitudes, width * num_rows);
+    if (status == SUCCESS) {
+        status = write_bytes(p_connection, p_state->field.iterations, width * num_rows * sizeof(uint32_t));
+    }
+    if (status == SUCCESS) {
+        status = write_bytes(p_connection, p_state->field.magnitudes, width * num_rows * sizeof(float));
+    }
+    return status;
+}
+
+/**
+ * Handles the commands of a coordinator until it disconnects.
+ *
+ * @param p_connection A pointer to the connection of the coordinator.
+ * @param p_thread_pool The thread pool or NULL.
+ */
+void _serve_coordinator(Connection *p_connection, ThreadPool *p_thread_pool) {
+    WorkerState state;
+    memset(&state, 0, sizeof(WorkerState));
+    char *line = NULL;
+    size_t capacity = 0;
+
+    while (read_line(p_connection, &line, &capacity) > 0) {
+        int status;
+        if (strncmp(line, "CONFIGURE ", 10) == 0) {
+            status = _configure_worker_state(&state, p_connection, line + 10);
+        } else if (strncmp(line, "BAND ", 5) == 0) {
+            status = _compute_worker_band(&state, p_connection, p_thread_pool, line + 5);
+        } else {
+            status = ERROR_INVALID_DAEMON_COMMAND;
+        }
+        if (status == ERROR_SOCKET) break;
+        // The status code is sent along with the message, so the coordinator knows why the worker failed.
+        if (status < 0 && write_line(p_connection, "ERROR %d %s", status, get_status_message(status)) != SUCCESS) break;
+    }
+
+    free(line);
+    if (state.configured) {
+        free_configuration(&state.config);
+    }
+    free_iteration_field(&state.field);
+}
+
+int run_render_worker(Listener *p_listener, ThreadPool *p_thread_pool) {
+#ifndef _WIN32
+    // A coordinator that disconnects while a band is sent must not terminate the worker.
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    int status = SUCCESS;
+    while (status == SUCCESS) {
+        Connection *p_connection;
+        status = accept_connection(p_listener, &p_connection);
+        if (status == SUCCESS) {
+            // A coordinator that stops sending commands is given up, so the worker is free for the next one.
+            if (set_connection_timeout(p_connection, DISTRIBUTED_TIMEOUT) == SUCCESS) {
+                _serve_coordinator(p_connection, p_thread_pool);
+            }
+            close_connection(p_connection);
+        }
+    }
+    return status;
+}
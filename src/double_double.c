@@ -0,0 +1,65 @@
+#include "../include/double_double.h"
+
+// The error-free transformations only work if every operation is rounded on its own, so contraction to fused multiply-adds is disabled.
+#if defined(__clang__)
+#define NO_FP_CONTRACT
+#else
+#define NO_FP_CONTRACT __attribute__((optimize("fp-contract=off")))
+#endif
+
+/**
+ * Splits a double into two halves with 26 bits each, so the product of two halves is exact (Dekker).
+ */
+#define SPLIT_FACTOR 134217729.0
+
+/**
+ * Adds two doubles whose sum is known to be at least as large as a, which saves two operations compared to double_double_from_sum.
+ *
+ * @param a The first summand. Its magnitude must not be smaller than the magnitude of b.
+ * @param b The second summand.
+ * @return The exact sum.
+ */
+NO_FP_CONTRACT
+DoubleDouble _quick_two_sum(double a, double b) {
+    DoubleDouble result;
+    result.hi = a + b;
+    result.lo = b - (result.hi - a);
+    return result;
+}
+
+NO_FP_CONTRACT
+DoubleDouble double_double_from_sum(double a, double b) {
+    DoubleDouble result;
+    result.hi = a + b;
+    double b_virtual = result.hi - a;
+    result.lo = (a - (result.hi - b_virtual)) + (b - b_virtual);
+    return result;
+}
+
+NO_FP_CONTRACT
+DoubleDouble double_double_from_product(double a, double b) {
+    double a_split = SPLIT_FACTOR * a;
+    double a_hi = a_split - (a_split - a);
+    double a_lo = a - a_hi;
+    double b_split = SPLIT_FACTOR * b;
+    double b_hi = b_split - (b_split - b);
+    double b_lo = b - b_hi;
+    DoubleDouble result;
+    result.hi = a * b;
+    result.lo = ((a_hi * b_hi - result.hi) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo;
+    return result;
+}
+
+NO_FP_CONTRACT
+DoubleDouble add_double_double(DoubleDouble a, DoubleDouble b) {
+    DoubleDouble sum = double_double_from_sum(a.hi, b.hi);
+    DoubleDouble low_sum = double_double_from_sum(a.lo, b.lo);
+    sum = _quick_two_sum(sum.hi, sum.lo + low_sum.hi);
+    return _quick_two_sum(sum.hi, sum.lo + low_sum.lo);
+}
+
+DoubleDouble subtract_double_double(DoubleDouble a, DoubleDouble b) {
+    b.hi = -b.hi;
+    b.lo = -b.lo;
+    return add_double_double(a, b);
+}
@@ -0,0 +1,267 @@
+#include "../include/fixed_point.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/status_manager.h"
+
+/**
+ * The number of bits per limb.
+ */
+#define LIMB_BITS 32
+
+/**
+ * The number of bits that are added to the precision that is needed to resolve a pixel.
+ * They absorb the rounding errors that accumulate over the iterations of the reference orbit.
+ */
+#define GUARD_BITS 64
+
+/**
+ * The largest decimal exponent that is accepted by parse_fixed_point.
+ * Numbers with a larger exponent either overflow the integer limb or underflow the smallest fractional limb.
+ */
+#define MAX_DECIMAL_EXPONENT 400
+
+/**
+ * Compares the magnitudes of two fixed point numbers over the given number of limbs.
+ *
+ * @return A negative value if |a| < |b|, 0 if |a| = |b| and a positive value if |a| > |b|.
+ */
+int _compare_magnitudes(const uint32_t *a, const uint32_t *b, size_t num_limbs) {
+    for (size_t i = 0; i < num_limbs; i++) {
+        if (a[i] != b[i]) {
+            return a[i] < b[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Adds the magnitudes a and b and stores the result in p_result. Overflow of the integer limb is discarded.
+ */
+void _add_magnitudes(const uint32_t *a, const uint32_t *b, size_t num_limbs, uint32_t *p_result) {
+    uint64_t carry = 0;
+    for (size_t i = num_limbs; i-- > 0;) {
+        uint64_t sum = (uint64_t)a[i] + b[i] + carry;
+        p_result[i] = (uint32_t)sum;
+        carry = sum >> LIMB_BITS;
+    }
+}
+
+/**
+ * Subtracts the magnitude b from a and stores the result in p_result. |a| must be greater than or equal to |b|.
+ */
+void _subtract_magnitudes(const uint32_t *a, const uint32_t *b, size_t num_limbs, uint32_t *p_result) {
+    uint64_t borrow = 0;
+    for (size_t i = num_limbs; i-- > 0;) {
+        uint64_t subtrahend = (uint64_t)b[i] + borrow;
+        borrow = a[i] < subtrahend ? 1 : 0;
+        p_result[i] = (uint32_t)(((uint64_t)1 << LIMB_BITS) * borrow + a[i] - subtrahend);
+    }
+}
+
+/**
+ * Adds a and b, where the sign of b is given explicitly. Used for both addition and subtraction.
+ */
+void _add_signed(const FixedPoint *p_a, const FixedPoint *p_b, bool b_negative, FixedPoint *p_result) {
+    size_t num_limbs = p_a->num_limbs > p_b->num_limbs ? p_a->num_limbs : p_b->num_limbs;
+    FixedPoint result;
+    memset(&result, 0, sizeof(FixedPoint));
+    result.num_limbs = num_limbs;
+
+    if (p_a->negative == b_negative) {
+        _add_magnitudes(p_a->limbs, p_b->limbs, num_limbs, result.limbs);
+        result.negative = p_a->negative;
+    } else if (_compare_magnitudes(p_a->limbs, p_b->limbs, num_limbs) >= 0) {
+        _subtract_magnitudes(p_a->limbs, p_b->limbs, num_limbs, result.limbs);
+        result.negative = p_a->negative;
+    } else {
+        _subtract_magnitudes(p_b->limbs, p_a->limbs, num_limbs, result.limbs);
+        result.negative = b_negative;
+    }
+    *p_result = result;
+}
+
+void add_fixed_point(const FixedPoint *p_a, const FixedPoint *p_b, FixedPoint *p_result) {
+    _add_signed(p_a, p_b, p_b->negative, p_result);
+}
+
+void subtract_fixed_point(const FixedPoint *p_a, const FixedPoint *p_b, FixedPoint *p_result) {
+    _add_signed(p_a, p_b, !p_b->negative, p_result);
+}
+
+void multiply_fixed_point(const FixedPoint *p_a, const FixedPoint *p_b, FixedPoint *p_result) {
+    size_t n = p_a->num_limbs > p_b->num_limbs ? p_a->num_limbs : p_b->num_limbs;
+    // The magnitudes are multiplied as integers with the least significant limb first.
+    // The product has 2n limbs, the upper n limbs are the result with the same scale as the factors.
+    uint32_t product[2 * FIXED_POINT_MAX_LIMBS];
+    memset(product, 0, sizeof(product));
+
+    for (size_t i = 0; i < n; i++) {
+        uint64_t a_limb = p_a->limbs[n - 1 - i];
+        if (a_limb == 0) {
+            continue;
+        }
+        uint64_t carry = 0;
+        for (size_t j = 0; j < n; j++) {
+            uint64_t term = a_limb * p_b->limbs[n - 1 - j] + product[i + j] + carry;
+            product[i + j] = (uint32_t)term;
+            carry = term >> LIMB_BITS;
+        }
+        product[i + n] = (uint32_t)carry;
+    }
+
+    FixedPoint result;
+    memset(&result, 0, sizeof(FixedPoint));
+    result.num_limbs = n;
+    result.negative = p_a->negative != p_b->negative;
+    for (size_t k = 0; k < n; k++) {
+        result.limbs[k] = product[2 * n - 2 - k];
+    }
+    *p_result = result;
+}
+
+void double_to_fixed_point(double value, size_t num_limbs, FixedPoint *p_result) {
+    memset(p_result, 0, sizeof(FixedPoint));
+    p_result->num_limbs = num_limbs;
+    p_result->negative = value < 0;
+
+    // Scaling by a power of two and subtracting the integer part are exact, so no precision is lost.
+    double magnitude = fabs(value);
+    for (size_t i = 0; i < num_limbs && magnitude > 0; i++) {
+        double limb = floor(magnitude);
+        p_result->limbs[i] = (uint32_t)limb;
+        magnitude = ldexp(magnitude - limb, LIMB_BITS);
+    }
+}
+
+double fixed_point_to_double(const FixedPoint *p_value) {
+    // Three limbs cover more than the 53 bits of a double mantissa.
+    double result = 0.0;
+    for (size_t i = 0; i < p_value->num_limbs && i < 3; i++) {
+        result += ldexp((double)p_value->limbs[i], -LIMB_BITS * (int)i);
+    }
+    return p_value->negative ? -result : result;
+}
+
+DoubleDouble fixed_point_to_double_double(const FixedPoint *p_value) {
+    // Every limb is exactly a double, so only the additions round. The small limbs are added first, so their carries reach the high part.
+    DoubleDouble result = {0.0, 0.0};
+    for (size_t i = p_value->num_limbs; i > 0; i--) {
+        DoubleDouble limb = {ldexp((double)p_value->limbs[i - 1], -LIMB_BITS * (int)(i - 1)), 0.0};
+        result = add_double_double(result, limb);
+    }
+    if (p_value->negative) {
+        result.hi = -result.hi;
+        result.lo = -result.lo;
+    }
+    return result;
+}
+
+void double_double_to_fixed_point(DoubleDouble value, size_t num_limbs, FixedPoint *p_result) {
+    FixedPoint low;
+    double_to_fixed_point(value.hi, num_limbs, p_result);
+    double_to_fixed_point(value.lo, num_limbs, &low);
+    add_fixed_point(p_result, &low, p_result);
+}
+
+void set_fixed_point_precision(FixedPoint *p_value, size_t num_limbs) {
+    for (size_t i = num_limbs; i < p_value->num_limbs; i++) {
+        p_value->limbs[i] = 0;
+    }
+    p_value->num_limbs = num_limbs;
+}
+
+size_t get_fixed_point_limbs_for_spacing(double pixel_spacing) {
+    double fractional_bits = -log2(pixel_spacing) + GUARD_BITS;
+    if (fractional_bits < LIMB_BITS) {
+        fractional_bits = LIMB_BITS;
+    }
+    // One limb for the integer part.
+    return 1 + (size_t)ceil(fractional_bits / LIMB_BITS);
+}
+
+int parse_fixed_point(const char *str, FixedPoint *p_result) {
+    size_t length = strlen(str);
+    unsigned char *digits = (unsigned char *)malloc(length + 2 * MAX_DECIMAL_EXPONENT + 1);
+    if (digits == NULL) {
+        return ERROR_MEMORY_ALLOC;
+    }
+
+    // Split the string into sign, mantissa digits and the position of the decimal point.
+    const char *p = str;
+    bool negative = false;
+    if (*p == '+' || *p == '-') {
+        negative = *p == '-';
+        p++;
+    }
+    size_t num_digits = 0;
+    long point = -1;
+    while (isdigit((unsigned char)*p) || (*p == '.' && point < 0)) {
+        if (*p == '.') {
+            point = (long)num_digits;
+        } else {
+            digits[num_digits++] = (unsigned char)(*p - '0');
+        }
+        p++;
+    }
+    if (point < 0) {
+        point = (long)num_digits;
+    }
+    if (*p == 'e' || *p == 'E') {
+        char *endptr;
+        long exponent = strtol(p + 1, &endptr, 10);
+        if (endptr == p + 1 || exponent > MAX_DECIMAL_EXPONENT || exponent < -MAX_DECIMAL_EXPONENT) {
+            free(digits);
+            return GENERIC_ERROR;
+        }
+        point += exponent;
+        p = endptr;
+    }
+    if (num_digits == 0 || *p != '\0') {
+        free(digits);
+        return GENERIC_ERROR;
+    }
+
+    // Integer part. Digits beyond the mantissa are zeros.
+    uint64_t integer_part = 0;
+    for (long i = 0; i < point; i++) {
+        integer_part = integer_part * 10 + ((size_t)i < num_digits ? digits[i] : 0);
+        if (integer_part > UINT32_MAX) {
+            free(digits);
+            return ERROR_ARITHMETIC_OVERFLOW;
+        }
+    }
+
+    // Fractional part, padded with leading zeros if the decimal point lies before the first digit.
+    unsigned char *fraction = digits;
+    size_t num_fraction_digits = 0;
+    if (point < 0) {
+        memmove(digits - point, digits, num_digits);
+        memset(digits, 0, (size_t)-point);
+        num_fraction_digits = num_digits - point;
+    } else if ((size_t)point < num_digits) {
+        fraction = digits + point;
+        num_fraction_digits = num_digits - point;
+    }
+
+    memset(p_result, 0, sizeof(FixedPoint));
+    p_result->negative = negative;
+    p_result->num_limbs = FIXED_POINT_MAX_LIMBS;
+    p_result->limbs[0] = (uint32_t)integer_part;
+    // Every multiplication of the decimal fraction by 2^32 moves the next limb into the carry.
+    for (size_t limb = 1; limb < FIXED_POINT_MAX_LIMBS; limb++) {
+        uint64_t carry = 0;
+        for (size_t i = num_fraction_digits; i-- > 0;) {
+            uint64_t value = ((uint64_t)fraction[i] << LIMB_BITS) + carry;
+            fraction[i] = (unsigned char)(value % 10);
+            carry = value / 10;
+        }
+        p_result->limbs[limb] = (uint32_t)carry;
+    }
+
+    free(digits);
+    return SUCCESS;
+}
@@ -1,81 +1,238 @@
 #include "../include/image_manager.h"
 
 #include <math.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 #include "../include/color_utilities.h"
 #include "../include/status_manager.h"
 
-/**
- * Saves the image data as a BMP file.
- * The image data is expected to be in RGB format.
- *
- * @param output_path The path of the file to save.
- * @param size The size of the image in pixels.
- * @param p_pixel_data A pointer to the image data in RGB format.
- * @return Status code.
- */
-int _save_bmp(const char *output_path, ImageSize size, unsigned char *p_pixel_data) {
-    BitmapFileHeader file_header;
-    BitmapInfoHeader info_header;
+size_t get_bmp_row_size(size_t width) {
+    return (3 * width + 3) / 4 * 4;
+}
 
-    if (size.width > SIZE_MAX / 3 || 3 * size.width > SIZE_MAX / size.height) {
-        return ERROR_ARITHMETIC_OVERFLOW;
-    }
+uint64_t get_bmp_file_size(ImageSize size) {
+    return sizeof(BitmapFileHeader) + sizeof(BitmapInfoHeader) + (uint64_t)get_bmp_row_size(size.width) * size.height;
+}
 
-    int image_size = size.width * size.height * 3;  // 3 bytes per pixel (RGB)
-    file_header.type = 0x4D42;                      // "BM" in hex
+unsigned char *get_row_in_image_data(const ImageData *p_image_data, size_t y) {
+    return p_image_data->data + (p_image_data->size.height - 1 - y) * p_image_data->stride;
+}
 
-    if (image_size > SIZE_MAX - sizeof(BitmapFileHeader) - sizeof(BitmapInfoHeader)) {
+unsigned char *get_row_in_indexed_image_data(const IndexedImageData *p_image_data, size_t y) {
+    return p_image_data->data + (p_image_data->size.height - 1 - y) * p_image_data->stride;
+}
+
+int build_bmp_header(ImageSize size, BitmapFileHeader *p_file_header, BitmapInfoHeader *p_info_header, uint64_t *p_file_size) {
+    // The width and height are stored as signed 32 bit integers.
+    if (size.width > INT32_MAX || size.height > INT32_MAX) {
         return ERROR_ARITHMETIC_OVERFLOW;
     }
+    uint64_t file_size = get_bmp_file_size(size);
+    uint64_t image_size = file_size - sizeof(BitmapFileHeader) - sizeof(BitmapInfoHeader);
 
-    file_header.size = sizeof(BitmapFileHeader) + sizeof(BitmapInfoHeader) + image_size;
-    file_header.reserved1 = 0;
-    file_header.reserved2 = 0;
-    file_header.offset_bits = sizeof(BitmapFileHeader) + sizeof(BitmapInfoHeader);
+    p_file_header->type = 0x4D42;  // "BM" in hex
+    p_file_header->size = file_size <= UINT32_MAX ? (unsigned int)file_size : 0;
+    p_file_header->reserved1 = 0;
+    p_file_header->reserved2 = 0;
+    p_file_header->offset_bits = sizeof(BitmapFileHeader) + sizeof(BitmapInfoHeader);
 
-    info_header.header_size = sizeof(BitmapInfoHeader);
-    info_header.width = size.width;
-    info_header.height = size.height;
-    info_header.num_planes = 1;
-    info_header.bits_per_pixel = 24;  // 24 bit (RGB)
-    info_header.compression = 0;      // No compression
-    info_header.image_size = image_size;
-    info_header.pixels_per_meter_x = 0;
-    info_header.pixels_per_meter_y = 0;
-    info_header.num_colors = 0;
-    info_header.num_important_colors = 0;
+    p_info_header->header_size = sizeof(BitmapInfoHeader);
+    p_info_header->width = size.width;
+    p_info_header->height = size.height;
+    p_info_header->num_planes = 1;
+    p_info_header->bits_per_pixel = 24;  // 24 bit (RGB)
+    p_info_header->compression = 0;      // No compression
+    p_info_header->image_size = file_size <= UINT32_MAX ? (unsigned int)image_size : 0;
+    p_info_header->pixels_per_meter_x = 0;
+    p_info_header->pixels_per_meter_y = 0;
+    p_info_header->num_colors = 0;
+    p_info_header->num_important_colors = 0;
+    *p_file_size = file_size;
+    return SUCCESS;
+}
 
+int write_bmp_header(FILE *file, ImageSize size) {
+    BitmapFileHeader file_header;
+    BitmapInfoHeader info_header;
+    uint64_t file_size;
+    int status = build_bmp_header(size, &file_header, &info_header, &file_size);
+    if (status < 0) return status;
+
+    if (fwrite(&file_header, sizeof(BitmapFileHeader), 1, file) != 1 || fwrite(&info_header, sizeof(BitmapInfoHeader), 1, file) != 1) {
+        return ERROR_FILE_ACCESS;
+    }
+    return SUCCESS;
+}
+
+int save_bmp(const char *output_path, const ImageData *p_image_data) {
     FILE *file = fopen(output_path, "wb");
     if (!file) {
         return ERROR_FILE_ACCESS;
     }
 
-    fwrite(&file_header, sizeof(BitmapFileHeader), 1, file);
-    fwrite(&info_header, sizeof(BitmapInfoHeader), 1, file);
-
-    // This works without overflow because of the checks above (size.width * size.height * 3 <= SIZE_MAX)
-    for (int y = size.height - 1; y >= 0; y--) {
-        fwrite(p_pixel_data + (y * size.width * 3), 3, size.width, file);
+    int status = write_bmp_header(file, p_image_data->size);
+    size_t image_size = p_image_data->stride * p_image_data->size.height;
+    if (status == SUCCESS && fwrite(p_image_data->data, 1, image_size, file) != image_size) {
+        status = ERROR_FILE_ACCESS;
+    }
+    if (fclose(file) != 0 && status == SUCCESS) {
+        status = ERROR_FILE_ACCESS;
     }
+    return status;
+}
 
-    fclose(file);
-    return SUCCESS;
+/**
+ * The number of indices of a run or a literal sequence of RLE8 is stored in a byte. Literal sequences are stored in absolute mode,
+ * which needs at least 3 indices, shorter ones are stored as runs of 1 index.
+ */
+#define RLE8_MAX_COUNT 255
+#define RLE8_MIN_ABSOLUTE_COUNT 3
+
+/**
+ * Compresses a row of indices with RLE8. A run is stored as its length and its index. A literal sequence is stored as 0,
+ * its length and its indices, padded to an even number of bytes. The row ends with the escape 0, 0, the last row with 0, 1.
+ *
+ * @param p_row The indices of the row.
+ * @param width The number of indices.
+ * @param last Whether the row is the last one of the pixel array.
+ * @param p_output A pointer to store the compressed row. Must have room for 2 * width + 2 bytes.
+ * @return The number of bytes of the compressed row.
+ */
+size_t _encode_rle8_row(const unsigned char *p_row, size_t width, bool last, unsigned char *p_output) {
+    size_t size = 0;
+    size_t x = 0;
+    while (x < width) {
+        size_t run = 1;
+        while (x + run < width && run < RLE8_MAX_COUNT && p_row[x + run] == p_row[x]) {
+            run++;
+        }
+        if (run > 1) {
+            p_output[size++] = (unsigned char)run;
+            p_output[size++] = p_row[x];
+            x += run;
+            continue;
+        }
+        // The literal sequence ends where the next run starts.
+        size_t end = x + 1;
+        while (end < width && end - x < RLE8_MAX_COUNT && (end + 1 >= width || p_row[end] != p_row[end + 1])) {
+            end++;
+        }
+        size_t count = end - x;
+        if (count >= RLE8_MIN_ABSOLUTE_COUNT) {
+            p_output[size++] = 0;
+            p_output[size++] = (unsigned char)count;
+            memcpy(p_output + size, p_row + x, count);
+            size += count;
+            if (count % 2 != 0) {
+                p_output[size++] = 0;
+            }
+        } else {
+            for (size_t i = 0; i < count; i++) {
+                p_output[size++] = 1;
+                p_output[size++] = p_row[x + i];
+            }
+        }
+        x = end;
+    }
+    p_output[size++] = 0;
+    p_output[size++] = last ? 1 : 0;
+    return size;
 }
 
 /**
- * Maps the viewport size to the image size. The aspect ratio is kept.
- * Calculates the image size based on the width and the viewport.
- * It keeps the aspect ratio and calculates the height.
+ * Writes the headers and the color table of a BMP file with 8 bits per pixel.
  *
- * @param viewport The viewport of the complex plane
- * @param image_width The width of the image in pixels
- * @param p_image_size The pointer to store the calculated image size
- * @return Status code
+ * @param file The file to write to.
+ * @param p_image_data A pointer to the indexed image data.
+ * @param rle Whether the pixel array is compressed with RLE8.
+ * @param image_size The number of bytes of the pixel array.
+ * @return Status code.
  */
-int _calc_image_size(Viewport viewport, size_t image_width, ImageSize *p_image_size) {
+int _write_indexed_bmp_header(FILE *file, const IndexedImageData *p_image_data, bool rle, uint64_t image_size) {
+    BitmapFileHeader file_header;
+    BitmapInfoHeader info_header;
+    uint64_t file_size;
+    int status = build_bmp_header(p_image_data->size, &file_header, &info_header, &file_size);
+    if (status < 0) return status;
+
+    uint32_t color_table_size = (uint32_t)(p_image_data->num_colors * sizeof(uint32_t));
+    file_size = sizeof(BitmapFileHeader) + sizeof(BitmapInfoHeader) + color_table_size + image_size;
+    file_header.size = file_size <= UINT32_MAX ? (unsigned int)file_size : 0;
+    file_header.offset_bits = sizeof(BitmapFileHeader) + sizeof(BitmapInfoHeader) + color_table_size;
+    info_header.bits_per_pixel = 8;
+    info_header.compression = rle ? 1 : 0;  // BI_RLE8 or no compression
+    info_header.image_size = file_size <= UINT32_MAX ? (unsigned int)image_size : 0;
+    info_header.num_colors = (unsigned int)p_image_data->num_colors;
+    if (fwrite(&file_header, sizeof(BitmapFileHeader), 1, file) != 1 || fwrite(&info_header, sizeof(BitmapInfoHeader), 1, file) != 1 ||
+        fwrite(p_image_data->colors, sizeof(uint32_t), p_image_data->num_colors, file) != p_image_data->num_colors) {
+        return ERROR_FILE_ACCESS;
+    }
+    return SUCCESS;
+}
+
+int save_indexed_bmp(const char *output_path, const IndexedImageData *p_image_data, bool rle, uint64_t *p_num_bytes_written) {
+    ImageSize size = p_image_data->size;
+    unsigned char *p_encoded_row = NULL;
+    if (rle) {
+        if (size.width > (SIZE_MAX - 2) / 2) return ERROR_ARITHMETIC_OVERFLOW;
+        p_encoded_row = (unsigned char *)malloc(2 * size.width + 2);
+        if (p_encoded_row == NULL) return ERROR_MEMORY_ALLOC;
+    }
+    FILE *file = fopen(output_path, "wb");
+    if (!file) {
+        free(p_encoded_row);
+        return ERROR_FILE_ACCESS;
+    }
+
+    // The size of a compressed pixel array is only known after it was written, so its headers are written again afterwards.
+    uint64_t image_size = (uint64_t)p_image_data->stride * size.height;
+    int status = _write_indexed_bmp_header(file, p_image_data, rle, image_size);
+    if (status == SUCCESS && !rle && fwrite(p_image_data->data, 1, (size_t)image_size, file) != image_size) {
+        status = ERROR_FILE_ACCESS;
+    }
+    if (status == SUCCESS && rle) {
+        // The rows are stored from the bottom to the top, like the rows of the indexed image data.
+        image_size = 0;
+        for (size_t row = 0; row < size.height && status == SUCCESS; row++) {
+            size_t encoded_size = _encode_rle8_row(p_image_data->data + row * p_image_data->stride, size.width, row == size.height - 1, p_encoded_row);
+            if (fwrite(p_encoded_row, 1, encoded_size, file) != encoded_size) {
+                status = ERROR_FILE_ACCESS;
+            }
+            image_size += encoded_size;
+        }
+        if (status == SUCCESS && image_size > UINT32_MAX) {
+            // Compressed pixel arrays must give their size in the header.
+            status = ERROR_ARITHMETIC_OVERFLOW;
+        }
+        if (status == SUCCESS && fseek(file, 0, SEEK_SET) != 0) {
+            status = ERROR_FILE_ACCESS;
+        }
+        if (status == SUCCESS) {
+            status = _write_indexed_bmp_header(file, p_image_data, rle, image_size);
+        }
+    }
+    if (fclose(file) != 0 && status == SUCCESS) {
+        status = ERROR_FILE_ACCESS;
+    }
+    free(p_encoded_row);
+    if (status == SUCCESS) {
+        *p_num_bytes_written = sizeof(BitmapFileHeader) + sizeof(BitmapInfoHeader) + p_image_data->num_colors * sizeof(uint32_t) + image_size;
+    }
+    return status;
+}
+
+int calc_image_size(Viewport viewport, size_t image_width, ImageSize *p_image_size) {
     if (viewport.upper_right.real == viewport.lower_left.real ||
         viewport.upper_right.imag == viewport.lower_left.imag) {
         return ERROR_INVALID_VIEWPORT;
@@ -113,10 +270,11 @@ int _malloc_image_data(ImageSize size, ImageData **p_p_image_data) {
     if (size.width == 0 || size.height == 0) {
         return ERROR_IMAGE_SIZE_0;
     }
-    if (size.width > SIZE_MAX / 3 || 3 * size.width > SIZE_MAX / size.height) {
+    if (size.width > (SIZE_MAX - 3) / 3 || get_bmp_row_size(size.width) > SIZE_MAX / size.height) {
         return ERROR_ARITHMETIC_OVERFLOW;
     }
-    size_t malloc_size = size.width * size.height * 3;
+    size_t stride = get_bmp_row_size(size.width);
+    size_t malloc_size = stride * size.height;
 
     unsigned char *p_memory = (unsigned char *)malloc(malloc_size);
     if (p_memory == NULL) {
@@ -131,13 +289,16 @@ int _malloc_image_data(ImageSize size, ImageData **p_p_image_data) {
 
     p_image_data->size = size;
     p_image_data->data = p_memory;
+    p_image_data->stride = stride;
+    p_image_data->p_mapping = NULL;
+    p_image_data->mapping_size = 0;
     *p_p_image_data = p_image_data;
     return SUCCESS;
 }
 
 int create_image_data(Viewport viewport, size_t image_width, ImageData **p_p_image_data) {
     ImageSize size;
-    int status = _calc_image_size(viewport, image_width, &size);
+    int status = calc_image_size(viewport, image_width, &size);
     if (status < 0) {
         return status;
     }
@@ -149,25 +310,138 @@ int create_image_data(Viewport viewport, size_t image_width, ImageData **p_p_ima
 }
 
 int export_and_free(ImageData *p_image_data, const char *output_path) {
+    int status_export = save_bmp(output_path, p_image_data);
+    free_image_data(p_image_data);
+    return status_export;
+}
+
+int set_pixel_in_image_data(size_t x, size_t y, uint32_t color, ImageData *p_image_data) {
     ImageSize size = p_image_data->size;
-    int status_export = _save_bmp(output_path, size, p_image_data->data);
-    if (status_export < 0) {
-        return status_export;
+    if (x >= size.width || y >= size.height) {
+        return GENERIC_ERROR;
     }
-    free(p_image_data);
+
+    unsigned char *p_pixel = get_row_in_image_data(p_image_data, y) + 3 * x;
+
+    p_pixel[0] = get_blue(color);
+    p_pixel[1] = get_green(color);
+    p_pixel[2] = get_red(color);
     return SUCCESS;
 }
 
-int set_pixel_in_image_data(size_t x, size_t y, uint32_t color, ImageData *p_image_data) {
-    ImageSize size = p_image_data->size;
-    if (y > SIZE_MAX / size.width || y * size.width > SIZE_MAX - x || x + y * size.width > SIZE_MAX / 3) {
+int create_image_data_with_size(ImageSize size, ImageData **p_p_image_data) {
+    return _malloc_image_data(size, p_p_image_data);
+}
+
+int create_indexed_image_data(ImageSize size, IndexedImageData **p_p_image_data) {
+    if (size.width == 0 || size.height == 0) {
+        return ERROR_IMAGE_SIZE_0;
+    }
+    if (size.width > SIZE_MAX - 3 || (size.width + 3) / 4 * 4 > SIZE_MAX / size.height) {
         return ERROR_ARITHMETIC_OVERFLOW;
     }
+    IndexedImageData *p_image_data = (IndexedImageData *)malloc(sizeof(IndexedImageData));
+    if (p_image_data == NULL) {
+        return ERROR_MEMORY_ALLOC;
+    }
+    p_image_data->size = size;
+    p_image_data->stride = (size.width + 3) / 4 * 4;
+    p_image_data->data = (unsigned char *)calloc(p_image_data->stride, size.height);
+    p_image_data->num_colors = 0;
+    if (p_image_data->data == NULL) {
+        free(p_image_data);
+        return ERROR_MEMORY_ALLOC;
+    }
+    *p_p_image_data = p_image_data;
+    return SUCCESS;
+}
+
+void free_indexed_image_data(IndexedImageData *p_image_data) {
+    free(p_image_data->data);
+    free(p_image_data);
+}
+
+/**
+ * Creates a file of the given size, or replaces an existing one, and maps it into memory for reading and writing.
+ * The disk space of the file is reserved where possible, so running out of space is reported here and not while writing to the mapping.
+ *
+ * @param path The path of the file.
+ * @param size The size of the file in bytes.
+ * @param p_p_mapping A pointer to store the start of the mapping.
+ * @return Status code.
+ */
+int _map_new_file(const char *path, uint64_t size, void **p_p_mapping) {
+    if (size > SIZE_MAX) return ERROR_ARITHMETIC_OVERFLOW;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return ERROR_FILE_ACCESS;
+    // The mapping object sets the size of the file.
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) return ERROR_FILE_ACCESS;
+    // The view keeps the mapping alive after its handle is closed.
+    *p_p_mapping = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0);
+    CloseHandle(mapping);
+    if (*p_p_mapping == NULL) return ERROR_FILE_ACCESS;
+#else
+    int file = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (file < 0) return ERROR_FILE_ACCESS;
+#ifdef __linux__
+    bool resized = posix_fallocate(file, 0, (off_t)size) == 0;
+#else
+    bool resized = ftruncate(file, (off_t)size) == 0;
+#endif
+    if (!resized) {
+        close(file);
+        return ERROR_FILE_ACCESS;
+    }
+    // The mapping stays valid after the file is closed.
+    void *p_mapping = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    close(file);
+    if (p_mapping == MAP_FAILED) return ERROR_FILE_ACCESS;
+    *p_p_mapping = p_mapping;
+#endif
+    return SUCCESS;
+}
 
-    int index = (x + y * size.width) * 3;
+int create_mapped_image_data(ImageSize size, const char *output_path, ImageData **p_p_image_data) {
+    BitmapFileHeader file_header;
+    BitmapInfoHeader info_header;
+    uint64_t file_size;
+    if (size.width == 0 || size.height == 0) return ERROR_IMAGE_SIZE_0;
+    int status = build_bmp_header(size, &file_header, &info_header, &file_size);
+    if (status < 0) return status;
+
+    ImageData *p_image_data = (ImageData *)malloc(sizeof(ImageData));
+    if (p_image_data == NULL) return ERROR_MEMORY_ALLOC;
+    void *p_mapping;
+    status = _map_new_file(output_path, file_size, &p_mapping);
+    if (status < 0) {
+        free(p_image_data);
+        return status;
+    }
 
-    p_image_data->data[index] = get_blue(color);
-    p_image_data->data[index + 1] = get_green(color);
-    p_image_data->data[index + 2] = get_red(color);
+    // The headers are written once, the pixel array directly follows them.
+    memcpy(p_mapping, &file_header, sizeof(BitmapFileHeader));
+    memcpy((char *)p_mapping + sizeof(BitmapFileHeader), &info_header, sizeof(BitmapInfoHeader));
+    p_image_data->size = size;
+    p_image_data->data = (unsigned char *)p_mapping + file_header.offset_bits;
+    p_image_data->stride = get_bmp_row_size(size.width);
+    p_image_data->p_mapping = p_mapping;
+    p_image_data->mapping_size = (size_t)file_size;
+    *p_p_image_data = p_image_data;
     return SUCCESS;
 }
+
+void free_image_data(ImageData *p_image_data) {
+    if (p_image_data->p_mapping != NULL) {
+#ifdef _WIN32
+        UnmapViewOfFile(p_image_data->p_mapping);
+#else
+        munmap(p_image_data->p_mapping, p_image_data->mapping_size);
+#endif
+    } else {
+        free(p_image_data->data);
+    }
+    free(p_image_data);
+}
@@ -0,0 +1,427 @@
+#include "../include/image_writer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/deflate.h"
+#include "../include/status_manager.h"
+#include "../include/tiff_writer.h"
+
+/**
+ * The number of bytes of filtered rows that are compressed as one segment, and the number of segments per thread that are
+ * compressed before they are written to the file.
+ */
+#define PNG_SEGMENT_SIZE (256 * 1024)
+#define PNG_SEGMENTS_PER_THREAD 4
+
+/**
+ * The number of bytes per pixel of an RGB image with 8 bits per channel, which is the distance of the pixel to the left for the filters.
+ */
+#define PNG_BYTES_PER_PIXEL 3
+
+/**
+ * The filters of PNG rows. Every filtered row starts with the byte of its filter.
+ */
+typedef enum {
+    PNG_FILTER_NONE,
+    PNG_FILTER_SUB,
+    PNG_FILTER_UP,
+    PNG_FILTER_AVERAGE,
+    PNG_FILTER_PAETH,
+    NUM_PNG_FILTERS
+} PngFilter;
+
+static const char *IMAGE_FORMAT_EXTENSIONS[NUM_IMAGE_FORMATS] = {".bmp", ".png", ".tif"};
+static const unsigned char PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+// The header of the zlib stream: deflate with a window of 32 KiB and the default compression level.
+static const unsigned char ZLIB_HEADER[2] = {0x78, 0x9C};
+
+/**
+ * The state shared by the tasks that compress the segments of a batch.
+ */
+typedef struct {
+    const ImageData *p_image_data;
+    // The number of bytes of a filtered row, including the filter byte.
+    size_t row_size;
+    size_t rows_per_segment;
+    size_t num_segments;
+    // The index of the first segment of the batch.
+    size_t first_segment;
+    // The compressed segments of the batch, their Adler-32 checksums and the numbers of filtered bytes.
+    ByteBuffer *outputs;
+    uint32_t *adlers;
+    size_t *sizes;
+} PngEncoder;
+
+const char *get_image_format_extension(ImageFormat format) {
+    return IMAGE_FORMAT_EXTENSIONS[format];
+}
+
+bool get_image_format(const char *path, ImageFormat *p_format) {
+    size_t path_length = strlen(path);
+    for (int format = 0; format < NUM_IMAGE_FORMATS; format++) {
+        size_t extension_length = strlen(IMAGE_FORMAT_EXTENSIONS[format]);
+        if (path_length >= extension_length && strcmp(path + path_length - extension_length, IMAGE_FORMAT_EXTENSIONS[format]) == 0) {
+            *p_format = (ImageFormat)format;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Stores a 32 bit number in big-endian byte order, the byte order of PNG files.
+ *
+ * @param value The number.
+ * @param p_bytes A pointer to store the 4 bytes.
+ */
+void _store_big_endian(uint32_t value, unsigned char *p_bytes) {
+    p_bytes[0] = (unsigned char)(value >> 24);
+    p_bytes[1] = (unsigned char)(value >> 16);
+    p_bytes[2] = (unsigned char)(value >> 8);
+    p_bytes[3] = (unsigned char)value;
+}
+
+/**
+ * Fills the table of the CRC-32 of PNG chunks, which has an entry for every byte.
+ *
+ * @param crc_table A pointer to the 256 entries of the table.
+ */
+void _build_crc_table(uint32_t *crc_table) {
+    for (uint32_t byte = 0; byte < 256; byte++) {
+        uint32_t crc = byte;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = crc & 1 ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+        }
+        crc_table[byte] = crc;
+    }
+}
+
+/**
+ * Updates a CRC-32 with more bytes.
+ *
+ * @param crc_table A pointer to the table of _build_crc_table.
+ * @param crc The CRC of the bytes so far, without the final inversion.
+ * @param data The bytes.
+ * @param size The number of bytes.
+ * @return The CRC including the bytes, without the final inversion.
+ */
+uint32_t _update_crc(const uint32_t *crc_table, uint32_t crc, const unsigned char *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+/**
+ * Writes a chunk of a PNG file: its length, its type, its data and the CRC-32 of the type and the data.
+ *
+ * @param file The file to write to.
+ * @param crc_table A pointer to the table of _build_crc_table.
+ * @param type The four letters of the type.
+ * @param data The data of the chunk.
+ * @param size The number of bytes of the data. Must be less than 2^31.
+ * @param p_num_bytes_written A pointer to the number of bytes written, which is increased by the size of the chunk.
+ * @return Status code.
+ */
+int _write_png_chunk(FILE *file, const uint32_t *crc_table, const char *type, const unsigned char *data, size_t size, uint64_t *p_num_bytes_written) {
+    unsigned char header[8];
+    unsigned char footer[4];
+    _store_big_endian((uint32_t)size, header);
+    memcpy(header + 4, type, 4);
+    uint32_t crc = _update_crc(crc_table, 0xFFFFFFFFu, header + 4, 4);
+    crc = _update_crc(crc_table, crc, data, size);
+    _store_big_endian(crc ^ 0xFFFFFFFFu, footer);
+    if (fwrite(header, 1, sizeof(header), file) != sizeof(header) || (size > 0 && fwrite(data, 1, size, file) != size) ||
+        fwrite(footer, 1, sizeof(footer), file) != sizeof(footer)) {
+        return ERROR_FILE_ACCESS;
+    }
+    *p_num_bytes_written += sizeof(header) + size + sizeof(footer);
+    return SUCCESS;
+}
+
+/**
+ * Converts a row of the image data from blue, green, red to red, green, blue, the order of PNG files.
+ *
+ * @param p_image_data A pointer to the image data.
+ * @param y The y-coordinate of the row, counted from the top.
+ * @param p_rgb A pointer to store the 3 bytes of every pixel of the row.
+ */
+void _convert_row_to_rgb(const ImageData *p_image_data, size_t y, unsigned char *p_rgb) {
+    const unsigned char *p_bgr = get_row_in_image_data(p_image_data, y);
+    for (size_t x = 0; x < p_image_data->size.width; x++) {
+        p_rgb[3 * x] = p_bgr[3 * x + 2];
+        p_rgb[3 * x + 1] = p_bgr[3 * x + 1];
+        p_rgb[3 * x + 2] = p_bgr[3 * x];
+    }
+}
+
+/**
+ * Predicts a byte of a row from its neighbors like a PNG filter.
+ *
+ * @param filter The filter.
+ * @param left The byte of the pixel to the left, or 0 at the start of the row.
+ * @param up The byte of the pixel above, or 0 in the first row.
+ * @param up_left The byte of the pixel above the one to the left, or 0.
+ * @return The prediction, which the filter subtracts from the byte.
+ */
+static inline unsigned char _predict_byte(PngFilter filter, int left, int up, int up_left) {
+    switch (filter) {
+        case PNG_FILTER_SUB:
+            return (unsigned char)left;
+        case PNG_FILTER_UP:
+            return (unsigned char)up;
+        case PNG_FILTER_AVERAGE:
+            return (unsigned char)((left + up) / 2);
+        case PNG_FILTER_PAETH: {
+            int estimate = left + up - up_left;
+            int distance_left = abs(estimate - left);
+            int distance_up = abs(estimate - up);
+            int distance_up_left = abs(estimate - up_left);
+            if (distance_left <= distance_up && distance_left <= distance_up_left) return (unsigned char)left;
+            return (unsigned char)(distance_up <= distance_up_left ? up : up_left);
+        }
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Filters a row with the filter that gives the smallest sum of the absolute values of the filtered bytes as signed numbers,
+ * the heuristic recommended by the PNG specification. Small differences compress better than the pixels themselves.
+ *
+ * @param p_row A pointer to the RGB bytes of the row.
+ * @param p_previous_row A pointer to the RGB bytes of the row above, or to zeros for the first row.
+ * @param num_bytes The number of RGB bytes of a row.
+ * @param p_output A pointer to store the filter byte followed by the filtered bytes.
+ */
+void _filter_row(const unsigned char *p_row, const unsigned char *p_previous_row, size_t num_bytes, unsigned char *p_output) {
+    uint64_t costs[NUM_PNG_FILTERS] = {0};
+    for (size_t i = 0; i < num_bytes; i++) {
+        int left = i >= PNG_BYTES_PER_PIXEL ? p_row[i - PNG_BYTES_PER_PIXEL] : 0;
+        int up_left = i >= PNG_BYTES_PER_PIXEL ? p_previous_row[i - PNG_BYTES_PER_PIXEL] : 0;
+        for (int filter = 0; filter < NUM_PNG_FILTERS; filter++) {
+            signed char difference = (signed char)(p_row[i] - _predict_byte((PngFilter)filter, left, p_previous_row[i], up_left));
+            costs[filter] += (uint64_t)abs(difference);
+        }
+    }
+    PngFilter best_filter = PNG_FILTER_NONE;
+    for (int filter = 1; filter < NUM_PNG_FILTERS; filter++) {
+        if (costs[filter] < costs[best_filter]) {
+            best_filter = (PngFilter)filter;
+        }
+    }
+
+    p_output[0] = (unsigned char)best_filter;
+    for (size_t i = 0; i < num_bytes; i++) {
+        int left = i >= PNG_BYTES_PER_PIXEL ? p_row[i - PNG_BYTES_PER_PIXEL] : 0;
+        int up_left = i >= PNG_BYTES_PER_PIXEL ? p_previous_row[i - PNG_BYTES_PER_PIXEL] : 0;
+        p_output[1 + i] = (unsigned char)(p_row[i] - _predict_byte(best_filter, left, p_previous_row[i], up_left));
+    }
+}
+
+/**
+ * Filters and compresses a segment of the image. The rows before the segment that fit into the window of deflate are filtered again
+ * as its dictionary, so every segment only depends on the image data and the segments can be compressed in any order.
+ * The first segment starts with the zlib header.
+ *
+ * @param task_index The index of the segment within the batch.
+ * @param worker_index The index of the worker thread, unused.
+ * @param p_context A pointer to the PngEncoder.
+ * @return Status code.
+ */
+int _compress_png_segment(size_t task_index, size_t worker_index, void *p_context) {
+    (void)worker_index;
+    PngEncoder *p_encoder = (PngEncoder *)p_context;
+    const ImageData *p_image_data = p_encoder->p_image_data;
+    size_t segment = p_encoder->first_segment + task_index;
+    size_t first_row = segment * p_encoder->rows_per_segment;
+    size_t end_row = first_row + p_encoder->rows_per_segment;
+    if (end_row > p_image_data->size.height) {
+        end_row = p_image_data->size.height;
+    }
+    size_t num_dictionary_rows = (DEFLATE_WINDOW_SIZE + p_encoder->row_size - 1) / p_encoder->row_size;
+    size_t start_row = first_row > num_dictionary_rows ? first_row - num_dictionary_rows : 0;
+
+    size_t num_rgb_bytes = p_encoder->row_size - 1;
+    unsigned char *p_filtered = (unsigned char *)malloc((end_row - start_row) * p_encoder->row_size);
+    unsigned char *p_rgb_rows = (unsigned char *)calloc(2, num_rgb_bytes);
+    if (p_filtered == NULL || p_rgb_rows == NULL) {
+        free(p_filtered);
+        free(p_rgb_rows);
+        return ERROR_MEMORY_ALLOC;
+    }
+    // The rows alternate between the two halves of p_rgb_rows, the row above the first one is zeros.
+    unsigned char *p_row = p_rgb_rows;
+    unsigned char *p_previous_row = p_rgb_rows + num_rgb_bytes;
+    if (start_row > 0) {
+        _convert_row_to_rgb(p_image_data, start_row - 1, p_previous_row);
+    }
+    for (size_t y = start_row; y < end_row; y++) {
+        _convert_row_to_rgb(p_image_data, y, p_row);
+        _filter_row(p_row, p_previous_row, num_rgb_bytes, p_filtered + (y - start_row) * p_encoder->row_size);
+        unsigned char *p_swap = p_row;
+        p_row = p_previous_row;
+        p_previous_row = p_swap;
+    }
+    free(p_rgb_rows);
+
+    size_t dictionary_size = (first_row - start_row) * p_encoder->row_size;
+    if (dictionary_size > DEFLATE_WINDOW_SIZE) {
+        dictionary_size = DEFLATE_WINDOW_SIZE;
+    }
+    const unsigned char *p_segment = p_filtered + (first_row - start_row) * p_encoder->row_size;
+    size_t size = (end_row - first_row) * p_encoder->row_size;
+    ByteBuffer *p_output = &p_encoder->outputs[task_index];
+    int status = segment == 0 ? append_to_byte_buffer(p_output, ZLIB_HEADER, sizeof(ZLIB_HEADER)) : SUCCESS;
+    if (status == SUCCESS) {
+        status = deflate_segment(p_segment - dictionary_size, dictionary_size, size, segment == p_encoder->num_segments - 1, p_output);
+    }
+    p_encoder->adlers[task_index] = update_adler32(1, p_segment, size);
+    p_encoder->sizes[task_index] = size;
+    free(p_filtered);
+    return status;
+}
+
+/**
+ * Writes the signature of a PNG file and its header chunk for an RGB image with 8 bits per channel.
+ *
+ * @param file The file to write to.
+ * @param crc_table A pointer to the table of _build_crc_table.
+ * @param size The size of the image in pixels.
+ * @param p_num_bytes_written A pointer to the number of bytes written.
+ * @return Status code.
+ */
+int _write_png_header(FILE *file, const uint32_t *crc_table, ImageSize size, uint64_t *p_num_bytes_written) {
+    unsigned char header[13];
+    _store_big_endian((uint32_t)size.width, header);
+    _store_big_endian((uint32_t)size.height, header + 4);
+    header[8] = 8;   // bit depth
+    header[9] = 2;   // color type: RGB
+    header[10] = 0;  // compression method: deflate
+    header[11] = 0;  // filter method: adaptive filtering with the five basic filters
+    header[12] = 0;  // no interlace
+    if (fwrite(PNG_SIGNATURE, 1, sizeof(PNG_SIGNATURE), file) != sizeof(PNG_SIGNATURE)) {
+        return ERROR_FILE_ACCESS;
+    }
+    *p_num_bytes_written += sizeof(PNG_SIGNATURE);
+    return _write_png_chunk(file, crc_table, "IHDR", header, sizeof(header), p_num_bytes_written);
+}
+
+int save_png(const char *output_path, const ImageData *p_image_data, ThreadPool *p_thread_pool, ImageFileStatistics *p_statistics) {
+    ImageSize size = p_image_data->size;
+    // PNG files store the size as 31 bit numbers.
+    if (size.width > INT32_MAX || size.height > INT32_MAX || size.width > (INT32_MAX - 1) / PNG_BYTES_PER_PIXEL) {
+        return ERROR_ARITHMETIC_OVERFLOW;
+    }
+    StageClock encode_clock, write_clock;
+    ImageFileStatistics statistics;
+    memset(&statistics, 0, sizeof(ImageFileStatistics));
+    uint32_t crc_table[256];
+    _build_crc_table(crc_table);
+
+    PngEncoder encoder;
+    encoder.p_image_data = p_image_data;
+    encoder.row_size = 1 + PNG_BYTES_PER_PIXEL * size.width;
+    encoder.rows_per_segment = PNG_SEGMENT_SIZE / encoder.row_size > 0 ? PNG_SEGMENT_SIZE / encoder.row_size : 1;
+    encoder.num_segments = (size.height + encoder.rows_per_segment - 1) / encoder.rows_per_segment;
+    size_t batch_size = (p_thread_pool != NULL ? get_thread_pool_size(p_thread_pool) : 1) * PNG_SEGMENTS_PER_THREAD;
+    if (batch_size > encoder.num_segments) {
+        batch_size = encoder.num_segments;
+    }
+    encoder.outputs = (ByteBuffer *)calloc(batch_size, sizeof(ByteBuffer));
+    encoder.adlers = (uint32_t *)malloc(batch_size * sizeof(uint32_t));
+    encoder.sizes = (size_t *)malloc(batch_size * sizeof(size_t));
+    if (encoder.outputs == NULL || encoder.adlers == NULL || encoder.sizes == NULL) {
+        free(encoder.outputs);
+        free(encoder.adlers);
+        free(encoder.sizes);
+        return ERROR_MEMORY_ALLOC;
+    }
+
+    start_stage_clock(&write_clock);
+    FILE *file = fopen(output_path, "wb");
+    int status = file != NULL ? _write_png_header(file, crc_table, size, &statistics.num_bytes_written) : ERROR_FILE_ACCESS;
+    stop_stage_clock(&write_clock, &statistics.write_time);
+
+    // The segments are compressed in batches, and every batch is written before the next one is compressed, which bounds the memory.
+    uint32_t adler = 1;
+    for (encoder.first_segment = 0; encoder.first_segment < encoder.num_segments && status == SUCCESS; encoder.first_segment += batch_size) {
+        size_t num_tasks = encoder.num_segments - encoder.first_segment < batch_size ? encoder.num_segments - encoder.first_segment : batch_size;
+        start_stage_clock(&encode_clock);
+        if (p_thread_pool != NULL) {
+            status = run_thread_pool(p_thread_pool, num_tasks, _compress_png_segment, &encoder, NULL);
+        } else {
+            for (size_t task_index = 0; task_index < num_tasks && status == SUCCESS; task_index++) {
+                status = _compress_png_segment(task_index, 0, &encoder);
+            }
+        }
+        for (size_t task_index = 0; task_index < num_tasks; task_index++) {
+            adler = combine_adler32(adler, encoder.adlers[task_index], encoder.sizes[task_index]);
+        }
+        // The checksum of all filtered rows ends the zlib stream.
+        if (status == SUCCESS && encoder.first_segment + num_tasks == encoder.num_segments) {
+            unsigned char trailer[4];
+            _store_big_endian(adler, trailer);
+            status = append_to_byte_buffer(&encoder.outputs[num_tasks - 1], trailer, sizeof(trailer));
+        }
+        stop_stage_clock(&encode_clock, &statistics.encode_time);
+
+        start_stage_clock(&write_clock);
+        for (size_t task_index = 0; task_index < num_tasks; task_index++) {
+            if (status == SUCCESS) {
+                status = _write_png_chunk(file, crc_table, "IDAT", encoder.outputs[task_index].data, encoder.outputs[task_index].size, &statistics.num_bytes_written);
+            }
+            free_byte_buffer(&encoder.outputs[task_index]);
+        }
+        stop_stage_clock(&write_clock, &statistics.write_time);
+    }
+
+    start_stage_clock(&write_clock);
+    if (status == SUCCESS) {
+        status = _write_png_chunk(file, crc_table, "IEND", NULL, 0, &statistics.num_bytes_written);
+    }
+    if (file != NULL && fclose(file) != 0 && status == SUCCESS) {
+        status = ERROR_FILE_ACCESS;
+    }
+    stop_stage_clock(&write_clock, &statistics.write_time);
+    free(encoder.outputs);
+    free(encoder.adlers);
+    free(encoder.sizes);
+
+    if (status == SUCCESS && p_statistics != NULL) {
+        add_stage_time(&p_statistics->encode_time, &statistics.encode_time);
+        add_stage_time(&p_statistics->write_time, &statistics.write_time);
+        p_statistics->num_bytes_written += statistics.num_bytes_written;
+    }
+    return status;
+}
+
+int save_image(const char *output_path, const ImageData *p_image_data, ThreadPool *p_thread_pool, ImageFileStatistics *p_statistics) {
+    ImageFormat format = IMAGE_FORMAT_BMP;
+    get_image_format(output_path, &format);
+    if (format == IMAGE_FORMAT_PNG) {
+        return save_png(output_path, p_image_data, p_thread_pool, p_statistics);
+    }
+    if (format == IMAGE_FORMAT_TIFF) {
+        // Every tile is written by the task that encodes it, so writing the file is part of encoding it.
+        StageClock encode_clock;
+        start_stage_clock(&encode_clock);
+        uint64_t num_bytes_written = 0;
+        int status = save_tiff(output_path, p_image_data, p_thread_pool, &num_bytes_written);
+        if (status == SUCCESS && p_statistics != NULL) {
+            stop_stage_clock(&encode_clock, &p_statistics->encode_time);
+            p_statistics->num_bytes_written += num_bytes_written;
+        }
+        return status;
+    }
+
+    StageClock write_clock;
+    start_stage_clock(&write_clock);
+    int status = save_bmp(output_path, p_image_data);
+    if (status == SUCCESS && p_statistics != NULL) {
+        stop_stage_clock(&write_clock, &p_statistics->write_time);
+        p_statistics->num_bytes_written += get_bmp_file_size(p_image_data->size);
+    }
+    return status;
+}
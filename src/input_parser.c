@@ -1,11 +1,15 @@
 #include "..\include\input_parser.h"
 
 #include <ctype.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "..\include\antialiasing.h"
+#include "..\include\fixed_point.h"
+#include "..\include\iteration_kernel.h"
 #include "..\include\status_manager.h"
 
 // The string that separates the key and the value in the ini file.
@@ -18,8 +22,39 @@
 #define KEY_UPPER_RIGHT_IMAG "upper_right_imag"
 #define KEY_INNER_COLOR "inner_color"
 #define KEY_OUTER_COLORS "outer_colors"
+#define KEY_SMOOTH_COLORING "smooth_coloring"
+// The keys of the deep zoom mode. They replace the corners of the viewport.
+#define KEY_CENTER_REAL "center_real"
+#define KEY_CENTER_IMAG "center_imag"
+#define KEY_VIEWPORT_WIDTH "viewport_width"
+#define KEY_VIEWPORT_HEIGHT "viewport_height"
+// The keys that switch the interior checks on and off.
+#define KEY_CARDIOID_CHECK "cardioid_check"
+#define KEY_BULB_CHECK "bulb_check"
+#define KEY_PERIODICITY_CHECK "periodicity_check"
+// The key that selects the render mode and its values.
+#define KEY_RENDER_MODE "render_mode"
+#define RENDER_MODE_BRUTE_FORCE_STR "brute_force"
+#define RENDER_MODE_SUBDIVISION_STR "subdivision"
+
+// The key that selects the number type of the iteration. Its values are the names of get_precision_name.
+#define KEY_PRECISION "precision"
+
+// The keys that select the formula and its parameters. The values of the formula are the names of get_formula_name,
+// and multibrot, which is the Mandelbrot set with a power above 2.
+#define KEY_FORMULA "formula"
+#define FORMULA_MULTIBROT_STR "multibrot"
+#define KEY_POWER "power"
+#define KEY_JULIA_C "julia_c"
+
+#define KEY_SUPERSAMPLING "supersampling"
+#define KEY_SUPERSAMPLING_THRESHOLD "supersampling_threshold"
 // The string that separates the values in an array in the ini file.
 #define ARRAY_SEPARATOR_STR ","
+
+// The characters that separate the values of a keyframe, and the number of values.
+#define KEYFRAME_SEPARATORS " \t,"
+#define KEYFRAME_NUM_VALUES 4
 // Comment characters that indicate that the line is a comment.
 #define NUM_COMMENT_CHARS 2
 #define COMMENT_CHARS {'#', ';'}
@@ -27,6 +62,9 @@
 #define STR_TERMINATOR '\0'
 // Note that this error code is only for internal use. It will not be returned to by any function defined in the header file.
 #define ERROR_PARSING -1
+// Corners whose rounding to doubles moves them by more than this fraction of the viewport width are turned into a center
+// with fixed point precision. The rounding is then visible at image widths of about 2^20 pixels.
+#define MAX_CORNER_ROUNDING_ERROR (1.0 / (1 << 20))
 
 /**
  * Parses a string to a size_t value.
@@ -44,6 +82,7 @@ int _parse_size_t(const char *str, size_t *p_value) {
     if (*endptr != STR_TERMINATOR) {
         return ERROR_PARSING;
     }
+    return SUCCESS;
 }
 
 /**
@@ -61,6 +100,29 @@ int _parse_double(const char *str, double *p_value) {
     return SUCCESS;
 }
 
+/**
+ * Parses a coordinate of a corner of the viewport to the nearest double and the part that is lost by the rounding,
+ * which is computed with a fixed point number, so corners can be given with more digits than a double has.
+ *
+ * @param str The string to parse.
+ * @param p_value The pointer to store the parsed value.
+ * @param p_low The pointer to store the difference of the exact value and the parsed value in double precision.
+ */
+int _parse_coordinate(const char *str, double *p_value, double *p_low) {
+    int status = _parse_double(str, p_value);
+    if (status != SUCCESS) {
+        return status;
+    }
+    // Values beyond the range of a fixed point number are far outside of the Mandelbrot set, so their rounding does not matter.
+    FixedPoint exact;
+    *p_low = 0.0;
+    if (fabs(*p_value) < 1e9 && parse_fixed_point(str, &exact) == SUCCESS) {
+        DoubleDouble rounded = {*p_value, 0.0};
+        *p_low = subtract_double_double(fixed_point_to_double_double(&exact), rounded).hi;
+    }
+    return SUCCESS;
+}
+
 /**
  * Parses a string as a hexadecimal int value.
  *
@@ -76,6 +138,23 @@ int _parse_hex(const char *str, uint32_t *p_value) {
     return SUCCESS;
 }
 
+/**
+ * Parses a string as a boolean value. Accepted are 1, 0, true and false.
+ *
+ * @param str The string to parse.
+ * @param p_value The pointer to store the parsed value.
+ */
+int _parse_bool(const char *str, bool *p_value) {
+    if (strcmp(str, "1") == 0 || strcmp(str, "true") == 0) {
+        *p_value = true;
+    } else if (strcmp(str, "0") == 0 || strcmp(str, "false") == 0) {
+        *p_value = false;
+    } else {
+        return ERROR_PARSING;
+    }
+    return SUCCESS;
+}
+
 /**
  * Removes all spaces from a string. The function modifies the input string.
  *
@@ -110,22 +189,22 @@ int _set_value(char *key, char *value, Configuration *p_settings) {
             return ERROR_INVALID_ITERATION_DEPTH;
         }
     } else if (strcmp(key, KEY_LOWER_LEFT_REAL) == 0) {
-        status = _parse_double(value, &p_settings->viewport.lower_left.real);
+        status = _parse_coordinate(value, &p_settings->viewport.lower_left.real, &p_settings->viewport_low.lower_left.real);
         if (status != SUCCESS) {
             return ERROR_INVALID_VIEWPORT;
         }
     } else if (strcmp(key, KEY_LOWER_LEFT_IMAG) == 0) {
-        status = _parse_double(value, &p_settings->viewport.lower_left.imag);
+        status = _parse_coordinate(value, &p_settings->viewport.lower_left.imag, &p_settings->viewport_low.lower_left.imag);
         if (status != SUCCESS) {
             return ERROR_INVALID_VIEWPORT;
         }
     } else if (strcmp(key, KEY_UPPER_RIGHT_REAL) == 0) {
-        status = _parse_double(value, &p_settings->viewport.upper_right.real);
+        status = _parse_coordinate(value, &p_settings->viewport.upper_right.real, &p_settings->viewport_low.upper_right.real);
         if (status != SUCCESS) {
             return ERROR_INVALID_VIEWPORT;
         }
     } else if (strcmp(key, KEY_UPPER_RIGHT_IMAG) == 0) {
-        status = _parse_double(value, &p_settings->viewport.upper_right.imag);
+        status = _parse_coordinate(value, &p_settings->viewport.upper_right.imag, &p_settings->viewport_low.upper_right.imag);
         if (status != SUCCESS) {
             return ERROR_INVALID_VIEWPORT;
         }
@@ -135,21 +214,130 @@ int _set_value(char *key, char *value, Configuration *p_settings) {
             return ERROR_INVALID_INNER_COLOR;
         }
     } else if (strcmp(key, KEY_OUTER_COLORS) == 0) {
-        // Parse the outer colors as an array
+        // Parse the outer colors as an array. There is one color more than separators.
+        size_t num_colors = 1;
+        for (const char *p = value; *p != STR_TERMINATOR; p++) {
+            num_colors += *p == ARRAY_SEPARATOR_STR[0];
+        }
+        uint32_t *outer_colors = (uint32_t *)malloc(num_colors * sizeof(uint32_t));
+        if (outer_colors == NULL) {
+            return ERROR_MEMORY_ALLOC;
+        }
         char *token = strtok(value, ARRAY_SEPARATOR_STR);
         size_t index = 0;
-        while (status == SUCCESS && token != NULL && index < MAX_NUM_COLORS) {
-            status = _parse_hex(token, &p_settings->outer_colors[index]);
+        while (status == SUCCESS && token != NULL && index < num_colors) {
+            status = _parse_hex(token, &outer_colors[index]);
             token = strtok(NULL, ARRAY_SEPARATOR_STR);
             index++;
         }
         if (status != SUCCESS) {
+            free(outer_colors);
             return ERROR_INVALID_OUTER_COLORS;
         }
+        free(p_settings->outer_colors);
+        p_settings->outer_colors = outer_colors;
         p_settings->num_outer_colors = index;  // Set the actual number of outer colors
+    } else if (strcmp(key, KEY_SMOOTH_COLORING) == 0) {
+        status = _parse_bool(value, &p_settings->smooth_coloring);
+        if (status != SUCCESS) {
+            return ERROR_INVALID_CONFIG_VALUE;
+        }
+    } else if (strcmp(key, KEY_CENTER_REAL) == 0 || strcmp(key, KEY_CENTER_IMAG) == 0) {
+        FixedPoint *p_center = strcmp(key, KEY_CENTER_REAL) == 0 ? &p_settings->center_real : &p_settings->center_imag;
+        status = parse_fixed_point(value, p_center);
+        if (status != SUCCESS) {
+            return status == ERROR_MEMORY_ALLOC ? status : ERROR_INVALID_VIEWPORT;
+        }
+        p_settings->deep_zoom = true;
+    } else if (strcmp(key, KEY_VIEWPORT_WIDTH) == 0 || strcmp(key, KEY_VIEWPORT_HEIGHT) == 0) {
+        // The viewport is centered around the origin. It is moved to the center during rendering.
+        double extent;
+        status = _parse_double(value, &extent);
+        if (status != SUCCESS || !(extent > 0)) {
+            return ERROR_INVALID_VIEWPORT;
+        }
+        if (strcmp(key, KEY_VIEWPORT_WIDTH) == 0) {
+            p_settings->viewport.lower_left.real = -extent / 2;
+            p_settings->viewport.upper_right.real = extent / 2;
+        } else {
+            p_settings->viewport.lower_left.imag = -extent / 2;
+            p_settings->viewport.upper_right.imag = extent / 2;
+        }
+    } else if (strcmp(key, KEY_CARDIOID_CHECK) == 0 || strcmp(key, KEY_BULB_CHECK) == 0 || strcmp(key, KEY_PERIODICITY_CHECK) == 0) {
+        bool enabled;
+        status = _parse_bool(value, &enabled);
+        if (status != SUCCESS) {
+            return ERROR_INVALID_CONFIG_VALUE;
+        }
+        unsigned int flag = strcmp(key, KEY_CARDIOID_CHECK) == 0 ? INTERIOR_CHECK_CARDIOID
+                            : strcmp(key, KEY_BULB_CHECK) == 0  ? INTERIOR_CHECK_BULB
+                                                                : INTERIOR_CHECK_PERIODICITY;
+        if (enabled) {
+            p_settings->interior_checks |= flag;
+        } else {
+            p_settings->interior_checks &= ~flag;
+        }
+    } else if (strcmp(key, KEY_RENDER_MODE) == 0) {
+        if (strcmp(value, RENDER_MODE_BRUTE_FORCE_STR) == 0) {
+            p_settings->render_mode = RENDER_MODE_BRUTE_FORCE;
+        } else if (strcmp(value, RENDER_MODE_SUBDIVISION_STR) == 0) {
+            p_settings->render_mode = RENDER_MODE_SUBDIVISION;
+        } else {
+            return ERROR_INVALID_CONFIG_VALUE;
+        }
+    } else if (strcmp(key, KEY_PRECISION) == 0) {
+        Precision precision = PRECISION_AUTO;
+        while (precision <= PRECISION_PERTURBATION && strcmp(value, get_precision_name(precision)) != 0) {
+            precision++;
+        }
+        if (precision > PRECISION_PERTURBATION) {
+            return ERROR_INVALID_CONFIG_VALUE;
+        }
+        p_settings->precision = precision;
+    } else if (strcmp(key, KEY_FORMULA) == 0) {
+        Formula formula = FORMULA_MANDELBROT;
+        while (formula < NUM_FORMULAS && strcmp(value, get_formula_name(formula)) != 0) {
+            formula++;
+        }
+        if (strcmp(value, FORMULA_MULTIBROT_STR) == 0) {
+            formula = FORMULA_MANDELBROT;
+        } else if (formula == NUM_FORMULAS) {
+            return ERROR_INVALID_CONFIG_VALUE;
+        }
+        p_settings->formula = formula;
+    } else if (strcmp(key, KEY_POWER) == 0) {
+        size_t power;
+        status = _parse_size_t(value, &power);
+        if (status != SUCCESS || power < 2 || power > MAX_FORMULA_POWER) {
+            return ERROR_INVALID_CONFIG_VALUE;
+        }
+        p_settings->power = (unsigned int)power;
+    } else if (strcmp(key, KEY_JULIA_C) == 0) {
+        // The real and the imaginary part, separated like the values of an array. The escape radius only works for |c| <= 2.
+        char *real = strtok(value, ARRAY_SEPARATOR_STR);
+        char *imag = strtok(NULL, ARRAY_SEPARATOR_STR);
+        Complex julia_c;
+        if (real == NULL || imag == NULL || strtok(NULL, ARRAY_SEPARATOR_STR) != NULL || _parse_double(real, &julia_c.real) != SUCCESS ||
+            _parse_double(imag, &julia_c.imag) != SUCCESS || !(julia_c.real * julia_c.real + julia_c.imag * julia_c.imag <= ESCAPE_RADIUS * ESCAPE_RADIUS)) {
+            return ERROR_INVALID_CONFIG_VALUE;
+        }
+        p_settings->julia_c = julia_c;
+    } else if (strcmp(key, KEY_SUPERSAMPLING) == 0) {
+        status = _parse_size_t(value, &p_settings->supersampling);
+        if (status != SUCCESS || p_settings->supersampling > MAX_SUPERSAMPLING) {
+            return ERROR_INVALID_CONFIG_VALUE;
+        }
+    } else if (strcmp(key, KEY_SUPERSAMPLING_THRESHOLD) == 0) {
+        size_t threshold;
+        status = _parse_size_t(value, &threshold);
+        if (status != SUCCESS || threshold > 255) {
+            return ERROR_INVALID_CONFIG_VALUE;
+        }
+        p_settings->supersampling_threshold = (unsigned int)threshold;
     } else {
         return ERROR_INVALID_CONFIG_KEY;
     }
+    return SUCCESS;
 }
 
 /**
@@ -168,38 +356,256 @@ bool _is_comment_line(char *line) {
     return false;
 }
 
+/**
+ * Reads a line of arbitrary length from a file. The line buffer is grown as needed and keeps its size for the next line.
+ *
+ * @param file The file to read from.
+ * @param p_p_line A pointer to the line buffer. Must point to NULL or a buffer allocated with malloc.
+ * @param p_capacity A pointer to the size of the line buffer.
+ * @return 1 if a line was read, 0 at the end of the file, or a negative status code.
+ */
+int _read_line(FILE *file, char **p_p_line, size_t *p_capacity) {
+    size_t length = 0;
+    do {
+        if (*p_capacity - length < 2) {
+            size_t capacity = *p_capacity < MAX_LINE_LENGTH ? MAX_LINE_LENGTH : 2 * *p_capacity;
+            char *p_line = (char *)realloc(*p_p_line, capacity);
+            if (p_line == NULL) return ERROR_MEMORY_ALLOC;
+            *p_p_line = p_line;
+            *p_capacity = capacity;
+        }
+        if (fgets(*p_p_line + length, (int)(*p_capacity - length), file) == NULL) {
+            return length > 0;
+        }
+        length += strlen(*p_p_line + length);
+    } while ((*p_p_line)[length - 1] != '\n');
+    return 1;
+}
+
+/**
+ * Parses a single line of an ini file and sets the value of its key in the configuration. Comment lines and lines without a value are skipped.
+ *
+ * @param line The line. It is modified by the parser.
+ * @param p_config A pointer to the configuration struct to store the value.
+ * @return Status code.
+ */
+int _parse_ini_line(char *line, Configuration *p_config) {
+    // Remove newline characters
+    line[strcspn(line, "\r\n")] = 0;
+    _remove_spaces(line);
+
+    if (_is_comment_line(line)) {
+        // Comment line, skip
+        return SUCCESS;
+    }
+
+    // Note that strchr expects a char but strtok expects a *char (string).
+    if (strchr(line, KEY_VALUE_SEPARATOR_STR[0])) {
+        // Separate the line into key and value
+        char *key = strtok(line, KEY_VALUE_SEPARATOR_STR);
+        char *value = strtok(NULL, KEY_VALUE_SEPARATOR_STR);
+
+        if (key && value) {
+            return _set_value(key, value, p_config);
+        }
+    }
+    return SUCCESS;
+}
+
+/**
+ * Turns corners that lose too much when they are rounded to doubles into the center of the viewport with fixed point precision,
+ * like in deep zoom mode. The viewport is then centered around the origin, and the renderer adds the center in double-double precision.
+ *
+ * @param p_config A pointer to the configuration struct. Must not be in deep zoom mode.
+ */
+void _center_precise_corners(Configuration *p_config) {
+    Viewport viewport = p_config->viewport;
+    Viewport low = p_config->viewport_low;
+    double width = fabs(viewport.upper_right.real - viewport.lower_left.real);
+    double max_low = fmax(fmax(fabs(low.lower_left.real), fabs(low.lower_left.imag)), fmax(fabs(low.upper_right.real), fabs(low.upper_right.imag)));
+    if (!(max_low > width * MAX_CORNER_ROUNDING_ERROR)) return;
+
+    // Halving is exact, so the center and the extents are as precise as the sums.
+    DoubleDouble real = add_double_double(double_double_from_sum(viewport.lower_left.real, low.lower_left.real),
+                                          double_double_from_sum(viewport.upper_right.real, low.upper_right.real));
+    DoubleDouble imag = add_double_double(double_double_from_sum(viewport.lower_left.imag, low.lower_left.imag),
+                                          double_double_from_sum(viewport.upper_right.imag, low.upper_right.imag));
+    DoubleDouble real_extent = subtract_double_double(double_double_from_sum(viewport.upper_right.real, low.upper_right.real),
+                                                      double_double_from_sum(viewport.lower_left.real, low.lower_left.real));
+    DoubleDouble imag_extent = subtract_double_double(double_double_from_sum(viewport.upper_right.imag, low.upper_right.imag),
+                                                      double_double_from_sum(viewport.lower_left.imag, low.lower_left.imag));
+    real.hi /= 2;
+    real.lo /= 2;
+    imag.hi /= 2;
+    imag.lo /= 2;
+    double_double_to_fixed_point(real, FIXED_POINT_MAX_LIMBS, &p_config->center_real);
+    double_double_to_fixed_point(imag, FIXED_POINT_MAX_LIMBS, &p_config->center_imag);
+    p_config->viewport.lower_left.real = -real_extent.hi / 2;
+    p_config->viewport.upper_right.real = real_extent.hi / 2;
+    p_config->viewport.lower_left.imag = -imag_extent.hi / 2;
+    p_config->viewport.upper_right.imag = imag_extent.hi / 2;
+    p_config->deep_zoom = true;
+}
+
+/**
+ * Checks a configuration after all of its lines were parsed and frees it if it is invalid.
+ *
+ * @param status The status of parsing the lines.
+ * @param p_config A pointer to the configuration struct.
+ * @return Status code.
+ */
+int _finish_configuration(int status, Configuration *p_config) {
+    if (status < 0) {
+        free_configuration(p_config);
+        return status;
+    }
+
+    // In deep zoom mode, the viewport must be given by its width and height, so it is centered around the origin.
+    if (p_config->deep_zoom && (p_config->viewport.lower_left.real != -p_config->viewport.upper_right.real ||
+                                p_config->viewport.lower_left.imag != -p_config->viewport.upper_right.imag)) {
+        free_configuration(p_config);
+        return ERROR_INVALID_VIEWPORT;
+    }
+    // The reference orbits of deep zoom mode are only computed for the Mandelbrot set with power 2.
+    if (p_config->deep_zoom && !is_quadratic_mandelbrot(p_config)) {
+        free_configuration(p_config);
+        return ERROR_INVALID_CONFIG_VALUE;
+    }
+    // The samples between the pixels can not be iterated with perturbation, which needs the reference orbits of the whole image.
+    if (p_config->precision == PRECISION_PERTURBATION && p_config->supersampling > 1) {
+        free_configuration(p_config);
+        return ERROR_INVALID_CONFIG_VALUE;
+    }
+    // The renderer only adds a precise center for the Mandelbrot set with power 2, the other formulas are iterated in double precision at most.
+    if (!p_config->deep_zoom && is_quadratic_mandelbrot(p_config)) {
+        _center_precise_corners(p_config);
+    }
+    memset(&p_config->viewport_low, 0, sizeof(Viewport));
+    return SUCCESS;
+}
+
 int parse_ini_file(const char *path, Configuration *p_config) {
     FILE *file = fopen(path, "r");
     if (file == NULL) {
         return ERROR_FILE_NOT_FOUND;
     }
 
-    char line[MAX_LINE_LENGTH];
+    char *line = NULL;
+    size_t capacity = 0;
+    int status;
+    memset(p_config, 0, sizeof(Configuration));
+    p_config->interior_checks = INTERIOR_CHECK_ALL;
+    p_config->power = 2;
+    p_config->supersampling_threshold = DEFAULT_SUPERSAMPLING_THRESHOLD;
 
-    while (fgets(line, sizeof(line), file)) {
-        // Remove newline characters
-        line[strcspn(line, "\r\n")] = 0;
-        _remove_spaces(line);
+    while ((status = _read_line(file, &line, &capacity)) > 0) {
+        status = _parse_ini_line(line, p_config);
+        if (status < 0) break;
+    }
 
-        if (_is_comment_line(line)) {
-            // Comment line, skip
-            continue;
+    free(line);
+    fclose(file);
+    return _finish_configuration(status, p_config);
+}
+
+int parse_ini_string(const char *text, Configuration *p_config) {
+    // The lines are parsed in place, so they are copied first.
+    char *copy = (char *)malloc(strlen(text) + 1);
+    if (copy == NULL) return ERROR_MEMORY_ALLOC;
+    strcpy(copy, text);
+
+    int status = SUCCESS;
+    memset(p_config, 0, sizeof(Configuration));
+    p_config->interior_checks = INTERIOR_CHECK_ALL;
+    p_config->power = 2;
+    p_config->supersampling_threshold = DEFAULT_SUPERSAMPLING_THRESHOLD;
+
+    char *line = copy;
+    while (line != NULL && status == SUCCESS) {
+        char *next_line = strchr(line, '\n');
+        if (next_line != NULL) {
+            *next_line++ = 0;
         }
+        status = _parse_ini_line(line, p_config);
+        line = next_line;
+    }
 
-        // Note that strchr expects a char but strtok expects a *char (string).
-        if (strchr(line, KEY_VALUE_SEPARATOR_STR[0])) {
-            // Separate the line into key and value
-            char *key = strtok(line, KEY_VALUE_SEPARATOR_STR);
-            char *value = strtok(NULL, KEY_VALUE_SEPARATOR_STR);
+    free(copy);
+    return _finish_configuration(status, p_config);
+}
 
-            if (key && value) {
-                int status = _set_value(key, value, p_config);
-                if (status < 0) return status;
+/**
+ * Parses a line of a keyframe file: the frame number, the real and the imaginary part of the center and the width of the viewport.
+ *
+ * @param line The line without the line break. It is modified by the parser.
+ * @param p_keyframe A pointer to store the keyframe.
+ * @return Status code.
+ */
+int _parse_keyframe(char *line, Keyframe *p_keyframe) {
+    char *tokens[KEYFRAME_NUM_VALUES];
+    char *token = strtok(line, KEYFRAME_SEPARATORS);
+    for (int i = 0; i < KEYFRAME_NUM_VALUES; i++) {
+        if (token == NULL) return ERROR_INVALID_KEYFRAMES;
+        tokens[i] = token;
+        token = strtok(NULL, KEYFRAME_SEPARATORS);
+    }
+    if (token != NULL || _parse_size_t(tokens[0], &p_keyframe->frame) != SUCCESS || _parse_double(tokens[1], &p_keyframe->center_real) != SUCCESS ||
+        _parse_double(tokens[2], &p_keyframe->center_imag) != SUCCESS || _parse_double(tokens[3], &p_keyframe->width) != SUCCESS ||
+        !(p_keyframe->width > 0.0) || !isfinite(p_keyframe->width)) {
+        return ERROR_INVALID_KEYFRAMES;
+    }
+    return SUCCESS;
+}
+
+int parse_keyframe_file(const char *path, Keyframe **p_p_keyframes, size_t *p_num_keyframes) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    char *line = NULL;
+    size_t capacity = 0;
+    Keyframe *keyframes = NULL;
+    size_t num_keyframes = 0;
+    size_t keyframes_capacity = 0;
+    int status;
+    while ((status = _read_line(file, &line, &capacity)) > 0) {
+        line[strcspn(line, "\r\n")] = 0;
+        char *start = line + strspn(line, KEYFRAME_SEPARATORS);
+        if (*start == STR_TERMINATOR || _is_comment_line(start)) {
+            continue;
+        }
+
+        if (num_keyframes == keyframes_capacity) {
+            keyframes_capacity = keyframes_capacity > 0 ? 2 * keyframes_capacity : 16;
+            Keyframe *p_grown = (Keyframe *)realloc(keyframes, keyframes_capacity * sizeof(Keyframe));
+            if (p_grown == NULL) {
+                status = ERROR_MEMORY_ALLOC;
+                break;
             }
+            keyframes = p_grown;
+        }
+        status = _parse_keyframe(start, &keyframes[num_keyframes]);
+        if (status < 0) break;
+        // The frame numbers must increase strictly, so every frame lies between two keyframes.
+        if (num_keyframes > 0 && keyframes[num_keyframes].frame <= keyframes[num_keyframes - 1].frame) {
+            status = ERROR_INVALID_KEYFRAMES;
+            break;
         }
+        num_keyframes++;
     }
 
+    free(line);
     fclose(file);
+    if (status == SUCCESS && num_keyframes == 0) {
+        status = ERROR_INVALID_KEYFRAMES;
+    }
+    if (status < 0) {
+        free(keyframes);
+        return status;
+    }
+    *p_p_keyframes = keyframes;
+    *p_num_keyframes = num_keyframes;
     return SUCCESS;
 }
 
@@ -209,4 +615,110 @@ int parse_image_width(const char *str, size_t *p_value) {
         return ERROR_INVALID_IMAGE_WIDTH;
     }
     return SUCCESS;
-}
\ No newline at end of file
+}
+
+/**
+ * Parses a number of bytes from a string. The number may be followed by one of the binary units K, M and G.
+ *
+ * @param str The string to parse.
+ * @param p_value The pointer to store the parsed value.
+ * @return Status code. GENERIC_ERROR if the string is not a positive number of bytes.
+ */
+int _parse_byte_size(const char *str, size_t *p_value) {
+    // Split the number from the unit, which is a single character.
+    char number[MAX_LINE_LENGTH];
+    size_t length = strlen(str);
+    if (length == 0 || length >= sizeof(number)) {
+        return GENERIC_ERROR;
+    }
+    strcpy(number, str);
+    size_t unit = 1;
+    switch (toupper((unsigned char)number[length - 1])) {
+        case 'K':
+            unit = (size_t)1 << 10;
+            break;
+        case 'M':
+            unit = (size_t)1 << 20;
+            break;
+        case 'G':
+            unit = (size_t)1 << 30;
+            break;
+    }
+    if (unit > 1) {
+        number[length - 1] = STR_TERMINATOR;
+    }
+
+    int status = _parse_size_t(number, p_value);
+    if (status != SUCCESS || number[0] == STR_TERMINATOR || *p_value == 0 || *p_value > SIZE_MAX / unit) {
+        return GENERIC_ERROR;
+    }
+    *p_value *= unit;
+    return SUCCESS;
+}
+
+int parse_memory_budget(const char *str, size_t *p_value) {
+    return _parse_byte_size(str, p_value) == SUCCESS ? SUCCESS : ERROR_INVALID_MEMORY_BUDGET;
+}
+
+int parse_cache_size(const char *str, size_t *p_value) {
+    return _parse_byte_size(str, p_value) == SUCCESS ? SUCCESS : ERROR_INVALID_CACHE_SIZE;
+}
+
+int parse_thread_count(const char *str, size_t *p_value) {
+    int status = _parse_size_t(str, p_value);
+    if (status != SUCCESS || *p_value == 0) {
+        return ERROR_INVALID_THREAD_COUNT;
+    }
+    return SUCCESS;
+}
+
+int parse_zoom_level(const char *str, size_t *p_value) {
+    int status = _parse_size_t(str, p_value);
+    if (status != SUCCESS || *p_value > PYRAMID_MAX_ZOOM_LEVEL) {
+        return ERROR_INVALID_ZOOM_LEVEL;
+    }
+    return SUCCESS;
+}
+
+int parse_pyramid_format(const char *str, PyramidFormat *p_format) {
+    if (strcmp(str, "xyz") == 0) {
+        *p_format = PYRAMID_FORMAT_XYZ;
+    } else if (strcmp(str, "dzi") == 0) {
+        *p_format = PYRAMID_FORMAT_DZI;
+    } else {
+        return ERROR_INVALID_PYRAMID_FORMAT;
+    }
+    return SUCCESS;
+}
+
+int parse_deadline(const char *str, double *p_value) {
+    int status = _parse_double(str, p_value);
+    if (status != SUCCESS || !isfinite(*p_value) || *p_value <= 0) {
+        return ERROR_INVALID_DEADLINE;
+    }
+    return SUCCESS;
+}
+
+int parse_repetition_count(const char *str, size_t *p_value) {
+    int status = _parse_size_t(str, p_value);
+    if (status != SUCCESS || *p_value == 0) {
+        return ERROR_INVALID_BENCHMARK_OPTION;
+    }
+    return SUCCESS;
+}
+
+int parse_tolerance(const char *str, double *p_value) {
+    char *endptr;
+    double percent = strtod(str, &endptr);
+    if (endptr == str || !isfinite(percent) || percent < 0) {
+        return ERROR_INVALID_BENCHMARK_OPTION;
+    }
+    if (*endptr == '%') {
+        endptr++;
+    }
+    if (*endptr != STR_TERMINATOR) {
+        return ERROR_INVALID_BENCHMARK_OPTION;
+    }
+    *p_value = percent / 100;
+    return SUCCESS;
+}
@@ -0,0 +1,217 @@
+#include "../include/iteration_field.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../include/status_manager.h"
+
+/**
+ * The magic bytes at the start of an iteration field file and the version of the format.
+ */
+#define FIELD_MAGIC "MBFIELD"
+#define FIELD_VERSION 1
+
+/**
+ * Written to the header to detect files that were saved on a machine with another byte order.
+ */
+#define FIELD_BYTE_ORDER_MARK 0x01020304u
+
+/**
+ * The alignment of the arrays in an iteration field file in bytes.
+ */
+#define FIELD_ALIGNMENT 64
+
+/**
+ * The header of an iteration field file. All fields have a fixed size, so the header is 64 bytes without any padding.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    uint64_t width;
+    uint64_t height;
+    uint64_t iteration_depth;
+    uint64_t iterations_offset;
+    uint64_t magnitudes_offset;
+    uint64_t file_size;
+} IterationFieldHeader;
+
+/**
+ * Rounds a file offset up to the next multiple of FIELD_ALIGNMENT.
+ */
+uint64_t _align_offset(uint64_t offset) {
+    return (offset + FIELD_ALIGNMENT - 1) / FIELD_ALIGNMENT * FIELD_ALIGNMENT;
+}
+
+/**
+ * Fills the header of an iteration field file, including the offsets of the arrays and the size of the file.
+ *
+ * @param size The size of the image in pixels.
+ * @param iteration_depth The iteration depth of the field.
+ * @param p_header A pointer to store the header.
+ * @return Status code.
+ */
+int _build_field_header(ImageSize size, size_t iteration_depth, IterationFieldHeader *p_header) {
+    if (size.width == 0 || size.height == 0) return ERROR_IMAGE_SIZE_0;
+    if (size.width > UINT64_MAX / size.height || (uint64_t)size.width * size.height > UINT64_MAX / 16) return ERROR_ARITHMETIC_OVERFLOW;
+    uint64_t num_pixels = (uint64_t)size.width * size.height;
+
+    memset(p_header, 0, sizeof(IterationFieldHeader));
+    memcpy(p_header->magic, FIELD_MAGIC, sizeof(FIELD_MAGIC));
+    p_header->version = FIELD_VERSION;
+    p_header->byte_order_mark = FIELD_BYTE_ORDER_MARK;
+    p_header->width = size.width;
+    p_header->height = size.height;
+    p_header->iteration_depth = iteration_depth;
+    p_header->iterations_offset = _align_offset(sizeof(IterationFieldHeader));
+    p_header->magnitudes_offset = _align_offset(p_header->iterations_offset + num_pixels * sizeof(uint32_t));
+    p_header->file_size = p_header->magnitudes_offset + num_pixels * sizeof(float);
+    return SUCCESS;
+}
+
+int create_iteration_field(ImageSize size, size_t iteration_depth, IterationField *p_field) {
+    memset(p_field, 0, sizeof(IterationField));
+    if (size.width == 0 || size.height == 0) return ERROR_IMAGE_SIZE_0;
+    if (iteration_depth == 0 || iteration_depth > UINT32_MAX) return ERROR_INVALID_ITERATION_DEPTH;
+    if (size.width > SIZE_MAX / size.height || size.width * size.height > SIZE_MAX / sizeof(uint32_t)) return ERROR_ARITHMETIC_OVERFLOW;
+
+    size_t num_pixels = size.width * size.height;
+    p_field->iterations = (uint32_t *)malloc(num_pixels * sizeof(uint32_t));
+    p_field->magnitudes = (float *)malloc(num_pixels * sizeof(float));
+    if (p_field->iterations == NULL || p_field->magnitudes == NULL) {
+        free_iteration_field(p_field);
+        return ERROR_MEMORY_ALLOC;
+    }
+    p_field->size = size;
+    p_field->iteration_depth = iteration_depth;
+    return SUCCESS;
+}
+
+void free_iteration_field(IterationField *p_field) {
+    if (p_field->p_mapping != NULL) {
+#ifdef _WIN32
+        UnmapViewOfFile(p_field->p_mapping);
+#else
+        munmap(p_field->p_mapping, p_field->mapping_size);
+#endif
+    } else {
+        free(p_field->iterations);
+        free(p_field->magnitudes);
+    }
+    memset(p_field, 0, sizeof(IterationField));
+}
+
+int save_iteration_field(const char *path, const IterationField *p_field) {
+    IterationFieldHeader header;
+    int status = _build_field_header(p_field->size, p_field->iteration_depth, &header);
+    if (status < 0) return status;
+
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        return ERROR_FILE_ACCESS;
+    }
+
+    size_t num_pixels = p_field->size.width * p_field->size.height;
+    char padding[FIELD_ALIGNMENT];
+    memset(padding, 0, sizeof(padding));
+    uint64_t iterations_end = header.iterations_offset + num_pixels * sizeof(uint32_t);
+    bool written = fwrite(&header, sizeof(IterationFieldHeader), 1, file) == 1 &&
+                   fwrite(padding, 1, header.iterations_offset - sizeof(IterationFieldHeader), file) == header.iterations_offset - sizeof(IterationFieldHeader) &&
+                   fwrite(p_field->iterations, sizeof(uint32_t), num_pixels, file) == num_pixels &&
+                   fwrite(padding, 1, header.magnitudes_offset - iterations_end, file) == header.magnitudes_offset - iterations_end &&
+                   fwrite(p_field->magnitudes, sizeof(float), num_pixels, file) == num_pixels;
+
+    if (fclose(file) != 0 || !written) {
+        return ERROR_FILE_ACCESS;
+    }
+    return SUCCESS;
+}
+
+/**
+ * Maps a whole file read only into memory.
+ *
+ * @param path The path of the file.
+ * @param p_p_mapping A pointer to store the start of the mapping.
+ * @param p_size A pointer to store the size of the file.
+ * @return Status code.
+ */
+int _map_file(const char *path, void **p_p_mapping, size_t *p_size) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return ERROR_FILE_ACCESS;
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0 || (unsigned long long)file_size.QuadPart > SIZE_MAX) {
+        CloseHandle(file);
+        return ERROR_INVALID_FIELD_FILE;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) return ERROR_FILE_ACCESS;
+    // The view keeps the mapping alive after its handle is closed.
+    *p_p_mapping = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (*p_p_mapping == NULL) return ERROR_FILE_ACCESS;
+    *p_size = (size_t)file_size.QuadPart;
+#else
+    int file = open(path, O_RDONLY);
+    if (file < 0) return ERROR_FILE_ACCESS;
+    struct stat file_stat;
+    if (fstat(file, &file_stat) != 0 || file_stat.st_size == 0 || (unsigned long long)file_stat.st_size > SIZE_MAX) {
+        close(file);
+        return ERROR_INVALID_FIELD_FILE;
+    }
+    // The mapping stays valid after the file is closed.
+    void *p_mapping = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (p_mapping == MAP_FAILED) return ERROR_FILE_ACCESS;
+    *p_p_mapping = p_mapping;
+    *p_size = (size_t)file_stat.st_size;
+#endif
+    return SUCCESS;
+}
+
+int load_iteration_field(const char *path, IterationField *p_field) {
+    memset(p_field, 0, sizeof(IterationField));
+    void *p_mapping;
+    size_t mapping_size;
+    int status = _map_file(path, &p_mapping, &mapping_size);
+    if (status < 0) return status;
+    p_field->p_mapping = p_mapping;
+    p_field->mapping_size = mapping_size;
+
+    // The header is rebuilt from the stored size, so every offset of the file is checked against the expected layout.
+    IterationFieldHeader header;
+    IterationFieldHeader expected_header;
+    status = ERROR_INVALID_FIELD_FILE;
+    if (mapping_size >= sizeof(IterationFieldHeader)) {
+        memcpy(&header, p_mapping, sizeof(IterationFieldHeader));
+        ImageSize size = {(size_t)header.width, (size_t)header.height};
+        if (memcmp(header.magic, FIELD_MAGIC, sizeof(FIELD_MAGIC)) == 0 && header.version == FIELD_VERSION &&
+            header.byte_order_mark == FIELD_BYTE_ORDER_MARK && header.width <= SIZE_MAX && header.height <= SIZE_MAX &&
+            header.iteration_depth > 0 && header.iteration_depth <= UINT32_MAX &&
+            _build_field_header(size, (size_t)header.iteration_depth, &expected_header) == SUCCESS &&
+            memcmp(&header, &expected_header, sizeof(IterationFieldHeader)) == 0 && header.file_size <= mapping_size) {
+            p_field->size = size;
+            p_field->iteration_depth = (size_t)header.iteration_depth;
+            p_field->iterations = (uint32_t *)((char *)p_mapping + header.iterations_offset);
+            p_field->magnitudes = (float *)((char *)p_mapping + header.magnitudes_offset);
+            status = SUCCESS;
+        }
+    }
+
+    if (status < 0) {
+        free_iteration_field(p_field);
+    }
+    return status;
+}
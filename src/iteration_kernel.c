@@ -0,0 +1,755 @@
+#include "../include/iteration_kernel.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#include "../include/status_manager.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define X86_KERNELS
+#include <immintrin.h>
+#endif
+
+/**
+ * The squared escape radius. Comparing the squared magnitude avoids a square root in every iteration.
+ */
+#define ESCAPE_RADIUS_SQUARED ((double)ESCAPE_RADIUS * ESCAPE_RADIUS)
+
+/**
+ * The number of points that are filtered by the analytic interior checks before they are passed to the kernel.
+ */
+#define KERNEL_BATCH_SIZE 256
+
+/**
+ * The periodicity check compares the sequence with the saved term only every PERIODICITY_CHECK_INTERVAL iterations.
+ * This keeps the overhead low for points outside of the set. A cycle is still found, only a few iterations later.
+ * Must be a power of two.
+ */
+#define PERIODICITY_CHECK_INTERVAL 8
+
+/**
+ * The number of bits of the mantissas of the number types, and the number of extra bits that get_precision_for_spacing requires
+ * for the rounding errors of the iteration. The error of a term grows with the iterations, so the guard bits are a compromise.
+ */
+#define FLOAT_MANTISSA_BITS 24
+#define DOUBLE_MANTISSA_BITS 53
+#define DOUBLE_DOUBLE_MANTISSA_BITS 106
+#define PRECISION_GUARD_BITS 12
+
+// A fused multiply-add rounds differently than a multiplication followed by an addition.
+// Contraction is disabled for every kernel, so all kernels compute bit-identical results.
+#if defined(__clang__)
+#define NO_FP_CONTRACT
+#else
+#define NO_FP_CONTRACT __attribute__((optimize("fp-contract=off")))
+#endif
+
+/**
+ * Splits a double into two halves with 26 bits each, so the product of two halves is exact (Dekker).
+ */
+#define SPLIT_FACTOR 134217729.0
+
+/**
+ * The operations of the kernels for every instruction set and number type, so the same kernel code can be generated for all of them.
+ * A set V provides V_SET1, V_LOAD and V_STORE to move numbers between vectors and arrays, the arithmetic V_ADD, V_SUB, V_MUL, V_SQRT and V_ABS,
+ * the comparisons V_GREATER and V_EQUAL, which return a mask, and the mask operations V_AND, V_AND_NOT (the first mask inverted),
+ * V_BLEND (the second vector where the mask is set), V_MASK_ADD (adds where the mask is set), V_ANY and V_FIRST_LANES (the first n lanes).
+ * The double sets additionally provide V_PRODUCT_ERROR, the rounding error of a product, for double-double arithmetic.
+ */
+#define SCALAR_PD_SET1(x) (x)
+#define SCALAR_PD_LOAD(p) (*(p))
+#define SCALAR_PD_STORE(p, v) (*(p) = (v))
+#define SCALAR_PD_ADD(a, b) ((a) + (b))
+#define SCALAR_PD_SUB(a, b) ((a) - (b))
+#define SCALAR_PD_MUL(a, b) ((a) * (b))
+#define SCALAR_PD_SQRT(a) sqrt(a)
+#define SCALAR_PD_ABS(a) fabs(a)
+#define SCALAR_PD_GREATER(a, b) ((a) > (b))
+#define SCALAR_PD_EQUAL(a, b) ((a) == (b))
+#define SCALAR_PD_AND(a, b) ((a) && (b))
+#define SCALAR_PD_AND_NOT(a, b) (!(a) && (b))
+#define SCALAR_PD_BLEND(m, a, b) ((m) ? (b) : (a))
+#define SCALAR_PD_MASK_ADD(m, a, b) ((m) ? (a) + (b) : (a))
+#define SCALAR_PD_ANY(m) (m)
+#define SCALAR_PD_FIRST_LANES(n) ((n) > 0)
+#define SCALAR_PD_PRODUCT_ERROR(a, b, p) DEKKER_PRODUCT_ERROR(SCALAR_PD, a, b, p)
+
+#define SCALAR_PS_SET1(x) (x)
+#define SCALAR_PS_LOAD(p) (*(p))
+#define SCALAR_PS_STORE(p, v) (*(p) = (v))
+#define SCALAR_PS_ADD(a, b) ((a) + (b))
+#define SCALAR_PS_SUB(a, b) ((a) - (b))
+#define SCALAR_PS_MUL(a, b) ((a) * (b))
+#define SCALAR_PS_SQRT(a) sqrtf(a)
+#define SCALAR_PS_ABS(a) fabsf(a)
+#define SCALAR_PS_GREATER(a, b) ((a) > (b))
+#define SCALAR_PS_EQUAL(a, b) ((a) == (b))
+#define SCALAR_PS_AND(a, b) ((a) && (b))
+#define SCALAR_PS_AND_NOT(a, b) (!(a) && (b))
+#define SCALAR_PS_BLEND(m, a, b) ((m) ? (b) : (a))
+#define SCALAR_PS_MASK_ADD(m, a, b) ((m) ? (a) + (b) : (a))
+#define SCALAR_PS_ANY(m) (m)
+#define SCALAR_PS_FIRST_LANES(n) ((n) > 0)
+
+#ifdef X86_KERNELS
+
+#define SSE2_PD_SET1(x) _mm_set1_pd(x)
+#define SSE2_PD_LOAD(p) _mm_loadu_pd(p)
+#define SSE2_PD_STORE(p, v) _mm_storeu_pd(p, v)
+#define SSE2_PD_ADD(a, b) _mm_add_pd(a, b)
+#define SSE2_PD_SUB(a, b) _mm_sub_pd(a, b)
+#define SSE2_PD_MUL(a, b) _mm_mul_pd(a, b)
+#define SSE2_PD_SQRT(a) _mm_sqrt_pd(a)
+#define SSE2_PD_ABS(a) _mm_andnot_pd(_mm_set1_pd(-0.0), a)
+#define SSE2_PD_GREATER(a, b) _mm_cmpgt_pd(a, b)
+#define SSE2_PD_EQUAL(a, b) _mm_cmpeq_pd(a, b)
+#define SSE2_PD_AND(a, b) _mm_and_pd(a, b)
+#define SSE2_PD_AND_NOT(a, b) _mm_andnot_pd(a, b)
+#define SSE2_PD_BLEND(m, a, b) _mm_or_pd(_mm_and_pd(m, b), _mm_andnot_pd(m, a))
+#define SSE2_PD_MASK_ADD(m, a, b) _mm_add_pd(a, _mm_and_pd(m, b))
+#define SSE2_PD_ANY(m) (_mm_movemask_pd(m) != 0)
+#define SSE2_PD_FIRST_LANES(n) _mm_cmplt_pd(_mm_set_pd(1.0, 0.0), _mm_set1_pd((double)(n)))
+#define SSE2_PD_PRODUCT_ERROR(a, b, p) DEKKER_PRODUCT_ERROR(SSE2_PD, a, b, p)
+
+#define SSE2_PS_SET1(x) _mm_set1_ps(x)
+#define SSE2_PS_LOAD(p) _mm_loadu_ps(p)
+#define SSE2_PS_STORE(p, v) _mm_storeu_ps(p, v)
+#define SSE2_PS_ADD(a, b) _mm_add_ps(a, b)
+#define SSE2_PS_SUB(a, b) _mm_sub_ps(a, b)
+#define SSE2_PS_MUL(a, b) _mm_mul_ps(a, b)
+#define SSE2_PS_SQRT(a) _mm_sqrt_ps(a)
+#define SSE2_PS_ABS(a) _mm_andnot_ps(_mm_set1_ps(-0.0f), a)
+#define SSE2_PS_GREATER(a, b) _mm_cmpgt_ps(a, b)
+#define SSE2_PS_EQUAL(a, b) _mm_cmpeq_ps(a, b)
+#define SSE2_PS_AND(a, b) _mm_and_ps(a, b)
+#define SSE2_PS_AND_NOT(a, b) _mm_andnot_ps(a, b)
+#define SSE2_PS_BLEND(m, a, b) _mm_or_ps(_mm_and_ps(m, b), _mm_andnot_ps(m, a))
+#define SSE2_PS_MASK_ADD(m, a, b) _mm_add_ps(a, _mm_and_ps(m, b))
+#define SSE2_PS_ANY(m) (_mm_movemask_ps(m) != 0)
+#define SSE2_PS_FIRST_LANES(n) _mm_cmplt_ps(_mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f), _mm_set1_ps((float)(n)))
+
+#define AVX2_PD_SET1(x) _mm256_set1_pd(x)
+#define AVX2_PD_LOAD(p) _mm256_loadu_pd(p)
+#define AVX2_PD_STORE(p, v) _mm256_storeu_pd(p, v)
+#define AVX2_PD_ADD(a, b) _mm256_add_pd(a, b)
+#define AVX2_PD_SUB(a, b) _mm256_sub_pd(a, b)
+#define AVX2_PD_MUL(a, b) _mm256_mul_pd(a, b)
+#define AVX2_PD_SQRT(a) _mm256_sqrt_pd(a)
+#define AVX2_PD_ABS(a) _mm256_andnot_pd(_mm256_set1_pd(-0.0), a)
+#define AVX2_PD_GREATER(a, b) _mm256_cmp_pd(a, b, _CMP_GT_OQ)
+#define AVX2_PD_EQUAL(a, b) _mm256_cmp_pd(a, b, _CMP_EQ_OQ)
+#define AVX2_PD_AND(a, b) _mm256_and_pd(a, b)
+#define AVX2_PD_AND_NOT(a, b) _mm256_andnot_pd(a, b)
+#define AVX2_PD_BLEND(m, a, b) _mm256_blendv_pd(a, b, m)
+#define AVX2_PD_MASK_ADD(m, a, b) _mm256_add_pd(a, _mm256_and_pd(m, b))
+#define AVX2_PD_ANY(m) (_mm256_movemask_pd(m) != 0)
+#define AVX2_PD_FIRST_LANES(n) _mm256_cmp_pd(_mm256_set_pd(3.0, 2.0, 1.0, 0.0), _mm256_set1_pd((double)(n)), _CMP_LT_OQ)
+// The fused multiply-subtract computes the exact rounding error of the product, which is the same as the one of Dekker's algorithm.
+#define AVX2_PD_PRODUCT_ERROR(a, b, p) _mm256_fmsub_pd(a, b, p)
+
+#define AVX2_PS_SET1(x) _mm256_set1_ps(x)
+#define AVX2_PS_LOAD(p) _mm256_loadu_ps(p)
+#define AVX2_PS_STORE(p, v) _mm256_storeu_ps(p, v)
+#define AVX2_PS_ADD(a, b) _mm256_add_ps(a, b)
+#define AVX2_PS_SUB(a, b) _mm256_sub_ps(a, b)
+#define AVX2_PS_MUL(a, b) _mm256_mul_ps(a, b)
+#define AVX2_PS_SQRT(a) _mm256_sqrt_ps(a)
+#define AVX2_PS_ABS(a) _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a)
+#define AVX2_PS_GREATER(a, b) _mm256_cmp_ps(a, b, _CMP_GT_OQ)
+#define AVX2_PS_EQUAL(a, b) _mm256_cmp_ps(a, b, _CMP_EQ_OQ)
+#define AVX2_PS_AND(a, b) _mm256_and_ps(a, b)
+#define AVX2_PS_AND_NOT(a, b) _mm256_andnot_ps(a, b)
+#define AVX2_PS_BLEND(m, a, b) _mm256_blendv_ps(a, b, m)
+#define AVX2_PS_MASK_ADD(m, a, b) _mm256_add_ps(a, _mm256_and_ps(m, b))
+#define AVX2_PS_ANY(m) (_mm256_movemask_ps(m) != 0)
+#define AVX2_PS_FIRST_LANES(n) \
+    _mm256_cmp_ps(_mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f), _mm256_set1_ps((float)(n)), _CMP_LT_OQ)
+
+#define AVX512_PD_SET1(x) _mm512_set1_pd(x)
+#define AVX512_PD_LOAD(p) _mm512_loadu_pd(p)
+#define AVX512_PD_STORE(p, v) _mm512_storeu_pd(p, v)
+#define AVX512_PD_ADD(a, b) _mm512_add_pd(a, b)
+#define AVX512_PD_SUB(a, b) _mm512_sub_pd(a, b)
+#define AVX512_PD_MUL(a, b) _mm512_mul_pd(a, b)
+#define AVX512_PD_SQRT(a) _mm512_sqrt_pd(a)
+#define AVX512_PD_ABS(a) _mm512_abs_pd(a)
+#define AVX512_PD_GREATER(a, b) _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ)
+#define AVX512_PD_EQUAL(a, b) _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ)
+#define AVX512_PD_AND(a, b) ((__mmask8)((a) & (b)))
+#define AVX512_PD_AND_NOT(a, b) ((__mmask8)(~(a) & (b)))
+#define AVX512_PD_BLEND(m, a, b) _mm512_mask_blend_pd(m, a, b)
+#define AVX512_PD_MASK_ADD(m, a, b) _mm512_mask_add_pd(a, m, a, b)
+#define AVX512_PD_ANY(m) ((m) != 0)
+#define AVX512_PD_FIRST_LANES(n) ((__mmask8)((1u << (n)) - 1))
+#define AVX512_PD_PRODUCT_ERROR(a, b, p) _mm512_fmsub_pd(a, b, p)
+
+#define AVX512_PS_SET1(x) _mm512_set1_ps(x)
+#define AVX512_PS_LOAD(p) _mm512_loadu_ps(p)
+#define AVX512_PS_STORE(p, v) _mm512_storeu_ps(p, v)
+#define AVX512_PS_ADD(a, b) _mm512_add_ps(a, b)
+#define AVX512_PS_SUB(a, b) _mm512_sub_ps(a, b)
+#define AVX512_PS_MUL(a, b) _mm512_mul_ps(a, b)
+#define AVX512_PS_SQRT(a) _mm512_sqrt_ps(a)
+#define AVX512_PS_ABS(a) _mm512_abs_ps(a)
+#define AVX512_PS_GREATER(a, b) _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ)
+#define AVX512_PS_EQUAL(a, b) _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ)
+#define AVX512_PS_AND(a, b) ((__mmask16)((a) & (b)))
+#define AVX512_PS_AND_NOT(a, b) ((__mmask16)(~(a) & (b)))
+#define AVX512_PS_BLEND(m, a, b) _mm512_mask_blend_ps(m, a, b)
+#define AVX512_PS_MASK_ADD(m, a, b) _mm512_mask_add_ps(a, m, a, b)
+#define AVX512_PS_ANY(m) ((m) != 0)
+#define AVX512_PS_FIRST_LANES(n) ((__mmask16)((1u << (n)) - 1))
+
+#endif  // X86_KERNELS
+
+/**
+ * The high and the low half of a double, split with SPLIT_FACTOR.
+ */
+#define DEKKER_HIGH_HALF(V, a) V##_SUB(V##_MUL(V##_SET1(SPLIT_FACTOR), a), V##_SUB(V##_MUL(V##_SET1(SPLIT_FACTOR), a), a))
+#define DEKKER_LOW_HALF(V, a) V##_SUB(a, DEKKER_HIGH_HALF(V, a))
+
+/**
+ * The exact rounding error of the product p = a * b without a fused multiply-add (Dekker).
+ * The repeated halves are computed only once by the compiler.
+ */
+#define DEKKER_PRODUCT_ERROR(V, a, b, p)                                                                                                  \
+    V##_ADD(V##_ADD(V##_ADD(V##_SUB(V##_MUL(DEKKER_HIGH_HALF(V, a), DEKKER_HIGH_HALF(V, b)), p), V##_MUL(DEKKER_HIGH_HALF(V, a), DEKKER_LOW_HALF(V, b))), \
+                    V##_MUL(DEKKER_LOW_HALF(V, a), DEKKER_HIGH_HALF(V, b))),                                                              \
+            V##_MUL(DEKKER_LOW_HALF(V, a), DEKKER_LOW_HALF(V, b)))
+
+/**
+ * The double-double operations of the kernels, in the same way as in double_double.c, but on vectors of the double set V.
+ * Every number is a pair of a high and a low vector. The results may be stored in the same variables as the operands.
+ */
+#define DD_QUICK_TWO_SUM(VEC, V, a, b, s, e) \
+    do {                                     \
+        VEC dd_sum_ = V##_ADD(a, b);         \
+        e = V##_SUB(b, V##_SUB(dd_sum_, a)); \
+        s = dd_sum_;                         \
+    } while (0)
+
+#define DD_TWO_SUM(VEC, V, a, b, s, e)                                                         \
+    do {                                                                                       \
+        VEC dd_sum_ = V##_ADD(a, b);                                                           \
+        VEC dd_virtual_ = V##_SUB(dd_sum_, a);                                                 \
+        e = V##_ADD(V##_SUB(a, V##_SUB(dd_sum_, dd_virtual_)), V##_SUB(b, dd_virtual_));       \
+        s = dd_sum_;                                                                           \
+    } while (0)
+
+#define DD_ADD(VEC, V, a_hi, a_lo, b_hi, b_lo, r_hi, r_lo)             \
+    do {                                                               \
+        VEC dd_high_sum_, dd_high_error_, dd_low_sum_, dd_low_error_;  \
+        DD_TWO_SUM(VEC, V, a_hi, b_hi, dd_high_sum_, dd_high_error_);  \
+        DD_TWO_SUM(VEC, V, a_lo, b_lo, dd_low_sum_, dd_low_error_);    \
+        dd_high_error_ = V##_ADD(dd_high_error_, dd_low_sum_);         \
+        DD_QUICK_TWO_SUM(VEC, V, dd_high_sum_, dd_high_error_, dd_high_sum_, dd_high_error_); \
+        dd_high_error_ = V##_ADD(dd_high_error_, dd_low_error_);       \
+        DD_QUICK_TWO_SUM(VEC, V, dd_high_sum_, dd_high_error_, r_hi, r_lo); \
+    } while (0)
+
+#define DD_MUL(VEC, V, a_hi, a_lo, b_hi, b_lo, r_hi, r_lo)                                                     \
+    do {                                                                                                       \
+        VEC dd_product_ = V##_MUL(a_hi, b_hi);                                                                 \
+        VEC dd_error_ = V##_PRODUCT_ERROR(a_hi, b_hi, dd_product_);                                            \
+        dd_error_ = V##_ADD(dd_error_, V##_ADD(V##_MUL(a_hi, b_lo), V##_MUL(a_lo, b_hi)));                      \
+        DD_QUICK_TWO_SUM(VEC, V, dd_product_, dd_error_, r_hi, r_lo);                                          \
+    } while (0)
+
+/**
+ * The formulas of the kernels. FORMULA_START is the first term z_0 of the sequence of a point, FORMULA_ADDEND the constant c
+ * that is added in every step, and FORMULA_FOLD is applied to the real and the imaginary part of a term before it is raised to the power.
+ */
+#define MANDELBROT_START(point, zero) (zero)
+#define MANDELBROT_ADDEND(V, TYPE, point, julia) (point)
+#define MANDELBROT_FOLD(V, a) (a)
+
+#define JULIA_START(point, zero) (point)
+#define JULIA_ADDEND(V, TYPE, point, julia) V##_SET1((TYPE)(julia))
+#define JULIA_FOLD(V, a) (a)
+
+#define BURNING_SHIP_START(point, zero) (zero)
+#define BURNING_SHIP_ADDEND(V, TYPE, point, julia) (point)
+#define BURNING_SHIP_FOLD(V, a) V##_ABS(a)
+
+/**
+ * The product and the square of complex numbers on vectors of the set V. The results may be stored in the same variables as the operands.
+ * The square needs one multiplication less than the product.
+ */
+#define COMPLEX_SQUARE(VEC, V, a_real, a_imag, r_real, r_imag)                        \
+    do {                                                                              \
+        VEC square_real_imag_ = V##_MUL(a_real, a_imag);                              \
+        VEC square_real_ = V##_SUB(V##_MUL(a_real, a_real), V##_MUL(a_imag, a_imag)); \
+        r_imag = V##_ADD(square_real_imag_, square_real_imag_);                       \
+        r_real = square_real_;                                                        \
+    } while (0)
+
+#define COMPLEX_MULTIPLY(VEC, V, a_real, a_imag, b_real, b_imag, r_real, r_imag)       \
+    do {                                                                               \
+        VEC product_real_ = V##_SUB(V##_MUL(a_real, b_real), V##_MUL(a_imag, b_imag)); \
+        VEC product_imag_ = V##_ADD(V##_MUL(a_real, b_imag), V##_MUL(a_imag, b_real)); \
+        r_real = product_real_;                                                        \
+        r_imag = product_imag_;                                                        \
+    } while (0)
+
+/**
+ * Raises a complex number to a small integer power with as few squares and products as possible (addition chains),
+ * so no kernel calls pow or converts to polar form.
+ */
+#define POWER_2(VEC, V, a_real, a_imag, r_real, r_imag) COMPLEX_SQUARE(VEC, V, a_real, a_imag, r_real, r_imag)
+#define POWER_3(VEC, V, a_real, a_imag, r_real, r_imag)                           \
+    do {                                                                          \
+        COMPLEX_SQUARE(VEC, V, a_real, a_imag, r_real, r_imag);                   \
+        COMPLEX_MULTIPLY(VEC, V, r_real, r_imag, a_real, a_imag, r_real, r_imag); \
+    } while (0)
+#define POWER_4(VEC, V, a_real, a_imag, r_real, r_imag)         \
+    do {                                                        \
+        COMPLEX_SQUARE(VEC, V, a_real, a_imag, r_real, r_imag); \
+        COMPLEX_SQUARE(VEC, V, r_real, r_imag, r_real, r_imag); \
+    } while (0)
+#define POWER_5(VEC, V, a_real, a_imag, r_real, r_imag)                           \
+    do {                                                                          \
+        POWER_4(VEC, V, a_real, a_imag, r_real, r_imag);                          \
+        COMPLEX_MULTIPLY(VEC, V, r_real, r_imag, a_real, a_imag, r_real, r_imag); \
+    } while (0)
+#define POWER_6(VEC, V, a_real, a_imag, r_real, r_imag)         \
+    do {                                                        \
+        POWER_3(VEC, V, a_real, a_imag, r_real, r_imag);        \
+        COMPLEX_SQUARE(VEC, V, r_real, r_imag, r_real, r_imag); \
+    } while (0)
+#define POWER_7(VEC, V, a_real, a_imag, r_real, r_imag)                           \
+    do {                                                                          \
+        POWER_6(VEC, V, a_real, a_imag, r_real, r_imag);                          \
+        COMPLEX_MULTIPLY(VEC, V, r_real, r_imag, a_real, a_imag, r_real, r_imag); \
+    } while (0)
+#define POWER_8(VEC, V, a_real, a_imag, r_real, r_imag)         \
+    do {                                                        \
+        POWER_4(VEC, V, a_real, a_imag, r_real, r_imag);        \
+        COMPLEX_SQUARE(VEC, V, r_real, r_imag, r_real, r_imag); \
+    } while (0)
+
+/**
+ * Generates a kernel that iterates WIDTH points of the number type TYPE at a time with the operations of the set V,
+ * for the formula FORMULA (MANDELBROT, JULIA or BURNING_SHIP) raised to the power POWER. Both are fixed at compile time,
+ * so every combination gets its own loop without branches.
+ * Points that escaped are masked out until every point of the vector has escaped or the iteration depth is reached,
+ * and lanes beyond the end of the batch are inactive from the start.
+ * The periodicity check follows Brent: the term after 2^k iterations is saved and compared with the following terms,
+ * until the term after 2^(k+1) iterations replaces it. Once 2^k is large enough, every cycle of the sequence is found.
+ * The points are rounded to TYPE, and the iterations are counted in TYPE, which is exact up to FLOAT_MAX_ITERATION_DEPTH for floats.
+ * The kernels of each number type compute bit-identical results, because they perform the same operations in the same order.
+ * Only the Julia kernels read julia_c.
+ * See IterationKernel for a description of the parameters.
+ */
+#define DEFINE_ITERATION_KERNEL(NAME, TARGET, TYPE, WIDTH, VEC, MASK, V, FORMULA, POWER)                                                            \
+    TARGET NO_FP_CONTRACT void NAME(const double *c_real, const double *c_imag, size_t count, size_t iteration_depth, bool periodicity_check,       \
+                                    Complex julia_c, size_t *p_iterations, double *p_magnitudes) {                                                  \
+        (void)julia_c;                                                                                                                              \
+        const VEC zero = V##_SET1((TYPE)0);                                                                                                         \
+        const VEC one = V##_SET1((TYPE)1);                                                                                                          \
+        const VEC depth = V##_SET1((TYPE)iteration_depth);                                                                                          \
+        const VEC escape_radius_squared = V##_SET1((TYPE)ESCAPE_RADIUS_SQUARED);                                                                    \
+                                                                                                                                                    \
+        for (size_t i = 0; i < count; i += WIDTH) {                                                                                                 \
+            size_t num_lanes = count - i < WIDTH ? count - i : WIDTH;                                                                               \
+            TYPE buffer_real[WIDTH] = {0};                                                                                                          \
+            TYPE buffer_imag[WIDTH] = {0};                                                                                                          \
+            for (size_t lane = 0; lane < num_lanes; lane++) {                                                                                       \
+                buffer_real[lane] = (TYPE)c_real[i + lane];                                                                                         \
+                buffer_imag[lane] = (TYPE)c_imag[i + lane];                                                                                         \
+            }                                                                                                                                       \
+                                                                                                                                                    \
+            VEC point_real = V##_LOAD(buffer_real);                                                                                                 \
+            VEC point_imag = V##_LOAD(buffer_imag);                                                                                                 \
+            VEC addend_real = FORMULA##_ADDEND(V, TYPE, point_real, julia_c.real);                                                                  \
+            VEC addend_imag = FORMULA##_ADDEND(V, TYPE, point_imag, julia_c.imag);                                                                  \
+            VEC z_real = FORMULA##_START(point_real, zero);                                                                                         \
+            VEC z_imag = FORMULA##_START(point_imag, zero);                                                                                         \
+            VEC iterations = zero;                                                                                                                  \
+            VEC saved_real = z_real;                                                                                                                \
+            VEC saved_imag = z_imag;                                                                                                                \
+            size_t next_save = PERIODICITY_CHECK_INTERVAL;                                                                                          \
+            MASK active = V##_FIRST_LANES(num_lanes);                                                                                               \
+                                                                                                                                                    \
+            for (size_t n = 0; n < iteration_depth && V##_ANY(active); n++) {                                                                       \
+                VEC base_real = FORMULA##_FOLD(V, z_real);                                                                                          \
+                VEC base_imag = FORMULA##_FOLD(V, z_imag);                                                                                          \
+                VEC next_real, next_imag;                                                                                                           \
+                POWER_##POWER(VEC, V, base_real, base_imag, next_real, next_imag);                                                                  \
+                next_real = V##_ADD(next_real, addend_real);                                                                                        \
+                next_imag = V##_ADD(next_imag, addend_imag);                                                                                        \
+                VEC magnitude_squared = V##_ADD(V##_MUL(next_real, next_real), V##_MUL(next_imag, next_imag));                                      \
+                MASK bounded = V##_AND_NOT(V##_GREATER(magnitude_squared, escape_radius_squared), active);                                          \
+                                                                                                                                                    \
+                iterations = V##_MASK_ADD(bounded, iterations, one);                                                                                \
+                z_real = V##_BLEND(active, z_real, next_real);                                                                                      \
+                z_imag = V##_BLEND(active, z_imag, next_imag);                                                                                      \
+                active = bounded;                                                                                                                   \
+                                                                                                                                                    \
+                if (periodicity_check && (n + 1) % PERIODICITY_CHECK_INTERVAL == 0) {                                                               \
+                    MASK periodic = V##_AND(active, V##_AND(V##_EQUAL(z_real, saved_real), V##_EQUAL(z_imag, saved_imag)));                         \
+                    iterations = V##_BLEND(periodic, iterations, depth);                                                                            \
+                    active = V##_AND_NOT(periodic, active);                                                                                         \
+                    if (n + 1 == next_save) {                                                                                                       \
+                        saved_real = z_real;                                                                                                        \
+                        saved_imag = z_imag;                                                                                                        \
+                        next_save *= 2;                                                                                                             \
+                    }                                                                                                                               \
+                }                                                                                                                                   \
+            }                                                                                                                                       \
+                                                                                                                                                    \
+            TYPE buffer_iterations[WIDTH];                                                                                                          \
+            TYPE buffer_magnitudes[WIDTH];                                                                                                          \
+            V##_STORE(buffer_iterations, iterations);                                                                                               \
+            V##_STORE(buffer_magnitudes, V##_SQRT(V##_ADD(V##_MUL(z_real, z_real), V##_MUL(z_imag, z_imag))));                                      \
+            for (size_t lane = 0; lane < num_lanes; lane++) {                                                                                       \
+                p_iterations[i + lane] = (size_t)buffer_iterations[lane];                                                                           \
+                p_magnitudes[i + lane] = (double)buffer_magnitudes[lane];                                                                           \
+            }                                                                                                                                       \
+        }                                                                                                                                           \
+    }
+
+/**
+ * Generates a kernel that iterates WIDTH points at a time in double-double precision with the operations of the double set V.
+ * It works like the kernels of DEFINE_ITERATION_KERNEL. Only the high parts are needed to decide whether a point escaped,
+ * but the periodicity check compares both parts, so it only stops at exact cycles. See DoubleDoubleKernel for a description of the parameters.
+ */
+#define DEFINE_DOUBLE_DOUBLE_KERNEL(NAME, TARGET, WIDTH, VEC, MASK, V)                                                                              \
+    TARGET NO_FP_CONTRACT void NAME(const DoubleDouble *c_real, const DoubleDouble *c_imag, size_t count, size_t iteration_depth,                   \
+                                    bool periodicity_check, size_t *p_iterations, double *p_magnitudes) {                                           \
+        const VEC zero = V##_SET1(0.0);                                                                                                             \
+        const VEC one = V##_SET1(1.0);                                                                                                              \
+        const VEC depth = V##_SET1((double)iteration_depth);                                                                                        \
+        const VEC escape_radius_squared = V##_SET1(ESCAPE_RADIUS_SQUARED);                                                                          \
+                                                                                                                                                    \
+        for (size_t i = 0; i < count; i += WIDTH) {                                                                                                 \
+            size_t num_lanes = count - i < WIDTH ? count - i : WIDTH;                                                                               \
+            double buffer_real_hi[WIDTH] = {0};                                                                                                     \
+            double buffer_real_lo[WIDTH] = {0};                                                                                                     \
+            double buffer_imag_hi[WIDTH] = {0};                                                                                                     \
+            double buffer_imag_lo[WIDTH] = {0};                                                                                                     \
+            for (size_t lane = 0; lane < num_lanes; lane++) {                                                                                       \
+                buffer_real_hi[lane] = c_real[i + lane].hi;                                                                                         \
+                buffer_real_lo[lane] = c_real[i + lane].lo;                                                                                         \
+                buffer_imag_hi[lane] = c_imag[i + lane].hi;                                                                                         \
+                buffer_imag_lo[lane] = c_imag[i + lane].lo;                                                                                         \
+            }                                                                                                                                       \
+                                                                                                                                                    \
+            VEC point_real_hi = V##_LOAD(buffer_real_hi);                                                                                           \
+            VEC point_real_lo = V##_LOAD(buffer_real_lo);                                                                                           \
+            VEC point_imag_hi = V##_LOAD(buffer_imag_hi);                                                                                           \
+            VEC point_imag_lo = V##_LOAD(buffer_imag_lo);                                                                                           \
+            VEC z_real_hi = zero;                                                                                                                   \
+            VEC z_real_lo = zero;                                                                                                                   \
+            VEC z_imag_hi = zero;                                                                                                                   \
+            VEC z_imag_lo = zero;                                                                                                                   \
+            VEC iterations = zero;                                                                                                                  \
+            VEC saved_real_hi = zero;                                                                                                               \
+            VEC saved_real_lo = zero;                                                                                                               \
+            VEC saved_imag_hi = zero;                                                                                                               \
+            VEC saved_imag_lo = zero;                                                                                                               \
+            size_t next_save = PERIODICITY_CHECK_INTERVAL;                                                                                          \
+            MASK active = V##_FIRST_LANES(num_lanes);                                                                                               \
+                                                                                                                                                    \
+            for (size_t n = 0; n < iteration_depth && V##_ANY(active); n++) {                                                                       \
+                VEC real_squared_hi, real_squared_lo, imag_squared_hi, imag_squared_lo, real_imag_hi, real_imag_lo;                                 \
+                VEC next_real_hi, next_real_lo, next_imag_hi, next_imag_lo;                                                                         \
+                DD_MUL(VEC, V, z_real_hi, z_real_lo, z_real_hi, z_real_lo, real_squared_hi, real_squared_lo);                                       \
+                DD_MUL(VEC, V, z_imag_hi, z_imag_lo, z_imag_hi, z_imag_lo, imag_squared_hi, imag_squared_lo);                                       \
+                DD_MUL(VEC, V, z_real_hi, z_real_lo, z_imag_hi, z_imag_lo, real_imag_hi, real_imag_lo);                                             \
+                /* Negating and doubling are exact, so they are applied to both parts. */                                                           \
+                imag_squared_hi = V##_SUB(zero, imag_squared_hi);                                                                                   \
+                imag_squared_lo = V##_SUB(zero, imag_squared_lo);                                                                                   \
+                real_imag_hi = V##_ADD(real_imag_hi, real_imag_hi);                                                                                 \
+                real_imag_lo = V##_ADD(real_imag_lo, real_imag_lo);                                                                                 \
+                DD_ADD(VEC, V, real_squared_hi, real_squared_lo, imag_squared_hi, imag_squared_lo, next_real_hi, next_real_lo);                     \
+                DD_ADD(VEC, V, next_real_hi, next_real_lo, point_real_hi, point_real_lo, next_real_hi, next_real_lo);                               \
+                DD_ADD(VEC, V, real_imag_hi, real_imag_lo, point_imag_hi, point_imag_lo, next_imag_hi, next_imag_lo);                               \
+                VEC magnitude_squared = V##_ADD(V##_MUL(next_real_hi, next_real_hi), V##_MUL(next_imag_hi, next_imag_hi));                          \
+                MASK bounded = V##_AND_NOT(V##_GREATER(magnitude_squared, escape_radius_squared), active);                                          \
+                                                                                                                                                    \
+                iterations = V##_MASK_ADD(bounded, iterations, one);                                                                                \
+                z_real_hi = V##_BLEND(active, z_real_hi, next_real_hi);                                                                             \
+                z_real_lo = V##_BLEND(active, z_real_lo, next_real_lo);                                                                             \
+                z_imag_hi = V##_BLEND(active, z_imag_hi, next_imag_hi);                                                                             \
+                z_imag_lo = V##_BLEND(active, z_imag_lo, next_imag_lo);                                                                             \
+                active = bounded;                                                                                                                   \
+                                                                                                                                                    \
+                if (periodicity_check && (n + 1) % PERIODICITY_CHECK_INTERVAL == 0) {                                                               \
+                    MASK periodic = V##_AND(active, V##_AND(V##_AND(V##_EQUAL(z_real_hi, saved_real_hi), V##_EQUAL(z_real_lo, saved_real_lo)),      \
+                                                            V##_AND(V##_EQUAL(z_imag_hi, saved_imag_hi), V##_EQUAL(z_imag_lo, saved_imag_lo))));    \
+                    iterations = V##_BLEND(periodic, iterations, depth);                                                                            \
+                    active = V##_AND_NOT(periodic, active);                                                                                         \
+                    if (n + 1 == next_save) {                                                                                                       \
+                        saved_real_hi = z_real_hi;                                                                                                  \
+                        saved_real_lo = z_real_lo;                                                                                                  \
+                        saved_imag_hi = z_imag_hi;                                                                                                  \
+                        saved_imag_lo = z_imag_lo;                                                                                                  \
+                        next_save *= 2;                                                                                                             \
+                    }                                                                                                                               \
+                }                                                                                                                                   \
+            }                                                                                                                                       \
+                                                                                                                                                    \
+            double buffer_iterations[WIDTH];                                                                                                        \
+            double buffer_magnitudes[WIDTH];                                                                                                        \
+            V##_STORE(buffer_iterations, iterations);                                                                                               \
+            V##_STORE(buffer_magnitudes, V##_SQRT(V##_ADD(V##_MUL(z_real_hi, z_real_hi), V##_MUL(z_imag_hi, z_imag_hi))));                          \
+            for (size_t lane = 0; lane < num_lanes; lane++) {                                                                                       \
+                p_iterations[i + lane] = (size_t)buffer_iterations[lane];                                                                           \
+                p_magnitudes[i + lane] = buffer_magnitudes[lane];                                                                                   \
+            }                                                                                                                                       \
+        }                                                                                                                                           \
+    }
+
+/**
+ * The kernels of a number type and an instruction set for every formula and power, indexed by the Formula and the power.
+ * The entries of the powers 0 and 1 are empty.
+ */
+typedef IterationKernel FormulaKernels[NUM_FORMULAS][MAX_FORMULA_POWER + 1];
+
+/**
+ * Generates the kernels of a formula for every power from 2 to MAX_FORMULA_POWER, named NAME_2 to NAME_8.
+ */
+#define DEFINE_POWER_KERNELS(NAME, TARGET, TYPE, WIDTH, VEC, MASK, V, FORMULA)       \
+    DEFINE_ITERATION_KERNEL(NAME##_2, TARGET, TYPE, WIDTH, VEC, MASK, V, FORMULA, 2) \
+    DEFINE_ITERATION_KERNEL(NAME##_3, TARGET, TYPE, WIDTH, VEC, MASK, V, FORMULA, 3) \
+    DEFINE_ITERATION_KERNEL(NAME##_4, TARGET, TYPE, WIDTH, VEC, MASK, V, FORMULA, 4) \
+    DEFINE_ITERATION_KERNEL(NAME##_5, TARGET, TYPE, WIDTH, VEC, MASK, V, FORMULA, 5) \
+    DEFINE_ITERATION_KERNEL(NAME##_6, TARGET, TYPE, WIDTH, VEC, MASK, V, FORMULA, 6) \
+    DEFINE_ITERATION_KERNEL(NAME##_7, TARGET, TYPE, WIDTH, VEC, MASK, V, FORMULA, 7) \
+    DEFINE_ITERATION_KERNEL(NAME##_8, TARGET, TYPE, WIDTH, VEC, MASK, V, FORMULA, 8)
+
+#define POWER_KERNELS(NAME) {[2] = NAME##_2, [3] = NAME##_3, [4] = NAME##_4, [5] = NAME##_5, [6] = NAME##_6, [7] = NAME##_7, [8] = NAME##_8}
+
+/**
+ * Generates the kernels of every formula and power and the FormulaKernels table NAME that holds them.
+ */
+#define DEFINE_FORMULA_KERNELS(NAME, TARGET, TYPE, WIDTH, VEC, MASK, V)                        \
+    DEFINE_POWER_KERNELS(NAME##_mandelbrot, TARGET, TYPE, WIDTH, VEC, MASK, V, MANDELBROT)     \
+    DEFINE_POWER_KERNELS(NAME##_julia, TARGET, TYPE, WIDTH, VEC, MASK, V, JULIA)               \
+    DEFINE_POWER_KERNELS(NAME##_burning_ship, TARGET, TYPE, WIDTH, VEC, MASK, V, BURNING_SHIP) \
+    static const FormulaKernels NAME = {                                                       \
+        [FORMULA_MANDELBROT] = POWER_KERNELS(NAME##_mandelbrot),                               \
+        [FORMULA_JULIA] = POWER_KERNELS(NAME##_julia),                                         \
+        [FORMULA_BURNING_SHIP] = POWER_KERNELS(NAME##_burning_ship),                           \
+    };
+
+// The portable kernels. Iterate one point at a time.
+DEFINE_FORMULA_KERNELS(_iterate_points_scalar_float, , float, 1, float, bool, SCALAR_PS)
+DEFINE_FORMULA_KERNELS(_iterate_points_scalar_double, , double, 1, double, bool, SCALAR_PD)
+DEFINE_DOUBLE_DOUBLE_KERNEL(_iterate_points_scalar_double_double, , 1, double, bool, SCALAR_PD)
+
+#ifdef X86_KERNELS
+
+// The SSE2 kernels. Iterate 4 floats or 2 doubles at a time.
+DEFINE_FORMULA_KERNELS(_iterate_points_sse2_float, __attribute__((target("sse2"))), float, 4, __m128, __m128, SSE2_PS)
+DEFINE_FORMULA_KERNELS(_iterate_points_sse2_double, __attribute__((target("sse2"))), double, 2, __m128d, __m128d, SSE2_PD)
+DEFINE_DOUBLE_DOUBLE_KERNEL(_iterate_points_sse2_double_double, __attribute__((target("sse2"))), 2, __m128d, __m128d, SSE2_PD)
+
+// The AVX2 kernels. Iterate 8 floats or 4 doubles at a time. The double-double kernel also needs fused multiply-adds.
+DEFINE_FORMULA_KERNELS(_iterate_points_avx2_float, __attribute__((target("avx2"))), float, 8, __m256, __m256, AVX2_PS)
+DEFINE_FORMULA_KERNELS(_iterate_points_avx2_double, __attribute__((target("avx2"))), double, 4, __m256d, __m256d, AVX2_PD)
+DEFINE_DOUBLE_DOUBLE_KERNEL(_iterate_points_avx2_double_double, __attribute__((target("avx2,fma"))), 4, __m256d, __m256d, AVX2_PD)
+
+// The AVX-512 kernels. Iterate 16 floats or 8 doubles at a time.
+DEFINE_FORMULA_KERNELS(_iterate_points_avx512_float, __attribute__((target("avx512f"))), float, 16, __m512, __mmask16, AVX512_PS)
+DEFINE_FORMULA_KERNELS(_iterate_points_avx512_double, __attribute__((target("avx512f"))), double, 8, __m512d, __mmask8, AVX512_PD)
+DEFINE_DOUBLE_DOUBLE_KERNEL(_iterate_points_avx512_double_double, __attribute__((target("avx512f"))), 8, __m512d, __mmask8, AVX512_PD)
+
+#endif  // X86_KERNELS
+
+/**
+ * The selected kernels of every number type and their name.
+ */
+static const FormulaKernels *s_float_kernels = &_iterate_points_scalar_float;
+static const FormulaKernels *s_double_kernels = &_iterate_points_scalar_double;
+static DoubleDoubleKernel s_double_double_kernel = _iterate_points_scalar_double_double;
+static const char *s_kernel_name = "scalar";
+
+void select_iteration_kernel(void) {
+#ifdef X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        s_float_kernels = &_iterate_points_avx512_float;
+        s_double_kernels = &_iterate_points_avx512_double;
+        s_double_double_kernel = _iterate_points_avx512_double_double;
+        s_kernel_name = "avx512";
+    } else if (__builtin_cpu_supports("avx2")) {
+        s_float_kernels = &_iterate_points_avx2_float;
+        s_double_kernels = &_iterate_points_avx2_double;
+        s_double_double_kernel = __builtin_cpu_supports("fma") ? _iterate_points_avx2_double_double : _iterate_points_sse2_double_double;
+        s_kernel_name = "avx2";
+    } else if (__builtin_cpu_supports("sse2")) {
+        s_float_kernels = &_iterate_points_sse2_float;
+        s_double_kernels = &_iterate_points_sse2_double;
+        s_double_double_kernel = _iterate_points_sse2_double_double;
+        s_kernel_name = "sse2";
+    }
+#endif
+}
+
+const char *get_iteration_kernel_name(void) {
+    return s_kernel_name;
+}
+
+/**
+ * Checks analytically whether a point lies inside of the main cardioid of the Mandelbrot set.
+ * With q = (x - 1/4)^2 + y^2, the point x + yi lies inside of the cardioid if q * (q + (x - 1/4)) <= y^2 / 4.
+ *
+ * @param real The real part of the point.
+ * @param imag The imaginary part of the point.
+ * @return True if the point lies inside of the main cardioid.
+ */
+bool _is_in_main_cardioid(double real, double imag) {
+    double shifted_real = real - 0.25;
+    double q = shifted_real * shifted_real + imag * imag;
+    return q * (q + shifted_real) <= 0.25 * imag * imag;
+}
+
+/**
+ * Checks analytically whether a point lies inside of the period-2 bulb, the disk with radius 1/4 around -1.
+ *
+ * @param real The real part of the point.
+ * @param imag The imaginary part of the point.
+ * @return True if the point lies inside of the period-2 bulb.
+ */
+bool _is_in_period_2_bulb(double real, double imag) {
+    double shifted_real = real + 1.0;
+    return shifted_real * shifted_real + imag * imag <= 0.0625;
+}
+
+Precision get_precision_for_spacing(double magnitude, double pixel_spacing, size_t iteration_depth, bool perturbation) {
+    // The number of bits of the mantissa that are needed to tell neighboring pixels apart, and some more for the rounding errors of the iteration.
+    if (magnitude < ESCAPE_RADIUS) {
+        magnitude = ESCAPE_RADIUS;
+    }
+    double num_bits = (magnitude > pixel_spacing ? log2(magnitude / pixel_spacing) : 0.0) + PRECISION_GUARD_BITS;
+    if (num_bits <= FLOAT_MANTISSA_BITS && iteration_depth <= FLOAT_MAX_ITERATION_DEPTH) return PRECISION_FLOAT;
+    if (num_bits <= DOUBLE_MANTISSA_BITS) return PRECISION_DOUBLE;
+    if (num_bits <= DOUBLE_DOUBLE_MANTISSA_BITS || !perturbation) return PRECISION_DOUBLE_DOUBLE;
+    return PRECISION_PERTURBATION;
+}
+
+bool is_quadratic_mandelbrot(const Configuration *p_config) {
+    return p_config->formula == FORMULA_MANDELBROT && p_config->power == 2;
+}
+
+int select_precision(const Configuration *p_config, size_t width, Precision *p_precision) {
+    if (width == 0) return ERROR_IMAGE_SIZE_0;
+    // The other formulas only have kernels for floats and doubles.
+    bool quadratic_mandelbrot = is_quadratic_mandelbrot(p_config);
+    if (!quadratic_mandelbrot && (p_config->precision == PRECISION_DOUBLE_DOUBLE || p_config->precision == PRECISION_PERTURBATION)) {
+        return ERROR_INCOMPATIBLE_OPTIONS;
+    }
+    if (p_config->precision == PRECISION_FLOAT && p_config->iteration_depth > FLOAT_MAX_ITERATION_DEPTH) return ERROR_INCOMPATIBLE_OPTIONS;
+    if (p_config->precision == PRECISION_PERTURBATION && !p_config->deep_zoom) return ERROR_INCOMPATIBLE_OPTIONS;
+
+    // In deep zoom mode, the viewport is relative to the center.
+    Viewport viewport = p_config->viewport;
+    double center_real = p_config->deep_zoom ? fixed_point_to_double(&p_config->center_real) : 0.0;
+    double center_imag = p_config->deep_zoom ? fixed_point_to_double(&p_config->center_imag) : 0.0;
+    double magnitude = fmax(fmax(fabs(center_real + viewport.lower_left.real), fabs(center_real + viewport.upper_right.real)),
+                            fmax(fabs(center_imag + viewport.lower_left.imag), fabs(center_imag + viewport.upper_right.imag)));
+    double pixel_spacing = fabs(viewport.upper_right.real - viewport.lower_left.real) / (double)width;
+    if (!(pixel_spacing > 0)) {
+        // An empty viewport has no pixel spacing, so it keeps the number type it had before precisions could be chosen.
+        if (p_config->precision != PRECISION_AUTO) {
+            *p_precision = p_config->precision;
+        } else {
+            *p_precision = p_config->deep_zoom ? PRECISION_PERTURBATION : PRECISION_DOUBLE;
+        }
+        return SUCCESS;
+    }
+    Precision required_precision = get_precision_for_spacing(magnitude, pixel_spacing, p_config->iteration_depth, p_config->deep_zoom);
+    if (p_config->precision != PRECISION_AUTO) {
+        // A number type that can not tell neighboring pixels apart renders blocks or a solid image, so it is rejected.
+        if (p_config->precision < required_precision) return ERROR_ZOOM_TOO_DEEP;
+        *p_precision = p_config->precision;
+        return SUCCESS;
+    }
+    // The other formulas can not be zoomed in deeper than doubles resolve.
+    if (!quadratic_mandelbrot && required_precision > PRECISION_DOUBLE) return ERROR_ZOOM_TOO_DEEP;
+    *p_precision = required_precision;
+    return SUCCESS;
+}
+
+const char *get_precision_name(Precision precision) {
+    switch (precision) {
+        case PRECISION_AUTO:
+            return "auto";
+        case PRECISION_FLOAT:
+            return "float";
+        case PRECISION_DOUBLE:
+            return "double";
+        case PRECISION_DOUBLE_DOUBLE:
+            return "double_double";
+        case PRECISION_PERTURBATION:
+            return "perturbation";
+    }
+    return "unknown";
+}
+
+const char *get_formula_name(Formula formula) {
+    switch (formula) {
+        case FORMULA_MANDELBROT:
+            return "mandelbrot";
+        case FORMULA_JULIA:
+            return "julia";
+        case FORMULA_BURNING_SHIP:
+            return "burning_ship";
+        case NUM_FORMULAS:
+            break;
+    }
+    return "unknown";
+}
+
+void iterate_points(const double *c_real, const double *c_imag, size_t count, const Configuration *p_config, Precision precision, size_t *p_iterations,
+                    double *p_magnitudes) {
+    const FormulaKernels *p_kernels = precision == PRECISION_FLOAT ? s_float_kernels : s_double_kernels;
+    IterationKernel kernel = (*p_kernels)[p_config->formula][p_config->power];
+    size_t iteration_depth = p_config->iteration_depth;
+    Complex julia_c = p_config->julia_c;
+    bool periodicity_check = (p_config->interior_checks & INTERIOR_CHECK_PERIODICITY) != 0;
+    // The cardioid and the bulb are only known for the Mandelbrot set with power 2.
+    bool cardioid_check = (p_config->interior_checks & INTERIOR_CHECK_CARDIOID) != 0 && is_quadratic_mandelbrot(p_config);
+    bool bulb_check = (p_config->interior_checks & INTERIOR_CHECK_BULB) != 0 && is_quadratic_mandelbrot(p_config);
+    if (!cardioid_check && !bulb_check) {
+        kernel(c_real, c_imag, count, iteration_depth, periodicity_check, julia_c, p_iterations, p_magnitudes);
+        return;
+    }
+
+    // The points that are not detected by the analytic checks are packed densely, so no vector lane is wasted on them.
+    double packed_real[KERNEL_BATCH_SIZE];
+    double packed_imag[KERNEL_BATCH_SIZE];
+    size_t packed_indices[KERNEL_BATCH_SIZE];
+    size_t packed_iterations[KERNEL_BATCH_SIZE];
+    double packed_magnitudes[KERNEL_BATCH_SIZE];
+
+    for (size_t start = 0; start < count; start += KERNEL_BATCH_SIZE) {
+        size_t end = start + KERNEL_BATCH_SIZE < count ? start + KERNEL_BATCH_SIZE : count;
+        size_t num_packed = 0;
+        for (size_t i = start; i < end; i++) {
+            if ((cardioid_check && _is_in_main_cardioid(c_real[i], c_imag[i])) || (bulb_check && _is_in_period_2_bulb(c_real[i], c_imag[i]))) {
+                // The sequence of an interior point is not computed, so its final magnitude is unknown.
+                p_iterations[i] = iteration_depth;
+                p_magnitudes[i] = 0.0;
+            } else {
+                packed_real[num_packed] = c_real[i];
+                packed_imag[num_packed] = c_imag[i];
+                packed_indices[num_packed] = i;
+                num_packed++;
+            }
+        }
+
+        kernel(packed_real, packed_imag, num_packed, iteration_depth, periodicity_check, julia_c, packed_iterations, packed_magnitudes);
+        for (size_t i = 0; i < num_packed; i++) {
+            p_iterations[packed_indices[i]] = packed_iterations[i];
+            p_magnitudes[packed_indices[i]] = packed_magnitudes[i];
+        }
+    }
+}
+
+void iterate_double_double_points(const DoubleDouble *c_real, const DoubleDouble *c_imag, size_t count, const Configuration *p_config, size_t *p_iterations,
+                                  double *p_magnitudes) {
+    s_double_double_kernel(c_real, c_imag, count, p_config->iteration_depth, (p_config->interior_checks & INTERIOR_CHECK_PERIODICITY) != 0, p_iterations,
+                           p_magnitudes);
+}
@@ -0,0 +1,314 @@
+#include "../include/log_polar.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/image_manager.h"
+#include "../include/iteration_field.h"
+#include "../include/raw_stream.h"
+#include "../include/shading.h"
+#include "../include/status_manager.h"
+
+/**
+ * The number of characters that a frame path may have in addition to the output prefix.
+ */
+#define FRAME_PATH_SUFFIX_LENGTH 32
+
+/**
+ * The part of the overall progress that is covered by the computation of the map. The rest is covered by the frames.
+ */
+#define MAP_PROGRESS 0.8
+
+/**
+ * The state shared by the tasks that resample the frames from the shaded map. Every task resamples and saves one frame.
+ */
+typedef struct {
+    // The shaded map and its exponential map.
+    const ImageData *p_map_image;
+    LogPolarMap map;
+    // The column of the map and the logarithm of the distance to the center in pixels, divided by the step of the map, of every pixel of a frame.
+    // All frames have the same center, so they only differ by the row offset that follows from their pixel spacing.
+    float *columns;
+    float *log_distances;
+    const Keyframe *keyframes;
+    size_t num_keyframes;
+    size_t first_frame;
+    ImageSize size;
+    const char *output_prefix;
+    void (*progress_callback)(double);
+} FrameResampler;
+
+/**
+ * A batch of consecutive frames that are resampled in parallel and then written to a frame stream in order.
+ */
+typedef struct {
+    const FrameResampler *p_resampler;
+    ImageData **frames;
+    // The index of the first frame of the batch, counted from the first keyframe.
+    size_t first_index;
+} FrameBatch;
+
+/**
+ * Calculates the exponential map that covers all frames of a zoom and the size of its field.
+ *
+ * @param keyframes The keyframes.
+ * @param num_keyframes The number of keyframes.
+ * @param size The size of every frame in pixels.
+ * @param p_map A pointer to store the exponential map.
+ * @param p_map_size A pointer to store the size of the field of the map.
+ * @return Status code.
+ */
+int _create_zoom_map(const Keyframe *keyframes, size_t num_keyframes, ImageSize size, LogPolarMap *p_map, ImageSize *p_map_size) {
+    if (size.width == 0 || size.height == 0) return ERROR_IMAGE_SIZE_0;
+    double aspect_ratio = (double)size.height / (double)size.width;
+    double min_width = keyframes[0].width;
+    double max_width = keyframes[0].width;
+    for (size_t k = 1; k < num_keyframes; k++) {
+        if (keyframes[k].center_real != keyframes[0].center_real || keyframes[k].center_imag != keyframes[0].center_imag) return ERROR_MOVING_CENTER;
+        // The width changes monotonically between two keyframes, so the keyframes bound the widths of all frames.
+        min_width = fmin(min_width, keyframes[k].width);
+        max_width = fmax(max_width, keyframes[k].width);
+    }
+
+    // The distance between two columns at the corners of the widest frame is the distance between two of its pixels.
+    double diagonal_factor = sqrt(1.0 + aspect_ratio * aspect_ratio);
+    double max_radius = max_width / 2 * diagonal_factor;
+    double min_radius = min_width / (double)size.width / 2;
+    p_map_size->width = (size_t)ceil(M_PI * (double)size.width * diagonal_factor);
+    p_map->step = 2 * M_PI / (double)p_map_size->width;
+    p_map_size->height = (size_t)ceil((log(max_radius) - log(min_radius)) / p_map->step) + 1;
+    p_map->center.real = keyframes[0].center_real;
+    p_map->center.imag = keyframes[0].center_imag;
+    p_map->log_max_radius = log(max_radius);
+    return SUCCESS;
+}
+
+/**
+ * Calculates the column of the map and the logarithm of the distance to the center of every pixel of a frame, see FrameResampler.
+ * The pixels are mapped like by a direct render of the viewport, so pixel (x, y) lies at the offset (x - width / 2, height / 2 - y) from the center.
+ *
+ * @param p_resampler A pointer to the FrameResampler. Its map and its size must be set.
+ * @param map_width The width of the field of the map.
+ * @return Status code.
+ */
+int _create_sample_table(FrameResampler *p_resampler, size_t map_width) {
+    ImageSize size = p_resampler->size;
+    p_resampler->columns = (float *)malloc(size.width * size.height * sizeof(float));
+    p_resampler->log_distances = (float *)malloc(size.width * size.height * sizeof(float));
+    if (p_resampler->columns == NULL || p_resampler->log_distances == NULL) return ERROR_MEMORY_ALLOC;
+
+    for (size_t y = 0; y < size.height; y++) {
+        double offset_imag = (double)size.height / 2 - (double)y;
+        for (size_t x = 0; x < size.width; x++) {
+            double offset_real = (double)x - (double)size.width / 2;
+            double column = atan2(offset_imag, offset_real) / p_resampler->map.step;
+            if (column < 0) column += (double)map_width;
+            // The center itself gets a distance of -infinity and therefore the last row.
+            p_resampler->columns[y * size.width + x] = (float)column;
+            p_resampler->log_distances[y * size.width + x] = (float)(log(hypot(offset_real, offset_imag)) / p_resampler->map.step);
+        }
+    }
+    return SUCCESS;
+}
+
+/**
+ * Resamples a single frame from the shaded map with bilinear interpolation. The columns of the map wrap around,
+ * and points closer to the center than the last row get the colors of the last row.
+ *
+ * @param p_resampler A pointer to the FrameResampler.
+ * @param frame The frame number.
+ * @param p_image_data A pointer to the image data of the frame.
+ */
+void _resample_frame(const FrameResampler *p_resampler, size_t frame, ImageData *p_image_data) {
+    const ImageData *p_map_image = p_resampler->p_map_image;
+    ImageSize map_size = p_map_image->size;
+    ImageSize size = p_resampler->size;
+    Viewport viewport = get_keyframe_viewport(p_resampler->keyframes, p_resampler->num_keyframes, frame, (double)size.height / (double)size.width);
+    double spacing = (viewport.upper_right.real - viewport.lower_left.real) / (double)size.width;
+    // The row of a pixel at a distance of one pixel from the center.
+    double row_offset = (p_resampler->map.log_max_radius - log(spacing)) / p_resampler->map.step;
+
+    for (size_t y = 0; y < size.height; y++) {
+        unsigned char *p_row = get_row_in_image_data(p_image_data, y);
+        for (size_t x = 0; x < size.width; x++) {
+            double column = p_resampler->columns[y * size.width + x];
+            double row = row_offset - p_resampler->log_distances[y * size.width + x];
+            row = fmin(fmax(row, 0.0), (double)(map_size.height - 1));
+
+            size_t x0 = (size_t)column % map_size.width;
+            size_t x1 = (x0 + 1) % map_size.width;
+            size_t y0 = (size_t)row;
+            size_t y1 = y0 + 1 < map_size.height ? y0 + 1 : y0;
+            double fx = column - floor(column);
+            double fy = row - (double)y0;
+            const unsigned char *p_top = get_row_in_image_data(p_map_image, y0);
+            const unsigned char *p_bottom = get_row_in_image_data(p_map_image, y1);
+            for (size_t channel = 0; channel < 3; channel++) {
+                double upper = p_top[3 * x0 + channel] + (p_top[3 * x1 + channel] - p_top[3 * x0 + channel]) * fx;
+                double lower = p_bottom[3 * x0 + channel] + (p_bottom[3 * x1 + channel] - p_bottom[3 * x0 + channel]) * fx;
+                p_row[3 * x + channel] = (unsigned char)lround(upper + (lower - upper) * fy);
+            }
+        }
+    }
+}
+
+/**
+ * Resamples and saves a single frame.
+ *
+ * @param task_index The index of the frame, counted from the first keyframe.
+ * @param worker_index The index of the worker thread. Unused.
+ * @param p_context A pointer to the FrameResampler.
+ * @return Status code.
+ */
+int _save_resampled_frame(size_t task_index, size_t worker_index, void *p_context) {
+    (void)worker_index;
+    const FrameResampler *p_resampler = (const FrameResampler *)p_context;
+    size_t frame = p_resampler->first_frame + task_index;
+    size_t length = strlen(p_resampler->output_prefix) + FRAME_PATH_SUFFIX_LENGTH;
+    char *path = (char *)malloc(length);
+    if (path == NULL) return ERROR_MEMORY_ALLOC;
+
+    ImageData *p_image_data;
+    int status = create_image_data_with_size(p_resampler->size, &p_image_data);
+    if (status == SUCCESS) {
+        _resample_frame(p_resampler, frame, p_image_data);
+        snprintf(path, length, "%s_%05zu.bmp", p_resampler->output_prefix, frame);
+        status = export_and_free(p_image_data, path);
+    }
+    free(path);
+    return status;
+}
+
+/**
+ * Converts the number of saved frames to the overall progress and outputs it.
+ *
+ * @param num_completed The number of saved frames.
+ * @param num_tasks The number of frames.
+ * @param p_context A pointer to the FrameResampler.
+ */
+void _process_frame_progress(size_t num_completed, size_t num_tasks, void *p_context) {
+    const FrameResampler *p_resampler = (const FrameResampler *)p_context;
+    if (p_resampler->progress_callback != NULL) {
+        p_resampler->progress_callback(MAP_PROGRESS + (1.0 - MAP_PROGRESS) * (double)num_completed / (double)num_tasks);
+    }
+}
+
+/**
+ * Resamples a frame of a batch into its image data.
+ *
+ * @param task_index The index of the frame within the batch.
+ * @param worker_index The index of the worker thread. Unused.
+ * @param p_context A pointer to the FrameBatch.
+ * @return Status code.
+ */
+int _resample_batch_frame(size_t task_index, size_t worker_index, void *p_context) {
+    (void)worker_index;
+    const FrameBatch *p_batch = (const FrameBatch *)p_context;
+    _resample_frame(p_batch->p_resampler, p_batch->p_resampler->first_frame + p_batch->first_index + task_index, p_batch->frames[task_index]);
+    return SUCCESS;
+}
+
+/**
+ * Resamples all frames in batches of one frame per thread and writes every batch to a YUV4MPEG2 stream in order.
+ *
+ * @param p_resampler A pointer to the FrameResampler.
+ * @param p_thread_pool The thread pool or NULL.
+ * @param num_frames The number of frames.
+ * @param frame_stream The stream to write the frames to.
+ * @return Status code.
+ */
+int _stream_resampled_frames(const FrameResampler *p_resampler, ThreadPool *p_thread_pool, size_t num_frames, FILE *frame_stream) {
+    size_t batch_size = p_thread_pool != NULL ? get_thread_pool_size(p_thread_pool) : 1;
+    if (batch_size > num_frames) {
+        batch_size = num_frames;
+    }
+    ImageData **frames = (ImageData **)calloc(batch_size, sizeof(ImageData *));
+    if (frames == NULL) return ERROR_MEMORY_ALLOC;
+    int status = write_y4m_header(frame_stream, p_resampler->size);
+    for (size_t i = 0; i < batch_size && status == SUCCESS; i++) {
+        status = create_image_data_with_size(p_resampler->size, &frames[i]);
+    }
+
+    FrameBatch batch = {p_resampler, frames, 0};
+    for (; batch.first_index < num_frames && status == SUCCESS; batch.first_index += batch_size) {
+        size_t num_batch_frames = num_frames - batch.first_index < batch_size ? num_frames - batch.first_index : batch_size;
+        if (p_thread_pool != NULL) {
+            status = run_thread_pool(p_thread_pool, num_batch_frames, _resample_batch_frame, &batch, NULL);
+        } else {
+            for (size_t i = 0; i < num_batch_frames; i++) {
+                _resample_batch_frame(i, 0, &batch);
+            }
+        }
+        for (size_t i = 0; i < num_batch_frames && status == SUCCESS; i++) {
+            status = write_y4m_frame(frame_stream, frames[i]);
+        }
+        _process_frame_progress(batch.first_index + num_batch_frames, num_frames, (void *)p_resampler);
+    }
+
+    for (size_t i = 0; i < batch_size; i++) {
+        if (frames[i] != NULL) {
+            free_image_data(frames[i]);
+        }
+    }
+    free(frames);
+    return status;
+}
+
+int render_log_polar_zoom(Configuration config, ThreadPool *p_thread_pool, const Keyframe *keyframes, size_t num_keyframes, ImageSize size,
+                          const char *output_prefix, FILE *frame_stream, void (*progress_callback)(double), RenderStatistics *p_statistics) {
+    if (num_keyframes == 0) return GENERIC_ERROR;
+    if (config.deep_zoom) return ERROR_INCOMPATIBLE_OPTIONS;
+
+    FrameResampler resampler;
+    memset(&resampler, 0, sizeof(FrameResampler));
+    ImageSize map_size;
+    int status = _create_zoom_map(keyframes, num_keyframes, size, &resampler.map, &map_size);
+    if (status != SUCCESS) return status;
+
+    // Compute and shade the map. The field is freed before the frames are resampled, because they only need the colors.
+    IterationField field;
+    status = create_iteration_field(map_size, config.iteration_depth, &field);
+    if (status != SUCCESS) return status;
+    ImageData *p_map_image = NULL;
+    status = compute_log_polar_field(config, p_thread_pool, resampler.map, &field, progress_callback, 0.0, MAP_PROGRESS, p_statistics);
+    if (status == SUCCESS) {
+        status = create_image_data_with_size(map_size, &p_map_image);
+    }
+    if (status == SUCCESS) {
+        status = shade_iteration_field(&field, &config, p_thread_pool, p_map_image);
+    }
+    free_iteration_field(&field);
+
+    resampler.size = size;
+    if (status == SUCCESS) {
+        status = _create_sample_table(&resampler, map_size.width);
+    }
+
+    if (status == SUCCESS) {
+        resampler.p_map_image = p_map_image;
+        resampler.keyframes = keyframes;
+        resampler.num_keyframes = num_keyframes;
+        resampler.first_frame = keyframes[0].frame;
+        resampler.output_prefix = output_prefix;
+        resampler.progress_callback = progress_callback;
+        size_t num_frames = keyframes[num_keyframes - 1].frame - keyframes[0].frame + 1;
+        if (frame_stream != NULL) {
+            status = _stream_resampled_frames(&resampler, p_thread_pool, num_frames, frame_stream);
+        } else if (p_thread_pool != NULL) {
+            status = run_thread_pool(p_thread_pool, num_frames, _save_resampled_frame, &resampler, _process_frame_progress);
+        } else {
+            for (size_t i = 0; i < num_frames && status == SUCCESS; i++) {
+                status = _save_resampled_frame(i, 0, &resampler);
+                _process_frame_progress(i + 1, num_frames, &resampler);
+            }
+        }
+    }
+    free(resampler.columns);
+    free(resampler.log_distances);
+    if (p_map_image != NULL) {
+        free_image_data(p_map_image);
+    }
+    return status;
+}
@@ -2,32 +2,94 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 
+#include "..\include\animation.h"
+#include "..\include\benchmark.h"
+#include "..\include\connection.h"
+#include "..\include\distributed_renderer.h"
 #include "..\include\image_manager.h"
+#include "..\include\image_writer.h"
 #include "..\include\input_parser.h"
+#include "..\include\iteration_field.h"
+#include "..\include\iteration_kernel.h"
+#include "..\include\log_polar.h"
+#include "..\include\metrics.h"
 #include "..\include\printer.h"
+#include "..\include\raw_stream.h"
+#include "..\include\pyramid.h"
+#include "..\include\render_daemon.h"
 #include "..\include\renderer.h"
+#include "..\include\shading.h"
 #include "..\include\status_manager.h"
+#include "..\include\stream_renderer.h"
+#include "..\include\thread_pool.h"
+#include "..\include\tile_cache.h"
 
-#define ARG_POS_CONFIG_PATH 1
-#define ARG_POS_WIDTH 2
-#define ARG_POS_OUTPUT_PATH 3
-#define EXPECTED_ARG_COUNT 4
+// Positions of the arguments that remain after all options have been removed from the command line.
+#define ARG_POS_CONFIG_PATH 0
+#define ARG_POS_WIDTH 1
+#define ARG_POS_OUTPUT_PATH 2
+#define EXPECTED_ARG_COUNT 3
 #define EXTENSION ".bmp"
+#define OPTION_THREADS "--threads"
+#define OPTION_SAVE_FIELD "--save-field"
+#define OPTION_MEMORY_BUDGET "--memory-budget"
+#define OPTION_MMAP "--mmap"
+#define OPTION_CACHE "--cache"
+#define OPTION_CACHE_SIZE "--cache-size"
+// Renders the image in passes from coarse to fine and saves it after every pass, see render_progressive.
+#define OPTION_PROGRESSIVE "--progressive"
+#define OPTION_DEADLINE "--deadline"
+// Saves the metrics of the render as a JSON file, see save_render_metrics.
+#define OPTION_STATS "--stats"
+// Saves the image as a BMP file with 8 bits per pixel, optionally compressed with RLE8, see save_indexed_bmp.
+#define OPTION_INDEXED "--indexed"
+#define OPTION_RLE "--rle"
+// Computes the iteration field on worker processes, see render_distributed. It is followed by their addresses, separated by commas.
+#define OPTION_WORKERS "--workers"
 
-// This is a macro to measure the time of a function call.
-// It returns the return value of the function call. The time is stored in the variable TIME_PTR.
-#define CPUTIME(FCALL, TIME_PTR)                                  \
-    ({                                                            \
-        double START = clock();                                   \
-        int return_value = FCALL;                                 \
-        *(TIME_PTR) = ((double)clock() - START) / CLOCKS_PER_SEC; \
-        return_value;                                             \
-    })
+// The command that shades a saved iteration field again. It is followed by the field path and pairs of config and output paths.
+#define COMMAND_RESHADE "reshade"
+#define RESHADE_ARG_POS_FIELD_PATH 2
+#define RESHADE_ARG_POS_FIRST_PALETTE 3
+
+// The command that renders a pyramid of tiles. It is followed by the config path, the largest zoom level and the output path.
+#define COMMAND_PYRAMID "pyramid"
+#define PYRAMID_ARG_POS_CONFIG_PATH 0
+#define PYRAMID_ARG_POS_ZOOM_LEVEL 1
+#define PYRAMID_ARG_POS_OUTPUT_PATH 2
+#define PYRAMID_EXPECTED_ARG_COUNT 3
+#define OPTION_FORMAT "--format"
+
+// The command that renders an animation. It is followed by the config path, the keyframe path, the image width and the output prefix.
+#define COMMAND_ANIMATE "animate"
+#define ANIMATE_ARG_POS_CONFIG_PATH 0
+#define ANIMATE_ARG_POS_KEYFRAME_PATH 1
+#define ANIMATE_ARG_POS_WIDTH 2
+#define ANIMATE_ARG_POS_OUTPUT_PREFIX 3
+#define ANIMATE_EXPECTED_ARG_COUNT 4
+// Renders a zoom into a fixed point from a single exponential map, see render_log_polar_zoom.
+#define OPTION_LOG_POLAR "--log-polar"
+
+// The command that serves render jobs until it is shut down. It is followed by the path of the socket.
+#define COMMAND_DAEMON "daemon"
+
+// The command that computes bands of distributed renders until it is stopped. It is followed by the TCP port to listen on.
+#define COMMAND_WORKER "worker"
+
+// The command that renders the scenes of the benchmark. It is followed by the path of the JSON file for the results.
+#define COMMAND_BENCH "bench"
+#define OPTION_REPEAT "--repeat"
+#define OPTION_BASELINE "--baseline"
+#define OPTION_TOLERANCE "--tolerance"
+#define BENCH_DEFAULT_REPETITIONS 5
+#define BENCH_DEFAULT_TOLERANCE 0.1
 
 /**
- * Generates a valid path by appending the specified extension if it is not already present.
+ * Generates a valid path by appending the specified extension if the path does not already end with the extension of an image format.
+ * The path of the standard output is kept as it is.
  *
  * @param incomplete_path The incomplete path to append the extension to, if necessary.
  * @param extension The extension to append.
@@ -36,8 +98,9 @@
 int generate_valid_path(char *incomplete_path, const char *extension, char **result) {
     size_t incomplete_path_length = strlen(incomplete_path);
     size_t extension_length = strlen(extension);
+    ImageFormat format;
 
-    if (strlen(incomplete_path) < extension_length || strcmp(incomplete_path + incomplete_path_length - extension_length, extension) != 0) {
+    if (!get_image_format(incomplete_path, &format) && !is_stdout_path(incomplete_path)) {
         *result = malloc(incomplete_path_length + extension_length + 1);
         if (*result == NULL) {
             return ERROR_MEMORY_ALLOC;
@@ -55,77 +118,966 @@ int generate_valid_path(char *incomplete_path, const char *extension, char **res
     return SUCCESS;
 }
 
+/**
+ * The arguments given on the command line.
+ */
+typedef struct {
+    char *config_path;
+    char *str_width;
+    char *incomplete_output_path;
+    size_t num_threads;
+    // The path to save the iteration field to, or NULL.
+    char *field_path;
+    // The memory budget of a streaming render in bytes, or 0 to render the whole image in memory.
+    size_t memory_budget;
+    // Whether the pixels are written directly to the memory mapped output file.
+    bool mmap_output;
+    // The directory of the tile cache, or NULL, and the size limit of the cache in bytes.
+    char *cache_path;
+    size_t cache_size;
+    // Whether the image is rendered progressively, and the time budget of the render in seconds, or 0.
+    bool progressive;
+    double deadline;
+    // The path to save the metrics of the render to, or NULL.
+    char *stats_path;
+    // Whether the image is saved with indexed colors, and whether the pixel array is compressed with RLE8.
+    bool indexed;
+    bool rle;
+    // The stream the image is written to as a PPM image if the output path is the standard output, or NULL. Opened by main.
+    FILE *output_stream;
+    // The addresses of the workers to compute the iteration field on, separated by commas, or NULL to compute it locally.
+    char *workers;
+} Arguments;
+
+/**
+ * Parses the command line arguments. Options may appear anywhere on the command line,
+ * all other arguments are assigned to the config path, the image width and the output path in this order.
+ * If the number of threads is not given, one thread per processor is used.
+ * A streaming render has no iteration field of the whole image, so it can not be combined with saving the field.
+ * A deadline implies a progressive render, which is done in memory and without the tile cache.
+ * Only BMP files can be mapped, and a memory budget requires a BMP or TIFF file, whose bands can be written while the image is built.
+ * RLE8 compression implies indexed colors, which are only rendered in memory and saved as BMP files.
+ * The standard output gets the finished image in a single pass from the top to the bottom, so it requires a render in memory.
+ * Workers compute the iteration field of the whole image, so they only replace a plain render in memory.
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @param p_arguments A pointer to store the parsed arguments.
+ * @return Status code.
+ */
+int parse_arguments(int argc, char **argv, Arguments *p_arguments) {
+    char *positional_args[EXPECTED_ARG_COUNT];
+    int num_positional_args = 0;
+    p_arguments->num_threads = get_num_processors();
+    p_arguments->field_path = NULL;
+    p_arguments->memory_budget = 0;
+    p_arguments->mmap_output = false;
+    p_arguments->cache_path = NULL;
+    p_arguments->cache_size = TILE_CACHE_DEFAULT_MAX_SIZE;
+    p_arguments->progressive = false;
+    p_arguments->deadline = 0;
+    p_arguments->stats_path = NULL;
+    p_arguments->indexed = false;
+    p_arguments->rle = false;
+    p_arguments->output_stream = NULL;
+    p_arguments->workers = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], OPTION_THREADS) == 0) {
+            if (i + 1 >= argc) {
+                return ERROR_INVALID_NUM_CL_ARG;
+            }
+            int status = parse_thread_count(argv[++i], &p_arguments->num_threads);
+            if (status != SUCCESS) {
+                return status;
+            }
+        } else if (strcmp(argv[i], OPTION_SAVE_FIELD) == 0) {
+            if (i + 1 >= argc) {
+                return ERROR_INVALID_NUM_CL_ARG;
+            }
+            p_arguments->field_path = argv[++i];
+        } else if (strcmp(argv[i], OPTION_MMAP) == 0) {
+            p_arguments->mmap_output = true;
+        } else if (strcmp(argv[i], OPTION_MEMORY_BUDGET) == 0) {
+            if (i + 1 >= argc) {
+                return ERROR_INVALID_NUM_CL_ARG;
+            }
+            int status = parse_memory_budget(argv[++i], &p_arguments->memory_budget);
+            if (status != SUCCESS) {
+                return status;
+            }
+        } else if (strcmp(argv[i], OPTION_CACHE) == 0) {
+            if (i + 1 >= argc) {
+                return ERROR_INVALID_NUM_CL_ARG;
+            }
+            p_arguments->cache_path = argv[++i];
+        } else if (strcmp(argv[i], OPTION_CACHE_SIZE) == 0) {
+            if (i + 1 >= argc) {
+                return ERROR_INVALID_NUM_CL_ARG;
+            }
+            int status = parse_cache_size(argv[++i], &p_arguments->cache_size);
+            if (status != SUCCESS) {
+                return status;
+            }
+        } else if (strcmp(argv[i], OPTION_PROGRESSIVE) == 0) {
+            p_arguments->progressive = true;
+        } else if (strcmp(argv[i], OPTION_DEADLINE) == 0) {
+            if (i + 1 >= argc) {
+                return ERROR_INVALID_NUM_CL_ARG;
+            }
+            int status = parse_deadline(argv[++i], &p_arguments->deadline);
+            if (status != SUCCESS) {
+                return status;
+            }
+            p_arguments->progressive = true;
+        } else if (strcmp(argv[i], OPTION_STATS) == 0) {
+            if (i + 1 >= argc) {
+                return ERROR_INVALID_NUM_CL_ARG;
+            }
+            p_arguments->stats_path = argv[++i];
+        } else if (strcmp(argv[i], OPTION_INDEXED) == 0) {
+            p_arguments->indexed = true;
+        } else if (strcmp(argv[i], OPTION_RLE) == 0) {
+            p_arguments->indexed = true;
+            p_arguments->rle = true;
+        } else if (strcmp(argv[i], OPTION_WORKERS) == 0) {
+            if (i + 1 >= argc) {
+                return ERROR_INVALID_NUM_CL_ARG;
+            }
+            p_arguments->workers = argv[++i];
+        } else {
+            if (num_positional_args >= EXPECTED_ARG_COUNT) {
+                return ERROR_INVALID_NUM_CL_ARG;
+            }
+            positional_args[num_positional_args++] = argv[i];
+        }
+    }
+
+    if (num_positional_args != EXPECTED_ARG_COUNT) {
+        return ERROR_INVALID_NUM_CL_ARG;
+    }
+    if (p_arguments->memory_budget > 0 && p_arguments->field_path != NULL) {
+        return ERROR_INCOMPATIBLE_OPTIONS;
+    }
+    if (p_arguments->progressive && (p_arguments->memory_budget > 0 || p_arguments->mmap_output || p_arguments->cache_path != NULL)) {
+        return ERROR_INCOMPATIBLE_OPTIONS;
+    }
+    if (p_arguments->indexed && (p_arguments->progressive || p_arguments->memory_budget > 0 || p_arguments->mmap_output)) {
+        return ERROR_INCOMPATIBLE_OPTIONS;
+    }
+    if (p_arguments->workers != NULL &&
+        (p_arguments->memory_budget > 0 || p_arguments->progressive || p_arguments->cache_path != NULL || p_arguments->indexed)) {
+        return ERROR_INCOMPATIBLE_OPTIONS;
+    }
+    p_arguments->config_path = positional_args[ARG_POS_CONFIG_PATH];
+    p_arguments->str_width = positional_args[ARG_POS_WIDTH];
+    p_arguments->incomplete_output_path = positional_args[ARG_POS_OUTPUT_PATH];
+    if (is_stdout_path(p_arguments->incomplete_output_path) &&
+        (p_arguments->memory_budget > 0 || p_arguments->mmap_output || p_arguments->indexed || p_arguments->progressive)) {
+        return ERROR_INCOMPATIBLE_OPTIONS;
+    }
+    // Only BMP files can be mapped or indexed. Streaming renders also write tiled TIFF files.
+    ImageFormat format = IMAGE_FORMAT_BMP;
+    get_image_format(p_arguments->incomplete_output_path, &format);
+    if ((p_arguments->mmap_output || p_arguments->indexed) && format != IMAGE_FORMAT_BMP) {
+        return ERROR_INCOMPATIBLE_OPTIONS;
+    }
+    if (p_arguments->memory_budget > 0 && format != IMAGE_FORMAT_BMP && format != IMAGE_FORMAT_TIFF) {
+        return ERROR_INCOMPATIBLE_OPTIONS;
+    }
+    return SUCCESS;
+}
+
+/**
+ * Shades a saved iteration field with one or more palettes. Every palette is read from a configuration file,
+ * only its inner color, outer colors and smooth coloring are used, and with smooth coloring the power of the formula.
+ * The field does not store whether it was shaded smoothly, so a configuration with a different smooth coloring gives a different image
+ * than the render that saved the field. Nothing is iterated, so every palette takes only as long as shading and saving the image.
+ * Command line: reshade <field_file> <config_file> <output_file> [<config_file> <output_file> ...]
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return Status code.
+ */
+int reshade(int argc, char **argv) {
+    if (argc < RESHADE_ARG_POS_FIRST_PALETTE + 2 || (argc - RESHADE_ARG_POS_FIRST_PALETTE) % 2 != 0) {
+        return ERROR_INVALID_NUM_CL_ARG;
+    }
+
+    IterationField field;
+    int status = load_iteration_field(argv[RESHADE_ARG_POS_FIELD_PATH], &field);
+    if (status != SUCCESS) {
+        return status;
+    }
+    ThreadPool *p_thread_pool = NULL;
+    size_t num_threads = get_num_processors();
+    if (num_threads > 1) {
+        status = create_thread_pool(num_threads, &p_thread_pool);
+        if (status != SUCCESS) {
+            free_iteration_field(&field);
+            return status;
+        }
+    }
+
+    for (int i = RESHADE_ARG_POS_FIRST_PALETTE; i + 1 < argc && status == SUCCESS; i += 2) {
+        Configuration config;
+        ImageData *p_image_data;
+        char *output_path;
+        struct timeval start, end;
+        gettimeofday(&start, NULL);
+
+        status = parse_ini_file(argv[i], &config);
+        if (status != SUCCESS) break;
+        status = create_image_data_with_size(field.size, &p_image_data);
+        if (status != SUCCESS) {
+            free_configuration(&config);
+            break;
+        }
+        status = shade_iteration_field(&field, &config, p_thread_pool, p_image_data);
+        free_configuration(&config);
+        if (status != SUCCESS) {
+            free_image_data(p_image_data);
+            break;
+        }
+        status = generate_valid_path(argv[i + 1], EXTENSION, &output_path);
+        if (status != SUCCESS) {
+            free_image_data(p_image_data);
+            break;
+        }
+        status = save_image(output_path, p_image_data, p_thread_pool, NULL);
+        free_image_data(p_image_data);
+
+        gettimeofday(&end, NULL);
+        if (status == SUCCESS) {
+            printf("> %s shaded with %s in %.1f ms\n", output_path, argv[i], (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_usec - start.tv_usec) / 1e3);
+        }
+        free(output_path);
+    }
+
+    free_thread_pool(p_thread_pool);
+    free_iteration_field(&field);
+    return status;
+}
+
+/**
+ * Renders a pyramid of tiles for all zoom levels up to the given one, see render_pyramid. Tiles that were written after the last
+ * modification of the configuration file are kept, so an interrupted pyramid is completed by running the command again.
+ * Command line: pyramid [--format xyz|dzi] [--threads <n>] <config_file> <max_zoom_level> <output_path>
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return Status code.
+ */
+int pyramid(int argc, char **argv) {
+    char *positional_args[PYRAMID_EXPECTED_ARG_COUNT];
+    int num_positional_args = 0;
+    size_t num_threads = get_num_processors();
+    PyramidFormat format = PYRAMID_FORMAT_XYZ;
+    int status = SUCCESS;
+
+    for (int i = 2; i < argc && status == SUCCESS; i++) {
+        if (strcmp(argv[i], OPTION_THREADS) == 0 || strcmp(argv[i], OPTION_FORMAT) == 0) {
+            if (i + 1 >= argc) {
+                return ERROR_INVALID_NUM_CL_ARG;
+            }
+            status = strcmp(argv[i], OPTION_THREADS) == 0 ? parse_thread_count(argv[i + 1], &num_threads) : parse_pyramid_format(argv[i + 1], &format);
+            i++;
+        } else {
+            if (num_positional_args >= PYRAMID_EXPECTED_ARG_COUNT) {
+                return ERROR_INVALID_NUM_CL_ARG;
+            }
+            positional_args[num_positional_args++] = argv[i];
+        }
+    }
+    if (status != SUCCESS) return status;
+    if (num_positional_args != PYRAMID_EXPECTED_ARG_COUNT) {
+        return ERROR_INVALID_NUM_CL_ARG;
+    }
+    size_t max_zoom_level;
+    status = parse_zoom_level(positional_args[PYRAMID_ARG_POS_ZOOM_LEVEL], &max_zoom_level);
+    if (status != SUCCESS) return status;
+
+    const char *config_path = positional_args[PYRAMID_ARG_POS_CONFIG_PATH];
+    struct stat config_stat;
+    if (stat(config_path, &config_stat) != 0) {
+        return ERROR_FILE_ACCESS;
+    }
+    Configuration config;
+    status = parse_ini_file(config_path, &config);
+    if (status != SUCCESS) return status;
+
+    // Pick the fastest iteration kernel before any worker thread is started.
+    select_iteration_kernel();
+    ThreadPool *p_thread_pool = NULL;
+    if (num_threads > 1) {
+        status = create_thread_pool(num_threads, &p_thread_pool);
+        if (status != SUCCESS) {
+            free_configuration(&config);
+            return status;
+        }
+    }
+
+    struct timeval start, end;
+    gettimeofday(&start, NULL);
+    PyramidStatistics statistics;
+    status = render_pyramid(config, p_thread_pool, max_zoom_level, format, positional_args[PYRAMID_ARG_POS_OUTPUT_PATH], config_stat.st_mtime,
+                            &print_progress_bar, &statistics);
+    gettimeofday(&end, NULL);
+    if (status == SUCCESS) {
+        printf("\n> %s: %zu tiles rendered, %zu downsampled, %zu up to date in %.1f s\n", positional_args[PYRAMID_ARG_POS_OUTPUT_PATH],
+               statistics.num_rendered_tiles, statistics.num_downsampled_tiles, statistics.num_skipped_tiles,
+               (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6);
+    }
+
+    free_thread_pool(p_thread_pool);
+    free_configuration(&config);
+    return status;
+}
+
+/**
+ * Renders an animation along a path of keyframes, see render_animation, or a zoom into a fixed point from a single exponential map,
+ * see render_log_polar_zoom. The configuration file provides everything but the viewport, whose aspect ratio determines the height of the frames.
+ * With the output prefix "-", the frames are written to the standard output as a YUV4MPEG2 stream instead of BMP files.
+ * Command line: animate [--threads <n>] [--log-polar] <config_file> <keyframe_file> <image_width> <output_prefix>
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return Status code.
+ */
+int animate(int argc, char **argv) {
+    char *positional_args[ANIMATE_EXPECTED_ARG_COUNT];
+    int num_positional_args = 0;
+    size_t num_threads = get_num_processors();
+    bool log_polar = false;
+    int status = SUCCESS;
+
+    for (int i = 2; i < argc && status == SUCCESS; i++) {
+        if (strcmp(argv[i], OPTION_THREADS) == 0) {
+            if (i + 1 >= argc) {
+                return ERROR_INVALID_NUM_CL_ARG;
+            }
+            status = parse_thread_count(argv[++i], &num_threads);
+        } else if (strcmp(argv[i], OPTION_LOG_POLAR) == 0) {
+            log_polar = true;
+        } else {
+            if (num_positional_args >= ANIMATE_EXPECTED_ARG_COUNT) {
+                return ERROR_INVALID_NUM_CL_ARG;
+            }
+            positional_args[num_positional_args++] = argv[i];
+        }
+    }
+    if (status != SUCCESS) return status;
+    if (num_positional_args != ANIMATE_EXPECTED_ARG_COUNT) {
+        return ERROR_INVALID_NUM_CL_ARG;
+    }
+    size_t image_width;
+    status = parse_image_width(positional_args[ANIMATE_ARG_POS_WIDTH], &image_width);
+    if (status != SUCCESS) return status;
+
+    Configuration config;
+    status = parse_ini_file(positional_args[ANIMATE_ARG_POS_CONFIG_PATH], &config);
+    if (status != SUCCESS) return status;
+    Keyframe *keyframes;
+    size_t num_keyframes;
+    status = parse_keyframe_file(positional_args[ANIMATE_ARG_POS_KEYFRAME_PATH], &keyframes, &num_keyframes);
+    if (status != SUCCESS) {
+        free_configuration(&config);
+        return status;
+    }
+    ImageSize image_size;
+    status = calc_image_size(config.viewport, image_width, &image_size);
+    FILE *frame_stream = NULL;
+    if (status == SUCCESS && is_stdout_path(positional_args[ANIMATE_ARG_POS_OUTPUT_PREFIX])) {
+        status = open_stdout_stream(&frame_stream);
+    }
+
+    // Pick the fastest iteration kernel before any worker thread is started.
+    select_iteration_kernel();
+    ThreadPool *p_thread_pool = NULL;
+    if (status == SUCCESS && num_threads > 1) {
+        status = create_thread_pool(num_threads, &p_thread_pool);
+    }
+
+    if (status == SUCCESS) {
+        struct timeval start, end;
+        gettimeofday(&start, NULL);
+        RenderStatistics statistics;
+        if (log_polar) {
+            status = render_log_polar_zoom(config, p_thread_pool, keyframes, num_keyframes, image_size, positional_args[ANIMATE_ARG_POS_OUTPUT_PREFIX],
+                                           frame_stream, &print_progress_bar, &statistics);
+        } else {
+            status = render_animation(config, p_thread_pool, keyframes, num_keyframes, image_size, positional_args[ANIMATE_ARG_POS_OUTPUT_PREFIX],
+                                      frame_stream, &print_progress_bar, &statistics);
+        }
+        gettimeofday(&end, NULL);
+        size_t num_frames = keyframes[num_keyframes - 1].frame - keyframes[0].frame + 1;
+        double num_pixels = (double)num_frames * image_size.width * image_size.height;
+        if (status == SUCCESS && log_polar) {
+            printf("\n> %zu frames of %zu x %zu resampled from %zu iterated pixels (%.1f%% of the frames) in %.1f s\n", num_frames, image_size.width,
+                   image_size.height, statistics.num_iterated_pixels, 100.0 * statistics.num_iterated_pixels / num_pixels,
+                   (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6);
+        } else if (status == SUCCESS) {
+            printf("\n> %zu frames of %zu x %zu: %.1f%% of the pixels reused from the previous frame in %.1f s\n", num_frames, image_size.width,
+                   image_size.height, 100.0 * statistics.num_reused_pixels / num_pixels, (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6);
+        }
+    }
+
+    free_thread_pool(p_thread_pool);
+    if (frame_stream != NULL && fclose(frame_stream) != 0 && status == SUCCESS) {
+        status = ERROR_FILE_ACCESS;
+    }
+    free(keyframes);
+    free_configuration(&config);
+    return status;
+}
+
+/**
+ * Serves render jobs on a Unix domain socket until a client shuts the daemon down, see run_render_daemon.
+ * Command line: daemon [--threads <n>] <socket_path>
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return Status code.
+ */
+int render_daemon(int argc, char **argv) {
+    const char *socket_path = NULL;
+    size_t num_threads = get_num_processors();
+    int status = SUCCESS;
+
+    for (int i = 2; i < argc && status == SUCCESS; i++) {
+        if (strcmp(argv[i], OPTION_THREADS) == 0) {
+            if (i + 1 >= argc) {
+                return ERROR_INVALID_NUM_CL_ARG;
+            }
+            status = parse_thread_count(argv[++i], &num_threads);
+        } else {
+            if (socket_path != NULL) {
+                return ERROR_INVALID_NUM_CL_ARG;
+            }
+            socket_path = argv[i];
+        }
+    }
+    if (status != SUCCESS) return status;
+    if (socket_path == NULL) {
+        return ERROR_INVALID_NUM_CL_ARG;
+    }
+
+    // Pick the fastest iteration kernel before any worker thread is started.
+    select_iteration_kernel();
+    ThreadPool *p_thread_pool = NULL;
+    if (num_threads > 1) {
+        status = create_thread_pool(num_threads, &p_thread_pool);
+    }
+    Listener *p_listener = NULL;
+    if (status == SUCCESS) {
+        status = open_unix_listener(socket_path, &p_listener);
+    }
+    if (status == SUCCESS) {
+        printf("> Listening on %s with %zu threads\n", socket_path, num_threads);
+        fflush(stdout);
+        status = run_render_daemon(p_listener, p_thread_pool);
+    }
+
+    close_listener(p_listener);
+    free_thread_pool(p_thread_pool);
+    return status;
+}
+
+/**
+ * Computes bands of iteration fields for distributed renders on a TCP port until the process is stopped, see run_render_worker.
+ * Command line: worker [--threads <n>] <port>
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return Status code.
+ */
+int render_worker(int argc, char **argv) {
+    const char *port = NULL;
+    size_t num_threads = get_num_processors();
+    int status = SUCCESS;
+
+    for (int i = 2; i < argc && status == SUCCESS; i++) {
+        if (strcmp(argv[i], OPTION_THREADS) == 0) {
+            if (i + 1 >= argc) {
+                return ERROR_INVALID_NUM_CL_ARG;
+            }
+            status = parse_thread_count(argv[++i], &num_threads);
+        } else {
+            if (port != NULL) {
+                return ERROR_INVALID_NUM_CL_ARG;
+            }
+            port = argv[i];
+        }
+    }
+    if (status != SUCCESS) return status;
+    if (port == NULL) {
+        return ERROR_INVALID_NUM_CL_ARG;
+    }
+
+    // Pick the fastest iteration kernel before any worker thread is started.
+    select_iteration_kernel();
+    ThreadPool *p_thread_pool = NULL;
+    if (num_threads > 1) {
+        status = create_thread_pool(num_threads, &p_thread_pool);
+    }
+    Listener *p_listener = NULL;
+    if (status == SUCCESS) {
+        status = open_tcp_listener(port, &p_listener);
+    }
+    if (status == SUCCESS) {
+        printf("> Listening on port %s with %zu threads\n", port, num_threads);
+        fflush(stdout);
+        status = run_render_worker(p_listener, p_thread_pool);
+    }
+
+    close_listener(p_listener);
+    free_thread_pool(p_thread_pool);
+    return status;
+}
+
+/**
+ * Renders the scenes of the benchmark, prints the results and saves them as JSON, see run_benchmark.
+ * If a baseline file of an earlier benchmark is given, every run is compared with the same run of the baseline.
+ * Command line: bench [--threads <n>] [--repeat <n>] [--baseline <json_file>] [--tolerance <percent>] <output_json_file>
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return Status code. ERROR_BENCHMARK_REGRESSION if a run is slower than the baseline by more than the tolerance.
+ */
+int bench(int argc, char **argv) {
+    const char *output_path = NULL;
+    const char *baseline_path = NULL;
+    size_t num_threads = get_num_processors();
+    size_t num_repetitions = BENCH_DEFAULT_REPETITIONS;
+    double tolerance = BENCH_DEFAULT_TOLERANCE;
+    int status = SUCCESS;
+
+    for (int i = 2; i < argc && status == SUCCESS; i++) {
+        if (strcmp(argv[i], OPTION_THREADS) == 0 || strcmp(argv[i], OPTION_REPEAT) == 0 || strcmp(argv[i], OPTION_BASELINE) == 0 ||
+            strcmp(argv[i], OPTION_TOLERANCE) == 0) {
+            if (i + 1 >= argc) {
+                return ERROR_INVALID_NUM_CL_ARG;
+            }
+            if (strcmp(argv[i], OPTION_THREADS) == 0) {
+                status = parse_thread_count(argv[i + 1], &num_threads);
+            } else if (strcmp(argv[i], OPTION_REPEAT) == 0) {
+                status = parse_repetition_count(argv[i + 1], &num_repetitions);
+            } else if (strcmp(argv[i], OPTION_BASELINE) == 0) {
+                baseline_path = argv[i + 1];
+            } else {
+                status = parse_tolerance(argv[i + 1], &tolerance);
+            }
+            i++;
+        } else {
+            if (output_path != NULL) {
+                return ERROR_INVALID_NUM_CL_ARG;
+            }
+            output_path = argv[i];
+        }
+    }
+    if (status != SUCCESS) return status;
+    if (output_path == NULL) {
+        return ERROR_INVALID_NUM_CL_ARG;
+    }
+
+    // The baseline is loaded first, so a wrong path is reported before the benchmark runs.
+    BenchmarkResult *baseline = NULL;
+    size_t num_baseline_results = 0;
+    if (baseline_path != NULL) {
+        status = load_benchmark_results(baseline_path, &baseline, &num_baseline_results);
+        if (status != SUCCESS) return status;
+    }
+
+    // Pick the fastest iteration kernel before any worker thread is started.
+    select_iteration_kernel();
+    ThreadPool *p_thread_pool = NULL;
+    if (num_threads > 1) {
+        status = create_thread_pool(num_threads, &p_thread_pool);
+    }
+    BenchmarkResult results[BENCHMARK_NUM_RUNS];
+    if (status == SUCCESS) {
+        status = run_benchmark(p_thread_pool, num_repetitions, results, &print_progress_bar);
+    }
+    free_thread_pool(p_thread_pool);
+    if (status == SUCCESS) {
+        print_benchmark_results(results, BENCHMARK_NUM_RUNS, baseline, num_baseline_results, tolerance);
+        status = save_benchmark_results(output_path, results, BENCHMARK_NUM_RUNS, num_threads);
+    }
+    if (status == SUCCESS && baseline != NULL) {
+        for (size_t i = 0; i < BENCHMARK_NUM_RUNS; i++) {
+            const BenchmarkResult *p_baseline = find_benchmark_result(&results[i], baseline, num_baseline_results);
+            if (p_baseline != NULL && is_benchmark_regression(&results[i], p_baseline, tolerance)) {
+                status = ERROR_BENCHMARK_REGRESSION;
+            }
+        }
+    }
+    free(baseline);
+    return status;
+}
+
+/**
+ * The state of the frame callback of a progressive render on the command line.
+ */
+typedef struct {
+    const char *output_path;
+    // The thread pool that compresses the passes, or NULL.
+    ThreadPool *p_thread_pool;
+    // The time of the monotonic clock when the render started.
+    double start_time;
+    // The status of the first failed save, or SUCCESS.
+    int status;
+    // The time spent saving the passes and the number of bytes written.
+    ImageFileStatistics file_statistics;
+} ProgressiveOutput;
+
+/**
+ * Saves the image after a pass of a progressive render, so it can be watched in an image viewer while it gets finer.
+ *
+ * @param p_image_data A pointer to the image data.
+ * @param step The step of the pass.
+ * @param p_context A pointer to the ProgressiveOutput.
+ */
+void save_progressive_pass(const ImageData *p_image_data, size_t step, void *p_context) {
+    ProgressiveOutput *p_output = (ProgressiveOutput *)p_context;
+    double elapsed = get_monotonic_time() - p_output->start_time;
+    int status = save_image(p_output->output_path, p_image_data, p_output->p_thread_pool, &p_output->file_statistics);
+    if (status != SUCCESS && p_output->status == SUCCESS) {
+        p_output->status = status;
+    }
+    printf("> pass 1/%zu saved after %.3f seconds\n", step, elapsed);
+    fflush(stdout);
+}
+
+/**
+ * Renders the image into image data that is either allocated or mapped to the output file, saves the iteration field if requested
+ * and exports the image. Mapped image data is complete as soon as it is rendered. With a memory budget, mapped image data is
+ * rendered in bands, so the iteration field of the whole image is never allocated.
+ * Creating the image data and the field is measured as the allocate stage, compressing a PNG file as the encode stage and writing
+ * the file as the write stage. BMP files need no encode stage, because the image data is already stored in the layout of the file.
+ *
+ * @param config The configuration struct.
+ * @param p_thread_pool The thread pool or NULL.
+ * @param p_tile_cache The tile cache or NULL.
+ * @param image_size The size of the image in pixels.
+ * @param p_arguments A pointer to the parsed command line arguments.
+ * @param output_path The path of the image file.
+ * @param p_statistics A pointer to store statistics about the render.
+ * @param p_metrics A pointer to the metrics to add the times of the stages and the number of bytes written to.
+ * @return Status code.
+ */
+int render_and_export(Configuration config, ThreadPool *p_thread_pool, TileCache *p_tile_cache, ImageSize image_size, const Arguments *p_arguments, const char *output_path,
+                      RenderStatistics *p_statistics, RenderMetrics *p_metrics) {
+    StageClock allocate_clock, write_clock;
+    start_stage_clock(&allocate_clock);
+    ImageData *p_image_data;
+    int status = p_arguments->mmap_output ? create_mapped_image_data(image_size, output_path, &p_image_data)
+                                          : create_image_data_with_size(image_size, &p_image_data);
+    if (status != SUCCESS) return status;
+    stop_stage_clock(&allocate_clock, &p_metrics->stages[STAGE_ALLOCATE]);
+
+    if (p_arguments->memory_budget > 0) {
+        status = render_to_mapped_image(config, p_thread_pool, p_tile_cache, p_image_data, p_arguments->memory_budget, &print_progress_bar, p_statistics);
+        start_stage_clock(&write_clock);
+        free_image_data(p_image_data);
+        stop_stage_clock(&write_clock, &p_metrics->stages[STAGE_WRITE]);
+        if (status == SUCCESS) {
+            p_metrics->num_bytes_written = get_bmp_file_size(image_size);
+        }
+        return status;
+    }
+
+    start_stage_clock(&allocate_clock);
+    IterationField field;
+    status = create_iteration_field(image_size, config.iteration_depth, &field);
+    if (status != SUCCESS) {
+        free_image_data(p_image_data);
+        return status;
+    }
+    stop_stage_clock(&allocate_clock, &p_metrics->stages[STAGE_ALLOCATE]);
+
+    if (p_arguments->progressive) {
+        // Every pass is saved by the frame callback, so the image is not exported again.
+        ProgressiveOutput output;
+        memset(&output, 0, sizeof(ProgressiveOutput));
+        output.output_path = output_path;
+        output.p_thread_pool = p_thread_pool;
+        output.start_time = get_monotonic_time();
+        status = render_progressive(config, p_thread_pool, &field, p_image_data, p_arguments->deadline, &save_progressive_pass, &output, NULL, p_statistics);
+        if (status == SUCCESS) {
+            status = output.status;
+        }
+        if (status == SUCCESS && p_arguments->field_path != NULL) {
+            status = save_iteration_field(p_arguments->field_path, &field);
+        }
+        add_stage_time(&p_metrics->stages[STAGE_ENCODE], &output.file_statistics.encode_time);
+        add_stage_time(&p_metrics->stages[STAGE_WRITE], &output.file_statistics.write_time);
+        p_metrics->num_bytes_written = output.file_statistics.num_bytes_written;
+        free_iteration_field(&field);
+        free_image_data(p_image_data);
+        return status;
+    }
+
+    if (p_arguments->workers != NULL) {
+        status = render_distributed(config, p_arguments->config_path, p_arguments->workers, p_thread_pool, &field, p_image_data, &print_progress_bar,
+                                    p_statistics);
+    } else {
+        status = render_to_image(config, p_thread_pool, p_tile_cache, &field, p_image_data, &print_progress_bar, p_statistics);
+    }
+    if (status == SUCCESS && p_arguments->field_path != NULL) {
+        status = save_iteration_field(p_arguments->field_path, &field);
+    }
+    free_iteration_field(&field);
+    if (status != SUCCESS) {
+        free_image_data(p_image_data);
+        return status;
+    }
+    // Mapped image data is already in the file, unmapping it flushes the pixels.
+    if (p_image_data->p_mapping != NULL) {
+        start_stage_clock(&write_clock);
+        free_image_data(p_image_data);
+        stop_stage_clock(&write_clock, &p_metrics->stages[STAGE_WRITE]);
+        p_metrics->num_bytes_written = get_bmp_file_size(image_size);
+        return status;
+    }
+    // The pixels only need to be reordered for the standard output, so converting them counts as writing.
+    if (p_arguments->output_stream != NULL) {
+        start_stage_clock(&write_clock);
+        status = write_ppm(p_arguments->output_stream, p_image_data, &p_metrics->num_bytes_written);
+        free_image_data(p_image_data);
+        stop_stage_clock(&write_clock, &p_metrics->stages[STAGE_WRITE]);
+        return status;
+    }
+    ImageFileStatistics file_statistics;
+    memset(&file_statistics, 0, sizeof(ImageFileStatistics));
+    status = save_image(output_path, p_image_data, p_thread_pool, &file_statistics);
+    free_image_data(p_image_data);
+    if (status == SUCCESS) {
+        add_stage_time(&p_metrics->stages[STAGE_ENCODE], &file_statistics.encode_time);
+        add_stage_time(&p_metrics->stages[STAGE_WRITE], &file_statistics.write_time);
+        p_metrics->num_bytes_written = file_statistics.num_bytes_written;
+    }
+    return status;
+}
+
+/**
+ * Renders the image into indexed image data, saves the iteration field if requested and exports the image as a BMP file with
+ * 8 bits per pixel. Compressing the pixel array with RLE8 is measured as part of the write stage, because the rows are compressed
+ * while they are written.
+ *
+ * @param config The configuration struct.
+ * @param p_thread_pool The thread pool or NULL.
+ * @param p_tile_cache The tile cache or NULL.
+ * @param image_size The size of the image in pixels.
+ * @param p_arguments A pointer to the parsed command line arguments.
+ * @param output_path The path of the image file.
+ * @param p_statistics A pointer to store statistics about the render.
+ * @param p_metrics A pointer to the metrics to add the times of the stages and the number of bytes written to.
+ * @return Status code.
+ */
+int render_and_export_indexed(Configuration config, ThreadPool *p_thread_pool, TileCache *p_tile_cache, ImageSize image_size, const Arguments *p_arguments,
+                              const char *output_path, RenderStatistics *p_statistics, RenderMetrics *p_metrics) {
+    StageClock allocate_clock, write_clock;
+    start_stage_clock(&allocate_clock);
+    IndexedImageData *p_image_data;
+    int status = create_indexed_image_data(image_size, &p_image_data);
+    if (status != SUCCESS) return status;
+    IterationField field;
+    status = create_iteration_field(image_size, config.iteration_depth, &field);
+    if (status != SUCCESS) {
+        free_indexed_image_data(p_image_data);
+        return status;
+    }
+    stop_stage_clock(&allocate_clock, &p_metrics->stages[STAGE_ALLOCATE]);
+
+    status = render_to_indexed_image(config, p_thread_pool, p_tile_cache, &field, p_image_data, &print_progress_bar, p_statistics);
+    if (status == SUCCESS && p_arguments->field_path != NULL) {
+        status = save_iteration_field(p_arguments->field_path, &field);
+    }
+    free_iteration_field(&field);
+    if (status == SUCCESS) {
+        start_stage_clock(&write_clock);
+        status = save_indexed_bmp(output_path, p_image_data, p_arguments->rle, &p_metrics->num_bytes_written);
+        stop_stage_clock(&write_clock, &p_metrics->stages[STAGE_WRITE]);
+    }
+    free_indexed_image_data(p_image_data);
+    return status;
+}
+
 /**
  * Main function of the program.
  * Parses the command line arguments, the ini file and the width of the image.
  * Calculates the image size and allocates memory for the image data.
- * Builds the image and prints the progress.
- * Exports the image and prints the info.
+ * Builds the image on a pool of worker threads and prints the progress.
+ * Exports the image and prints the info. With a memory budget or a mapped output file, the image is written to the file while it is built.
  */
 int main(int argc, char **argv) {
     // TODO: free memory also in case of errors
-    if (argc == 2 && (strcmp(argv[ARG_POS_CONFIG_PATH], "-h") == 0 || strcmp(argv[ARG_POS_CONFIG_PATH], "--help") == 0)) {
+    if (argc == 2 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
         print_help(argv[0]);
         return SUCCESS;
     }
-
-    if (argc != EXPECTED_ARG_COUNT) {
-        print_error_message(ERROR_INVALID_NUM_CL_ARG);
-        return ERROR_INVALID_NUM_CL_ARG;
+    if (argc > 1 && strcmp(argv[1], COMMAND_RESHADE) == 0) {
+        int status = reshade(argc, argv);
+        if (status != SUCCESS) {
+            print_error_message(status);
+        }
+        return status;
+    }
+    if (argc > 1 && strcmp(argv[1], COMMAND_ANIMATE) == 0) {
+        int status = animate(argc, argv);
+        if (status != SUCCESS) {
+            print_error_message(status);
+        }
+        return status;
+    }
+    if (argc > 1 && strcmp(argv[1], COMMAND_DAEMON) == 0) {
+        int status = render_daemon(argc, argv);
+        if (status != SUCCESS) {
+            print_error_message(status);
+        }
+        return status;
+    }
+    if (argc > 1 && strcmp(argv[1], COMMAND_WORKER) == 0) {
+        int status = render_worker(argc, argv);
+        if (status != SUCCESS) {
+            print_error_message(status);
+        }
+        return status;
+    }
+    if (argc > 1 && strcmp(argv[1], COMMAND_BENCH) == 0) {
+        int status = bench(argc, argv);
+        if (status != SUCCESS) {
+            print_error_message(status);
+        }
+        return status;
+    }
+    if (argc > 1 && strcmp(argv[1], COMMAND_PYRAMID) == 0) {
+        int status = pyramid(argc, argv);
+        if (status != SUCCESS) {
+            print_error_message(status);
+        }
+        return status;
     }
 
-    char *config_path = argv[ARG_POS_CONFIG_PATH];
-    char *str_width = argv[ARG_POS_WIDTH];
-    char *incomplete_output_path = argv[ARG_POS_OUTPUT_PATH];
+    // Pick the fastest iteration kernel before any worker thread is started.
+    select_iteration_kernel();
 
     int status;
+    RenderMetrics metrics;
+    memset(&metrics, 0, sizeof(RenderMetrics));
+    StageClock parse_clock, allocate_clock;
+    start_stage_clock(&parse_clock);
 
-    // Parse ini file
-    Configuration config;
-    status = parse_ini_file(config_path, &config);
+    Arguments arguments;
+    status = parse_arguments(argc, argv, &arguments);
     if (status != SUCCESS) {
         print_error_message(status);
         return status;
     }
+    // From here on, everything that is printed goes to the standard error if the image goes to the standard output.
+    if (is_stdout_path(arguments.incomplete_output_path)) {
+        status = open_stdout_stream(&arguments.output_stream);
+        if (status != SUCCESS) {
+            print_error_message(status);
+            return status;
+        }
+    }
 
-    // Parse width fom command line parameter
-    size_t image_width;
-    status = parse_image_width(str_width, &image_width);
+    // Parse ini file
+    Configuration config;
+    status = parse_ini_file(arguments.config_path, &config);
     if (status != SUCCESS) {
         print_error_message(status);
         return status;
     }
 
-    ImageData *p_image_data;
-    status = create_image_data(config.viewport, image_width, &p_image_data);
+    // Parse width fom command line parameter
+    size_t image_width;
+    status = parse_image_width(arguments.str_width, &image_width);
     if (status != SUCCESS) {
         print_error_message(status);
         return status;
     }
 
-    // Build image and print progress
-    double build_time;
-    status = CPUTIME(render_to_image(config, p_image_data, &print_progress_bar), &build_time);
+    ImageSize image_size;
+    status = calc_image_size(config.viewport, image_width, &image_size);
     if (status != SUCCESS) {
         print_error_message(status);
         return status;
     }
 
-    // Export image
     char *output_path;
-    status = generate_valid_path(incomplete_output_path, EXTENSION, &output_path);
+    status = generate_valid_path(arguments.incomplete_output_path, EXTENSION, &output_path);
     if (status != SUCCESS) {
         print_error_message(status);
         return status;
     }
-    status = export_and_free(p_image_data, output_path);
+    stop_stage_clock(&parse_clock, &metrics.stages[STAGE_PARSE]);
+
+    // A single thread renders on the main thread, so no pool is needed.
+    start_stage_clock(&allocate_clock);
+    ThreadPool *p_thread_pool = NULL;
+    if (arguments.num_threads > 1) {
+        status = create_thread_pool(arguments.num_threads, &p_thread_pool);
+        if (status != SUCCESS) {
+            print_error_message(status);
+            return status;
+        }
+    }
+
+    TileCache *p_tile_cache = NULL;
+    if (arguments.cache_path != NULL) {
+        status = open_tile_cache(arguments.cache_path, arguments.cache_size, &p_tile_cache);
+        if (status != SUCCESS) {
+            print_error_message(status);
+            return status;
+        }
+    }
+
+    stop_stage_clock(&allocate_clock, &metrics.stages[STAGE_ALLOCATE]);
+
+    // Build image and print progress
+    RenderStatistics statistics;
+    if (arguments.memory_budget > 0 && !arguments.mmap_output) {
+        ImageFormat format = IMAGE_FORMAT_BMP;
+        get_image_format(output_path, &format);
+        if (format == IMAGE_FORMAT_TIFF) {
+            status = render_to_tiff_stream(config, p_thread_pool, p_tile_cache, image_size, arguments.memory_budget, output_path, &print_progress_bar,
+                                           &statistics);
+        } else {
+            status = render_to_bmp_stream(config, p_thread_pool, p_tile_cache, image_size, arguments.memory_budget, output_path, &print_progress_bar,
+                                          &statistics);
+        }
+        add_stage_time(&metrics.stages[STAGE_WRITE], &statistics.write_time);
+        metrics.num_bytes_written = statistics.num_bytes_written;
+    } else if (arguments.indexed) {
+        status = render_and_export_indexed(config, p_thread_pool, p_tile_cache, image_size, &arguments, output_path, &statistics, &metrics);
+    } else {
+        status = render_and_export(config, p_thread_pool, p_tile_cache, image_size, &arguments, output_path, &statistics, &metrics);
+    }
+    free_thread_pool(p_thread_pool);
+    close_tile_cache(p_tile_cache);
+    if (arguments.output_stream != NULL && fclose(arguments.output_stream) != 0 && status == SUCCESS) {
+        status = ERROR_FILE_ACCESS;
+    }
     if (status != SUCCESS) {
         print_error_message(status);
         return status;
     }
+    metrics.stages[STAGE_COMPUTE] = statistics.compute_time;
+    metrics.stages[STAGE_SHADE] = statistics.shade_time;
+    metrics.histogram = statistics.histogram;
 
     // Print info
-    print_info(config_path, output_path, p_image_data->size, config, build_time);
+    print_info(arguments.config_path, output_path, image_size, config, arguments.num_threads, &statistics, &metrics);
+    free_configuration(&config);
+    if (arguments.stats_path != NULL) {
+        status = save_render_metrics(arguments.stats_path, output_path, image_size, arguments.num_threads, &metrics);
+        if (status != SUCCESS) {
+            print_error_message(status);
+            return status;
+        }
+    }
 
     return SUCCESS;
-}
\ No newline at end of file
+}
@@ -0,0 +1,182 @@
+#include "../include/metrics.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "../include/iteration_kernel.h"
+#include "../include/status_manager.h"
+
+/**
+ * The version of the JSON files. It is increased whenever a key is changed or removed.
+ */
+#define METRICS_FILE_VERSION 1
+
+static const char *STAGE_NAMES[NUM_STAGES] = {"parse", "allocate", "compute", "shade", "encode", "write"};
+
+#ifdef _WIN32
+/**
+ * Converts the time of a FILETIME, which counts 100 nanosecond intervals, to seconds.
+ *
+ * @param time The time.
+ * @return The time in seconds.
+ */
+double _filetime_to_seconds(FILETIME time) {
+    ULARGE_INTEGER value;
+    value.LowPart = time.dwLowDateTime;
+    value.HighPart = time.dwHighDateTime;
+    return (double)value.QuadPart / 1e7;
+}
+#endif
+
+double get_monotonic_time(void) {
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec / 1e9;
+#endif
+}
+
+double get_process_cpu_time(void) {
+#ifdef _WIN32
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time, &kernel_time, &user_time)) return 0;
+    return _filetime_to_seconds(kernel_time) + _filetime_to_seconds(user_time);
+#else
+    struct timespec time;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec / 1e9;
+#endif
+}
+
+double get_thread_cpu_time(void) {
+#ifdef _WIN32
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    if (!GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time)) return 0;
+    return _filetime_to_seconds(kernel_time) + _filetime_to_seconds(user_time);
+#else
+    struct timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec / 1e9;
+#endif
+}
+
+void start_stage_clock(StageClock *p_clock) {
+    p_clock->wall_start = get_monotonic_time();
+    p_clock->cpu_start = get_process_cpu_time();
+}
+
+void stop_stage_clock(const StageClock *p_clock, StageTime *p_time) {
+    p_time->wall_time += get_monotonic_time() - p_clock->wall_start;
+    p_time->cpu_time += get_process_cpu_time() - p_clock->cpu_start;
+}
+
+void add_stage_time(StageTime *p_sum, const StageTime *p_time) {
+    p_sum->wall_time += p_time->wall_time;
+    p_sum->cpu_time += p_time->cpu_time;
+}
+
+const char *get_stage_name(Stage stage) {
+    return stage < NUM_STAGES ? STAGE_NAMES[stage] : "unknown";
+}
+
+void add_field_to_iteration_histogram(const IterationField *p_field, IterationHistogram *p_histogram) {
+    size_t num_pixels = p_field->size.width * p_field->size.height;
+    for (size_t i = 0; i < num_pixels; i++) {
+        uint32_t iterations = p_field->iterations[i];
+        p_histogram->num_iterations += iterations;
+        if (iterations >= p_field->iteration_depth) {
+            p_histogram->num_interior_pixels++;
+            continue;
+        }
+        size_t bin = 0;
+        while (iterations >> (bin + 1) != 0) {
+            bin++;
+        }
+        p_histogram->bins[bin]++;
+    }
+    p_histogram->num_pixels += num_pixels;
+}
+
+void add_iteration_histogram(IterationHistogram *p_sum, const IterationHistogram *p_histogram) {
+    p_sum->num_pixels += p_histogram->num_pixels;
+    p_sum->num_iterations += p_histogram->num_iterations;
+    p_sum->num_interior_pixels += p_histogram->num_interior_pixels;
+    for (size_t i = 0; i < ITERATION_HISTOGRAM_SIZE; i++) {
+        p_sum->bins[i] += p_histogram->bins[i];
+    }
+}
+
+/**
+ * Writes a string as a JSON string, so paths with backslashes or quotes stay valid JSON.
+ *
+ * @param file The file.
+ * @param string The string.
+ */
+void _write_json_string(FILE *file, const char *string) {
+    fputc('"', file);
+    for (const char *p_char = string; *p_char != '\0'; p_char++) {
+        if (*p_char == '"' || *p_char == '\\') {
+            fputc('\\', file);
+            fputc(*p_char, file);
+        } else if ((unsigned char)*p_char < 0x20) {
+            fprintf(file, "\\u%04x", (unsigned int)(unsigned char)*p_char);
+        } else {
+            fputc(*p_char, file);
+        }
+    }
+    fputc('"', file);
+}
+
+int save_render_metrics(const char *path, const char *output_path, ImageSize size, size_t num_threads, const RenderMetrics *p_metrics) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) return ERROR_FILE_ACCESS;
+    const IterationHistogram *p_histogram = &p_metrics->histogram;
+    StageTime total = {0, 0};
+    for (size_t i = 0; i < NUM_STAGES; i++) {
+        add_stage_time(&total, &p_metrics->stages[i]);
+    }
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"version\": %d,\n", METRICS_FILE_VERSION);
+    fprintf(file, "  \"output\": ");
+    _write_json_string(file, output_path);
+    fprintf(file, ",\n");
+    fprintf(file, "  \"width\": %zu,\n", size.width);
+    fprintf(file, "  \"height\": %zu,\n", size.height);
+    fprintf(file, "  \"threads\": %zu,\n", num_threads);
+    fprintf(file, "  \"iteration_kernel\": \"%s\",\n", get_iteration_kernel_name());
+    fprintf(file, "  \"stages\": {\n");
+    for (size_t i = 0; i < NUM_STAGES; i++) {
+        fprintf(file, "    \"%s\": {\"wall_time\": %.6f, \"cpu_time\": %.6f},\n", get_stage_name((Stage)i), p_metrics->stages[i].wall_time,
+                p_metrics->stages[i].cpu_time);
+    }
+    fprintf(file, "    \"total\": {\"wall_time\": %.6f, \"cpu_time\": %.6f}\n", total.wall_time, total.cpu_time);
+    fprintf(file, "  },\n");
+    fprintf(file, "  \"pixels\": %zu,\n", p_histogram->num_pixels);
+    fprintf(file, "  \"iterations\": %llu,\n", (unsigned long long)p_histogram->num_iterations);
+    fprintf(file, "  \"interior_pixels\": %zu,\n", p_histogram->num_interior_pixels);
+    fprintf(file, "  \"interior_fraction\": %.6f,\n",
+            p_histogram->num_pixels > 0 ? (double)p_histogram->num_interior_pixels / (double)p_histogram->num_pixels : 0.0);
+    // The histogram ends with its last bin that is not empty.
+    size_t num_bins = ITERATION_HISTOGRAM_SIZE;
+    while (num_bins > 0 && p_histogram->bins[num_bins - 1] == 0) {
+        num_bins--;
+    }
+    fprintf(file, "  \"iteration_histogram\": [");
+    for (size_t i = 0; i < num_bins; i++) {
+        fprintf(file, "%zu%s", p_histogram->bins[i], i + 1 < num_bins ? ", " : "");
+    }
+    fprintf(file, "],\n");
+    fprintf(file, "  \"bytes_written\": %llu\n", (unsigned long long)p_metrics->num_bytes_written);
+    fprintf(file, "}\n");
+    return fclose(file) == 0 ? SUCCESS : ERROR_FILE_ACCESS;
+}
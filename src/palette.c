@@ -0,0 +1,106 @@
+#include "../include/palette.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/color_utilities.h"
+#include "../include/status_manager.h"
+
+/**
+ * Calculates the color of the gradient of outer colors at a position between 0 and iteration_depth - 1 iterations.
+ * The gradient is divided into num_outer_colors - 1 segments of equal size, the color is interpolated within its segment.
+ *
+ * @param position The position in iterations. May be fractional.
+ * @param iteration_depth The maximum number of iterations.
+ * @param p_config A pointer to the configuration struct with the outer colors.
+ * @param p_result A pointer to store the calculated color.
+ * @return Status code.
+ */
+int _get_gradient_color(double position, size_t iteration_depth, const Configuration *p_config, uint32_t *p_result) {
+    // If there is only one outer color, return the outer color
+    if (p_config->num_outer_colors == 1) {
+        *p_result = p_config->outer_colors[0];
+        return SUCCESS;
+    }
+
+    // Calculate segment size and segment index. The segment size is the size of the color interval in the number of iterations.
+    // Example: I have 3 outer colors and iteration_depth = 4. Then num_iterations can be 0, 1, 2, 3 (4 is mapped to inner color).
+    // We have 2=num_outer_colors-1 color intervals [c1, c2], [c2, c3]. Then we map these intervals to the [0, 1.5], [1.5, 3] in the number of iterations, where 1.5 = (iteration_depth-1)/(num_outer_colors-1).
+    double segment_size = (iteration_depth - 1) / (double)(p_config->num_outer_colors - 1);
+    if (isnan(segment_size) || isinf(segment_size)) {
+        return ERROR_ARITHMETIC_OVERFLOW;
+    }
+    size_t segment_index = position / segment_size;
+    // Calculate the progress within the segment
+    double t = position / segment_size - segment_index;
+    // The end of the gradient is the end of the last segment.
+    if (segment_index >= p_config->num_outer_colors - 1) {
+        segment_index = p_config->num_outer_colors - 2;
+        t = 1.0;
+    }
+
+    uint32_t start_color = p_config->outer_colors[segment_index];
+    uint32_t end_color = p_config->outer_colors[segment_index + 1];
+
+    interpolate_color(start_color, end_color, t, p_result);
+    return SUCCESS;
+}
+
+/**
+ * Converts a color to an entry of a lookup table: blue, green and red in the byte order of the image data.
+ *
+ * @param color The color. From LSB to MSB: blue (8 bit), green (8 bit), red (8 bit). Alpha value will be ignored.
+ * @return The entry.
+ */
+uint32_t _to_palette_entry(uint32_t color) {
+    uint8_t bytes[4] = {get_blue(color), get_green(color), get_red(color), 0};
+    uint32_t entry;
+    memcpy(&entry, bytes, sizeof(entry));
+    return entry;
+}
+
+int compile_palette(const Configuration *p_config, size_t iteration_depth, Palette *p_palette) {
+    memset(p_palette, 0, sizeof(Palette));
+    // If there are no outer colors, return an error
+    if (p_config->num_outer_colors < 1) return ERROR_NO_OUTER_COLORS;
+    // If the maximum number of iterations is 0, return an error
+    if (iteration_depth == 0) return ERROR_INVALID_ITERATION_DEPTH;
+    // there are not enough different values for num_iterations to map to the outer colors. We don't know which color to dismiss?
+    if (p_config->num_outer_colors > iteration_depth) return ERROR_TOO_MANY_OUTER_COLORS;
+
+    // The gradient covers the positions 0 to iteration_depth - 1, the inner color is stored separately.
+    size_t num_entries = iteration_depth;
+    if (p_config->smooth_coloring) {
+        num_entries = iteration_depth - 1 <= (MAX_PALETTE_ENTRIES - 1) / SMOOTH_PALETTE_STEPS ? (iteration_depth - 1) * SMOOTH_PALETTE_STEPS + 1 : MAX_PALETTE_ENTRIES;
+    } else if (num_entries > MAX_PALETTE_ENTRIES) {
+        num_entries = MAX_PALETTE_ENTRIES;
+    }
+
+    p_palette->entries = (uint32_t *)malloc((num_entries + 1) * sizeof(uint32_t));
+    if (p_palette->entries == NULL) return ERROR_MEMORY_ALLOC;
+    p_palette->num_entries = num_entries;
+    p_palette->iteration_depth = iteration_depth;
+    p_palette->smooth = p_config->smooth_coloring;
+    p_palette->entries_per_iteration = iteration_depth > 1 ? (num_entries - 1) / (double)(iteration_depth - 1) : 0.0;
+    p_palette->smooth_scale = p_config->power > 2 ? (float)(1.0 / log2((double)p_config->power)) : 1.0f;
+
+    uint32_t color;
+    for (size_t i = 0; i < num_entries; i++) {
+        // Is exactly i if there is one entry per number of iterations.
+        double position = num_entries > 1 ? (double)i * (iteration_depth - 1) / (num_entries - 1) : 0.0;
+        int status = _get_gradient_color(position, iteration_depth, p_config, &color);
+        if (status < 0) {
+            free_palette(p_palette);
+            return status;
+        }
+        p_palette->entries[i] = _to_palette_entry(color);
+    }
+    p_palette->entries[num_entries] = _to_palette_entry(p_config->inner_color);
+    return SUCCESS;
+}
+
+void free_palette(Palette *p_palette) {
+    free(p_palette->entries);
+    memset(p_palette, 0, sizeof(Palette));
+}
@@ -0,0 +1,103 @@
+#include "../include/perturbation.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "../include/iteration_kernel.h"
+#include "../include/status_manager.h"
+
+/**
+ * A point is considered a glitch if |z_n|^2 < GLITCH_TOLERANCE * |Z_n|^2 (Pauldelbrot's criterion).
+ * In that case, the difference d_n is of the same size as Z_n and has lost most of its significant bits.
+ */
+#define GLITCH_TOLERANCE 1e-6
+
+int compute_reference_orbit(const FixedPoint *p_c_real, const FixedPoint *p_c_imag, size_t iteration_depth, ReferenceOrbit *p_orbit) {
+    if (iteration_depth == 0) return ERROR_INVALID_ITERATION_DEPTH;
+    if (iteration_depth >= SIZE_MAX / sizeof(double)) return ERROR_ARITHMETIC_OVERFLOW;
+
+    p_orbit->z_real = (double *)malloc((iteration_depth + 1) * sizeof(double));
+    p_orbit->z_imag = (double *)malloc((iteration_depth + 1) * sizeof(double));
+    if (p_orbit->z_real == NULL || p_orbit->z_imag == NULL) {
+        free_reference_orbit(p_orbit);
+        return ERROR_MEMORY_ALLOC;
+    }
+
+    size_t num_limbs = p_c_real->num_limbs > p_c_imag->num_limbs ? p_c_real->num_limbs : p_c_imag->num_limbs;
+    FixedPoint z_real, z_imag, z_real_squared, z_imag_squared, z_real_imag;
+    double_to_fixed_point(0.0, num_limbs, &z_real);
+    double_to_fixed_point(0.0, num_limbs, &z_imag);
+
+    p_orbit->z_real[0] = 0.0;
+    p_orbit->z_imag[0] = 0.0;
+    p_orbit->length = 1;
+
+    for (size_t n = 0; n < iteration_depth; n++) {
+        multiply_fixed_point(&z_real, &z_real, &z_real_squared);
+        multiply_fixed_point(&z_imag, &z_imag, &z_imag_squared);
+        multiply_fixed_point(&z_real, &z_imag, &z_real_imag);
+
+        subtract_fixed_point(&z_real_squared, &z_imag_squared, &z_real);
+        add_fixed_point(&z_real, p_c_real, &z_real);
+        add_fixed_point(&z_real_imag, &z_real_imag, &z_imag);
+        add_fixed_point(&z_imag, p_c_imag, &z_imag);
+
+        double real = fixed_point_to_double(&z_real);
+        double imag = fixed_point_to_double(&z_imag);
+        p_orbit->z_real[n + 1] = real;
+        p_orbit->z_imag[n + 1] = imag;
+        p_orbit->length = n + 2;
+
+        // The escaped term is kept, because points close to the reference point escape at the same iteration.
+        if (real * real + imag * imag > (double)ESCAPE_RADIUS * ESCAPE_RADIUS) {
+            break;
+        }
+    }
+    return SUCCESS;
+}
+
+void free_reference_orbit(ReferenceOrbit *p_orbit) {
+    free(p_orbit->z_real);
+    free(p_orbit->z_imag);
+    p_orbit->z_real = NULL;
+    p_orbit->z_imag = NULL;
+    p_orbit->length = 0;
+}
+
+size_t iterate_perturbed_point(const ReferenceOrbit *p_orbit, double dc_real, double dc_imag, size_t iteration_depth, double *p_magnitude, bool *p_glitched) {
+    double d_real = 0.0;
+    double d_imag = 0.0;
+    *p_magnitude = 0.0;
+    *p_glitched = false;
+
+    for (size_t n = 0; n < iteration_depth; n++) {
+        if (n + 1 >= p_orbit->length) {
+            // The reference point escaped before this point.
+            *p_glitched = true;
+            return n;
+        }
+
+        double reference_real = p_orbit->z_real[n];
+        double reference_imag = p_orbit->z_imag[n];
+        double next_real = 2.0 * (reference_real * d_real - reference_imag * d_imag) + (d_real * d_real - d_imag * d_imag) + dc_real;
+        double next_imag = 2.0 * (reference_real * d_imag + reference_imag * d_real) + 2.0 * d_real * d_imag + dc_imag;
+        d_real = next_real;
+        d_imag = next_imag;
+
+        reference_real = p_orbit->z_real[n + 1];
+        reference_imag = p_orbit->z_imag[n + 1];
+        double z_real = reference_real + d_real;
+        double z_imag = reference_imag + d_imag;
+        double magnitude_squared = z_real * z_real + z_imag * z_imag;
+        *p_magnitude = sqrt(magnitude_squared);
+
+        if (magnitude_squared > (double)ESCAPE_RADIUS * ESCAPE_RADIUS) {
+            return n;
+        }
+        if (magnitude_squared < GLITCH_TOLERANCE * (reference_real * reference_real + reference_imag * reference_imag)) {
+            *p_glitched = true;
+            return n;
+        }
+    }
+    return iteration_depth;
+}
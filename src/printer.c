@@ -7,24 +7,99 @@
 #include <string.h>
 #include <sys/time.h>
 
+#include "../include/fixed_point.h"
+#include "../include/iteration_kernel.h"
 #include "../include/status_manager.h"
 
-void print_info(const char *config_path, const char *output_path, ImageSize size, Configuration p_config, double build_time) {
+void print_info(const char *config_path, const char *output_path, ImageSize size, Configuration p_config, size_t num_threads, const RenderStatistics *p_statistics, const RenderMetrics *p_metrics) {
     printf("\n\n");
     printf("> output file: %s\n", output_path);
     printf("> image size: %d x %d\n", size.width, size.height);
     printf("> configurations (%s):\n", config_path);
     printf("  - iteration depth: %d\n", p_config.iteration_depth);
-    printf("  - lower left: %lf + (%lf)i\n", p_config.viewport.lower_left.real, p_config.viewport.lower_left.imag);
-    printf("  - upper right: %lf + (%lf)i\n", p_config.viewport.upper_right.real, p_config.viewport.upper_right.imag);
+    printf("  - formula: %s, power %u", get_formula_name(p_config.formula), p_config.power);
+    if (p_config.formula == FORMULA_JULIA) {
+        printf(", c = %g + (%g)i", p_config.julia_c.real, p_config.julia_c.imag);
+    }
+    printf("\n");
+    if (p_config.deep_zoom) {
+        printf("  - center (deep zoom): %.17g + (%.17g)i\n", fixed_point_to_double(&p_config.center_real), fixed_point_to_double(&p_config.center_imag));
+        printf("  - viewport size: %g x %g\n", p_config.viewport.upper_right.real - p_config.viewport.lower_left.real,
+               p_config.viewport.upper_right.imag - p_config.viewport.lower_left.imag);
+    } else {
+        printf("  - lower left: %lf + (%lf)i\n", p_config.viewport.lower_left.real, p_config.viewport.lower_left.imag);
+        printf("  - upper right: %lf + (%lf)i\n", p_config.viewport.upper_right.real, p_config.viewport.upper_right.imag);
+    }
+    if (!p_config.deep_zoom) {
+        printf("  - interior checks: cardioid %s, bulb %s, periodicity %s\n", p_config.interior_checks & INTERIOR_CHECK_CARDIOID ? "on" : "off",
+               p_config.interior_checks & INTERIOR_CHECK_BULB ? "on" : "off", p_config.interior_checks & INTERIOR_CHECK_PERIODICITY ? "on" : "off");
+    }
     printf("  - inner color: %x\n", p_config.inner_color);
     printf("  - outer colors: ");
     for (size_t i = 0; i < p_config.num_outer_colors; i++) {
         printf("%x ", p_config.outer_colors[i]);
     }
     printf("\n");
+    printf("  - smooth coloring: %s\n", p_config.smooth_coloring ? "on" : "off");
+    if (p_config.supersampling > 1) {
+        printf("  - supersampling: %zu x %zu samples at edges (threshold %u)\n", p_config.supersampling, p_config.supersampling, p_config.supersampling_threshold);
+    }
     printf("> build information \n");
-    printf("  - build time: %.6f seconds\n", build_time);
+    printf("  - threads: %zu\n", num_threads);
+    printf("  - iteration kernel: %s\n", get_iteration_kernel_name());
+    Precision precision;
+    if (select_precision(&p_config, size.width, &precision) == SUCCESS) {
+        printf("  - precision: %s%s\n", get_precision_name(precision), p_config.precision == PRECISION_AUTO ? " (auto)" : "");
+    }
+    printf("  - render mode: %s\n", p_config.render_mode == RENDER_MODE_SUBDIVISION ? "subdivision" : "brute force");
+    printf("  - iterated pixels: %zu of %zu (%.1f%%)\n", p_statistics->num_iterated_pixels, (size_t)size.width * size.height,
+           100.0 * p_statistics->num_iterated_pixels / ((double)size.width * size.height));
+    size_t num_pixels = p_metrics->histogram.num_pixels;
+    printf("  - iterations: %llu (%.1f per pixel), interior pixels: %.1f%%\n", (unsigned long long)p_metrics->histogram.num_iterations,
+           num_pixels > 0 ? (double)p_metrics->histogram.num_iterations / num_pixels : 0.0,
+           num_pixels > 0 ? 100.0 * p_metrics->histogram.num_interior_pixels / num_pixels : 0.0);
+    printf("  - stage times (wall / cpu):\n");
+    StageTime total = {0, 0};
+    for (size_t i = 0; i < NUM_STAGES; i++) {
+        printf("    %-9s %10.6f / %10.6f seconds\n", get_stage_name((Stage)i), p_metrics->stages[i].wall_time, p_metrics->stages[i].cpu_time);
+        add_stage_time(&total, &p_metrics->stages[i]);
+    }
+    printf("    %-9s %10.6f / %10.6f seconds\n", "total", total.wall_time, total.cpu_time);
+    printf("  - bytes written: %llu\n", (unsigned long long)p_metrics->num_bytes_written);
+    if (p_statistics->num_cache_hits + p_statistics->num_cache_misses > 0) {
+        printf("  - tile cache: %zu hits, %zu misses (%.1f%%)\n", p_statistics->num_cache_hits, p_statistics->num_cache_misses,
+               100.0 * p_statistics->num_cache_hits / (double)(p_statistics->num_cache_hits + p_statistics->num_cache_misses));
+    }
+    if (p_config.supersampling > 1) {
+        printf("  - supersampled pixels: %zu (%.1f%%), %zu extra samples (%.2f per pixel)\n", p_statistics->num_supersampled_pixels,
+               100.0 * p_statistics->num_supersampled_pixels / ((double)size.width * size.height), p_statistics->num_extra_samples,
+               p_statistics->num_extra_samples / ((double)size.width * size.height));
+    }
+    if (p_statistics->num_skipped_tiles > 0) {
+        printf("  - deadline: %zu tiles of the finer passes skipped\n", p_statistics->num_skipped_tiles);
+    }
+}
+
+void print_benchmark_results(const BenchmarkResult *results, size_t num_results, const BenchmarkResult *baseline, size_t num_baseline_results, double tolerance) {
+    printf("\n\n");
+    printf("> iteration kernel: %s\n", get_iteration_kernel_name());
+    printf("  %-18s %6s %6s %7s %10s %11s %9s %9s%s\n", "scene", "width", "height", "depth", "time [s]", "Mpixels/s", "Giter/s", "RSS [MiB]",
+           baseline != NULL ? "   baseline" : "");
+    for (size_t i = 0; i < num_results; i++) {
+        const BenchmarkResult *p_result = &results[i];
+        printf("  %-18s %6zu %6zu %7zu %10.4f %11.2f %9.3f %9.1f", p_result->scene, p_result->width, p_result->height, p_result->iteration_depth,
+               p_result->wall_time, p_result->pixels_per_second / 1e6, p_result->iterations_per_second / 1e9, p_result->peak_rss / (1024.0 * 1024.0));
+        if (baseline != NULL) {
+            const BenchmarkResult *p_baseline = find_benchmark_result(p_result, baseline, num_baseline_results);
+            if (p_baseline == NULL) {
+                printf("   new");
+            } else {
+                printf("   %+6.1f%%%s", 100.0 * (p_result->wall_time / p_baseline->wall_time - 1.0),
+                       is_benchmark_regression(p_result, p_baseline, tolerance) ? " REGRESSION" : "");
+            }
+        }
+        printf("\n");
+    }
 }
 
 void print_help(const char *program_name) {
@@ -33,12 +108,49 @@ void print_help(const char *program_name) {
     printf("\n");
     printf("Description:\n");
     printf("  This program generates a Mandelbrot set image based on the given configuration file.\n");
-    printf("  The image is saved as a bmp file.\n");
+    printf("  The image is saved as a bmp, png or tiled BigTIFF file, depending on the extension of the output file.\n");
     printf("\n");
     printf("Arguments: \n");
-    printf("  <config_file>   Path to the .ini configuration file that defines viewport, colors, etc.\n");
-    printf("  <image_width>   Width of the output image in pixels (height is auto-calculated to preserve aspect ratio).\n");
-    printf("  <output_file>   Path to the output file (must end with .bmp).\n\n");
+    printf("  <config_file>               Path to the .ini configuration file that defines viewport, colors, etc.\n");
+    printf("  <image_width>               Width of the output image in pixels (height is auto-calculated to preserve aspect ratio).\n");
+    printf("  <output_file>               Path to the output file (.bmp, .png or .tif, .bmp is appended to other paths).\n");
+    printf("                              With -, the image is written to the standard output as a binary PPM image.\n");
+    printf("\n");
+    printf("Options: \n");
+    printf("  --threads <n>               Number of worker threads (default: number of processors).\n");
+    printf("  --save-field <path>         Save the iteration field of the image, so it can be shaded again with other colors.\n");
+    printf("  --memory-budget <bytes>     Render the image in bands that fit into the budget (suffix K, M or G) and write them while rendering.\n");
+    printf("  --mmap                      Write the pixels directly to the memory mapped output file.\n");
+    printf("  --cache <dir>               Load and store the iteration data of the tiles in a cache directory that may be shared by several processes.\n");
+    printf("  --cache-size <bytes>        Size limit of the cache (suffix K, M or G, default: 1G). The least recently used tiles are deleted.\n");
+    printf("  --indexed                   Save the image as a bmp file with 8 bits per pixel. The palette must have at most 256 colors.\n");
+    printf("  --rle                       Like --indexed, and compress the pixels with RLE8.\n");
+    printf("  --progressive               Render the image in passes from 1/8 to full resolution and save it after every pass.\n");
+    printf("  --deadline <seconds>        Render progressively and stop refining when the time is up. The first pass is always completed.\n");
+    printf("  --stats <path>              Save the stage times, the iteration histogram and the bytes written as a JSON file.\n");
+    printf("  --workers <host:port,...>   Compute the image on worker processes, see the worker command, and shade it locally.\n");
+    printf("\n");
+    printf("Reshading a saved iteration field: \n");
+    printf("  \"%s\" reshade <field_file> <config_file> <output_file> [<config_file> <output_file> ...]\n", program_name);
+    printf("  Every config file only needs the inner color, the outer colors and smooth_coloring (and the power if it is smooth).\n\n");
+    printf("Rendering an animation: \n");
+    printf("  \"%s\" animate [--threads <n>] [--log-polar] <config_file> <keyframe_file> <image_width> <output_prefix>\n", program_name);
+    printf("  Every line of the keyframe file holds a frame number, the center (real and imaginary part) and the width of the viewport.\n");
+    printf("  With --log-polar, all keyframes must have the same center and the frames are resampled from a single exponential map.\n");
+    printf("  With the output prefix -, the frames are written to the standard output as a YUV4MPEG2 stream.\n\n");
+    printf("Serving render jobs: \n");
+    printf("  \"%s\" daemon [--threads <n>] <socket_path>\n", program_name);
+    printf("  Clients send RENDER, STATUS, CANCEL, RESULT and SHUTDOWN commands over the Unix domain socket, see the README.\n\n");
+    printf("Computing bands for distributed renders: \n");
+    printf("  \"%s\" worker [--threads <n>] <port>\n", program_name);
+    printf("  Serves renders started with --workers on the TCP port until the process is stopped.\n\n");
+    printf("Benchmarking the renderer: \n");
+    printf("  \"%s\" bench [--threads <n>] [--repeat <n>] [--baseline <json_file>] [--tolerance <percent>] <output_json_file>\n", program_name);
+    printf("  Renders a fixed set of scenes and saves the results. With --baseline, runs slower than the baseline by more than the tolerance\n");
+    printf("  (default: 10%%) are reported as regressions.\n\n");
+    printf("Rendering a tile pyramid: \n");
+    printf("  \"%s\" pyramid [--format xyz|dzi] [--threads <n>] <config_file> <max_zoom_level> <output_path>\n", program_name);
+    printf("  Writes 256x256 tiles for the zoom levels 0 to <max_zoom_level> (at most 22). Tiles newer than the config file are kept.\n\n");
 }
 
 void print_error_message(int status) {
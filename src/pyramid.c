@@ -0,0 +1,436 @@
+#include "../include/pyramid.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+#include "../include/image_manager.h"
+#include "../include/iteration_field.h"
+#include "../include/renderer.h"
+#include "../include/shading.h"
+#include "../include/status_manager.h"
+
+/**
+ * The number of characters that a tile path may have in addition to the output path.
+ */
+#define PYRAMID_PATH_SUFFIX_LENGTH 80
+
+/**
+ * The tiles of the coarsest level that is built in parallel. Every worker should get several subtrees, so the load stays balanced.
+ */
+#define PYRAMID_SUBTREES_PER_WORKER 4
+
+/**
+ * The geometry of a zoom level of a pyramid.
+ */
+typedef struct {
+    // The size of the image of the level in pixels. Tiles of the XYZ layout may extend beyond it.
+    size_t width;
+    size_t height;
+    // The distance between two neighboring pixels in the complex plane.
+    double spacing;
+    size_t num_tiles_x;
+    size_t num_tiles_y;
+} PyramidLevel;
+
+/**
+ * The context shared by all tiles of a pyramid.
+ */
+typedef struct {
+    Configuration config;
+    PyramidFormat format;
+    const char *output_path;
+    time_t source_time;
+    PyramidLevel *levels;
+    size_t num_levels;
+    // The tiles of the levels from first_level to last_level are built. The levels are numbered from the coarsest to the finest.
+    size_t first_level;
+    size_t last_level;
+    void (*progress_callback)(double);
+    // The statistics, counted separately by every worker thread.
+    PyramidStatistics *worker_statistics;
+} PyramidContext;
+
+/**
+ * Divides a number by 2^shift and rounds the result up.
+ */
+size_t _shift_round_up(size_t value, size_t shift) {
+    return shift == 0 ? value : (value >> shift) + ((value & (((size_t)1 << shift) - 1)) != 0);
+}
+
+/**
+ * Calculates the geometry of every zoom level of a pyramid. The finest level is PYRAMID_TILE_SIZE * 2^max_zoom_level pixels wide.
+ * The XYZ layout starts with a single tile at level 0, the Deep Zoom layout starts with a single pixel.
+ *
+ * @param p_pyramid_context A pointer to the PyramidContext with the configuration and the format.
+ * @param max_zoom_level The largest zoom level.
+ * @return Status code.
+ */
+int _create_pyramid_levels(PyramidContext *p_pyramid_context, size_t max_zoom_level) {
+    ImageSize size;
+    int status = calc_image_size(p_pyramid_context->config.viewport, (size_t)PYRAMID_TILE_SIZE << max_zoom_level, &size);
+    if (status < 0) return status;
+    Viewport viewport = p_pyramid_context->config.viewport;
+    double spacing = fabs(viewport.upper_right.real - viewport.lower_left.real) / size.width;
+
+    size_t finest_level = max_zoom_level;
+    if (p_pyramid_context->format == PYRAMID_FORMAT_DZI) {
+        // The number of halvings until the longer edge of the image is a single pixel.
+        finest_level = 0;
+        while (_shift_round_up(size.width > size.height ? size.width : size.height, finest_level) > 1) {
+            finest_level++;
+        }
+    }
+
+    p_pyramid_context->num_levels = finest_level + 1;
+    p_pyramid_context->levels = (PyramidLevel *)malloc(p_pyramid_context->num_levels * sizeof(PyramidLevel));
+    if (p_pyramid_context->levels == NULL) return ERROR_MEMORY_ALLOC;
+    for (size_t level = 0; level <= finest_level; level++) {
+        PyramidLevel *p_level = &p_pyramid_context->levels[level];
+        size_t shift = finest_level - level;
+        p_level->width = _shift_round_up(size.width, shift);
+        p_level->height = _shift_round_up(size.height, shift);
+        p_level->spacing = ldexp(spacing, (int)shift);
+        p_level->num_tiles_x = (p_level->width + PYRAMID_TILE_SIZE - 1) / PYRAMID_TILE_SIZE;
+        p_level->num_tiles_y = (p_level->height + PYRAMID_TILE_SIZE - 1) / PYRAMID_TILE_SIZE;
+    }
+    return SUCCESS;
+}
+
+/**
+ * Calculates the size of a tile. Tiles of the Deep Zoom layout are cropped to the image of their level.
+ *
+ * @param p_pyramid_context A pointer to the PyramidContext.
+ * @param level The zoom level of the tile.
+ * @param x The column of the tile.
+ * @param y The row of the tile.
+ * @return The size of the tile in pixels.
+ */
+ImageSize _get_pyramid_tile_size(const PyramidContext *p_pyramid_context, size_t level, size_t x, size_t y) {
+    ImageSize size = {PYRAMID_TILE_SIZE, PYRAMID_TILE_SIZE};
+    if (p_pyramid_context->format == PYRAMID_FORMAT_DZI) {
+        const PyramidLevel *p_level = &p_pyramid_context->levels[level];
+        size.width = p_level->width - x * PYRAMID_TILE_SIZE < PYRAMID_TILE_SIZE ? p_level->width - x * PYRAMID_TILE_SIZE : PYRAMID_TILE_SIZE;
+        size.height = p_level->height - y * PYRAMID_TILE_SIZE < PYRAMID_TILE_SIZE ? p_level->height - y * PYRAMID_TILE_SIZE : PYRAMID_TILE_SIZE;
+    }
+    return size;
+}
+
+/**
+ * Builds the path of the file of a tile.
+ *
+ * @param p_pyramid_context A pointer to the PyramidContext.
+ * @param level The zoom level of the tile.
+ * @param x The column of the tile.
+ * @param y The row of the tile.
+ * @param p_p_path A pointer to store the path. Must be freed by the caller.
+ * @return Status code.
+ */
+int _get_pyramid_tile_path(const PyramidContext *p_pyramid_context, size_t level, size_t x, size_t y, char **p_p_path) {
+    size_t length = strlen(p_pyramid_context->output_path) + PYRAMID_PATH_SUFFIX_LENGTH;
+    *p_p_path = (char *)malloc(length);
+    if (*p_p_path == NULL) return ERROR_MEMORY_ALLOC;
+    if (p_pyramid_context->format == PYRAMID_FORMAT_DZI) {
+        snprintf(*p_p_path, length, "%s_files/%zu/%zu_%zu.bmp", p_pyramid_context->output_path, level, x, y);
+    } else {
+        snprintf(*p_p_path, length, "%s/%zu/%zu/%zu.bmp", p_pyramid_context->output_path, level, x, y);
+    }
+    return SUCCESS;
+}
+
+/**
+ * Creates all directories of a file path that do not exist yet. Errors are ignored, because they show up when the file is written.
+ *
+ * @param path The path of the file. It is modified temporarily.
+ */
+void _create_parent_directories(char *path) {
+    for (char *p = path + 1; *p != '\0'; p++) {
+        if (*p != '/' && *p != '\\') continue;
+        char separator = *p;
+        *p = '\0';
+#ifdef _WIN32
+        _mkdir(path);
+#else
+        mkdir(path, 0755);
+#endif
+        *p = separator;
+    }
+}
+
+/**
+ * Checks whether the file of a tile was written after the last modification of the configuration.
+ *
+ * @param p_pyramid_context A pointer to the PyramidContext.
+ * @param path The path of the file of the tile.
+ * @return True if the tile is up to date.
+ */
+bool _is_tile_up_to_date(const PyramidContext *p_pyramid_context, const char *path) {
+    struct stat file_stat;
+    return stat(path, &file_stat) == 0 && file_stat.st_mtime > p_pyramid_context->source_time;
+}
+
+/**
+ * Fills the iteration field of a tile with every second pixel of the iteration fields of the four tiles of the next zoom level
+ * that cover it. These pixels lie at the same points of the complex plane as the pixels of the tile.
+ *
+ * @param children The iteration fields of the tiles of the next level, in the order upper left, upper right, lower left, lower right.
+ *                 The iterations of a field are NULL if the tile was not built.
+ * @param p_field A pointer to the iteration field of the tile.
+ * @return True if all pixels of the tile were covered by the fields of the next level.
+ */
+bool _downsample_pyramid_tile(const IterationField *children, IterationField *p_field) {
+    for (size_t tile_y = 0; tile_y < p_field->size.height; tile_y++) {
+        for (size_t tile_x = 0; tile_x < p_field->size.width; tile_x++) {
+            // The position of the pixel in the image of the next level, relative to the upper left child.
+            size_t child_x = 2 * tile_x;
+            size_t child_y = 2 * tile_y;
+            const IterationField *p_child = &children[(child_x / PYRAMID_TILE_SIZE) + 2 * (child_y / PYRAMID_TILE_SIZE)];
+            child_x %= PYRAMID_TILE_SIZE;
+            child_y %= PYRAMID_TILE_SIZE;
+            if (p_child->iterations == NULL || child_x >= p_child->size.width || child_y >= p_child->size.height) {
+                return false;
+            }
+            size_t child_index = child_y * p_child->size.width + child_x;
+            p_field->iterations[tile_y * p_field->size.width + tile_x] = p_child->iterations[child_index];
+            p_field->magnitudes[tile_y * p_field->size.width + tile_x] = p_child->magnitudes[child_index];
+        }
+    }
+    return true;
+}
+
+/**
+ * Computes the iteration field of a tile by rendering it as an image of its own.
+ *
+ * @param p_pyramid_context A pointer to the PyramidContext.
+ * @param p_thread_pool The thread pool or NULL.
+ * @param level The zoom level of the tile.
+ * @param x The column of the tile.
+ * @param y The row of the tile.
+ * @param p_field A pointer to the iteration field of the tile.
+ * @param p_image_data A pointer to the image data of the tile.
+ * @return Status code.
+ */
+int _render_pyramid_tile(const PyramidContext *p_pyramid_context, ThreadPool *p_thread_pool, size_t level, size_t x, size_t y, IterationField *p_field,
+                         ImageData *p_image_data) {
+    const PyramidLevel *p_level = &p_pyramid_context->levels[level];
+    Configuration config = p_pyramid_context->config;
+    Viewport viewport = p_pyramid_context->config.viewport;
+    double left = viewport.lower_left.real + (double)(x * PYRAMID_TILE_SIZE) * p_level->spacing;
+    double top = viewport.upper_right.imag - (double)(y * PYRAMID_TILE_SIZE) * p_level->spacing;
+    config.viewport.lower_left.real = left;
+    config.viewport.lower_left.imag = top - (double)p_field->size.height * p_level->spacing;
+    config.viewport.upper_right.real = left + (double)p_field->size.width * p_level->spacing;
+    config.viewport.upper_right.imag = top;
+    return render_to_image(config, p_thread_pool, NULL, p_field, p_image_data, NULL, NULL);
+}
+
+/**
+ * Builds a tile and, recursively, the tiles of the finer levels up to the last level of the context below it.
+ * A tile that is up to date is skipped, otherwise it is downsampled from the tiles of the next level or rendered.
+ *
+ * @param p_pyramid_context A pointer to the PyramidContext.
+ * @param p_thread_pool The thread pool to render a tile with, or NULL.
+ * @param worker_index The index of the worker thread, which selects the statistics.
+ * @param level The zoom level of the tile.
+ * @param x The column of the tile.
+ * @param y The row of the tile.
+ * @param p_field A pointer to store the iteration field of the tile. Its iterations are NULL if the tile was skipped.
+ *                Otherwise, it must be freed by the caller.
+ * @return Status code.
+ */
+int _build_pyramid_tile(const PyramidContext *p_pyramid_context, ThreadPool *p_thread_pool, size_t worker_index, size_t level, size_t x, size_t y,
+                        IterationField *p_field) {
+    PyramidStatistics *p_statistics = &p_pyramid_context->worker_statistics[worker_index];
+    IterationField children[4];
+    memset(p_field, 0, sizeof(IterationField));
+    memset(children, 0, sizeof(children));
+    int status = SUCCESS;
+
+    bool has_children = level < p_pyramid_context->last_level;
+    if (has_children) {
+        const PyramidLevel *p_next_level = &p_pyramid_context->levels[level + 1];
+        for (size_t i = 0; i < 4 && status == SUCCESS; i++) {
+            size_t child_x = 2 * x + i % 2;
+            size_t child_y = 2 * y + i / 2;
+            if (child_x < p_next_level->num_tiles_x && child_y < p_next_level->num_tiles_y) {
+                status = _build_pyramid_tile(p_pyramid_context, p_thread_pool, worker_index, level + 1, child_x, child_y, &children[i]);
+            }
+        }
+    }
+
+    char *path = NULL;
+    if (status == SUCCESS) {
+        status = _get_pyramid_tile_path(p_pyramid_context, level, x, y, &path);
+    }
+    if (status == SUCCESS && _is_tile_up_to_date(p_pyramid_context, path)) {
+        p_statistics->num_skipped_tiles++;
+    } else if (status == SUCCESS) {
+        ImageSize size = _get_pyramid_tile_size(p_pyramid_context, level, x, y);
+        ImageData *p_image_data = NULL;
+        status = create_iteration_field(size, p_pyramid_context->config.iteration_depth, p_field);
+        if (status == SUCCESS) {
+            status = create_image_data_with_size(size, &p_image_data);
+        }
+        if (status == SUCCESS) {
+            if (has_children && _downsample_pyramid_tile(children, p_field)) {
+                status = shade_iteration_field(p_field, &p_pyramid_context->config, NULL, p_image_data);
+                p_statistics->num_downsampled_tiles++;
+            } else {
+                status = _render_pyramid_tile(p_pyramid_context, p_thread_pool, level, x, y, p_field, p_image_data);
+                p_statistics->num_rendered_tiles++;
+            }
+            if (status == SUCCESS) {
+                _create_parent_directories(path);
+                status = export_and_free(p_image_data, path);
+            } else {
+                free_image_data(p_image_data);
+            }
+        }
+        if (status != SUCCESS) {
+            free_iteration_field(p_field);
+        }
+    }
+
+    free(path);
+    for (size_t i = 0; i < 4; i++) {
+        free_iteration_field(&children[i]);
+    }
+    return status;
+}
+
+/**
+ * Builds the subtree of tiles below a tile of the first level of the context.
+ *
+ * @param task_index The index of the tile within its level, counted row by row.
+ * @param worker_index The index of the worker thread.
+ * @param p_context A pointer to the PyramidContext.
+ * @return Status code.
+ */
+int _build_pyramid_subtree(size_t task_index, size_t worker_index, void *p_context) {
+    PyramidContext *p_pyramid_context = (PyramidContext *)p_context;
+    const PyramidLevel *p_level = &p_pyramid_context->levels[p_pyramid_context->first_level];
+    IterationField field;
+    int status = _build_pyramid_tile(p_pyramid_context, NULL, worker_index, p_pyramid_context->first_level, task_index % p_level->num_tiles_x,
+                                     task_index / p_level->num_tiles_x, &field);
+    free_iteration_field(&field);
+    return status;
+}
+
+/**
+ * Converts the number of completed subtrees to the progress of the pyramid and outputs it.
+ * The subtrees cover almost the whole pyramid, only the coarse levels above them are left.
+ *
+ * @param num_completed The number of completed subtrees.
+ * @param num_tasks The total number of subtrees.
+ * @param p_context A pointer to the PyramidContext.
+ */
+void _process_pyramid_progress(size_t num_completed, size_t num_tasks, void *p_context) {
+    PyramidContext *p_pyramid_context = (PyramidContext *)p_context;
+    if (p_pyramid_context->progress_callback != NULL) {
+        p_pyramid_context->progress_callback(0.99 * (double)num_completed / (double)num_tasks);
+    }
+}
+
+/**
+ * Writes the descriptor file of a Deep Zoom image.
+ *
+ * @param p_pyramid_context A pointer to the PyramidContext.
+ * @return Status code.
+ */
+int _write_dzi_descriptor(const PyramidContext *p_pyramid_context) {
+    size_t length = strlen(p_pyramid_context->output_path) + PYRAMID_PATH_SUFFIX_LENGTH;
+    char *path = (char *)malloc(length);
+    if (path == NULL) return ERROR_MEMORY_ALLOC;
+    snprintf(path, length, "%s.dzi", p_pyramid_context->output_path);
+    FILE *file = fopen(path, "w");
+    free(path);
+    if (!file) {
+        return ERROR_FILE_ACCESS;
+    }
+
+    const PyramidLevel *p_finest_level = &p_pyramid_context->levels[p_pyramid_context->num_levels - 1];
+    fprintf(file, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    fprintf(file, "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" Format=\"bmp\" Overlap=\"0\" TileSize=\"%d\">\n", PYRAMID_TILE_SIZE);
+    fprintf(file, "  <Size Width=\"%zu\" Height=\"%zu\"/>\n", p_finest_level->width, p_finest_level->height);
+    fprintf(file, "</Image>\n");
+    if (fclose(file) != 0) {
+        return ERROR_FILE_ACCESS;
+    }
+    return SUCCESS;
+}
+
+int render_pyramid(Configuration config, ThreadPool *p_thread_pool, size_t max_zoom_level, PyramidFormat format, const char *output_path,
+                   time_t source_time, void (*progress_callback)(double), PyramidStatistics *p_statistics) {
+    if (max_zoom_level > PYRAMID_MAX_ZOOM_LEVEL) return ERROR_INVALID_ZOOM_LEVEL;
+    if (config.iteration_depth == 0) return ERROR_INVALID_ITERATION_DEPTH;
+
+    PyramidContext context;
+    memset(&context, 0, sizeof(PyramidContext));
+    context.config = config;
+    context.format = format;
+    context.output_path = output_path;
+    context.source_time = source_time;
+    context.progress_callback = progress_callback;
+    int status = _create_pyramid_levels(&context, max_zoom_level);
+    if (status < 0) return status;
+    size_t num_workers = p_thread_pool != NULL ? get_thread_pool_size(p_thread_pool) : 1;
+    context.worker_statistics = (PyramidStatistics *)calloc(num_workers, sizeof(PyramidStatistics));
+    if (context.worker_statistics == NULL) {
+        free(context.levels);
+        return ERROR_MEMORY_ALLOC;
+    }
+
+    // The subtrees below the first level with enough tiles are built in parallel, every worker builds its subtrees on its own.
+    size_t subtree_level = 0;
+    while (subtree_level + 1 < context.num_levels &&
+           context.levels[subtree_level].num_tiles_x * context.levels[subtree_level].num_tiles_y < PYRAMID_SUBTREES_PER_WORKER * num_workers) {
+        subtree_level++;
+    }
+    const PyramidLevel *p_subtree_level = &context.levels[subtree_level];
+    size_t num_subtrees = p_subtree_level->num_tiles_x * p_subtree_level->num_tiles_y;
+    context.first_level = subtree_level;
+    context.last_level = context.num_levels - 1;
+    if (p_thread_pool != NULL) {
+        status = run_thread_pool(p_thread_pool, num_subtrees, _build_pyramid_subtree, &context, _process_pyramid_progress);
+    } else {
+        for (size_t i = 0; i < num_subtrees && status == SUCCESS; i++) {
+            status = _build_pyramid_subtree(i, 0, &context);
+            _process_pyramid_progress(i + 1, num_subtrees, &context);
+        }
+    }
+
+    // The few tiles of the coarse levels above the subtrees are rendered one after another, every tile on the whole thread pool.
+    // Their iteration fields would have to be kept for all subtrees, so they are not downsampled from the first level of the subtrees.
+    if (status == SUCCESS && subtree_level > 0) {
+        context.first_level = 0;
+        context.last_level = subtree_level - 1;
+        IterationField field;
+        status = _build_pyramid_tile(&context, p_thread_pool, 0, 0, 0, 0, &field);
+        free_iteration_field(&field);
+    }
+    if (status == SUCCESS && format == PYRAMID_FORMAT_DZI) {
+        status = _write_dzi_descriptor(&context);
+    }
+
+    if (p_statistics != NULL) {
+        memset(p_statistics, 0, sizeof(PyramidStatistics));
+        for (size_t i = 0; i < num_workers; i++) {
+            p_statistics->num_rendered_tiles += context.worker_statistics[i].num_rendered_tiles;
+            p_statistics->num_downsampled_tiles += context.worker_statistics[i].num_downsampled_tiles;
+            p_statistics->num_skipped_tiles += context.worker_statistics[i].num_skipped_tiles;
+        }
+    }
+    free(context.worker_statistics);
+    free(context.levels);
+    if (status == SUCCESS && progress_callback != NULL) {
+        progress_callback(1.0);
+    }
+    return status;
+}
@@ -0,0 +1,143 @@
+#include "../include/raw_stream.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "../include/status_manager.h"
+
+/**
+ * The size of the buffer of the stream to the standard output. Pipes are drained in chunks of at most a few pages,
+ * so a large buffer mainly saves system calls for the small writes of the headers.
+ */
+#define RAW_STREAM_BUFFER_SIZE (4 * 1024 * 1024)
+
+/**
+ * The number of bytes of converted rows that are written to the stream with a single call.
+ */
+#define RAW_CHUNK_SIZE (1024 * 1024)
+
+bool is_stdout_path(const char *path) {
+    return strcmp(path, STDOUT_PATH) == 0;
+}
+
+int open_stdout_stream(FILE **p_stream) {
+    // The image data gets a duplicate of the standard output, and the standard output itself is pointed at the standard error.
+    fflush(stdout);
+#ifdef _WIN32
+    int fd = _dup(_fileno(stdout));
+    if (fd < 0 || _dup2(_fileno(stderr), _fileno(stdout)) != 0) return ERROR_FILE_ACCESS;
+    _setmode(fd, _O_BINARY);
+    FILE *stream = _fdopen(fd, "wb");
+#else
+    int fd = dup(STDOUT_FILENO);
+    if (fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) return ERROR_FILE_ACCESS;
+    FILE *stream = fdopen(fd, "wb");
+#endif
+    if (stream == NULL) return ERROR_FILE_ACCESS;
+    setvbuf(stream, NULL, _IOFBF, RAW_STREAM_BUFFER_SIZE);
+    *p_stream = stream;
+    return SUCCESS;
+}
+
+int write_ppm(FILE *stream, const ImageData *p_image_data, uint64_t *p_num_bytes_written) {
+    ImageSize size = p_image_data->size;
+    int header_length = fprintf(stream, "P6\n%zu %zu\n255\n", size.width, size.height);
+    if (header_length < 0) return ERROR_FILE_ACCESS;
+
+    // The rows of the image data are stored from the bottom to the top in blue, green, red, so they are converted before they are written.
+    size_t row_size = 3 * size.width;
+    size_t rows_per_chunk = RAW_CHUNK_SIZE / row_size > 0 ? RAW_CHUNK_SIZE / row_size : 1;
+    if (rows_per_chunk > size.height) {
+        rows_per_chunk = size.height;
+    }
+    unsigned char *chunk = (unsigned char *)malloc(rows_per_chunk * row_size);
+    if (chunk == NULL) return ERROR_MEMORY_ALLOC;
+
+    int status = SUCCESS;
+    for (size_t first_row = 0; first_row < size.height && status == SUCCESS; first_row += rows_per_chunk) {
+        size_t num_rows = size.height - first_row < rows_per_chunk ? size.height - first_row : rows_per_chunk;
+        for (size_t row = 0; row < num_rows; row++) {
+            const unsigned char *p_source = get_row_in_image_data(p_image_data, first_row + row);
+            unsigned char *p_destination = chunk + row * row_size;
+            for (size_t x = 0; x < size.width; x++) {
+                p_destination[3 * x] = p_source[3 * x + 2];
+                p_destination[3 * x + 1] = p_source[3 * x + 1];
+                p_destination[3 * x + 2] = p_source[3 * x];
+            }
+        }
+        if (fwrite(chunk, 1, num_rows * row_size, stream) != num_rows * row_size) {
+            status = ERROR_FILE_ACCESS;
+        }
+    }
+    free(chunk);
+    if (status == SUCCESS && p_num_bytes_written != NULL) {
+        *p_num_bytes_written = (uint64_t)header_length + (uint64_t)row_size * size.height;
+    }
+    return status;
+}
+
+int write_y4m_header(FILE *stream, ImageSize size) {
+    // Progressive frames with square pixels and chroma sited at the center of every 2 x 2 block, which is where the mean of the block lies.
+    if (fprintf(stream, "YUV4MPEG2 W%zu H%zu F%d:1 Ip A1:1 C420jpeg\n", size.width, size.height, Y4M_FRAME_RATE) < 0) {
+        return ERROR_FILE_ACCESS;
+    }
+    return SUCCESS;
+}
+
+int write_y4m_frame(FILE *stream, const ImageData *p_image_data) {
+    ImageSize size = p_image_data->size;
+    size_t chroma_width = (size.width + 1) / 2;
+    size_t chroma_height = (size.height + 1) / 2;
+    size_t luma_size = size.width * size.height;
+    size_t chroma_size = chroma_width * chroma_height;
+    unsigned char *planes = (unsigned char *)malloc(luma_size + 2 * chroma_size);
+    if (planes == NULL) return ERROR_MEMORY_ALLOC;
+    unsigned char *p_luma = planes;
+    unsigned char *p_blue_difference = planes + luma_size;
+    unsigned char *p_red_difference = p_blue_difference + chroma_size;
+
+    // The integer approximation of BT.601 with 8 bit precision. The offsets of 128 << 8 keep the sums positive before they are shifted.
+    for (size_t y = 0; y < size.height; y++) {
+        const unsigned char *p_row = get_row_in_image_data(p_image_data, y);
+        for (size_t x = 0; x < size.width; x++) {
+            int blue = p_row[3 * x];
+            int green = p_row[3 * x + 1];
+            int red = p_row[3 * x + 2];
+            p_luma[y * size.width + x] = (unsigned char)(((66 * red + 129 * green + 25 * blue + 128) >> 8) + 16);
+        }
+    }
+    for (size_t chroma_y = 0; chroma_y < chroma_height; chroma_y++) {
+        // The last row and column of an image with an odd size form blocks of their own.
+        const unsigned char *p_upper_row = get_row_in_image_data(p_image_data, 2 * chroma_y);
+        const unsigned char *p_lower_row = 2 * chroma_y + 1 < size.height ? get_row_in_image_data(p_image_data, 2 * chroma_y + 1) : NULL;
+        for (size_t chroma_x = 0; chroma_x < chroma_width; chroma_x++) {
+            int sums[3] = {0, 0, 0};
+            int count = 0;
+            for (size_t x = 2 * chroma_x; x < 2 * chroma_x + 2 && x < size.width; x++) {
+                for (int channel = 0; channel < 3; channel++) {
+                    sums[channel] += p_upper_row[3 * x + channel] + (p_lower_row != NULL ? p_lower_row[3 * x + channel] : 0);
+                }
+                count += p_lower_row != NULL ? 2 : 1;
+            }
+            int blue = (sums[0] + count / 2) / count;
+            int green = (sums[1] + count / 2) / count;
+            int red = (sums[2] + count / 2) / count;
+            p_blue_difference[chroma_y * chroma_width + chroma_x] = (unsigned char)((-38 * red - 74 * green + 112 * blue + 128 + (128 << 8)) >> 8);
+            p_red_difference[chroma_y * chroma_width + chroma_x] = (unsigned char)((112 * red - 94 * green - 18 * blue + 128 + (128 << 8)) >> 8);
+        }
+    }
+
+    int status = SUCCESS;
+    if (fputs("FRAME\n", stream) < 0 || fwrite(planes, 1, luma_size + 2 * chroma_size, stream) != luma_size + 2 * chroma_size) {
+        status = ERROR_FILE_ACCESS;
+    }
+    free(planes);
+    return status;
+}
@@ -0,0 +1,757 @@
+#include "../include/render_daemon.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <signal.h>
+#endif
+
+#include "../include/config.h"
+#include "../include/image_manager.h"
+#include "../include/image_writer.h"
+#include "../include/input_parser.h"
+#include "../include/iteration_field.h"
+#include "../include/status_manager.h"
+
+/**
+ * The output path of a job whose image is kept in memory until it is fetched.
+ */
+#define INLINE_OUTPUT "-"
+
+/**
+ * The characters that separate the arguments of a command.
+ */
+#define ARGUMENT_SEPARATORS " \t"
+
+/**
+ * The state of a job. Done, cancelled and failed jobs are finished.
+ */
+typedef enum {
+    JOB_QUEUED,
+    JOB_RUNNING,
+    JOB_DONE,
+    JOB_CANCELLED,
+    JOB_FAILED
+} JobState;
+
+/**
+ * Image data whose pixel buffer may be larger than the image, because it was allocated for a larger image of an earlier job.
+ */
+typedef struct {
+    ImageData *p_image_data;
+    // The size of the pixel buffer in bytes.
+    size_t capacity;
+} PooledImage;
+
+/**
+ * A render job. All jobs are kept in a list that is ordered by their ids, which increase in the order the jobs were submitted.
+ */
+typedef struct Job {
+    size_t id;
+    long priority;
+    Configuration config;
+    size_t image_width;
+    // The path of the image file, whose extension gives its format, or NULL if the image is kept in memory until it is fetched.
+    char *output_path;
+    JobState state;
+    // The progress of a running job between 0 and 1.
+    double progress;
+    // The status code of a failed job.
+    int status;
+    bool cancel_requested;
+    // The image of a done job without output path, or NULL.
+    PooledImage image;
+    struct Job *p_next;
+} Job;
+
+/**
+ * The state of the daemon, which is shared by the thread that accepts the clients, the threads that serve them
+ * and the dispatcher thread that renders the jobs.
+ */
+typedef struct {
+    Listener *p_listener;
+    ThreadPool *p_thread_pool;
+    // Serializes parse_ini_string, because the input parser uses strtok, which keeps its state in a global variable.
+    pthread_mutex_t parser_lock;
+    // Protects all members below, except for the iteration field.
+    pthread_mutex_t lock;
+    // Signaled when a job is submitted or changes its state, a client disconnects or the daemon shuts down.
+    pthread_cond_t changed;
+    Job *p_first_job;
+    Job *p_last_job;
+    size_t next_job_id;
+    size_t num_finished_jobs;
+    bool shutting_down;
+    // The image buffers of finished jobs that can be reused.
+    PooledImage free_images[DAEMON_MAX_POOLED_IMAGES];
+    size_t num_free_images;
+    // The connections of the clients that are being served.
+    Connection **connections;
+    size_t num_connections;
+    size_t connections_capacity;
+
+    // The iteration field of a band and the number of pixels it can hold. Only used by the dispatcher thread.
+    IterationField field;
+    size_t field_capacity;
+} RenderDaemon;
+
+/**
+ * The argument of a thread that serves a client.
+ */
+typedef struct {
+    RenderDaemon *p_daemon;
+    Connection *p_connection;
+} Client;
+
+/**
+ * Splits the next argument off a command line. Unlike strtok, this does not keep any state between calls,
+ * so the threads of several clients can split their commands at the same time.
+ *
+ * @param p_p_rest A pointer to the rest of the line, which is advanced behind the argument.
+ * @return The argument, or NULL if there are no more arguments.
+ */
+char *_next_argument(char **p_p_rest) {
+    char *argument = *p_p_rest + strspn(*p_p_rest, ARGUMENT_SEPARATORS);
+    if (*argument == 0) return NULL;
+    char *end = argument + strcspn(argument, ARGUMENT_SEPARATORS);
+    *p_p_rest = end;
+    if (*end != 0) {
+        *end = 0;
+        (*p_p_rest)++;
+    }
+    return argument;
+}
+
+/**
+ * Parses a job id.
+ *
+ * @param token The job id as a string, or NULL.
+ * @param p_id A pointer to store the job id.
+ * @return Status code.
+ */
+int _parse_job_id(const char *token, size_t *p_id) {
+    if (token == NULL) return ERROR_INVALID_DAEMON_COMMAND;
+    char *end;
+    unsigned long long id = strtoull(token, &end, 10);
+    if (end == token || *end != 0 || id > SIZE_MAX) return ERROR_UNKNOWN_JOB;
+    *p_id = (size_t)id;
+    return SUCCESS;
+}
+
+/**
+ * Finds a job by its id. The lock must be held.
+ *
+ * @param p_daemon A pointer to the daemon.
+ * @param id The id of the job.
+ * @return A pointer to the job, or NULL if there is no such job.
+ */
+Job *_find_job(RenderDaemon *p_daemon, size_t id) {
+    for (Job *p_job = p_daemon->p_first_job; p_job != NULL; p_job = p_job->p_next) {
+        if (p_job->id == id) return p_job;
+    }
+    return NULL;
+}
+
+/**
+ * Takes the smallest free image buffer that is large enough for an image. The lock must be held.
+ *
+ * @param p_daemon A pointer to the daemon.
+ * @param size The size of the image in pixels.
+ * @param p_image A pointer to store the image. Its image data is NULL if no buffer is large enough.
+ */
+void _take_pooled_image(RenderDaemon *p_daemon, ImageSize size, PooledImage *p_image) {
+    size_t stride = get_bmp_row_size(size.width);
+    size_t needed = stride * size.height;
+    size_t best = p_daemon->num_free_images;
+    for (size_t i = 0; i < p_daemon->num_free_images; i++) {
+        if (p_daemon->free_images[i].capacity >= needed &&
+            (best == p_daemon->num_free_images || p_daemon->free_images[i].capacity < p_daemon->free_images[best].capacity)) {
+            best = i;
+        }
+    }
+    memset(p_image, 0, sizeof(PooledImage));
+    if (best == p_daemon->num_free_images) return;
+
+    *p_image = p_daemon->free_images[best];
+    p_daemon->free_images[best] = p_daemon->free_images[--p_daemon->num_free_images];
+    p_image->p_image_data->size = size;
+    p_image->p_image_data->stride = stride;
+}
+
+/**
+ * Returns an image buffer to the pool. If the pool is full, the smallest buffer is freed. The lock must be held.
+ *
+ * @param p_daemon A pointer to the daemon.
+ * @param image The image, or an image whose image data is NULL.
+ */
+void _return_pooled_image(RenderDaemon *p_daemon, PooledImage image) {
+    if (image.p_image_data == NULL) return;
+    if (p_daemon->num_free_images < DAEMON_MAX_POOLED_IMAGES) {
+        p_daemon->free_images[p_daemon->num_free_images++] = image;
+        return;
+    }
+    size_t smallest = 0;
+    for (size_t i = 1; i < p_daemon->num_free_images; i++) {
+        if (p_daemon->free_images[i].capacity < p_daemon->free_images[smallest].capacity) smallest = i;
+    }
+    if (p_daemon->free_images[smallest].capacity < image.capacity) {
+        PooledImage swapped = p_daemon->free_images[smallest];
+        p_daemon->free_images[smallest] = image;
+        image = swapped;
+    }
+    free_image_data(image.p_image_data);
+}
+
+/**
+ * Removes a job from the list and frees it. The lock must be held.
+ *
+ * @param p_daemon A pointer to the daemon.
+ * @param p_job A pointer to the job. Must be finished.
+ */
+void _remove_job(RenderDaemon *p_daemon, Job *p_job) {
+    Job *p_previous = NULL;
+    for (Job *p_other = p_daemon->p_first_job; p_other != p_job; p_other = p_other->p_next) {
+        p_previous = p_other;
+    }
+    if (p_previous != NULL) {
+        p_previous->p_next = p_job->p_next;
+    } else {
+        p_daemon->p_first_job = p_job->p_next;
+    }
+    if (p_daemon->p_last_job == p_job) {
+        p_daemon->p_last_job = p_previous;
+    }
+    p_daemon->num_finished_jobs--;
+    _return_pooled_image(p_daemon, p_job->image);
+    free(p_job->output_path);
+    free(p_job);
+}
+
+/**
+ * Marks a job as finished, frees its configuration and forgets the oldest finished jobs if there are too many. The lock must be held.
+ *
+ * @param p_daemon A pointer to the daemon.
+ * @param p_job A pointer to the job.
+ * @param state The final state of the job.
+ * @param status The status code of a failed job.
+ */
+void _finish_job(RenderDaemon *p_daemon, Job *p_job, JobState state, int status) {
+    p_job->state = state;
+    p_job->status = status;
+    free_configuration(&p_job->config);
+    p_daemon->num_finished_jobs++;
+
+    Job *p_oldest = p_daemon->p_first_job;
+    while (p_daemon->num_finished_jobs > DAEMON_MAX_FINISHED_JOBS) {
+        while (p_oldest->state == JOB_QUEUED || p_oldest->state == JOB_RUNNING) {
+            p_oldest = p_oldest->p_next;
+        }
+        Job *p_next = p_oldest->p_next;
+        _remove_job(p_daemon, p_oldest);
+        p_oldest = p_next;
+    }
+    pthread_cond_broadcast(&p_daemon->changed);
+}
+
+/**
+ * Cancels all queued jobs and makes the running job stop after its current band. The lock must be held.
+ *
+ * @param p_daemon A pointer to the daemon.
+ */
+void _cancel_all_jobs(RenderDaemon *p_daemon) {
+    Job *p_job = p_daemon->p_first_job;
+    while (p_job != NULL) {
+        // Finishing a job may forget older jobs, but never the ones after it.
+        Job *p_next = p_job->p_next;
+        p_job->cancel_requested = true;
+        if (p_job->state == JOB_QUEUED) {
+            _finish_job(p_daemon, p_job, JOB_CANCELLED, SUCCESS);
+        }
+        p_job = p_next;
+    }
+}
+
+/**
+ * Renders the image of a job band by band into a buffer from the pool. Between two bands, the progress of the job is updated
+ * and the job stops if it was cancelled.
+ *
+ * @param p_daemon A pointer to the daemon.
+ * @param p_job A pointer to the running job.
+ * @param p_image A pointer to store the rendered image. Its image data is NULL if the job failed or was cancelled.
+ * @param p_cancelled A pointer to store whether the job was cancelled.
+ * @return Status code.
+ */
+int _render_job(RenderDaemon *p_daemon, Job *p_job, PooledImage *p_image, bool *p_cancelled) {
+    const Configuration *p_config = &p_job->config;
+    ImageSize size;
+    *p_cancelled = false;
+    memset(p_image, 0, sizeof(PooledImage));
+    int status = calc_image_size(p_config->viewport, p_job->image_width, &size);
+    if (status != SUCCESS) return status;
+
+    // The iteration field is reused by all jobs whose bands fit into it.
+    size_t band_height = size.height < DAEMON_BAND_HEIGHT ? size.height : DAEMON_BAND_HEIGHT;
+    if (p_config->iteration_depth > UINT32_MAX) return ERROR_INVALID_ITERATION_DEPTH;
+    if (size.width > SIZE_MAX / band_height) return ERROR_ARITHMETIC_OVERFLOW;
+    if (p_daemon->field_capacity < size.width * band_height) {
+        free_iteration_field(&p_daemon->field);
+        p_daemon->field_capacity = 0;
+        ImageSize field_size = {size.width, band_height};
+        status = create_iteration_field(field_size, p_config->iteration_depth, &p_daemon->field);
+        if (status != SUCCESS) return status;
+        p_daemon->field_capacity = size.width * band_height;
+    }
+    p_daemon->field.iteration_depth = p_config->iteration_depth;
+
+    pthread_mutex_lock(&p_daemon->lock);
+    _take_pooled_image(p_daemon, size, p_image);
+    pthread_mutex_unlock(&p_daemon->lock);
+    if (p_image->p_image_data == NULL) {
+        status = create_image_data_with_size(size, &p_image->p_image_data);
+        if (status != SUCCESS) return status;
+        p_image->capacity = p_image->p_image_data->stride * size.height;
+    }
+
+    for (size_t first_row = 0; first_row < size.height && status == SUCCESS && !*p_cancelled; first_row += band_height) {
+        size_t num_rows = size.height - first_row < band_height ? size.height - first_row : band_height;
+        // The rows of a band are stored from the bottom to the top, so its image data starts at the last row of the band.
+        ImageData band;
+        memset(&band, 0, sizeof(ImageData));
+        band.size.width = size.width;
+        band.size.height = num_rows;
+        band.data = get_row_in_image_data(p_image->p_image_data, first_row + num_rows - 1);
+        band.stride = p_image->p_image_data->stride;
+        p_daemon->field.size = band.size;
+        status = render_band_to_image(*p_config, p_daemon->p_thread_pool, NULL, first_row, &p_daemon->field, &band, NULL, 0.0, 1.0, NULL);
+
+        pthread_mutex_lock(&p_daemon->lock);
+        p_job->progress = (double)(first_row + num_rows) / (double)size.height;
+        *p_cancelled = p_job->cancel_requested;
+        pthread_mutex_unlock(&p_daemon->lock);
+    }
+
+    if (status == SUCCESS && !*p_cancelled && p_job->output_path != NULL) {
+        status = save_image(p_job->output_path, p_image->p_image_data, p_daemon->p_thread_pool, NULL);
+    }
+    if (status != SUCCESS || *p_cancelled || p_job->output_path != NULL) {
+        pthread_mutex_lock(&p_daemon->lock);
+        _return_pooled_image(p_daemon, *p_image);
+        pthread_mutex_unlock(&p_daemon->lock);
+        memset(p_image, 0, sizeof(PooledImage));
+    }
+    return status;
+}
+
+/**
+ * The main function of the dispatcher thread. Renders the queued jobs one after another until the daemon shuts down.
+ *
+ * @param p_argument A pointer to the RenderDaemon.
+ * @return NULL.
+ */
+void *_run_dispatcher(void *p_argument) {
+    RenderDaemon *p_daemon = (RenderDaemon *)p_argument;
+    pthread_mutex_lock(&p_daemon->lock);
+    while (true) {
+        // The queued job with the highest priority, and the oldest one of those with the same priority.
+        Job *p_next_job = NULL;
+        for (Job *p_job = p_daemon->p_first_job; p_job != NULL; p_job = p_job->p_next) {
+            if (p_job->state == JOB_QUEUED && (p_next_job == NULL || p_job->priority > p_next_job->priority)) {
+                p_next_job = p_job;
+            }
+        }
+        if (p_next_job == NULL) {
+            if (p_daemon->shutting_down) break;
+            pthread_cond_wait(&p_daemon->changed, &p_daemon->lock);
+            continue;
+        }
+        p_next_job->state = JOB_RUNNING;
+        pthread_cond_broadcast(&p_daemon->changed);
+        pthread_mutex_unlock(&p_daemon->lock);
+
+        PooledImage image;
+        bool cancelled;
+        int status = _render_job(p_daemon, p_next_job, &image, &cancelled);
+
+        pthread_mutex_lock(&p_daemon->lock);
+        p_next_job->image = image;
+        if (status != SUCCESS) {
+            _finish_job(p_daemon, p_next_job, JOB_FAILED, status);
+        } else {
+            _finish_job(p_daemon, p_next_job, cancelled ? JOB_CANCELLED : JOB_DONE, SUCCESS);
+        }
+    }
+    pthread_mutex_unlock(&p_daemon->lock);
+    return NULL;
+}
+
+/**
+ * Handles the RENDER command: reads the configuration that follows the command and queues the job.
+ *
+ * @param p_daemon A pointer to the daemon.
+ * @param p_connection A pointer to the connection of the client.
+ * @param arguments The arguments of the command.
+ * @return Status code.
+ */
+int _submit_job(RenderDaemon *p_daemon, Connection *p_connection, char *arguments) {
+    // The configuration is read first, so the next command is read correctly even if the arguments are invalid.
+    char *text;
+    int status = read_configuration_text(p_connection, &text);
+    if (status != SUCCESS) return status;
+
+    Job *p_job = (Job *)calloc(1, sizeof(Job));
+    if (p_job == NULL) {
+        free(text);
+        return ERROR_MEMORY_ALLOC;
+    }
+    char *priority = _next_argument(&arguments);
+    char *image_width = _next_argument(&arguments);
+    // The output path is the rest of the line, so it may contain spaces.
+    char *output_path = arguments + strspn(arguments, ARGUMENT_SEPARATORS);
+    char *end = NULL;
+    if (priority != NULL) {
+        p_job->priority = strtol(priority, &end, 10);
+    }
+    if (priority == NULL || *end != 0 || image_width == NULL || *output_path == 0) {
+        status = ERROR_INVALID_DAEMON_COMMAND;
+    } else {
+        status = parse_image_width(image_width, &p_job->image_width);
+    }
+    if (status == SUCCESS) {
+        pthread_mutex_lock(&p_daemon->parser_lock);
+        status = parse_ini_string(text, &p_job->config);
+        pthread_mutex_unlock(&p_daemon->parser_lock);
+    }
+    free(text);
+
+    // The size is checked now, so the client gets the error right away.
+    ImageSize size;
+    if (status == SUCCESS) {
+        status = calc_image_size(p_job->config.viewport, p_job->image_width, &size);
+        if (status == SUCCESS && strcmp(output_path, INLINE_OUTPUT) != 0) {
+            p_job->output_path = (char *)malloc(strlen(output_path) + 1);
+            if (p_job->output_path == NULL) {
+                status = ERROR_MEMORY_ALLOC;
+            } else {
+                strcpy(p_job->output_path, output_path);
+            }
+        }
+        if (status != SUCCESS) {
+            free_configuration(&p_job->config);
+        }
+    }
+    if (status != SUCCESS) {
+        free(p_job->output_path);
+        free(p_job);
+        return status;
+    }
+
+    pthread_mutex_lock(&p_daemon->lock);
+    if (p_daemon->shutting_down) {
+        pthread_mutex_unlock(&p_daemon->lock);
+        free_configuration(&p_job->config);
+        free(p_job->output_path);
+        free(p_job);
+        return ERROR_INVALID_DAEMON_COMMAND;
+    }
+    p_job->id = ++p_daemon->next_job_id;
+    p_job->state = JOB_QUEUED;
+    if (p_daemon->p_last_job != NULL) {
+        p_daemon->p_last_job->p_next = p_job;
+    } else {
+        p_daemon->p_first_job = p_job;
+    }
+    p_daemon->p_last_job = p_job;
+    size_t id = p_job->id;
+    pthread_cond_broadcast(&p_daemon->changed);
+    pthread_mutex_unlock(&p_daemon->lock);
+    return write_line(p_connection, "OK %zu", id);
+}
+
+/**
+ * Formats the answer to a STATUS command, or to a RESULT command of a job whose image is written to a file. The lock must be held.
+ *
+ * @param p_job A pointer to the job.
+ * @param with_path Whether the output path of a done job is added.
+ * @return The answer, allocated with malloc, or NULL if the memory could not be allocated.
+ */
+char *_format_job_state(const Job *p_job, bool with_path) {
+    const char *detail = "";
+    if (p_job->state == JOB_FAILED) {
+        detail = get_status_message(p_job->status);
+    } else if (p_job->state == JOB_DONE && with_path && p_job->output_path != NULL) {
+        detail = p_job->output_path;
+    }
+    size_t length = strlen(detail) + 32;
+    char *answer = (char *)malloc(length);
+    if (answer == NULL) return NULL;
+
+    switch (p_job->state) {
+        case JOB_QUEUED:
+            snprintf(answer, length, "QUEUED");
+            break;
+        case JOB_RUNNING:
+            snprintf(answer, length, "RUNNING %.1f", 100.0 * p_job->progress);
+            break;
+        case JOB_DONE:
+            if (*detail != 0) {
+                snprintf(answer, length, "DONE %s", detail);
+            } else {
+                snprintf(answer, length, "DONE");
+            }
+            break;
+        case JOB_CANCELLED:
+            snprintf(answer, length, "CANCELLED");
+            break;
+        case JOB_FAILED:
+            snprintf(answer, length, "FAILED %s", detail);
+            break;
+    }
+    return answer;
+}
+
+/**
+ * Handles the STATUS, CANCEL and RESULT commands.
+ *
+ * @param p_daemon A pointer to the daemon.
+ * @param p_connection A pointer to the connection of the client.
+ * @param command The command.
+ * @param argument The job id.
+ * @return Status code.
+ */
+int _handle_job_command(RenderDaemon *p_daemon, Connection *p_connection, const char *command, const char *argument) {
+    size_t id;
+    int status = _parse_job_id(argument, &id);
+    if (status != SUCCESS) return status;
+
+    pthread_mutex_lock(&p_daemon->lock);
+    Job *p_job = _find_job(p_daemon, id);
+    if (p_job != NULL && strcmp(command, "CANCEL") == 0) {
+        p_job->cancel_requested = true;
+        if (p_job->state == JOB_QUEUED) {
+            _finish_job(p_daemon, p_job, JOB_CANCELLED, SUCCESS);
+        }
+        pthread_mutex_unlock(&p_daemon->lock);
+        return write_line(p_connection, "OK");
+    }
+    if (strcmp(command, "RESULT") == 0) {
+        // The job may be forgotten while waiting, so it is looked up again after every change.
+        while (p_job != NULL && (p_job->state == JOB_QUEUED || p_job->state == JOB_RUNNING)) {
+            pthread_cond_wait(&p_daemon->changed, &p_daemon->lock);
+            p_job = _find_job(p_daemon, id);
+        }
+    }
+    if (p_job == NULL) {
+        pthread_mutex_unlock(&p_daemon->lock);
+        return ERROR_UNKNOWN_JOB;
+    }
+
+    if (strcmp(command, "RESULT") == 0 && p_job->state == JOB_DONE && p_job->output_path == NULL) {
+        // The image is taken from the job and the job is forgotten, so the image is only sent once.
+        PooledImage image = p_job->image;
+        memset(&p_job->image, 0, sizeof(PooledImage));
+        _remove_job(p_daemon, p_job);
+        pthread_mutex_unlock(&p_daemon->lock);
+
+        BitmapFileHeader file_header;
+        BitmapInfoHeader info_header;
+        uint64_t file_size;
+        status = build_bmp_header(image.p_image_data->size, &file_header, &info_header, &file_size);
+        if (status == SUCCESS) {
+            status = write_line(p_connection, "DATA %llu", (unsigned long long)file_size);
+        }
+        if (status == SUCCESS) {
+            status = write_bytes(p_connection, &file_header, sizeof(BitmapFileHeader));
+        }
+        if (status == SUCCESS) {
+            status = write_bytes(p_connection, &info_header, sizeof(BitmapInfoHeader));
+        }
+        if (status == SUCCESS) {
+            status = write_bytes(p_connection, image.p_image_data->data, image.p_image_data->stride * image.p_image_data->size.height);
+        }
+        pthread_mutex_lock(&p_daemon->lock);
+        _return_pooled_image(p_daemon, image);
+        pthread_mutex_unlock(&p_daemon->lock);
+        return status;
+    }
+
+    char *answer = _format_job_state(p_job, strcmp(command, "RESULT") == 0);
+    pthread_mutex_unlock(&p_daemon->lock);
+    if (answer == NULL) return ERROR_MEMORY_ALLOC;
+    status = write_line(p_connection, "%s", answer);
+    free(answer);
+    return status;
+}
+
+/**
+ * Handles a single command of a client.
+ *
+ * @param p_daemon A pointer to the daemon.
+ * @param p_connection A pointer to the connection of the client.
+ * @param line The line of the command. It is modified by the parser.
+ * @return Status code.
+ */
+int _handle_command(RenderDaemon *p_daemon, Connection *p_connection, char *line) {
+    char *command = _next_argument(&line);
+    if (command == NULL) return ERROR_INVALID_DAEMON_COMMAND;
+    if (strcmp(command, "RENDER") == 0) {
+        return _submit_job(p_daemon, p_connection, line);
+    }
+    if (strcmp(command, "STATUS") == 0 || strcmp(command, "CANCEL") == 0 || strcmp(command, "RESULT") == 0) {
+        return _handle_job_command(p_daemon, p_connection, command, _next_argument(&line));
+    }
+    if (strcmp(command, "SHUTDOWN") == 0) {
+        pthread_mutex_lock(&p_daemon->lock);
+        p_daemon->shutting_down = true;
+        _cancel_all_jobs(p_daemon);
+        pthread_cond_broadcast(&p_daemon->changed);
+        pthread_mutex_unlock(&p_daemon->lock);
+        interrupt_listener(p_daemon->p_listener);
+        return write_line(p_connection, "OK");
+    }
+    return ERROR_INVALID_DAEMON_COMMAND;
+}
+
+/**
+ * The main function of a thread that serves a client. Handles its commands until it disconnects.
+ *
+ * @param p_argument A pointer to the Client, which is freed by the thread.
+ * @return NULL.
+ */
+void *_serve_client(void *p_argument) {
+    Client client = *(Client *)p_argument;
+    free(p_argument);
+    RenderDaemon *p_daemon = client.p_daemon;
+    char *line = NULL;
+    size_t capacity = 0;
+
+    while (read_line(client.p_connection, &line, &capacity) > 0) {
+        int status = _handle_command(p_daemon, client.p_connection, line);
+        if (status == ERROR_SOCKET) break;
+        // Errors of a command are sent to the client, which can go on with the next command.
+        if (status < 0 && write_line(client.p_connection, "ERROR %s", get_status_message(status)) != SUCCESS) break;
+    }
+    free(line);
+
+    pthread_mutex_lock(&p_daemon->lock);
+    for (size_t i = 0; i < p_daemon->num_connections; i++) {
+        if (p_daemon->connections[i] == client.p_connection) {
+            p_daemon->connections[i] = p_daemon->connections[--p_daemon->num_connections];
+            break;
+        }
+    }
+    pthread_cond_broadcast(&p_daemon->changed);
+    pthread_mutex_unlock(&p_daemon->lock);
+    close_connection(client.p_connection);
+    return NULL;
+}
+
+/**
+ * Starts a thread that serves a new client. The connection is closed if the thread can not be started.
+ *
+ * @param p_daemon A pointer to the daemon.
+ * @param p_connection A pointer to the connection of the client.
+ * @return Status code.
+ */
+int _start_client(RenderDaemon *p_daemon, Connection *p_connection) {
+    Client *p_client = (Client *)malloc(sizeof(Client));
+    int status = p_client != NULL ? SUCCESS : ERROR_MEMORY_ALLOC;
+
+    pthread_mutex_lock(&p_daemon->lock);
+    if (status == SUCCESS && p_daemon->num_connections == p_daemon->connections_capacity) {
+        size_t capacity = p_daemon->connections_capacity > 0 ? 2 * p_daemon->connections_capacity : 16;
+        Connection **connections = (Connection **)realloc(p_daemon->connections, capacity * sizeof(Connection *));
+        if (connections == NULL) {
+            status = ERROR_MEMORY_ALLOC;
+        } else {
+            p_daemon->connections = connections;
+            p_daemon->connections_capacity = capacity;
+        }
+    }
+    if (status == SUCCESS) {
+        p_client->p_daemon = p_daemon;
+        p_client->p_connection = p_connection;
+        pthread_t thread;
+        pthread_attr_t attributes;
+        pthread_attr_init(&attributes);
+        pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+        if (pthread_create(&thread, &attributes, _serve_client, p_client) != 0) {
+            status = ERROR_THREAD_CREATE;
+        } else {
+            p_daemon->connections[p_daemon->num_connections++] = p_connection;
+        }
+        pthread_attr_destroy(&attributes);
+    }
+    pthread_mutex_unlock(&p_daemon->lock);
+
+    if (status != SUCCESS) {
+        free(p_client);
+        close_connection(p_connection);
+    }
+    return status;
+}
+
+int run_render_daemon(Listener *p_listener, ThreadPool *p_thread_pool) {
+#ifndef _WIN32
+    // A client that disconnects while its result is sent must not terminate the daemon.
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    RenderDaemon daemon;
+    memset(&daemon, 0, sizeof(RenderDaemon));
+    daemon.p_listener = p_listener;
+    daemon.p_thread_pool = p_thread_pool;
+    pthread_mutex_init(&daemon.lock, NULL);
+    pthread_mutex_init(&daemon.parser_lock, NULL);
+    pthread_cond_init(&daemon.changed, NULL);
+
+    pthread_t dispatcher;
+    int status = SUCCESS;
+    if (pthread_create(&dispatcher, NULL, _run_dispatcher, &daemon) != 0) {
+        status = ERROR_THREAD_CREATE;
+    }
+
+    while (status == SUCCESS) {
+        Connection *p_connection;
+        status = accept_connection(p_listener, &p_connection);
+        if (status == SUCCESS) {
+            // A client that can not be served is disconnected, but the daemon goes on.
+            _start_client(&daemon, p_connection);
+        }
+    }
+
+    pthread_mutex_lock(&daemon.lock);
+    // accept_connection fails after a SHUTDOWN command, which is the regular way to stop the daemon.
+    if (daemon.shutting_down) {
+        status = SUCCESS;
+    }
+    daemon.shutting_down = true;
+    _cancel_all_jobs(&daemon);
+    pthread_cond_broadcast(&daemon.changed);
+    for (size_t i = 0; i < daemon.num_connections; i++) {
+        interrupt_connection(daemon.connections[i]);
+    }
+    while (daemon.num_connections > 0) {
+        pthread_cond_wait(&daemon.changed, &daemon.lock);
+    }
+    pthread_mutex_unlock(&daemon.lock);
+    if (status != ERROR_THREAD_CREATE) {
+        pthread_join(dispatcher, NULL);
+    }
+
+    while (daemon.p_first_job != NULL) {
+        _remove_job(&daemon, daemon.p_first_job);
+    }
+    for (size_t i = 0; i < daemon.num_free_images; i++) {
+        free_image_data(daemon.free_images[i].p_image_data);
+    }
+    free_iteration_field(&daemon.field);
+    free(daemon.connections);
+    pthread_cond_destroy(&daemon.changed);
+    pthread_mutex_destroy(&daemon.parser_lock);
+    pthread_mutex_destroy(&daemon.lock);
+    return status;
+}
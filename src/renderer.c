@@ -1,11 +1,22 @@
 #include "../include/renderer.h"
 
+#include <float.h>
 #include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
 
-#include "../include/color_utilities.h"
+#include "../include/antialiasing.h"
 #include "../include/config.h"
 #include "../include/image_manager.h"
+#include "../include/iteration_kernel.h"
+#include "../include/metrics.h"
+#include "../include/perturbation.h"
+#include "../include/shading.h"
 #include "../include/status_manager.h"
+#include "../include/thread_pool.h"
+#include "../include/tile_cache.h"
 
 /**
  * The progress step for the image building process.
@@ -14,11 +25,37 @@
 #define PROGRESS_STEP 0.05
 
 /**
- * The escape radius for the Mandelbrot function.
- * If the magnitude of a term of the mandelbrot sequence is greater than the escape radius, the sequence is considered to be unbounded.
- * It is proven that an escape radius of 2 is sufficient.
+ * The maximum number of reference orbits of a deep zoom render.
+ * Pixels that are still glitched after the last reference orbit keep their last number of iterations.
  */
-#define ESCAPE_RADIUS 2
+#define MAX_REFERENCES 64
+
+/**
+ * The number of glitched pixels that are iterated again as one task.
+ */
+#define GLITCH_CHUNK_SIZE 1024
+
+/**
+ * The largest edge length of a rectangle that is not split any further by the subdivision.
+ * Such small rectangles are iterated completely, because their border already covers most of their pixels.
+ */
+#define MIN_SUBDIVISION_SIZE 6
+
+/**
+ * The number of pixels that are iterated as one batch by the subdivision. Covers the border of a whole tile.
+ */
+#define SUBDIVISION_BATCH_SIZE (4 * TILE_SIZE)
+
+/**
+ * The largest number of pixels that are iterated as one batch, by a row of a tile or by the subdivision.
+ */
+#define PIXEL_BATCH_SIZE SUBDIVISION_BATCH_SIZE
+
+/**
+ * The number of significant bits the pixel spacing of a grid is rounded to. Viewports whose width differs only by
+ * rounding errors get the same spacing, so they share the points of their grids.
+ */
+#define GRID_SPACING_BITS 32
 
 /**
  * Processes the progress of the image building process.
@@ -26,52 +63,17 @@
  *
  * @param progress The progress of the image building process. Must be between 0 and 1.
  * @param p_prev_progress The pointer to the previous output progress.
- * @param progress_callback The callback function to output the progress.
+ * @param progress_callback The callback function to output the progress, or NULL.
  * @return Status code.
  */
 void _process_progress(double progress, double *p_prev_progress, void (*progress_callback)(double)) {
-    if ((progress - *p_prev_progress < PROGRESS_STEP) && p_prev_progress != 0 && progress != 1) {
+    if (progress_callback == NULL || ((progress - *p_prev_progress < PROGRESS_STEP) && p_prev_progress != 0 && progress != 1)) {
         return;
     }
     progress_callback(progress);
     *p_prev_progress = progress;
 }
 
-/**
- * Iterates the Mandelbrot function for a given complex number c.
- * z_0 = 0, z_1 = z_0^2 + c = c, z_2 = z_1^2 + c, ...
- * The function stores the number of iterations for which the Mandelbrot function remained within the ESCAPE_RADIUS in p_iterations.
- * For example, if |z_5| <= 2 but |z_6| > ESCAPE_RADIUS, p_iterations will be set to 5. Because of z_0 = 0, the minimum value for p_iterations is 0.
- * If the algorithm reaches z_{iteration_depth} and |z_{iteration_depth}| <= ESCAPE_RADIUS, p_iterations will be set to iteration_depth and the function will stop.
- *
- * @param c The complex number for which the Mandelbrot function should be iterated.
- * @param iteration_depth The maximum number of iterations. Must be greater than 0.
- * @param p_iterations A pointer to store the number of iterations for which the mandelbrot function remained within the ESCAPE_RADIUS.
- * @return Status code.
- */
-int _iteration_count(Complex c, size_t iteration_depth, size_t *p_iterations) {
-    // The maximum number of iterations must be greater than 0. Otherwise the sequence would not be iterated.
-    if (iteration_depth == 0) return ERROR_INVALID_ITERATION_DEPTH;
-
-    Complex z = {0.0, 0.0};
-    double magnitude_z;
-    size_t iteration_count = 0;
-
-    while (iteration_count < iteration_depth) {
-        multiply(z, z, &z);
-        add(z, c, &z);
-        magnitude(z, &magnitude_z);
-        iteration_count++;
-        if (magnitude_z > ESCAPE_RADIUS) {
-            *p_iterations = iteration_count - 1;
-            return SUCCESS;
-        }
-    }
-
-    *p_iterations = iteration_count;
-    return SUCCESS;
-}
-
 /**
  * Maps the pixel coordinates (x, y) to the complex plane.
  *
@@ -97,103 +99,1302 @@ int _map_to_complex_number(size_t x, size_t y, Viewport viewport, ImageSize size
 }
 
 /**
- * Calculates the color for a given number of iterations.
- * The color is determined by the number of iterations for which the mandelbrot function remained within the ESCAPE_RADIUS.
+ * Maps the pixel coordinates (x, y) of a field with an exponential map to the complex plane, see LogPolarMap.
  *
- * @param num_iterations The number of iterations for which the mandelbrot function remained within the ESCAPE_RADIUS.
- * @param config The configuration struct.
- * @param p_result A pointer to store the calculated color.
- * @return Status code.
- */
-int _choose_color(size_t num_iterations, Configuration config, uint32_t *result) {
-    // If the number of iterations is greater than the maximum number of iterations, return an error
-    if (num_iterations > config.iteration_depth) return ERROR_INVALID_NUM_ITERATIONS;
-    // If there are no outer colors, return an error
-    if (config.num_outer_colors < 1) return ERROR_NO_OUTER_COLORS;
-    // If the maximum number of iterations is 0, return an error
-    if (config.iteration_depth == 0) return ERROR_INVALID_ITERATION_DEPTH;
-    // there are not enough different values for num_iterations to map to the outer colors. We don't know which color to dismiss?
-    if (config.num_outer_colors > config.iteration_depth) return ERROR_TOO_MANY_OUTER_COLORS;
-
-    // If number of iterations equals iteration_depth, assume the point is in the Mandelbrot set and return the inner color.
-    if (num_iterations == config.iteration_depth) {
-        *result = config.inner_color;
+ * @param x The x-coordinate of the pixel.
+ * @param y The y-coordinate of the pixel.
+ * @param map The exponential map.
+ * @param p_c A pointer to store the complex number.
+ */
+void _map_log_polar_to_complex_number(size_t x, size_t y, LogPolarMap map, Complex *p_c) {
+    double radius = exp(map.log_max_radius - (double)y * map.step);
+    double angle = (double)x * map.step;
+    p_c->real = map.center.real + radius * cos(angle);
+    p_c->imag = map.center.imag + radius * sin(angle);
+}
+
+/**
+ * The context shared by all tiles of a render.
+ */
+typedef struct {
+    Configuration config;
+    // The number type the pixels are iterated with, see select_precision.
+    Precision precision;
+    // The center in double-double precision. Is 0 unless the render is in deep zoom mode.
+    DoubleDouble center_real;
+    DoubleDouble center_imag;
+    // The iteration field the tiles are computed into.
+    IterationField *p_field;
+    // The row of the image that is the first row of the field. Is 0 unless a band of a larger image is rendered.
+    size_t first_row;
+    size_t num_tiles_x;
+    size_t num_tiles_y;
+    // The first column and the first row of tiles are narrower by these numbers of pixels, so the tiles are aligned to the grid.
+    // Both are 0 unless a tile cache is used.
+    size_t tile_shift_x;
+    size_t tile_shift_y;
+    void (*progress_callback)(double);
+    double prev_progress;
+    // The range of the overall progress that is covered by the render.
+    double render_progress_start;
+    double render_progress_end;
+    // The range of the overall progress that is covered by the current batch of tasks.
+    double progress_start;
+    double progress_end;
+
+    // Deep zoom mode only. The glitch flag of every pixel, row by row.
+    bool *glitched;
+    // The current reference orbit and the offset of its reference point from the center.
+    ReferenceOrbit orbit;
+    Complex reference_offset;
+    // The indices of the pixels that were glitched after the previous pass.
+    size_t *glitched_pixels;
+    size_t num_glitched_pixels;
+
+    // Whether the pixels are snapped to a grid, which is the case for cached renders and animation frames, and the grid of the field.
+    bool on_grid;
+    PixelGrid grid;
+    // The tile cache, or NULL, and the function that computes a tile that is not in the cache.
+    TileCache *p_tile_cache;
+    TaskFunction compute_tile;
+    // The field of the previous animation frame, or NULL, and its grid. Its pixels are copied if they lie on the grid of the field.
+    const IterationField *p_previous_field;
+    PixelGrid previous_grid;
+    // 0 if both grids have the same spacing, 1 if the spacing is half of the previous spacing, -1 if it is twice the previous spacing.
+    int previous_scale;
+    // Whether the field is computed for an exponential map instead of the viewport, and the map.
+    bool log_polar;
+    LogPolarMap log_polar_map;
+    // Progressive renders only. The step of the current pass, or 0 if every pixel is computed, whether it is the first pass,
+    // and the wall clock time after which the tiles of the pass are skipped, or 0.
+    size_t pass_step;
+    bool first_pass;
+    double deadline;
+
+    // The statistics, counted separately by every worker thread.
+    RenderStatistics *worker_statistics;
+} RenderContext;
+
+/**
+ * A tile that is rendered by subdivision. The coordinates of the pixels are relative to the upper left corner of the tile.
+ */
+typedef struct {
+    RenderContext *p_render_context;
+    size_t x_start;
+    size_t y_start;
+    // The number of iterations, the magnitude and the glitch flag of every pixel of the tile, row by row with the stride of the field.
+    // The glitch flags are NULL if the render is not in deep zoom mode.
+    uint32_t *iterations;
+    float *magnitudes;
+    bool *glitched;
+    size_t stride;
+    // Whether the number of iterations of a pixel is already known, row by row with a stride of TILE_SIZE.
+    bool known[TILE_SIZE * TILE_SIZE];
+    size_t num_iterated_pixels;
+} SubdivisionTile;
+
+/**
+ * Maps the pixel coordinates (x, y) of the field of a render to the complex plane in double-double precision.
+ * Exponential maps are not supported. The center of a deep zoom render is added to the point, see _map_pixel_to_complex_number.
+ *
+ * @param p_render_context A pointer to the RenderContext.
+ * @param x The x-coordinate of the pixel in the field.
+ * @param y The y-coordinate of the pixel in the field.
+ * @param p_real A pointer to store the real part of the point.
+ * @param p_imag A pointer to store the imaginary part of the point.
+ */
+void _map_pixel_to_double_double(const RenderContext *p_render_context, size_t x, size_t y, DoubleDouble *p_real, DoubleDouble *p_imag) {
+    if (p_render_context->on_grid) {
+        // The position on the grid and the spacing are exact, so their product is exact as well.
+        *p_real = double_double_from_product((double)(p_render_context->grid.x + (int64_t)x), p_render_context->grid.spacing);
+        *p_imag = double_double_from_product(-(double)(p_render_context->grid.y + (int64_t)y), p_render_context->grid.spacing);
+        return;
+    }
+    // The offset from the upper left corner is at most the size of the viewport, so its rounding error is far below the pixel spacing.
+    Viewport viewport = p_render_context->config.viewport;
+    double spacing = fabs(viewport.upper_right.real - viewport.lower_left.real) / p_render_context->p_field->size.width;
+    DoubleDouble real = double_double_from_sum(viewport.lower_left.real, (double)x * spacing);
+    DoubleDouble imag = double_double_from_sum(viewport.upper_right.imag, -(double)(p_render_context->first_row + y) * spacing);
+    *p_real = add_double_double(p_render_context->center_real, real);
+    *p_imag = add_double_double(p_render_context->center_imag, imag);
+}
+
+/**
+ * Maps the pixel coordinates (x, y) of the field of a render to the complex plane. If the render is snapped to a grid, the point is
+ * computed from the position of the pixel on the grid, so the same pixel of the grid always gets exactly the same point.
+ * If the render has an exponential map, the point is computed from the map. The viewport of a deep zoom render is relative to its center,
+ * so the point is computed in double-double precision and rounded.
+ *
+ * @param p_render_context A pointer to the RenderContext.
+ * @param x The x-coordinate of the pixel in the field.
+ * @param y The y-coordinate of the pixel in the field.
+ * @param p_c A pointer to store the complex number.
+ * @return Status code.
+ */
+int _map_pixel_to_complex_number(const RenderContext *p_render_context, size_t x, size_t y, Complex *p_c) {
+    if (p_render_context->log_polar) {
+        _map_log_polar_to_complex_number(x, y, p_render_context->log_polar_map, p_c);
         return SUCCESS;
     }
-    // If number of iterations is less than iteration_depth and there is only one outer color, return the outer color
-    if (num_iterations < config.iteration_depth && config.num_outer_colors == 1) {
-        *result = config.outer_colors[0];
+    if (p_render_context->config.deep_zoom) {
+        DoubleDouble real, imag;
+        _map_pixel_to_double_double(p_render_context, x, y, &real, &imag);
+        p_c->real = real.hi;
+        p_c->imag = imag.hi;
         return SUCCESS;
     }
+    if (p_render_context->on_grid) {
+        p_c->real = (double)(p_render_context->grid.x + (int64_t)x) * p_render_context->grid.spacing;
+        p_c->imag = -(double)(p_render_context->grid.y + (int64_t)y) * p_render_context->grid.spacing;
+        return SUCCESS;
+    }
+    return _map_to_complex_number(x, p_render_context->first_row + y, p_render_context->config.viewport, p_render_context->p_field->size, p_c);
+}
+
+/**
+ * Checks whether a pixel is computed by the current pass of a progressive render. A pass computes the pixels whose coordinates
+ * are multiples of its step, except for the ones that were computed by the previous pass with twice the step.
+ *
+ * @param p_render_context A pointer to the RenderContext.
+ * @param x The x-coordinate of the pixel in the field.
+ * @param y The y-coordinate of the pixel in the field.
+ * @return True if the pixel is computed, which is always the case if the render is not progressive.
+ */
+bool _is_in_pass(const RenderContext *p_render_context, size_t x, size_t y) {
+    size_t step = p_render_context->pass_step;
+    if (step == 0) return true;
+    if (x % step != 0 || y % step != 0) return false;
+    return p_render_context->first_pass || x % (2 * step) != 0 || y % (2 * step) != 0;
+}
 
-    // Calculate segment size and segment index. The segment size is the size of the color interval in the number of iterations.
-    // Example: I have 3 outer colors and iteration_depth = 4. Then num_iterations can be 0, 1, 2, 3 (4 is mapped to inner color, see clause above).
-    // We have 2=num_outer_colors-1 color intervals [c1, c2], [c2, c3]. Then we map these intervals to the [0, 1.5], [1.5, 3] in the number of iterations, where 1.5 = (iteration_depth-1)/(num_outer_colors-1).
-    double segment_size = (config.iteration_depth - 1) / (double)(config.num_outer_colors - 1);
-    if (isnan(segment_size) || isinf(segment_size)) {
-        return ERROR_ARITHMETIC_OVERFLOW;
+/**
+ * Finds the pixel of the previous animation frame that lies on the same point as a pixel of the field.
+ *
+ * @param p_render_context A pointer to the RenderContext. Its previous field must not be NULL.
+ * @param x The x-coordinate of the pixel in the field.
+ * @param y The y-coordinate of the pixel in the field.
+ * @param p_index A pointer to store the index of the pixel in the previous field.
+ * @return True if the previous field contains a pixel on the same point.
+ */
+bool _find_previous_pixel(const RenderContext *p_render_context, size_t x, size_t y, size_t *p_index) {
+    int64_t grid_x = p_render_context->grid.x + (int64_t)x;
+    int64_t grid_y = p_render_context->grid.y + (int64_t)y;
+    if (p_render_context->previous_scale > 0) {
+        // Only every second pixel in both directions lies on the coarser previous grid.
+        if (grid_x % 2 != 0 || grid_y % 2 != 0) return false;
+        grid_x /= 2;
+        grid_y /= 2;
+    } else if (p_render_context->previous_scale < 0) {
+        grid_x *= 2;
+        grid_y *= 2;
+    }
+    ImageSize previous_size = p_render_context->p_previous_field->size;
+    int64_t previous_x = grid_x - p_render_context->previous_grid.x;
+    int64_t previous_y = grid_y - p_render_context->previous_grid.y;
+    if (previous_x < 0 || previous_y < 0 || (uint64_t)previous_x >= previous_size.width || (uint64_t)previous_y >= previous_size.height) {
+        return false;
     }
-    size_t segment_index = num_iterations / segment_size;
-    // Calculate the progress within the segment
-    double t = num_iterations / segment_size - segment_index;
+    *p_index = (size_t)previous_y * previous_size.width + (size_t)previous_x;
+    return true;
+}
 
-    uint32_t start_color = config.outer_colors[segment_index];
-    uint32_t end_color = config.outer_colors[segment_index + 1];
+/**
+ * Calculates the pixel bounds of a tile. The tiles are numbered row by row, starting in the upper left corner.
+ * Tiles at the right and bottom border of the image may be smaller than TILE_SIZE x TILE_SIZE.
+ *
+ * @param p_render_context A pointer to the RenderContext.
+ * @param tile_index The index of the tile.
+ * @param p_x_start A pointer to store the first column of the tile.
+ * @param p_y_start A pointer to store the first row of the tile.
+ * @param p_x_end A pointer to store the column after the last column of the tile.
+ * @param p_y_end A pointer to store the row after the last row of the tile.
+ */
+void _get_tile_bounds(const RenderContext *p_render_context, size_t tile_index, size_t *p_x_start, size_t *p_y_start, size_t *p_x_end, size_t *p_y_end) {
+    ImageSize size = p_render_context->p_field->size;
+    size_t x_end = (tile_index % p_render_context->num_tiles_x + 1) * TILE_SIZE - p_render_context->tile_shift_x;
+    size_t y_end = (tile_index / p_render_context->num_tiles_x + 1) * TILE_SIZE - p_render_context->tile_shift_y;
+    *p_x_start = x_end > TILE_SIZE ? x_end - TILE_SIZE : 0;
+    *p_y_start = y_end > TILE_SIZE ? y_end - TILE_SIZE : 0;
+    *p_x_end = x_end < size.width ? x_end : size.width;
+    *p_y_end = y_end < size.height ? y_end : size.height;
+}
 
-    interpolate_color(start_color, end_color, t, result);
+/**
+ * Iterates a batch of pixels of the field with the number type of the render.
+ *
+ * @param p_render_context A pointer to the RenderContext.
+ * @param xs The x-coordinates of the pixels in the field.
+ * @param ys The y-coordinates of the pixels in the field.
+ * @param count The number of pixels. Must not be greater than PIXEL_BATCH_SIZE.
+ * @param p_iterations A pointer to an array of count elements to store the number of iterations.
+ * @param p_magnitudes A pointer to an array of count elements to store the magnitude of the last computed term.
+ * @return Status code.
+ */
+int _iterate_pixel_batch(const RenderContext *p_render_context, const size_t *xs, const size_t *ys, size_t count, size_t *p_iterations,
+                         double *p_magnitudes) {
+    const Configuration *p_config = &p_render_context->config;
+    if (p_render_context->precision == PRECISION_DOUBLE_DOUBLE) {
+        DoubleDouble c_real[PIXEL_BATCH_SIZE];
+        DoubleDouble c_imag[PIXEL_BATCH_SIZE];
+        for (size_t i = 0; i < count; i++) {
+            _map_pixel_to_double_double(p_render_context, xs[i], ys[i], &c_real[i], &c_imag[i]);
+        }
+        iterate_double_double_points(c_real, c_imag, count, p_config, p_iterations, p_magnitudes);
+        return SUCCESS;
+    }
+
+    double c_real[PIXEL_BATCH_SIZE];
+    double c_imag[PIXEL_BATCH_SIZE];
+    Complex c;
+    for (size_t i = 0; i < count; i++) {
+        int status = _map_pixel_to_complex_number(p_render_context, xs[i], ys[i], &c);
+        if (status < 0) return status;
+        c_real[i] = c.real;
+        c_imag[i] = c.imag;
+    }
+    iterate_points(c_real, c_imag, count, p_config, p_render_context->precision, p_iterations, p_magnitudes);
     return SUCCESS;
 }
 
 /**
- * Calculates the color for a given pixel. The color is determined by the number of iterations for which the mandelbrot function remained within the ESCAPE_RADIUS.
- * The color is then stored in p_color.
+ * Computes the number of iterations of every pixel of a single tile of the image.
+ *
+ * @param tile_index The index of the tile.
+ * @param worker_index The index of the worker thread.
+ * @param p_context A pointer to the RenderContext.
+ * @return Status code.
+ */
+int _render_tile(size_t tile_index, size_t worker_index, void *p_context) {
+    RenderContext *p_render_context = (RenderContext *)p_context;
+    Configuration *p_config = &p_render_context->config;
+    IterationField *p_field = p_render_context->p_field;
+    const IterationField *p_previous_field = p_render_context->p_previous_field;
+    RenderStatistics *p_statistics = &p_render_context->worker_statistics[worker_index];
+    size_t xs[TILE_SIZE];
+    size_t ys[TILE_SIZE];
+    size_t iterations[TILE_SIZE];
+    double magnitudes[TILE_SIZE];
+    int status;
+
+    if (p_config->iteration_depth == 0) return ERROR_INVALID_ITERATION_DEPTH;
+
+    size_t x_start, y_start, x_end, y_end;
+    _get_tile_bounds(p_render_context, tile_index, &x_start, &y_start, &x_end, &y_end);
+
+    // Every row of the tile is iterated as one batch, so the kernel can iterate several points at once.
+    // Pixels that lie on a pixel of the previous animation frame are copied and left out of the batch,
+    // and so are the pixels that are not part of the current pass of a progressive render.
+    for (size_t y = y_start; y < y_end; y++) {
+        size_t count = 0;
+        for (size_t x = x_start; x < x_end; x++) {
+            if (!_is_in_pass(p_render_context, x, y)) continue;
+            size_t previous_index;
+            if (p_previous_field != NULL && _find_previous_pixel(p_render_context, x, y, &previous_index)) {
+                p_field->iterations[y * p_field->size.width + x] = p_previous_field->iterations[previous_index];
+                p_field->magnitudes[y * p_field->size.width + x] = p_previous_field->magnitudes[previous_index];
+                p_statistics->num_reused_pixels++;
+                continue;
+            }
+            xs[count] = x;
+            ys[count] = y;
+            count++;
+        }
+        if (count == 0) continue;
+
+        status = _iterate_pixel_batch(p_render_context, xs, ys, count, iterations, magnitudes);
+        if (status < 0) return status;
+
+        for (size_t i = 0; i < count; i++) {
+            p_field->iterations[y * p_field->size.width + xs[i]] = (uint32_t)iterations[i];
+            p_field->magnitudes[y * p_field->size.width + xs[i]] = (float)magnitudes[i];
+        }
+        p_statistics->num_iterated_pixels += count;
+    }
+    return SUCCESS;
+}
+
+/**
+ * Returns the wall clock time in seconds.
+ *
+ * @return The time in seconds since an arbitrary point in the past.
+ */
+double _get_wall_time(void) {
+    struct timeval time;
+    gettimeofday(&time, NULL);
+    return (double)time.tv_sec + (double)time.tv_usec / 1e6;
+}
+
+/**
+ * Computes the pixels of a single tile that belong to the current pass of a progressive render, unless the deadline has passed.
+ *
+ * @param tile_index The index of the tile.
+ * @param worker_index The index of the worker thread.
+ * @param p_context A pointer to the RenderContext.
+ * @return Status code.
+ */
+int _render_progressive_tile(size_t tile_index, size_t worker_index, void *p_context) {
+    RenderContext *p_render_context = (RenderContext *)p_context;
+    if (p_render_context->deadline > 0 && _get_wall_time() >= p_render_context->deadline) {
+        p_render_context->worker_statistics[worker_index].num_skipped_tiles++;
+        return SUCCESS;
+    }
+    return _render_tile(tile_index, worker_index, p_context);
+}
+
+/**
+ * Iterates a single pixel of a deep zoom render relative to the current reference orbit
+ * and stores the number of iterations, the magnitude and the glitch flag.
+ *
+ * @param p_render_context A pointer to the RenderContext.
+ * @param pixel_index The index of the pixel, counted row by row.
+ * @return Status code.
+ */
+int _iterate_deep_pixel(RenderContext *p_render_context, size_t pixel_index) {
+    IterationField *p_field = p_render_context->p_field;
+    ImageSize size = p_field->size;
+    Complex dc;
+    double magnitude;
+    // In deep zoom mode the viewport is relative to the center, so the mapped point is the offset of the pixel from the center.
+    int status = _map_to_complex_number(pixel_index % size.width, p_render_context->first_row + pixel_index / size.width, p_render_context->config.viewport,
+                                        size, &dc);
+    if (status < 0) return status;
+
+    p_field->iterations[pixel_index] = (uint32_t)iterate_perturbed_point(
+        &p_render_context->orbit, dc.real - p_render_context->reference_offset.real, dc.imag - p_render_context->reference_offset.imag,
+        p_render_context->config.iteration_depth, &magnitude, &p_render_context->glitched[pixel_index]);
+    p_field->magnitudes[pixel_index] = (float)magnitude;
+    return SUCCESS;
+}
+
+/**
+ * Iterates all pixels of a tile of a deep zoom render relative to the current reference orbit.
+ *
+ * @param tile_index The index of the tile.
+ * @param worker_index The index of the worker thread.
+ * @param p_context A pointer to the RenderContext.
+ * @return Status code.
+ */
+int _iterate_deep_tile(size_t tile_index, size_t worker_index, void *p_context) {
+    RenderContext *p_render_context = (RenderContext *)p_context;
+    size_t width = p_render_context->p_field->size.width;
+    size_t x_start, y_start, x_end, y_end;
+    _get_tile_bounds(p_render_context, tile_index, &x_start, &y_start, &x_end, &y_end);
+
+    for (size_t y = y_start; y < y_end; y++) {
+        for (size_t x = x_start; x < x_end; x++) {
+            int status = _iterate_deep_pixel(p_render_context, y * width + x);
+            if (status < 0) return status;
+        }
+    }
+    p_render_context->worker_statistics[worker_index].num_iterated_pixels += (x_end - x_start) * (y_end - y_start);
+    return SUCCESS;
+}
+
+/**
+ * Iterates a batch of pixels of a subdivision tile and marks them as known.
+ * In deep zoom mode, the pixels are iterated relative to the current reference orbit.
+ *
+ * @param p_tile A pointer to the SubdivisionTile.
+ * @param xs The x-coordinates of the pixels relative to the tile.
+ * @param ys The y-coordinates of the pixels relative to the tile.
+ * @param count The number of pixels. Must not be greater than SUBDIVISION_BATCH_SIZE.
+ * @return Status code.
+ */
+int _iterate_subdivision_pixels(SubdivisionTile *p_tile, const size_t *xs, const size_t *ys, size_t count) {
+    RenderContext *p_render_context = p_tile->p_render_context;
+    ImageSize size = p_render_context->p_field->size;
+    int status;
+
+    if (count == 0) return SUCCESS;
+    if (p_render_context->precision == PRECISION_PERTURBATION) {
+        for (size_t i = 0; i < count; i++) {
+            status = _iterate_deep_pixel(p_render_context, (p_tile->y_start + ys[i]) * size.width + p_tile->x_start + xs[i]);
+            if (status < 0) return status;
+        }
+    } else {
+        size_t field_xs[SUBDIVISION_BATCH_SIZE];
+        size_t field_ys[SUBDIVISION_BATCH_SIZE];
+        size_t iterations[SUBDIVISION_BATCH_SIZE];
+        double magnitudes[SUBDIVISION_BATCH_SIZE];
+        for (size_t i = 0; i < count; i++) {
+            field_xs[i] = p_tile->x_start + xs[i];
+            field_ys[i] = p_tile->y_start + ys[i];
+        }
+        status = _iterate_pixel_batch(p_render_context, field_xs, field_ys, count, iterations, magnitudes);
+        if (status < 0) return status;
+        for (size_t i = 0; i < count; i++) {
+            p_tile->iterations[ys[i] * p_tile->stride + xs[i]] = (uint32_t)iterations[i];
+            p_tile->magnitudes[ys[i] * p_tile->stride + xs[i]] = (float)magnitudes[i];
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        p_tile->known[ys[i] * TILE_SIZE + xs[i]] = true;
+    }
+    p_tile->num_iterated_pixels += count;
+    return SUCCESS;
+}
+
+/**
+ * Iterates all pixels of a rectangle of a subdivision tile whose number of iterations is not known yet.
+ *
+ * @param p_tile A pointer to the SubdivisionTile.
+ * @param x_start The first column of the rectangle.
+ * @param y_start The first row of the rectangle.
+ * @param x_end The column after the last column of the rectangle.
+ * @param y_end The row after the last row of the rectangle.
+ * @param border_only Whether only the pixels on the border of the rectangle are iterated.
+ * @return Status code.
+ */
+int _iterate_subdivision_rectangle(SubdivisionTile *p_tile, size_t x_start, size_t y_start, size_t x_end, size_t y_end, bool border_only) {
+    size_t xs[SUBDIVISION_BATCH_SIZE];
+    size_t ys[SUBDIVISION_BATCH_SIZE];
+    size_t count = 0;
+    int status;
+
+    for (size_t y = y_start; y < y_end; y++) {
+        bool border_row = y == y_start || y == y_end - 1;
+        for (size_t x = x_start; x < x_end; x++) {
+            if (border_only && !border_row && x != x_start && x != x_end - 1) {
+                // Skip the inside of the row.
+                x = x_end - 2;
+                continue;
+            }
+            if (p_tile->known[y * TILE_SIZE + x]) {
+                continue;
+            }
+            xs[count] = x;
+            ys[count] = y;
+            count++;
+            if (count == SUBDIVISION_BATCH_SIZE) {
+                status = _iterate_subdivision_pixels(p_tile, xs, ys, count);
+                if (status < 0) return status;
+                count = 0;
+            }
+        }
+    }
+    if (count > 0) {
+        return _iterate_subdivision_pixels(p_tile, xs, ys, count);
+    }
+    return SUCCESS;
+}
+
+/**
+ * Checks whether all pixels on the border of a rectangle of a subdivision tile have the same number of iterations
+ * and none of them is glitched. The border must be known.
+ *
+ * @param p_tile A pointer to the SubdivisionTile.
+ * @param x_start The first column of the rectangle.
+ * @param y_start The first row of the rectangle.
+ * @param x_end The column after the last column of the rectangle.
+ * @param y_end The row after the last row of the rectangle.
+ * @return True if the border is uniform.
+ */
+bool _is_uniform_border(const SubdivisionTile *p_tile, size_t x_start, size_t y_start, size_t x_end, size_t y_end) {
+    size_t stride = p_tile->stride;
+    uint32_t reference = p_tile->iterations[y_start * stride + x_start];
+    for (size_t y = y_start; y < y_end; y++) {
+        bool border_row = y == y_start || y == y_end - 1;
+        for (size_t x = x_start; x < x_end; x++) {
+            if (!border_row && x != x_start && x != x_end - 1) {
+                x = x_end - 2;
+                continue;
+            }
+            size_t index = y * stride + x;
+            if (p_tile->iterations[index] != reference || (p_tile->glitched != NULL && p_tile->glitched[index])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Renders a rectangle of a subdivision tile with the Mariani-Silver algorithm.
+ * The border of the rectangle is iterated first. If the border is uniform, the inside of the rectangle is filled
+ * with the number of iterations of the border, because the Mandelbrot set and the areas with the same number of iterations
+ * around it have no holes. Otherwise, the rectangle is split along its longer edge into two halves that share a row or column,
+ * so the border of each half is partly known already.
+ *
+ * @param p_tile A pointer to the SubdivisionTile.
+ * @param x_start The first column of the rectangle.
+ * @param y_start The first row of the rectangle.
+ * @param x_end The column after the last column of the rectangle.
+ * @param y_end The row after the last row of the rectangle.
+ * @return Status code.
+ */
+int _subdivide_rectangle(SubdivisionTile *p_tile, size_t x_start, size_t y_start, size_t x_end, size_t y_end) {
+    int status = _iterate_subdivision_rectangle(p_tile, x_start, y_start, x_end, y_end, true);
+    if (status < 0) return status;
+
+    if (_is_uniform_border(p_tile, x_start, y_start, x_end, y_end)) {
+        // The magnitudes of the filled pixels are not known. The magnitude of the corner is the best guess for smooth coloring.
+        uint32_t iterations = p_tile->iterations[y_start * p_tile->stride + x_start];
+        float magnitude = p_tile->magnitudes[y_start * p_tile->stride + x_start];
+        for (size_t y = y_start + 1; y + 1 < y_end; y++) {
+            for (size_t x = x_start + 1; x + 1 < x_end; x++) {
+                p_tile->iterations[y * p_tile->stride + x] = iterations;
+                p_tile->magnitudes[y * p_tile->stride + x] = magnitude;
+                if (p_tile->glitched != NULL) {
+                    p_tile->glitched[y * p_tile->stride + x] = false;
+                }
+                p_tile->known[y * TILE_SIZE + x] = true;
+            }
+        }
+        return SUCCESS;
+    }
+
+    size_t width = x_end - x_start;
+    size_t height = y_end - y_start;
+    if (width <= MIN_SUBDIVISION_SIZE && height <= MIN_SUBDIVISION_SIZE) {
+        return _iterate_subdivision_rectangle(p_tile, x_start, y_start, x_end, y_end, false);
+    }
+    if (width >= height) {
+        size_t x_middle = x_start + width / 2;
+        status = _subdivide_rectangle(p_tile, x_start, y_start, x_middle + 1, y_end);
+        if (status < 0) return status;
+        return _subdivide_rectangle(p_tile, x_middle, y_start, x_end, y_end);
+    }
+    size_t y_middle = y_start + height / 2;
+    status = _subdivide_rectangle(p_tile, x_start, y_start, x_end, y_middle + 1);
+    if (status < 0) return status;
+    return _subdivide_rectangle(p_tile, x_start, y_middle, x_end, y_end);
+}
+
+/**
+ * Computes the number of iterations of the pixels of a single tile of the image by subdivision. See _subdivide_rectangle.
+ * In deep zoom mode, the pixels are iterated relative to the current reference orbit.
+ *
+ * @param tile_index The index of the tile.
+ * @param worker_index The index of the worker thread.
+ * @param p_context A pointer to the RenderContext.
+ * @return Status code.
+ */
+int _render_subdivision_tile(size_t tile_index, size_t worker_index, void *p_context) {
+    RenderContext *p_render_context = (RenderContext *)p_context;
+    IterationField *p_field = p_render_context->p_field;
+    size_t width = p_field->size.width;
+    SubdivisionTile tile;
+    int status;
+
+    if (p_render_context->config.iteration_depth == 0) return ERROR_INVALID_ITERATION_DEPTH;
+
+    size_t x_start, y_start, x_end, y_end;
+    _get_tile_bounds(p_render_context, tile_index, &x_start, &y_start, &x_end, &y_end);
+
+    memset(&tile, 0, sizeof(SubdivisionTile));
+    tile.p_render_context = p_render_context;
+    tile.x_start = x_start;
+    tile.y_start = y_start;
+    tile.iterations = p_field->iterations + y_start * width + x_start;
+    tile.magnitudes = p_field->magnitudes + y_start * width + x_start;
+    tile.glitched = p_render_context->precision == PRECISION_PERTURBATION ? p_render_context->glitched + y_start * width + x_start : NULL;
+    tile.stride = width;
+
+    // Pixels that lie on a pixel of the previous animation frame are known from the start, so the subdivision does not iterate them.
+    size_t num_reused_pixels = 0;
+    if (p_render_context->p_previous_field != NULL) {
+        const IterationField *p_previous_field = p_render_context->p_previous_field;
+        for (size_t y = 0; y < y_end - y_start; y++) {
+            for (size_t x = 0; x < x_end - x_start; x++) {
+                size_t previous_index;
+                if (_find_previous_pixel(p_render_context, x_start + x, y_start + y, &previous_index)) {
+                    tile.iterations[y * width + x] = p_previous_field->iterations[previous_index];
+                    tile.magnitudes[y * width + x] = p_previous_field->magnitudes[previous_index];
+                    tile.known[y * TILE_SIZE + x] = true;
+                    num_reused_pixels++;
+                }
+            }
+        }
+    }
+
+    status = _subdivide_rectangle(&tile, 0, 0, x_end - x_start, y_end - y_start);
+    if (status < 0) return status;
+    p_render_context->worker_statistics[worker_index].num_iterated_pixels += tile.num_iterated_pixels;
+    p_render_context->worker_statistics[worker_index].num_reused_pixels += num_reused_pixels;
+    return SUCCESS;
+}
+
+/**
+ * Loads a tile from the tile cache, or computes it with the compute_tile function of the context and stores it in the cache.
+ *
+ * @param tile_index The index of the tile.
+ * @param worker_index The index of the worker thread.
+ * @param p_context A pointer to the RenderContext.
+ * @return Status code.
+ */
+int _render_cached_tile(size_t tile_index, size_t worker_index, void *p_context) {
+    RenderContext *p_render_context = (RenderContext *)p_context;
+    Configuration *p_config = &p_render_context->config;
+    IterationField *p_field = p_render_context->p_field;
+    size_t x_start, y_start, x_end, y_end;
+    _get_tile_bounds(p_render_context, tile_index, &x_start, &y_start, &x_end, &y_end);
+
+    TileKey key = {p_render_context->grid.x + (int64_t)x_start,
+                   p_render_context->grid.y + (int64_t)y_start,
+                   p_render_context->grid.spacing,
+                   x_end - x_start,
+                   y_end - y_start,
+                   p_config->iteration_depth,
+                   (unsigned int)p_config->render_mode,
+                   p_config->interior_checks,
+                   (unsigned int)p_render_context->precision,
+                   (unsigned int)p_config->formula,
+                   p_config->power,
+                   p_config->julia_c.real,
+                   p_config->julia_c.imag,
+                   get_iteration_kernel_name()};
+    size_t offset = y_start * p_field->size.width + x_start;
+    if (load_cached_tile(p_render_context->p_tile_cache, &key, p_field->iterations + offset, p_field->magnitudes + offset, p_field->size.width)) {
+        p_render_context->worker_statistics[worker_index].num_cache_hits++;
+        return SUCCESS;
+    }
+
+    int status = p_render_context->compute_tile(tile_index, worker_index, p_context);
+    if (status < 0) return status;
+    p_render_context->worker_statistics[worker_index].num_cache_misses++;
+    // A tile that can not be stored is just computed again by the next render, so errors of the cache do not fail the render.
+    store_cached_tile(p_render_context->p_tile_cache, &key, p_field->iterations + offset, p_field->magnitudes + offset, p_field->size.width);
+    return SUCCESS;
+}
+
+/**
+ * Iterates a chunk of GLITCH_CHUNK_SIZE glitched pixels of a deep zoom render relative to the current reference orbit.
+ *
+ * @param chunk_index The index of the chunk in the list of glitched pixels.
+ * @param worker_index The index of the worker thread. Unused.
+ * @param p_context A pointer to the RenderContext.
+ * @return Status code.
+ */
+int _iterate_glitched_chunk(size_t chunk_index, size_t worker_index, void *p_context) {
+    (void)worker_index;
+    RenderContext *p_render_context = (RenderContext *)p_context;
+    size_t start = chunk_index * GLITCH_CHUNK_SIZE;
+    size_t end = start + GLITCH_CHUNK_SIZE < p_render_context->num_glitched_pixels ? start + GLITCH_CHUNK_SIZE : p_render_context->num_glitched_pixels;
+
+    for (size_t i = start; i < end; i++) {
+        int status = _iterate_deep_pixel(p_render_context, p_render_context->glitched_pixels[i]);
+        if (status < 0) return status;
+    }
+    return SUCCESS;
+}
+
+/**
+ * Converts the number of completed tasks to the progress of the image building process and processes it.
+ * The tasks of the current batch cover the progress range [progress_start, progress_end] of the context.
+ *
+ * @param num_completed The number of completed tasks.
+ * @param num_tasks The total number of tasks.
+ * @param p_context A pointer to the RenderContext.
+ */
+void _process_task_progress(size_t num_completed, size_t num_tasks, void *p_context) {
+    RenderContext *p_render_context = (RenderContext *)p_context;
+    double progress = p_render_context->progress_start +
+                      (p_render_context->progress_end - p_render_context->progress_start) * (double)num_completed / (double)num_tasks;
+    _process_progress(progress, &p_render_context->prev_progress, p_render_context->progress_callback);
+}
+
+/**
+ * Runs a batch of tasks on the thread pool, or one after another on the calling thread if no thread pool is given.
+ *
+ * @param p_render_context A pointer to the RenderContext that is passed to the tasks.
+ * @param p_thread_pool The thread pool or NULL.
+ * @param num_tasks The number of tasks.
+ * @param task The function that executes a single task.
+ * @param progress_start The progress of the render before the first task, relative to the progress range of the render.
+ * @param progress_end The progress of the render after the last task, relative to the progress range of the render.
+ * @return Status code.
+ */
+int _run_tasks(RenderContext *p_render_context, ThreadPool *p_thread_pool, size_t num_tasks, TaskFunction task, double progress_start, double progress_end) {
+    double render_progress_range = p_render_context->render_progress_end - p_render_context->render_progress_start;
+    p_render_context->progress_start = p_render_context->render_progress_start + render_progress_range * progress_start;
+    p_render_context->progress_end = p_render_context->render_progress_start + render_progress_range * progress_end;
+
+    if (p_thread_pool != NULL) {
+        return run_thread_pool(p_thread_pool, num_tasks, task, p_render_context, _process_task_progress);
+    }
+    for (size_t task_index = 0; task_index < num_tasks; task_index++) {
+        int status = task(task_index, 0, p_render_context);
+        if (status < 0) return status;
+        _process_task_progress(task_index + 1, num_tasks, p_render_context);
+    }
+    return SUCCESS;
+}
+
+/**
+ * Computes the reference orbit of the point center + offset with the given precision and stores it in the context.
+ *
+ * @param p_render_context A pointer to the RenderContext.
+ * @param offset The offset of the reference point from the center.
+ * @param num_limbs The precision of the reference point in limbs.
+ * @return Status code.
+ */
+int _compute_deep_reference(RenderContext *p_render_context, Complex offset, size_t num_limbs) {
+    FixedPoint c_real, c_imag, offset_real, offset_imag;
+    c_real = p_render_context->config.center_real;
+    c_imag = p_render_context->config.center_imag;
+    set_fixed_point_precision(&c_real, num_limbs);
+    set_fixed_point_precision(&c_imag, num_limbs);
+    double_to_fixed_point(offset.real, num_limbs, &offset_real);
+    double_to_fixed_point(offset.imag, num_limbs, &offset_imag);
+    add_fixed_point(&c_real, &offset_real, &c_real);
+    add_fixed_point(&c_imag, &offset_imag, &c_imag);
+
+    free_reference_orbit(&p_render_context->orbit);
+    p_render_context->reference_offset = offset;
+    return compute_reference_orbit(&c_real, &c_imag, p_render_context->config.iteration_depth, &p_render_context->orbit);
+}
+
+/**
+ * Iterates all pixels of a deep zoom render with perturbation theory.
+ * A single reference orbit is computed with fixed point precision and every pixel only iterates its difference
+ * to the reference orbit in double precision. Pixels that turn out to be glitched are iterated again relative to
+ * a new reference point that is chosen among the glitched pixels, until no glitches remain or MAX_REFERENCES is reached.
+ *
+ * @param p_render_context A pointer to the RenderContext with allocated per pixel buffers.
+ * @param p_thread_pool The thread pool or NULL.
+ * @param num_limbs The precision of the reference points in limbs.
+ * @return Status code.
+ */
+int _iterate_deep(RenderContext *p_render_context, ThreadPool *p_thread_pool, size_t num_limbs) {
+    ImageSize size = p_render_context->p_field->size;
+    size_t num_pixels = size.width * size.height;
+    size_t num_tiles = p_render_context->num_tiles_x * p_render_context->num_tiles_y;
+
+    // The first reference point is the center, every pixel is iterated relative to it.
+    Complex offset = {0.0, 0.0};
+    int status = _compute_deep_reference(p_render_context, offset, num_limbs);
+    if (status < 0) return status;
+    TaskFunction iterate_tile = p_render_context->config.render_mode == RENDER_MODE_SUBDIVISION ? _render_subdivision_tile : _iterate_deep_tile;
+    status = _run_tasks(p_render_context, p_thread_pool, num_tiles, iterate_tile, 0.0, 0.8);
+    if (status < 0) return status;
+
+    for (size_t reference = 1; reference < MAX_REFERENCES; reference++) {
+        p_render_context->num_glitched_pixels = 0;
+        for (size_t i = 0; i < num_pixels; i++) {
+            if (p_render_context->glitched[i]) {
+                p_render_context->glitched_pixels[p_render_context->num_glitched_pixels++] = i;
+            }
+        }
+        if (p_render_context->num_glitched_pixels == 0) {
+            break;
+        }
+
+        // The reference pixel itself can not be glitched relative to its own orbit, so every pass fixes at least one pixel.
+        size_t reference_pixel = p_render_context->glitched_pixels[p_render_context->num_glitched_pixels / 2];
+        status = _map_to_complex_number(reference_pixel % size.width, p_render_context->first_row + reference_pixel / size.width,
+                                        p_render_context->config.viewport, size, &offset);
+        if (status < 0) return status;
+        status = _compute_deep_reference(p_render_context, offset, num_limbs);
+        if (status < 0) return status;
+
+        size_t num_chunks = (p_render_context->num_glitched_pixels + GLITCH_CHUNK_SIZE - 1) / GLITCH_CHUNK_SIZE;
+        double progress = 0.8 + 0.1 * reference / MAX_REFERENCES;
+        status = _run_tasks(p_render_context, p_thread_pool, num_chunks, _iterate_glitched_chunk, progress, progress);
+        if (status < 0) return status;
+    }
+    return SUCCESS;
+}
+
+/**
+ * Computes the iteration field of a deep zoom render. Allocates the per pixel buffers and iterates all pixels with perturbation theory.
+ *
+ * @param p_render_context A pointer to the RenderContext.
+ * @param p_thread_pool The thread pool or NULL.
+ * @return Status code.
+ */
+int _render_deep(RenderContext *p_render_context, ThreadPool *p_thread_pool) {
+    ImageSize size = p_render_context->p_field->size;
+    Viewport viewport = p_render_context->config.viewport;
+
+    double pixel_spacing = fabs(viewport.upper_right.real - viewport.lower_left.real) / size.width;
+    size_t num_limbs = get_fixed_point_limbs_for_spacing(pixel_spacing);
+    if (pixel_spacing < DBL_MIN || num_limbs > FIXED_POINT_MAX_LIMBS) return ERROR_ZOOM_TOO_DEEP;
+
+    size_t num_pixels = size.width * size.height;
+    if (num_pixels > SIZE_MAX / sizeof(size_t)) return ERROR_ARITHMETIC_OVERFLOW;
+    p_render_context->glitched = (bool *)malloc(num_pixels * sizeof(bool));
+    p_render_context->glitched_pixels = (size_t *)malloc(num_pixels * sizeof(size_t));
+
+    int status = ERROR_MEMORY_ALLOC;
+    if (p_render_context->glitched != NULL && p_render_context->glitched_pixels != NULL) {
+        status = _iterate_deep(p_render_context, p_thread_pool, num_limbs);
+    }
+
+    free_reference_orbit(&p_render_context->orbit);
+    free(p_render_context->glitched);
+    free(p_render_context->glitched_pixels);
+    return status;
+}
+
+/**
+ * Snaps the pixels of a render to the pixel grid of its viewport, see get_pixel_grid.
+ *
+ * @param p_render_context A pointer to the RenderContext. Its field, first row and configuration must be set.
+ * @return True if the viewport lies within the range of the grid.
+ */
+bool _snap_to_grid(RenderContext *p_render_context) {
+    ImageSize size = p_render_context->p_field->size;
+    if (get_pixel_grid(p_render_context->config.viewport, size, &p_render_context->grid) != SUCCESS) return false;
+    p_render_context->grid.y += (int64_t)p_render_context->first_row;
+    p_render_context->on_grid = true;
+    return true;
+}
+
+/**
+ * Selects the number type of a render and converts the center of a deep zoom render to double-double precision.
+ *
+ * @param p_render_context A pointer to the RenderContext. Its field and configuration must be set.
+ * @return Status code.
+ */
+int _set_up_precision(RenderContext *p_render_context) {
+    const Configuration *p_config = &p_render_context->config;
+    int status = select_precision(p_config, p_render_context->p_field->size.width, &p_render_context->precision);
+    if (status < 0) return status;
+    if (p_config->deep_zoom) {
+        p_render_context->center_real = fixed_point_to_double_double(&p_config->center_real);
+        p_render_context->center_imag = fixed_point_to_double_double(&p_config->center_imag);
+    }
+    return SUCCESS;
+}
+
+/**
+ * Runs the compute stage of a render whose context is set up: the reference orbits and glitch correction in deep zoom mode,
+ * otherwise one task per tile.
+ *
+ * @param p_render_context A pointer to the RenderContext.
+ * @param p_thread_pool The thread pool or NULL.
+ * @param p_statistics A pointer to store statistics about the render, or NULL.
+ * @return Status code.
+ */
+int _compute_field(RenderContext *p_render_context, ThreadPool *p_thread_pool, RenderStatistics *p_statistics) {
+    const Configuration *p_config = &p_render_context->config;
+    IterationField *p_field = p_render_context->p_field;
+    size_t num_workers = p_thread_pool != NULL ? get_thread_pool_size(p_thread_pool) : 1;
+    p_render_context->worker_statistics = (RenderStatistics *)calloc(num_workers, sizeof(RenderStatistics));
+    if (p_render_context->worker_statistics == NULL) return ERROR_MEMORY_ALLOC;
+    p_render_context->num_tiles_x = (p_field->size.width + p_render_context->tile_shift_x + TILE_SIZE - 1) / TILE_SIZE;
+    p_render_context->num_tiles_y = (p_field->size.height + p_render_context->tile_shift_y + TILE_SIZE - 1) / TILE_SIZE;
+    size_t num_tiles = p_render_context->num_tiles_x * p_render_context->num_tiles_y;
+
+    int status;
+    if (p_render_context->precision == PRECISION_PERTURBATION) {
+        status = _render_deep(p_render_context, p_thread_pool);
+    } else if (p_render_context->pass_step > 0) {
+        // Subdivision is not used by progressive renders, because a pass does not compute whole tiles.
+        status = _run_tasks(p_render_context, p_thread_pool, num_tiles, _render_progressive_tile, 0.0, 0.9);
+    } else {
+        TaskFunction render_tile = p_config->render_mode == RENDER_MODE_SUBDIVISION ? _render_subdivision_tile : _render_tile;
+        if (p_render_context->p_tile_cache != NULL) {
+            p_render_context->compute_tile = render_tile;
+            render_tile = _render_cached_tile;
+        }
+        status = _run_tasks(p_render_context, p_thread_pool, num_tiles, render_tile, 0.0, 0.9);
+    }
+
+    if (p_statistics != NULL) {
+        memset(p_statistics, 0, sizeof(RenderStatistics));
+        for (size_t i = 0; i < num_workers; i++) {
+            p_statistics->num_iterated_pixels += p_render_context->worker_statistics[i].num_iterated_pixels;
+            p_statistics->num_reused_pixels += p_render_context->worker_statistics[i].num_reused_pixels;
+            p_statistics->num_cache_hits += p_render_context->worker_statistics[i].num_cache_hits;
+            p_statistics->num_cache_misses += p_render_context->worker_statistics[i].num_cache_misses;
+            p_statistics->num_skipped_tiles += p_render_context->worker_statistics[i].num_skipped_tiles;
+        }
+    }
+    free(p_render_context->worker_statistics);
+    p_render_context->worker_statistics = NULL;
+    return status;
+}
+
+int get_pixel_grid(Viewport viewport, ImageSize size, PixelGrid *p_grid) {
+    if (size.width == 0) return ERROR_IMAGE_SIZE_0;
+    double spacing = fabs(viewport.upper_right.real - viewport.lower_left.real) / size.width;
+    int exponent;
+    double mantissa = frexp(spacing, &exponent);
+    spacing = ldexp(round(ldexp(mantissa, GRID_SPACING_BITS)), exponent - GRID_SPACING_BITS);
+    if (!(spacing >= DBL_MIN) || !isfinite(spacing)) return ERROR_ZOOM_TOO_DEEP;
+
+    // The positions of all pixels must be exact integers in a double, so they are limited to 2^53.
+    double x = round(viewport.lower_left.real / spacing);
+    double y = round(-viewport.upper_right.imag / spacing);
+    double max_position = ldexp(1.0, DBL_MANT_DIG) - (double)size.width - (double)size.height;
+    if (!(fabs(x) < max_position && fabs(y) < max_position)) return ERROR_ZOOM_TOO_DEEP;
+
+    p_grid->x = (int64_t)x;
+    p_grid->y = (int64_t)y;
+    p_grid->spacing = spacing;
+    return SUCCESS;
+}
+
+/**
+ * Sets up the context of a band like every band of a render: the number type and, if a tile cache is used, the grid the tiles are aligned to.
+ *
+ * @param p_render_context A pointer to the RenderContext to set up.
+ * @param config The configuration struct.
+ * @param p_tile_cache The cache to load and store the tiles, or NULL.
+ * @param first_row The row of the whole image that is the first row of the band.
+ * @param p_field A pointer to the iteration field of the band.
+ * @return Status code.
+ */
+int _set_up_band_context(RenderContext *p_render_context, Configuration config, TileCache *p_tile_cache, size_t first_row, IterationField *p_field) {
+    memset(p_render_context, 0, sizeof(RenderContext));
+    p_render_context->config = config;
+    p_render_context->p_field = p_field;
+    p_render_context->first_row = first_row;
+    int status = _set_up_precision(p_render_context);
+    if (status < 0) return status;
+    // Deep zoom renders are not cached, because their viewports are relative to their centers, and the pixels of perturbation
+    // depend on the reference orbits of the whole image. The tiles of cached renders are aligned to the grid, so renders with
+    // different viewports share them.
+    if (p_tile_cache != NULL && !config.deep_zoom && _snap_to_grid(p_render_context)) {
+        p_render_context->p_tile_cache = p_tile_cache;
+        p_render_context->tile_shift_x = (size_t)(((p_render_context->grid.x % TILE_SIZE) + TILE_SIZE) % TILE_SIZE);
+        p_render_context->tile_shift_y = (size_t)(((p_render_context->grid.y % TILE_SIZE) + TILE_SIZE) % TILE_SIZE);
+    }
+    return SUCCESS;
+}
+
+/**
+ * Computes a single row of the image like the band that contains it, so it can be compared with the rows of the band next to it.
+ * The pixels of a brute force render only depend on their position, so only the row is computed. The subdivision fills the pixels
+ * of a tile from its border, so the whole row of tiles that contains the row is computed.
+ *
+ * @param config The configuration struct.
+ * @param p_thread_pool The thread pool, or NULL.
+ * @param p_tile_cache The tile cache of the render, or NULL.
+ * @param row The row of the image.
+ * @param image_size The size of the whole image in pixels.
+ * @param p_row A pointer to store the iteration field of the row. It must be freed with free_iteration_field.
+ * @return Status code.
+ */
+int _compute_neighbor_row(Configuration config, ThreadPool *p_thread_pool, TileCache *p_tile_cache, size_t row, ImageSize image_size, IterationField *p_row) {
+    size_t offset = 0;
+    if (config.render_mode == RENDER_MODE_SUBDIVISION) {
+        // The tiles of a cached render are aligned to the grid instead of the top of the image.
+        PixelGrid grid;
+        bool on_grid = p_tile_cache != NULL && !config.deep_zoom && get_pixel_grid(config.viewport, image_size, &grid) == SUCCESS;
+        offset = on_grid ? (size_t)((((grid.y + (int64_t)row) % TILE_SIZE) + TILE_SIZE) % TILE_SIZE) : row % TILE_SIZE;
+    } else {
+        // Single rows would fill the cache with tiles that no other render uses.
+        p_tile_cache = NULL;
+    }
+    size_t first_row = row >= offset ? row - offset : 0;
+    size_t end_row = row - offset + (config.render_mode == RENDER_MODE_SUBDIVISION ? TILE_SIZE : 1);
+    ImageSize size = {image_size.width, (end_row < image_size.height ? end_row : image_size.height) - first_row};
+
+    IterationField field;
+    int status = create_iteration_field(size, config.iteration_depth, &field);
+    if (status < 0) return status;
+    RenderContext context;
+    status = _set_up_band_context(&context, config, p_tile_cache, first_row, &field);
+    if (status == SUCCESS) {
+        status = _compute_field(&context, p_thread_pool, NULL);
+    }
+    if (status == SUCCESS) {
+        ImageSize row_size = {image_size.width, 1};
+        status = create_iteration_field(row_size, config.iteration_depth, p_row);
+    }
+    if (status == SUCCESS) {
+        memcpy(p_row->iterations, field.iterations + (row - first_row) * size.width, size.width * sizeof(uint32_t));
+        memcpy(p_row->magnitudes, field.magnitudes + (row - first_row) * size.width, size.width * sizeof(float));
+    }
+    free_iteration_field(&field);
+    return status;
+}
+
+/**
+ * Supersamples the edges of a shaded band if the configuration asks for it, see supersample_edges.
+ * The rows next to a band that does not cover the whole image are computed again, so the edges on the borders of the band are found.
+ *
+ * @param p_config A pointer to the configuration.
+ * @param p_thread_pool The thread pool, or NULL.
+ * @param p_tile_cache The tile cache of the render, or NULL.
+ * @param p_field A pointer to the iteration field of the band.
+ * @param first_row The row of the image that is the first row of the band.
+ * @param p_image_data A pointer to the shaded image data of the band.
+ * @param p_statistics A pointer to add the numbers of supersampled pixels and samples to, or NULL.
+ * @return Status code.
+ */
+int _supersample(const Configuration *p_config, ThreadPool *p_thread_pool, TileCache *p_tile_cache, const IterationField *p_field, size_t first_row,
+                 ImageData *p_image_data, RenderStatistics *p_statistics) {
+    if (p_config->supersampling < 2) return SUCCESS;
+    ImageSize image_size;
+    int status = calc_image_size(p_config->viewport, p_field->size.width, &image_size);
+    if (status < 0) return status;
+    IterationField row_above, row_below;
+    bool has_row_above = first_row > 0;
+    bool has_row_below = first_row + p_field->size.height < image_size.height;
+    if (has_row_above) {
+        status = _compute_neighbor_row(*p_config, p_thread_pool, p_tile_cache, first_row - 1, image_size, &row_above);
+        if (status < 0) return status;
+    }
+    if (has_row_below) {
+        status = _compute_neighbor_row(*p_config, p_thread_pool, p_tile_cache, first_row + p_field->size.height, image_size, &row_below);
+        if (status < 0) {
+            if (has_row_above) {
+                free_iteration_field(&row_above);
+            }
+            return status;
+        }
+    }
+
+    size_t num_pixels, num_samples;
+    status = supersample_edges(p_config, p_thread_pool, p_field, first_row, p_image_data, has_row_above ? &row_above : NULL,
+                               has_row_below ? &row_below : NULL, &num_pixels, &num_samples);
+    if (has_row_above) {
+        free_iteration_field(&row_above);
+    }
+    if (has_row_below) {
+        free_iteration_field(&row_below);
+    }
+    if (status == SUCCESS && p_statistics != NULL) {
+        p_statistics->num_supersampled_pixels += num_pixels;
+        p_statistics->num_extra_samples += num_samples;
+    }
+    return status;
+}
+
+/**
+ * Builds the image data or the indexed image data of a band, see render_band_to_image and render_to_indexed_image.
  *
- * @param x The x-coordinate of the pixel.
- * @param y The y-coordinate of the pixel.
  * @param config The configuration struct.
- * @param size The size of the image in pixels.
- * @param p_color A pointer to store the calculated color.
+ * @param p_thread_pool The thread pool to render the tiles with, or NULL to render on the calling thread.
+ * @param p_tile_cache The cache to load and store the tiles, or NULL.
+ * @param first_row The row of the whole image that is the first row of the band.
+ * @param p_field A pointer to the iteration field of the band.
+ * @param p_image_data A pointer to the image data of the band, or NULL if the indexed image data is given.
+ * @param p_indexed_image_data A pointer to the indexed image data of the band, or NULL if the image data is given.
+ * @param progress_callback A callback function to output the progress. It is always called on the calling thread.
+ * @param progress_start The overall progress before the band is rendered.
+ * @param progress_end The overall progress after the band is rendered.
+ * @param p_statistics A pointer to store statistics about the band, or NULL.
  * @return Status code.
  */
-int _get_color_for_pixel(size_t x, size_t y, Configuration config, ImageSize size, uint32_t *p_color) {
-    Complex c = {0, 0};
-    size_t number_iterations;
-    int status = _map_to_complex_number(x, y, config.viewport, size, &c);
+int _render_band(Configuration config, ThreadPool *p_thread_pool, TileCache *p_tile_cache, size_t first_row, IterationField *p_field, ImageData *p_image_data,
+                 IndexedImageData *p_indexed_image_data, void (*progress_callback)(double), double progress_start, double progress_end,
+                 RenderStatistics *p_statistics) {
+    if (config.iteration_depth == 0 || config.iteration_depth != p_field->iteration_depth) return ERROR_INVALID_ITERATION_DEPTH;
+    if (p_indexed_image_data != NULL) {
+        if (config.supersampling >= 2) return ERROR_INCOMPATIBLE_OPTIONS;
+        // A palette with too many colors is rejected before anything is computed.
+        int status = find_indexed_colors(&config, config.iteration_depth, p_indexed_image_data);
+        if (status < 0) return status;
+    }
+
+    RenderContext context;
+    int status = _set_up_band_context(&context, config, p_tile_cache, first_row, p_field);
     if (status < 0) return status;
+    context.progress_callback = progress_callback;
+    context.render_progress_start = progress_start;
+    context.render_progress_end = progress_end;
+    context.prev_progress = progress_start;
 
-    status = _iteration_count(c, config.iteration_depth, &number_iterations);
+    // Compute stage. The progress of the shading stage is not reported, because shading is much faster.
+    RenderStatistics statistics;
+    StageClock compute_clock, shade_clock;
+    _process_progress(progress_start, &context.prev_progress, progress_callback);
+    start_stage_clock(&compute_clock);
+    status = _compute_field(&context, p_thread_pool, &statistics);
     if (status < 0) return status;
+    stop_stage_clock(&compute_clock, &statistics.compute_time);
+    add_field_to_iteration_histogram(p_field, &statistics.histogram);
 
-    status = _choose_color(number_iterations, config, p_color);
+    // Shading stage.
+    start_stage_clock(&shade_clock);
+    status = p_indexed_image_data != NULL ? shade_iteration_field_to_indices(p_field, &config, p_thread_pool, p_indexed_image_data)
+                                          : shade_iteration_field(p_field, &config, p_thread_pool, p_image_data);
     if (status < 0) return status;
+    stop_stage_clock(&shade_clock, &statistics.shade_time);
+    if (p_image_data != NULL) {
+        start_stage_clock(&compute_clock);
+        status = _supersample(&config, p_thread_pool, p_tile_cache, p_field, first_row, p_image_data, &statistics);
+        if (status < 0) return status;
+        stop_stage_clock(&compute_clock, &statistics.compute_time);
+    }
+    if (p_statistics != NULL) {
+        *p_statistics = statistics;
+    }
 
+    _process_progress(progress_end, &context.prev_progress, progress_callback);
     return SUCCESS;
 }
 
-int render_to_image(Configuration config, ImageData *p_image_data, void (*progress_callback)(double)) {
-    Complex c = {0, 0};
-    size_t number_iterations;
-    uint32_t color;
+int render_band_to_image(Configuration config, ThreadPool *p_thread_pool, TileCache *p_tile_cache, size_t first_row, IterationField *p_field,
+                         ImageData *p_image_data, void (*progress_callback)(double), double progress_start, double progress_end,
+                         RenderStatistics *p_statistics) {
+    return _render_band(config, p_thread_pool, p_tile_cache, first_row, p_field, p_image_data, NULL, progress_callback, progress_start, progress_end, p_statistics);
+}
+
+int compute_band_field(Configuration config, ThreadPool *p_thread_pool, size_t first_row, IterationField *p_field, RenderStatistics *p_statistics) {
+    if (config.iteration_depth == 0 || config.iteration_depth != p_field->iteration_depth) return ERROR_INVALID_ITERATION_DEPTH;
 
-    double progress = 0.0;
-    double prev_progress = 0.0;
-    _process_progress(progress, &prev_progress, progress_callback);
-    int status = SUCCESS;
+    RenderContext context;
+    memset(&context, 0, sizeof(RenderContext));
+    context.config = config;
+    context.p_field = p_field;
+    context.first_row = first_row;
+    int status = _set_up_precision(&context);
+    if (status < 0) return status;
 
-    for (int x = 0; x < p_image_data->size.width; x++) {
-        for (int y = 0; y < p_image_data->size.height; y++) {
-            status = _get_color_for_pixel(x, y, config, p_image_data->size, &color);
-            if (status < 0) return status;
-            status = set_pixel_in_image_data(x, y, color, p_image_data);
-            if (status < 0) return status;
+    StageClock compute_clock;
+    start_stage_clock(&compute_clock);
+    RenderStatistics statistics;
+    status = _compute_field(&context, p_thread_pool, &statistics);
+    if (status < 0) return status;
+    stop_stage_clock(&compute_clock, &statistics.compute_time);
+    if (p_statistics != NULL) {
+        *p_statistics = statistics;
+    }
+    return SUCCESS;
+}
+
+int render_to_image(Configuration config, ThreadPool *p_thread_pool, TileCache *p_tile_cache, IterationField *p_field, ImageData *p_image_data,
+                    void (*progress_callback)(double), RenderStatistics *p_statistics) {
+    return render_band_to_image(config, p_thread_pool, p_tile_cache, 0, p_field, p_image_data, progress_callback, 0.0, 1.0, p_statistics);
+}
+
+int render_to_indexed_image(Configuration config, ThreadPool *p_thread_pool, TileCache *p_tile_cache, IterationField *p_field, IndexedImageData *p_image_data,
+                            void (*progress_callback)(double), RenderStatistics *p_statistics) {
+    return _render_band(config, p_thread_pool, p_tile_cache, 0, p_field, NULL, p_image_data, progress_callback, 0.0, 1.0, p_statistics);
+}
 
-            // Note: Division by zero is not possible here, because size.width is always greater than 0.
-            // Otherwise the program would not reach this point.
-            progress = (double)x / (double)p_image_data->size.width;
-            _process_progress(progress, &prev_progress, progress_callback);
+int compute_frame_field(Configuration config, ThreadPool *p_thread_pool, const IterationField *p_previous_field, Viewport previous_viewport,
+                        IterationField *p_field, RenderStatistics *p_statistics) {
+    if (config.iteration_depth == 0 || config.iteration_depth != p_field->iteration_depth) return ERROR_INVALID_ITERATION_DEPTH;
+    if (config.deep_zoom) return ERROR_INCOMPATIBLE_OPTIONS;
+
+    RenderContext context;
+    memset(&context, 0, sizeof(RenderContext));
+    context.config = config;
+    context.p_field = p_field;
+    int status = _set_up_precision(&context);
+    if (status < 0) return status;
+    if (!_snap_to_grid(&context)) return ERROR_ZOOM_TOO_DEEP;
+
+    // Only grids whose spacings are equal or differ by a factor of 2 share points.
+    if (p_previous_field != NULL && p_previous_field->iteration_depth == config.iteration_depth &&
+        get_pixel_grid(previous_viewport, p_previous_field->size, &context.previous_grid) == SUCCESS) {
+        if (context.previous_grid.spacing == context.grid.spacing) {
+            context.previous_scale = 0;
+            context.p_previous_field = p_previous_field;
+        } else if (context.previous_grid.spacing == 2.0 * context.grid.spacing) {
+            context.previous_scale = 1;
+            context.p_previous_field = p_previous_field;
+        } else if (2.0 * context.previous_grid.spacing == context.grid.spacing) {
+            context.previous_scale = -1;
+            context.p_previous_field = p_previous_field;
         }
     }
+    return _compute_field(&context, p_thread_pool, p_statistics);
+}
+
+int compute_log_polar_field(Configuration config, ThreadPool *p_thread_pool, LogPolarMap map, IterationField *p_field,
+                            void (*progress_callback)(double), double progress_start, double progress_end, RenderStatistics *p_statistics) {
+    if (config.iteration_depth == 0 || config.iteration_depth != p_field->iteration_depth) return ERROR_INVALID_ITERATION_DEPTH;
+    if (config.deep_zoom) return ERROR_INCOMPATIBLE_OPTIONS;
+
+    RenderContext context;
+    memset(&context, 0, sizeof(RenderContext));
+    context.config = config;
+    context.p_field = p_field;
+    // The pixels of an exponential map span many scales, so they are always iterated in double precision.
+    context.precision = PRECISION_DOUBLE;
+    context.log_polar = true;
+    context.log_polar_map = map;
+    context.progress_callback = progress_callback;
+    context.render_progress_start = progress_start;
+    context.render_progress_end = progress_end;
+    context.prev_progress = progress_start;
 
-    _process_progress(1.0, &prev_progress, progress_callback);
+    _process_progress(progress_start, &context.prev_progress, progress_callback);
+    int status = _compute_field(&context, p_thread_pool, p_statistics);
+    if (status < 0) return status;
+    _process_progress(progress_end, &context.prev_progress, progress_callback);
+    return SUCCESS;
+}
+
+/**
+ * Gives every pixel that has not been computed by the passes of a progressive render so far the values of the computed pixel
+ * at the upper left corner of its block, so the field can be shaded as a whole. The values are overwritten by the next passes.
+ *
+ * @param p_field A pointer to the iteration field.
+ * @param step The step of the last pass.
+ */
+void _fill_pass_blocks(IterationField *p_field, size_t step) {
+    ImageSize size = p_field->size;
+    for (size_t y = 0; y < size.height; y++) {
+        size_t source_row = (y - y % step) * size.width;
+        for (size_t x = 0; x < size.width; x++) {
+            if (x % step == 0 && y % step == 0) continue;
+            p_field->iterations[y * size.width + x] = p_field->iterations[source_row + x - x % step];
+            p_field->magnitudes[y * size.width + x] = p_field->magnitudes[source_row + x - x % step];
+        }
+    }
+}
+
+int render_progressive(Configuration config, ThreadPool *p_thread_pool, IterationField *p_field, ImageData *p_image_data, double time_budget,
+                       ProgressiveFrameCallback frame_callback, void *p_callback_context, size_t *p_final_step, RenderStatistics *p_statistics) {
+    if (config.iteration_depth == 0 || config.iteration_depth != p_field->iteration_depth) return ERROR_INVALID_ITERATION_DEPTH;
+    double deadline = time_budget > 0 ? _get_wall_time() + time_budget : 0;
+    if (p_statistics != NULL) {
+        memset(p_statistics, 0, sizeof(RenderStatistics));
+    }
+
+    RenderContext context;
+    memset(&context, 0, sizeof(RenderContext));
+    context.config = config;
+    context.p_field = p_field;
+    // The passes need tiles that can be computed on their own, which perturbation does not provide.
+    int status = _set_up_precision(&context);
+    if (status < 0) return status;
+    if (context.precision == PRECISION_PERTURBATION) return ERROR_INCOMPATIBLE_OPTIONS;
+    for (size_t step = PROGRESSIVE_FIRST_STEP; step >= 1; step /= 2) {
+        // The first pass ignores the deadline, so there is always a complete image.
+        context.pass_step = step;
+        context.first_pass = step == PROGRESSIVE_FIRST_STEP;
+        context.deadline = context.first_pass ? 0 : deadline;
+        RenderStatistics pass_statistics;
+        StageClock compute_clock, shade_clock;
+        start_stage_clock(&compute_clock);
+        status = _compute_field(&context, p_thread_pool, &pass_statistics);
+        if (status < 0) return status;
+        stop_stage_clock(&compute_clock, &pass_statistics.compute_time);
+        // Pixels of skipped tiles still have the values of the previous pass, which the fill spreads over the blocks of this pass.
+        start_stage_clock(&shade_clock);
+        if (step > 1) {
+            _fill_pass_blocks(p_field, step);
+        }
+        status = shade_iteration_field(p_field, &config, p_thread_pool, p_image_data);
+        if (status < 0) return status;
+        stop_stage_clock(&shade_clock, &pass_statistics.shade_time);
+        // Only the complete image is supersampled, because the edges of a coarse pass are the edges of its blocks.
+        if (step == 1 && pass_statistics.num_skipped_tiles == 0) {
+            start_stage_clock(&compute_clock);
+            status = _supersample(&config, p_thread_pool, NULL, p_field, 0, p_image_data, &pass_statistics);
+            if (status < 0) return status;
+            stop_stage_clock(&compute_clock, &pass_statistics.compute_time);
+        }
+
+        if (p_statistics != NULL) {
+            p_statistics->num_iterated_pixels += pass_statistics.num_iterated_pixels;
+            p_statistics->num_skipped_tiles += pass_statistics.num_skipped_tiles;
+            p_statistics->num_supersampled_pixels += pass_statistics.num_supersampled_pixels;
+            p_statistics->num_extra_samples += pass_statistics.num_extra_samples;
+            add_stage_time(&p_statistics->compute_time, &pass_statistics.compute_time);
+            add_stage_time(&p_statistics->shade_time, &pass_statistics.shade_time);
+        }
+        if (pass_statistics.num_skipped_tiles == 0 && p_final_step != NULL) {
+            *p_final_step = step;
+        }
+        if (frame_callback != NULL) {
+            frame_callback(p_image_data, step, p_callback_context);
+        }
+        if (deadline > 0 && _get_wall_time() >= deadline) break;
+    }
+    // The histogram describes the final image, whose blocks of the last pass are filled.
+    if (p_statistics != NULL) {
+        add_field_to_iteration_histogram(p_field, &p_statistics->histogram);
+    }
     return SUCCESS;
 }
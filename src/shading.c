@@ -0,0 +1,358 @@
+#include "../include/shading.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/palette.h"
+#include "../include/status_manager.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define X86_KERNELS
+#include <immintrin.h>
+#endif
+
+/**
+ * The number of rows that are shaded as one task.
+ */
+#define SHADING_BAND_HEIGHT 64
+
+/**
+ * The number of pixels whose palette indices are computed before they are looked up.
+ */
+#define SHADING_CHUNK_SIZE SHADING_MAX_POINTS
+
+/**
+ * The smallest magnitude that is used for smooth coloring. Pixels whose last term lies within the ESCAPE_RADIUS
+ * (filled pixels of the subdivision or points detected by the interior checks) are colored as if they just escaped.
+ */
+#define SMOOTH_MIN_MAGNITUDE 2.0f
+
+/**
+ * Looks up the palette entries of count pixels and stores their blue, green and red bytes in the image data.
+ *
+ * @param p_indices The palette indices of the pixels. Every index must be at most num_entries of the palette.
+ * @param count The number of pixels.
+ * @param p_entries The entries of the palette.
+ * @param p_pixels A pointer to the first byte of the first pixel in the image data.
+ */
+typedef void (*LookupKernel)(const uint32_t *p_indices, size_t count, const uint32_t *p_entries, unsigned char *p_pixels);
+
+/**
+ * The number of slots of the hash table that finds the distinct colors of a palette. Twice the number of colors keeps the probe sequences short.
+ */
+#define COLOR_HASH_SIZE (2 * MAX_INDEXED_COLORS)
+
+/**
+ * The context shared by all bands of a shading pass. Either the image data or the indexed image data is set.
+ */
+typedef struct {
+    const IterationField *p_field;
+    const Palette *p_palette;
+    LookupKernel lookup;
+    ImageData *p_image_data;
+    IndexedImageData *p_indexed_image_data;
+    // The index of the color of every entry of the palette, for indexed image data.
+    const uint8_t *p_color_indices;
+} ShadingContext;
+
+/**
+ * The portable lookup kernel. Copies three bytes per pixel.
+ * See LookupKernel for a description of the parameters.
+ */
+void _lookup_scalar(const uint32_t *p_indices, size_t count, const uint32_t *p_entries, unsigned char *p_pixels) {
+    for (size_t i = 0; i < count; i++) {
+        memcpy(p_pixels + 3 * i, &p_entries[p_indices[i]], 3);
+    }
+}
+
+#ifdef X86_KERNELS
+
+/**
+ * The AVX2 lookup kernel. Gathers the entries of 8 pixels at once and packs them from 4 to 3 bytes per pixel.
+ * Every store writes 16 bytes, of which the last 4 are overwritten by the next store. The kernel stops early enough
+ * that no store writes beyond the last pixel, the remaining pixels are copied by the scalar kernel.
+ * See LookupKernel for a description of the parameters.
+ */
+__attribute__((target("avx2")))
+void _lookup_avx2(const uint32_t *p_indices, size_t count, const uint32_t *p_entries, unsigned char *p_pixels) {
+    // Moves the blue, green and red bytes of the 4 entries of each 128 bit lane to the front of the lane.
+    const __m256i pack = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                          0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    size_t i = 0;
+    // The second store of a group of 8 pixels writes 4 bytes into the pixels after the group, which must exist.
+    for (; i + 10 <= count; i += 8) {
+        __m256i indices = _mm256_loadu_si256((const __m256i *)(p_indices + i));
+        __m256i entries = _mm256_i32gather_epi32((const int *)p_entries, indices, 4);
+        __m256i packed = _mm256_shuffle_epi8(entries, pack);
+        _mm_storeu_si128((__m128i *)(p_pixels + 3 * i), _mm256_castsi256_si128(packed));
+        _mm_storeu_si128((__m128i *)(p_pixels + 3 * i + 12), _mm256_extracti128_si256(packed, 1));
+    }
+    _lookup_scalar(p_indices + i, count - i, p_entries, p_pixels + 3 * i);
+}
+
+#endif  // X86_KERNELS
+
+/**
+ * Approximates the binary logarithm of a positive, normal float. The exponent is taken from the bits of the float,
+ * the logarithm of the mantissa is approximated by a polynomial with an absolute error below 3e-5.
+ * The function has no branches and no calls, so the compiler can vectorize loops that use it.
+ *
+ * @param x The argument.
+ * @return The binary logarithm of x.
+ */
+static inline float _fast_log2(float x) {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    float exponent = (float)((int32_t)(bits >> 23) - 127);
+    bits = (bits & 0x007FFFFF) | 0x3F800000;
+    float mantissa;
+    memcpy(&mantissa, &bits, sizeof(mantissa));
+    float t = mantissa - 1.0f;
+    return exponent + t * (1.4418255f + t * (-0.70867891f + t * (0.41541119f + t * (-0.19440832f + t * 0.04587895f))));
+}
+
+/**
+ * Computes the palette indices of count pixels with integer coloring.
+ *
+ * @param p_palette A pointer to the palette.
+ * @param p_iterations The numbers of iterations of the pixels.
+ * @param count The number of pixels.
+ * @param p_indices A pointer to store the palette indices.
+ */
+void _compute_integer_indices(const Palette *p_palette, const uint32_t *p_iterations, size_t count, uint32_t *p_indices) {
+    uint32_t depth = (uint32_t)p_palette->iteration_depth;
+    uint32_t inner_index = (uint32_t)p_palette->num_entries;
+    float entries_per_iteration = (float)p_palette->entries_per_iteration;
+    float max_index = (float)(inner_index - 1);
+    for (size_t i = 0; i < count; i++) {
+        float scaled = (float)p_iterations[i] * entries_per_iteration;
+        scaled = scaled < max_index ? scaled : max_index;
+        p_indices[i] = p_iterations[i] >= depth ? inner_index : (uint32_t)scaled;
+    }
+}
+
+/**
+ * Computes the palette indices of count pixels with smooth coloring. The fractional number of iterations of an escaped pixel is
+ * n + 1 - log2(log2(|z|)) / log2(d), where n is its number of iterations, |z| the magnitude of its first term outside of the ESCAPE_RADIUS
+ * and d the power of the formula.
+ * It is continuous across the borders between pixels with different numbers of iterations.
+ *
+ * @param p_palette A pointer to the palette.
+ * @param p_iterations The numbers of iterations of the pixels.
+ * @param p_magnitudes The magnitudes of the last terms of the pixels.
+ * @param count The number of pixels.
+ * @param p_indices A pointer to store the palette indices.
+ */
+void _compute_smooth_indices(const Palette *p_palette, const uint32_t *p_iterations, const float *p_magnitudes, size_t count, uint32_t *p_indices) {
+    uint32_t depth = (uint32_t)p_palette->iteration_depth;
+    uint32_t inner_index = (uint32_t)p_palette->num_entries;
+    float max_position = (float)(p_palette->iteration_depth - 1);
+    float entries_per_iteration = (float)p_palette->entries_per_iteration;
+    float max_index = (float)(inner_index - 1);
+    float smooth_scale = p_palette->smooth_scale;
+    for (size_t i = 0; i < count; i++) {
+        float magnitude = p_magnitudes[i] > SMOOTH_MIN_MAGNITUDE ? p_magnitudes[i] : SMOOTH_MIN_MAGNITUDE;
+        float position = (float)p_iterations[i] + 1.0f - _fast_log2(_fast_log2(magnitude)) * smooth_scale;
+        position = position > 0.0f ? position : 0.0f;
+        position = position < max_position ? position : max_position;
+        float scaled = position * entries_per_iteration;
+        scaled = scaled < max_index ? scaled : max_index;
+        p_indices[i] = p_iterations[i] >= depth ? inner_index : (uint32_t)scaled;
+    }
+}
+
+/**
+ * Shades a band of SHADING_BAND_HEIGHT rows of the iteration field.
+ * The palette indices of a chunk of pixels of a row are computed first and looked up afterwards, so both loops can be vectorized.
+ *
+ * @param band_index The index of the band.
+ * @param worker_index The index of the worker thread. Unused.
+ * @param p_context A pointer to the ShadingContext.
+ * @return Status code.
+ */
+int _shade_band(size_t band_index, size_t worker_index, void *p_context) {
+    (void)worker_index;
+    ShadingContext *p_shading_context = (ShadingContext *)p_context;
+    const IterationField *p_field = p_shading_context->p_field;
+    const Palette *p_palette = p_shading_context->p_palette;
+    ImageSize size = p_field->size;
+    size_t y_start = band_index * SHADING_BAND_HEIGHT;
+    size_t y_end = y_start + SHADING_BAND_HEIGHT < size.height ? y_start + SHADING_BAND_HEIGHT : size.height;
+    uint32_t indices[SHADING_CHUNK_SIZE];
+
+    for (size_t y = y_start; y < y_end; y++) {
+        const uint32_t *p_iterations = p_field->iterations + y * size.width;
+        const float *p_magnitudes = p_field->magnitudes + y * size.width;
+        unsigned char *p_row = get_row_in_image_data(p_shading_context->p_image_data, y);
+        for (size_t x = 0; x < size.width; x += SHADING_CHUNK_SIZE) {
+            size_t count = size.width - x < SHADING_CHUNK_SIZE ? size.width - x : SHADING_CHUNK_SIZE;
+            if (p_palette->smooth) {
+                _compute_smooth_indices(p_palette, p_iterations + x, p_magnitudes + x, count, indices);
+            } else {
+                _compute_integer_indices(p_palette, p_iterations + x, count, indices);
+            }
+            p_shading_context->lookup(indices, count, p_palette->entries, p_row + 3 * x);
+        }
+    }
+    return SUCCESS;
+}
+
+/**
+ * Shades a band of SHADING_BAND_HEIGHT rows of the iteration field to color indices, like _shade_band.
+ *
+ * @param band_index The index of the band.
+ * @param worker_index The index of the worker thread. Unused.
+ * @param p_context A pointer to the ShadingContext.
+ * @return Status code.
+ */
+int _shade_band_to_indices(size_t band_index, size_t worker_index, void *p_context) {
+    (void)worker_index;
+    ShadingContext *p_shading_context = (ShadingContext *)p_context;
+    const IterationField *p_field = p_shading_context->p_field;
+    const Palette *p_palette = p_shading_context->p_palette;
+    const uint8_t *p_color_indices = p_shading_context->p_color_indices;
+    ImageSize size = p_field->size;
+    size_t y_start = band_index * SHADING_BAND_HEIGHT;
+    size_t y_end = y_start + SHADING_BAND_HEIGHT < size.height ? y_start + SHADING_BAND_HEIGHT : size.height;
+    uint32_t indices[SHADING_CHUNK_SIZE];
+
+    for (size_t y = y_start; y < y_end; y++) {
+        const uint32_t *p_iterations = p_field->iterations + y * size.width;
+        const float *p_magnitudes = p_field->magnitudes + y * size.width;
+        unsigned char *p_row = get_row_in_indexed_image_data(p_shading_context->p_indexed_image_data, y);
+        for (size_t x = 0; x < size.width; x += SHADING_CHUNK_SIZE) {
+            size_t count = size.width - x < SHADING_CHUNK_SIZE ? size.width - x : SHADING_CHUNK_SIZE;
+            if (p_palette->smooth) {
+                _compute_smooth_indices(p_palette, p_iterations + x, p_magnitudes + x, count, indices);
+            } else {
+                _compute_integer_indices(p_palette, p_iterations + x, count, indices);
+            }
+            for (size_t i = 0; i < count; i++) {
+                p_row[x + i] = p_color_indices[indices[i]];
+            }
+        }
+    }
+    return SUCCESS;
+}
+
+/**
+ * Finds the distinct colors of the entries of a palette, including the inner color, with a small hash table.
+ * Neighboring entries often have the same color, so the color of the previous entry is checked first.
+ *
+ * @param p_palette A pointer to the palette.
+ * @param p_color_indices A pointer to store the index of the color of every entry, num_entries + 1 bytes.
+ * @param p_image_data A pointer to the indexed image data to store the colors in.
+ * @return Status code. ERROR_TOO_MANY_COLORS if there are more than MAX_INDEXED_COLORS colors.
+ */
+int _index_palette_colors(const Palette *p_palette, uint8_t *p_color_indices, IndexedImageData *p_image_data) {
+    // Entries have an unused top byte, so an entry is never UINT32_MAX, which marks an empty slot.
+    uint32_t slot_entries[COLOR_HASH_SIZE];
+    uint8_t slot_indices[COLOR_HASH_SIZE];
+    memset(slot_entries, 0xFF, sizeof(slot_entries));
+    p_image_data->num_colors = 0;
+
+    for (size_t i = 0; i <= p_palette->num_entries; i++) {
+        uint32_t entry = p_palette->entries[i];
+        if (i > 0 && entry == p_palette->entries[i - 1]) {
+            p_color_indices[i] = p_color_indices[i - 1];
+            continue;
+        }
+        size_t slot = (entry * 2654435761u) % COLOR_HASH_SIZE;
+        while (slot_entries[slot] != UINT32_MAX && slot_entries[slot] != entry) {
+            slot = (slot + 1) % COLOR_HASH_SIZE;
+        }
+        if (slot_entries[slot] == UINT32_MAX) {
+            if (p_image_data->num_colors == MAX_INDEXED_COLORS) return ERROR_TOO_MANY_COLORS;
+            slot_entries[slot] = entry;
+            slot_indices[slot] = (uint8_t)p_image_data->num_colors;
+            p_image_data->colors[p_image_data->num_colors++] = entry;
+        }
+        p_color_indices[i] = slot_indices[slot];
+    }
+    return SUCCESS;
+}
+
+int shade_iteration_field(const IterationField *p_field, const Configuration *p_config, ThreadPool *p_thread_pool, ImageData *p_image_data) {
+    if (p_field->size.width != p_image_data->size.width || p_field->size.height != p_image_data->size.height) {
+        return GENERIC_ERROR;
+    }
+
+    Palette palette;
+    int status = compile_palette(p_config, p_field->iteration_depth, &palette);
+    if (status < 0) return status;
+
+    ShadingContext context = {p_field, &palette, _lookup_scalar, p_image_data, NULL, NULL};
+#ifdef X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        context.lookup = _lookup_avx2;
+    }
+#endif
+
+    size_t num_bands = (p_field->size.height + SHADING_BAND_HEIGHT - 1) / SHADING_BAND_HEIGHT;
+    if (p_thread_pool != NULL) {
+        status = run_thread_pool(p_thread_pool, num_bands, _shade_band, &context, NULL);
+    } else {
+        for (size_t band_index = 0; band_index < num_bands && status == SUCCESS; band_index++) {
+            status = _shade_band(band_index, 0, &context);
+        }
+    }
+    free_palette(&palette);
+    return status;
+}
+
+int shade_iteration_field_to_indices(const IterationField *p_field, const Configuration *p_config, ThreadPool *p_thread_pool, IndexedImageData *p_image_data) {
+    if (p_field->size.width != p_image_data->size.width || p_field->size.height != p_image_data->size.height) {
+        return GENERIC_ERROR;
+    }
+
+    Palette palette;
+    int status = compile_palette(p_config, p_field->iteration_depth, &palette);
+    if (status < 0) return status;
+    uint8_t *p_color_indices = (uint8_t *)malloc(palette.num_entries + 1);
+    if (p_color_indices == NULL) {
+        free_palette(&palette);
+        return ERROR_MEMORY_ALLOC;
+    }
+    status = _index_palette_colors(&palette, p_color_indices, p_image_data);
+
+    ShadingContext context = {p_field, &palette, NULL, NULL, p_image_data, p_color_indices};
+    size_t num_bands = (p_field->size.height + SHADING_BAND_HEIGHT - 1) / SHADING_BAND_HEIGHT;
+    if (status == SUCCESS && p_thread_pool != NULL) {
+        status = run_thread_pool(p_thread_pool, num_bands, _shade_band_to_indices, &context, NULL);
+    } else {
+        for (size_t band_index = 0; band_index < num_bands && status == SUCCESS; band_index++) {
+            status = _shade_band_to_indices(band_index, 0, &context);
+        }
+    }
+    free(p_color_indices);
+    free_palette(&palette);
+    return status;
+}
+
+int find_indexed_colors(const Configuration *p_config, size_t iteration_depth, IndexedImageData *p_image_data) {
+    Palette palette;
+    int status = compile_palette(p_config, iteration_depth, &palette);
+    if (status < 0) return status;
+    uint8_t *p_color_indices = (uint8_t *)malloc(palette.num_entries + 1);
+    if (p_color_indices == NULL) {
+        free_palette(&palette);
+        return ERROR_MEMORY_ALLOC;
+    }
+    status = _index_palette_colors(&palette, p_color_indices, p_image_data);
+    free(p_color_indices);
+    free_palette(&palette);
+    return status;
+}
+
+void shade_points(const Palette *p_palette, const uint32_t *p_iterations, const float *p_magnitudes, size_t count, unsigned char *p_pixels) {
+    uint32_t indices[SHADING_MAX_POINTS];
+    if (p_palette->smooth) {
+        _compute_smooth_indices(p_palette, p_iterations, p_magnitudes, count, indices);
+    } else {
+        _compute_integer_indices(p_palette, p_iterations, count, indices);
+    }
+    _lookup_scalar(indices, count, p_palette->entries, p_pixels);
+}
@@ -53,6 +53,69 @@ char* get_status_message(int status_code) {
         case ERROR_INVALID_NUM_CL_ARG:
             return "Invalid number of command line arguments";
             break;
+        case ERROR_INVALID_THREAD_COUNT:
+            return "Invalid number of threads. Please provide a number greater than 0";
+            break;
+        case ERROR_THREAD_CREATE:
+            return "Could not create worker threads";
+            break;
+        case ERROR_ZOOM_TOO_DEEP:
+            return "Zoom too deep. The distance between two pixels is below the supported precision";
+            break;
+        case ERROR_INVALID_CONFIG_VALUE:
+            return "Invalid value in configuration file";
+            break;
+        case ERROR_INVALID_FIELD_FILE:
+            return "Invalid iteration field file";
+            break;
+        case ERROR_INVALID_MEMORY_BUDGET:
+            return "Invalid memory budget. The budget must at least hold a single row of the image, or a row of tiles of a TIFF file";
+            break;
+        case ERROR_INCOMPATIBLE_OPTIONS:
+            return "The given command line options can not be combined";
+            break;
+        case ERROR_INVALID_ZOOM_LEVEL:
+            return "Invalid zoom level. The zoom level must be a number between 0 and 22";
+            break;
+        case ERROR_INVALID_PYRAMID_FORMAT:
+            return "Invalid pyramid format. The format must be xyz or dzi";
+            break;
+        case ERROR_INVALID_CACHE_SIZE:
+            return "Invalid cache size. The size must be a positive number of bytes";
+            break;
+        case ERROR_INVALID_KEYFRAMES:
+            return "Invalid keyframe file. Every keyframe needs a frame number, a center and a positive width, and the frame numbers must increase";
+            break;
+        case ERROR_MOVING_CENTER:
+            return "A log-polar zoom needs the same center in all keyframes";
+            break;
+        case ERROR_SOCKET:
+            return "Error while accessing the socket";
+            break;
+        case ERROR_UNKNOWN_JOB:
+            return "Unknown job";
+            break;
+        case ERROR_INVALID_DAEMON_COMMAND:
+            return "Invalid daemon command";
+            break;
+        case ERROR_INVALID_DEADLINE:
+            return "Invalid deadline. The deadline must be a positive number of seconds";
+            break;
+        case ERROR_BENCHMARK_REGRESSION:
+            return "At least one benchmark run is slower than the baseline";
+            break;
+        case ERROR_INVALID_BENCHMARK_FILE:
+            return "Invalid benchmark file";
+            break;
+        case ERROR_INVALID_BENCHMARK_OPTION:
+            return "Invalid benchmark option. The repetitions must be a positive number and the tolerance a percentage";
+            break;
+        case ERROR_TOO_MANY_COLORS:
+            return "The palette has more than 256 colors, so the image can not be saved with indexed colors. Use fewer iterations or no smooth coloring";
+            break;
+        case ERROR_NO_WORKERS:
+            return "No worker is left to render the image. All workers could not be reached, disconnected or stopped answering";
+            break;
         default:
             return "Generic status message";
             break;
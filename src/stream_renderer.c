@@ -0,0 +1,341 @@
+#include "../include/stream_renderer.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/iteration_field.h"
+#include "../include/metrics.h"
+#include "../include/status_manager.h"
+#include "../include/tiff_writer.h"
+
+/**
+ * The queue of finished bands that are waiting to be written to the file. The band at the head is written first.
+ * A band stays in the queue until it has been written, so its buffer is not reused while the writer thread reads it.
+ */
+typedef struct {
+    // The BMP file the rows of the bands are appended to, or NULL if the bands are written as tiles of a TIFF file.
+    FILE *file;
+    TiffWriter *p_tiff_writer;
+    // Protects all members below.
+    pthread_mutex_t lock;
+    // Signaled when a band is queued, a band has been written or no more bands will be queued.
+    pthread_cond_t changed;
+    ImageData *queue[NUM_STREAM_BUFFERS];
+    // The row of the whole image that is the first row of every queued band.
+    size_t first_rows[NUM_STREAM_BUFFERS];
+    size_t head;
+    size_t count;
+    bool finished;
+    // The status of the first failed write or SUCCESS.
+    int status;
+    // The time the writer thread spent writing and the number of bytes it wrote. Only accessed by the writer thread until it is joined.
+    StageTime write_time;
+    uint64_t num_bytes_written;
+} BandWriter;
+
+/**
+ * The main function of the writer thread. Writes the queued bands to the file until no more bands will be queued.
+ *
+ * @param p_argument A pointer to the BandWriter.
+ * @return NULL.
+ */
+void *_run_band_writer(void *p_argument) {
+    BandWriter *p_writer = (BandWriter *)p_argument;
+
+    pthread_mutex_lock(&p_writer->lock);
+    while (true) {
+        while (p_writer->count == 0 && !p_writer->finished) {
+            pthread_cond_wait(&p_writer->changed, &p_writer->lock);
+        }
+        if (p_writer->count == 0) {
+            break;
+        }
+        ImageData *p_band = p_writer->queue[p_writer->head];
+        size_t first_row = p_writer->first_rows[p_writer->head];
+        bool skip = p_writer->status != SUCCESS;
+        pthread_mutex_unlock(&p_writer->lock);
+
+        // The rows of a band are already in the order of a BMP file, so the band is written with a single call.
+        // The tiles of a TIFF file are encoded on this thread, so the worker threads are left to render the next band.
+        // The CPU time is the time of the writer thread, because the worker threads render the next bands at the same time.
+        size_t band_size = p_band->stride * p_band->size.height;
+        double wall_start = get_monotonic_time();
+        double cpu_start = get_thread_cpu_time();
+        int write_status = SUCCESS;
+        if (!skip && p_writer->p_tiff_writer != NULL) {
+            write_status = write_tiff_band(p_writer->p_tiff_writer, p_band, first_row, NULL);
+        } else if (!skip) {
+            if (fwrite(p_band->data, 1, band_size, p_writer->file) == band_size) {
+                p_writer->num_bytes_written += band_size;
+            } else {
+                write_status = ERROR_FILE_ACCESS;
+            }
+        }
+        p_writer->write_time.wall_time += get_monotonic_time() - wall_start;
+        p_writer->write_time.cpu_time += get_thread_cpu_time() - cpu_start;
+
+        pthread_mutex_lock(&p_writer->lock);
+        if (write_status != SUCCESS) {
+            p_writer->status = write_status;
+        }
+        p_writer->head = (p_writer->head + 1) % NUM_STREAM_BUFFERS;
+        p_writer->count--;
+        pthread_cond_broadcast(&p_writer->changed);
+    }
+    pthread_mutex_unlock(&p_writer->lock);
+    return NULL;
+}
+
+/**
+ * Blocks until a buffer is free for the next band, which is the case when less than NUM_STREAM_BUFFERS bands are queued.
+ *
+ * @param p_writer A pointer to the BandWriter.
+ * @return Status code. The status of the first failed write or SUCCESS.
+ */
+int _wait_for_free_buffer(BandWriter *p_writer) {
+    pthread_mutex_lock(&p_writer->lock);
+    while (p_writer->count == NUM_STREAM_BUFFERS && p_writer->status == SUCCESS) {
+        pthread_cond_wait(&p_writer->changed, &p_writer->lock);
+    }
+    int status = p_writer->status;
+    pthread_mutex_unlock(&p_writer->lock);
+    return status;
+}
+
+/**
+ * Appends a finished band to the queue of the writer thread. There must be a free buffer, see _wait_for_free_buffer.
+ *
+ * @param p_writer A pointer to the BandWriter.
+ * @param p_band A pointer to the image data of the band.
+ * @param first_row The row of the whole image that is the first row of the band.
+ */
+void _queue_band(BandWriter *p_writer, ImageData *p_band, size_t first_row) {
+    pthread_mutex_lock(&p_writer->lock);
+    p_writer->queue[(p_writer->head + p_writer->count) % NUM_STREAM_BUFFERS] = p_band;
+    p_writer->first_rows[(p_writer->head + p_writer->count) % NUM_STREAM_BUFFERS] = first_row;
+    p_writer->count++;
+    pthread_cond_broadcast(&p_writer->changed);
+    pthread_mutex_unlock(&p_writer->lock);
+}
+
+int get_stream_band_height(Configuration config, ImageSize size, size_t memory_budget, bool mapped, size_t *p_band_height) {
+    if (size.width == 0 || size.height == 0) return ERROR_IMAGE_SIZE_0;
+    if (size.width > (SIZE_MAX - 3) / 3) return ERROR_ARITHMETIC_OVERFLOW;
+
+    // The iteration field of the band, the glitch buffers of deep zoom renders and the image data of every band buffer.
+    // Mapped image data is written directly to the file, so it has no band buffers.
+    size_t bytes_per_pixel = sizeof(uint32_t) + sizeof(float);
+    if (config.deep_zoom) {
+        bytes_per_pixel += sizeof(bool) + sizeof(size_t);
+    }
+    size_t row_size = get_bmp_row_size(size.width);
+    if (size.width > SIZE_MAX / bytes_per_pixel / 2 || row_size > SIZE_MAX / NUM_STREAM_BUFFERS / 2) return ERROR_ARITHMETIC_OVERFLOW;
+    size_t bytes_per_row = size.width * bytes_per_pixel + (mapped ? 0 : NUM_STREAM_BUFFERS * row_size);
+
+    size_t band_height = memory_budget / bytes_per_row;
+    if (band_height == 0) return ERROR_INVALID_MEMORY_BUDGET;
+    if (band_height >= size.height) {
+        band_height = size.height;
+    } else if (band_height >= TILE_SIZE) {
+        band_height -= band_height % TILE_SIZE;
+    }
+    *p_band_height = band_height;
+    return SUCCESS;
+}
+
+/**
+ * Renders the bands of a streaming render from the bottom to the top. Every band is either rendered into a band buffer
+ * and queued for the writer thread, or rendered directly into its rows of the image data of the whole image.
+ *
+ * @param p_config A pointer to the configuration struct.
+ * @param p_thread_pool The thread pool or NULL.
+ * @param p_tile_cache The tile cache or NULL.
+ * @param p_writer A pointer to the BandWriter whose thread is running, or NULL to render into p_image_data.
+ * @param p_field A pointer to an iteration field that is large enough for a band.
+ * @param p_bands The image data of the band buffers. Every buffer is large enough for a band. Unused without a writer.
+ * @param p_image_data A pointer to the image data of the whole image. Unused with a writer.
+ * @param size The size of the whole image in pixels.
+ * @param band_height The number of rows of a band.
+ * @param progress_callback A callback function to output the progress.
+ * @param p_statistics A pointer to store statistics about the render, or NULL.
+ * @return Status code.
+ */
+int _render_bands(const Configuration *p_config, ThreadPool *p_thread_pool, TileCache *p_tile_cache, BandWriter *p_writer, IterationField *p_field,
+                  ImageData **p_bands, ImageData *p_image_data, ImageSize size, size_t band_height, void (*progress_callback)(double),
+                  RenderStatistics *p_statistics) {
+    // The bands are aligned to the top of the image, so only the band at the bottom may be lower than the others.
+    size_t num_bands = (size.height + band_height - 1) / band_height;
+    RenderStatistics band_statistics;
+    int status = SUCCESS;
+
+    for (size_t i = 0; i < num_bands && status == SUCCESS; i++) {
+        size_t first_row = (num_bands - 1 - i) * band_height;
+        size_t num_rows = size.height - first_row < band_height ? size.height - first_row : band_height;
+        // The rows of a band are stored from the bottom to the top, so its image data starts at the last row of the band.
+        ImageData band;
+        ImageData *p_band = &band;
+        if (p_writer != NULL) {
+            p_band = p_bands[i % NUM_STREAM_BUFFERS];
+            status = _wait_for_free_buffer(p_writer);
+            if (status != SUCCESS) break;
+        } else {
+            memset(&band, 0, sizeof(ImageData));
+            band.size.width = size.width;
+            band.data = get_row_in_image_data(p_image_data, first_row + num_rows - 1);
+            band.stride = p_image_data->stride;
+        }
+        p_field->size.height = num_rows;
+        p_band->size.height = num_rows;
+        status = render_band_to_image(*p_config, p_thread_pool, p_tile_cache, first_row, p_field, p_band, progress_callback, (double)i / num_bands,
+                                      (double)(i + 1) / num_bands, &band_statistics);
+        if (status != SUCCESS) break;
+        if (p_statistics != NULL) {
+            p_statistics->num_iterated_pixels += band_statistics.num_iterated_pixels;
+            p_statistics->num_cache_hits += band_statistics.num_cache_hits;
+            p_statistics->num_cache_misses += band_statistics.num_cache_misses;
+            p_statistics->num_supersampled_pixels += band_statistics.num_supersampled_pixels;
+            p_statistics->num_extra_samples += band_statistics.num_extra_samples;
+            add_iteration_histogram(&p_statistics->histogram, &band_statistics.histogram);
+            add_stage_time(&p_statistics->compute_time, &band_statistics.compute_time);
+            add_stage_time(&p_statistics->shade_time, &band_statistics.shade_time);
+        }
+        if (p_writer != NULL) {
+            _queue_band(p_writer, p_band, first_row);
+        }
+    }
+    return status;
+}
+
+/**
+ * Renders an image band by band and writes every finished band on a writer thread, either as rows of a BMP file or as tiles of a TIFF file.
+ *
+ * @param config The configuration struct.
+ * @param p_thread_pool The thread pool or NULL.
+ * @param p_tile_cache The tile cache or NULL.
+ * @param size The size of the image in pixels.
+ * @param memory_budget The maximum number of bytes of the per pixel buffers.
+ * @param output_path The path of the file.
+ * @param tiff Whether the file is a TIFF file instead of a BMP file.
+ * @param progress_callback A callback function to output the progress.
+ * @param p_statistics A pointer to store statistics about the render, or NULL.
+ * @return Status code.
+ */
+int _render_to_stream(Configuration config, ThreadPool *p_thread_pool, TileCache *p_tile_cache, ImageSize size, size_t memory_budget,
+                      const char *output_path, bool tiff, void (*progress_callback)(double), RenderStatistics *p_statistics) {
+    size_t band_height;
+    int status = get_stream_band_height(config, size, memory_budget, false, &band_height);
+    if (status < 0) return status;
+    // Every band of a TIFF file is a row of whole tiles.
+    if (tiff && band_height < size.height) {
+        band_height -= band_height % TIFF_TILE_SIZE;
+        if (band_height == 0) return ERROR_INVALID_MEMORY_BUDGET;
+    }
+    if (p_statistics != NULL) {
+        memset(p_statistics, 0, sizeof(RenderStatistics));
+    }
+
+    ImageSize band_size = {size.width, band_height};
+    IterationField field;
+    status = create_iteration_field(band_size, config.iteration_depth, &field);
+    if (status < 0) return status;
+    ImageData *p_bands[NUM_STREAM_BUFFERS] = {NULL};
+    for (size_t i = 0; i < NUM_STREAM_BUFFERS && status == SUCCESS; i++) {
+        status = create_image_data_with_size(band_size, &p_bands[i]);
+    }
+
+    BandWriter writer;
+    memset(&writer, 0, sizeof(BandWriter));
+    if (status == SUCCESS && tiff) {
+        status = open_tiff_writer(output_path, size, &writer.p_tiff_writer);
+    } else if (status == SUCCESS) {
+        writer.file = fopen(output_path, "wb");
+        status = writer.file != NULL ? write_bmp_header(writer.file, size) : ERROR_FILE_ACCESS;
+        if (status == SUCCESS) {
+            writer.num_bytes_written = sizeof(BitmapFileHeader) + sizeof(BitmapInfoHeader);
+        }
+    }
+
+    pthread_t writer_thread;
+    if (status == SUCCESS) {
+        pthread_mutex_init(&writer.lock, NULL);
+        pthread_cond_init(&writer.changed, NULL);
+        if (pthread_create(&writer_thread, NULL, _run_band_writer, &writer) != 0) {
+            status = ERROR_THREAD_CREATE;
+        } else {
+            status = _render_bands(&config, p_thread_pool, p_tile_cache, &writer, &field, p_bands, NULL, size, band_height, progress_callback, p_statistics);
+
+            // Let the writer thread write the remaining bands and wait for it.
+            pthread_mutex_lock(&writer.lock);
+            writer.finished = true;
+            pthread_cond_broadcast(&writer.changed);
+            pthread_mutex_unlock(&writer.lock);
+            pthread_join(writer_thread, NULL);
+            if (status == SUCCESS) {
+                status = writer.status;
+            }
+        }
+        pthread_cond_destroy(&writer.changed);
+        pthread_mutex_destroy(&writer.lock);
+    }
+
+    if (writer.file != NULL) {
+        StageClock close_clock;
+        start_stage_clock(&close_clock);
+        if (fclose(writer.file) != 0 && status == SUCCESS) {
+            status = ERROR_FILE_ACCESS;
+        }
+        stop_stage_clock(&close_clock, &writer.write_time);
+    }
+    if (writer.p_tiff_writer != NULL) {
+        StageClock close_clock;
+        start_stage_clock(&close_clock);
+        int close_status = close_tiff_writer(writer.p_tiff_writer, &writer.num_bytes_written);
+        if (status == SUCCESS) {
+            status = close_status;
+        }
+        stop_stage_clock(&close_clock, &writer.write_time);
+    }
+    if (p_statistics != NULL) {
+        p_statistics->write_time = writer.write_time;
+        p_statistics->num_bytes_written = writer.num_bytes_written;
+    }
+    for (size_t i = 0; i < NUM_STREAM_BUFFERS; i++) {
+        if (p_bands[i] != NULL) {
+            free_image_data(p_bands[i]);
+        }
+    }
+    free_iteration_field(&field);
+    return status;
+}
+
+int render_to_bmp_stream(Configuration config, ThreadPool *p_thread_pool, TileCache *p_tile_cache, ImageSize size, size_t memory_budget,
+                         const char *output_path, void (*progress_callback)(double), RenderStatistics *p_statistics) {
+    return _render_to_stream(config, p_thread_pool, p_tile_cache, size, memory_budget, output_path, false, progress_callback, p_statistics);
+}
+
+int render_to_tiff_stream(Configuration config, ThreadPool *p_thread_pool, TileCache *p_tile_cache, ImageSize size, size_t memory_budget,
+                          const char *output_path, void (*progress_callback)(double), RenderStatistics *p_statistics) {
+    return _render_to_stream(config, p_thread_pool, p_tile_cache, size, memory_budget, output_path, true, progress_callback, p_statistics);
+}
+
+int render_to_mapped_image(Configuration config, ThreadPool *p_thread_pool, TileCache *p_tile_cache, ImageData *p_image_data, size_t memory_budget,
+                           void (*progress_callback)(double), RenderStatistics *p_statistics) {
+    ImageSize size = p_image_data->size;
+    size_t band_height;
+    int status = get_stream_band_height(config, size, memory_budget, true, &band_height);
+    if (status < 0) return status;
+    if (p_statistics != NULL) {
+        memset(p_statistics, 0, sizeof(RenderStatistics));
+    }
+
+    ImageSize band_size = {size.width, band_height};
+    IterationField field;
+    status = create_iteration_field(band_size, config.iteration_depth, &field);
+    if (status < 0) return status;
+    status = _render_bands(&config, p_thread_pool, p_tile_cache, NULL, &field, NULL, p_image_data, size, band_height, progress_callback, p_statistics);
+    free_iteration_field(&field);
+    return status;
+}
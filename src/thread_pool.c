@@ -0,0 +1,267 @@
+#include "../include/thread_pool.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "../include/status_manager.h"
+
+/**
+ * The task deque of a single worker. The deque holds the task indices in the range [head, tail).
+ * The owner takes tasks from the tail, thieves take tasks from the head.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    size_t head;
+    size_t tail;
+} TaskDeque;
+
+/**
+ * The arguments passed to a worker thread.
+ */
+typedef struct {
+    ThreadPool *p_pool;
+    size_t worker_index;
+} WorkerArguments;
+
+struct ThreadPool {
+    size_t num_threads;
+    pthread_t *threads;
+    WorkerArguments *worker_arguments;
+    TaskDeque *deques;
+
+    // Serializes batches that are started from different threads.
+    pthread_mutex_t run_lock;
+    // Protects all members below.
+    pthread_mutex_t lock;
+    // Signaled when a new batch is started or the pool is shut down.
+    pthread_cond_t work_available;
+    // Signaled when a task has been completed or a worker has finished the batch.
+    pthread_cond_t task_completed;
+
+    bool shutdown;
+    size_t batch_id;
+    size_t num_active_workers;
+
+    // The current batch.
+    size_t num_tasks;
+    size_t num_completed;
+    TaskFunction task;
+    void *p_context;
+    int batch_status;
+};
+
+size_t get_num_processors(void) {
+#ifdef _WIN32
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    long num_processors = (long)system_info.dwNumberOfProcessors;
+#else
+    long num_processors = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (num_processors < 1) {
+        return 1;
+    }
+    return (size_t)num_processors;
+}
+
+/**
+ * Takes the next task for the given worker. The worker first takes the newest task of its own deque.
+ * If its own deque is empty, it steals the oldest task of the deque of another worker.
+ *
+ * @param p_pool The thread pool.
+ * @param worker_index The index of the worker.
+ * @param p_task_index A pointer to store the index of the task.
+ * @return True if a task was found, false if all deques are empty.
+ */
+bool _take_task(ThreadPool *p_pool, size_t worker_index, size_t *p_task_index) {
+    TaskDeque *p_own = &p_pool->deques[worker_index];
+    pthread_mutex_lock(&p_own->lock);
+    if (p_own->head < p_own->tail) {
+        *p_task_index = --p_own->tail;
+        pthread_mutex_unlock(&p_own->lock);
+        return true;
+    }
+    pthread_mutex_unlock(&p_own->lock);
+
+    for (size_t offset = 1; offset < p_pool->num_threads; offset++) {
+        TaskDeque *p_victim = &p_pool->deques[(worker_index + offset) % p_pool->num_threads];
+        pthread_mutex_lock(&p_victim->lock);
+        if (p_victim->head < p_victim->tail) {
+            *p_task_index = p_victim->head++;
+            pthread_mutex_unlock(&p_victim->lock);
+            return true;
+        }
+        pthread_mutex_unlock(&p_victim->lock);
+    }
+    return false;
+}
+
+/**
+ * The main function of a worker thread. Waits for batches and executes tasks until the pool is shut down.
+ *
+ * @param p_arguments A pointer to the WorkerArguments of the worker.
+ * @return Always NULL.
+ */
+void *_worker_main(void *p_arguments) {
+    ThreadPool *p_pool = ((WorkerArguments *)p_arguments)->p_pool;
+    size_t worker_index = ((WorkerArguments *)p_arguments)->worker_index;
+    size_t seen_batch_id = 0;
+
+    pthread_mutex_lock(&p_pool->lock);
+    while (true) {
+        while (!p_pool->shutdown && p_pool->batch_id == seen_batch_id) {
+            pthread_cond_wait(&p_pool->work_available, &p_pool->lock);
+        }
+        if (p_pool->shutdown) {
+            break;
+        }
+        seen_batch_id = p_pool->batch_id;
+        bool batch_failed = p_pool->batch_status != SUCCESS;
+        pthread_mutex_unlock(&p_pool->lock);
+
+        size_t task_index;
+        while (_take_task(p_pool, worker_index, &task_index)) {
+            // Once a task has failed, the remaining tasks are only counted as completed.
+            int status = SUCCESS;
+            if (!batch_failed) {
+                status = p_pool->task(task_index, worker_index, p_pool->p_context);
+            }
+
+            pthread_mutex_lock(&p_pool->lock);
+            if (status < 0 && p_pool->batch_status == SUCCESS) {
+                p_pool->batch_status = status;
+            }
+            batch_failed = p_pool->batch_status != SUCCESS;
+            p_pool->num_completed++;
+            pthread_cond_signal(&p_pool->task_completed);
+            pthread_mutex_unlock(&p_pool->lock);
+        }
+
+        pthread_mutex_lock(&p_pool->lock);
+        p_pool->num_active_workers--;
+        pthread_cond_signal(&p_pool->task_completed);
+    }
+    pthread_mutex_unlock(&p_pool->lock);
+    return NULL;
+}
+
+int create_thread_pool(size_t num_threads, ThreadPool **p_p_pool) {
+    if (num_threads == 0) {
+        return ERROR_INVALID_THREAD_COUNT;
+    }
+
+    ThreadPool *p_pool = (ThreadPool *)calloc(1, sizeof(ThreadPool));
+    if (p_pool == NULL) {
+        return ERROR_MEMORY_ALLOC;
+    }
+    p_pool->threads = (pthread_t *)calloc(num_threads, sizeof(pthread_t));
+    p_pool->worker_arguments = (WorkerArguments *)calloc(num_threads, sizeof(WorkerArguments));
+    p_pool->deques = (TaskDeque *)calloc(num_threads, sizeof(TaskDeque));
+    if (p_pool->threads == NULL || p_pool->worker_arguments == NULL || p_pool->deques == NULL) {
+        free(p_pool->threads);
+        free(p_pool->worker_arguments);
+        free(p_pool->deques);
+        free(p_pool);
+        return ERROR_MEMORY_ALLOC;
+    }
+
+    pthread_mutex_init(&p_pool->run_lock, NULL);
+    pthread_mutex_init(&p_pool->lock, NULL);
+    pthread_cond_init(&p_pool->work_available, NULL);
+    pthread_cond_init(&p_pool->task_completed, NULL);
+
+    for (size_t i = 0; i < num_threads; i++) {
+        p_pool->worker_arguments[i].p_pool = p_pool;
+        p_pool->worker_arguments[i].worker_index = i;
+        pthread_mutex_init(&p_pool->deques[i].lock, NULL);
+        if (pthread_create(&p_pool->threads[i], NULL, _worker_main, &p_pool->worker_arguments[i]) != 0) {
+            // Only the threads that were started successfully must be joined.
+            pthread_mutex_destroy(&p_pool->deques[i].lock);
+            p_pool->num_threads = i;
+            free_thread_pool(p_pool);
+            return ERROR_THREAD_CREATE;
+        }
+        p_pool->num_threads = i + 1;
+    }
+
+    *p_p_pool = p_pool;
+    return SUCCESS;
+}
+
+size_t get_thread_pool_size(const ThreadPool *p_pool) {
+    return p_pool->num_threads;
+}
+
+int run_thread_pool(ThreadPool *p_pool, size_t num_tasks, TaskFunction task, void *p_context, TaskProgressFunction progress) {
+    if (num_tasks == 0) {
+        return SUCCESS;
+    }
+
+    pthread_mutex_lock(&p_pool->run_lock);
+
+    // Distribute the tasks in contiguous blocks, so neighbouring tasks are likely executed by the same worker.
+    for (size_t i = 0; i < p_pool->num_threads; i++) {
+        p_pool->deques[i].head = i * num_tasks / p_pool->num_threads;
+        p_pool->deques[i].tail = (i + 1) * num_tasks / p_pool->num_threads;
+    }
+
+    pthread_mutex_lock(&p_pool->lock);
+    p_pool->num_tasks = num_tasks;
+    p_pool->num_completed = 0;
+    p_pool->task = task;
+    p_pool->p_context = p_context;
+    p_pool->batch_status = SUCCESS;
+    p_pool->num_active_workers = p_pool->num_threads;
+    p_pool->batch_id++;
+    pthread_cond_broadcast(&p_pool->work_available);
+
+    size_t reported = 0;
+    while (p_pool->num_completed < num_tasks || p_pool->num_active_workers > 0) {
+        pthread_cond_wait(&p_pool->task_completed, &p_pool->lock);
+        if (progress != NULL && p_pool->num_completed != reported) {
+            reported = p_pool->num_completed;
+            // The callback must not block the workers, so it is called without holding the lock.
+            pthread_mutex_unlock(&p_pool->lock);
+            progress(reported, num_tasks, p_context);
+            pthread_mutex_lock(&p_pool->lock);
+        }
+    }
+    int status = p_pool->batch_status;
+    pthread_mutex_unlock(&p_pool->lock);
+    pthread_mutex_unlock(&p_pool->run_lock);
+    return status;
+}
+
+void free_thread_pool(ThreadPool *p_pool) {
+    if (p_pool == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&p_pool->lock);
+    p_pool->shutdown = true;
+    pthread_cond_broadcast(&p_pool->work_available);
+    pthread_mutex_unlock(&p_pool->lock);
+
+    for (size_t i = 0; i < p_pool->num_threads; i++) {
+        pthread_join(p_pool->threads[i], NULL);
+    }
+
+    for (size_t i = 0; i < p_pool->num_threads; i++) {
+        pthread_mutex_destroy(&p_pool->deques[i].lock);
+    }
+    pthread_cond_destroy(&p_pool->task_completed);
+    pthread_cond_destroy(&p_pool->work_available);
+    pthread_mutex_destroy(&p_pool->lock);
+    pthread_mutex_destroy(&p_pool->run_lock);
+    free(p_pool->threads);
+    free(p_pool->worker_arguments);
+    free(p_pool->deques);
+    free(p_pool);
+}
@@ -0,0 +1,342 @@
+#include "../include/tiff_writer.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/deflate.h"
+#include "../include/status_manager.h"
+
+/**
+ * The size of the header of a BigTIFF file: the byte order, the version 43, the size of offsets, a reserved field and the offset of the directory.
+ */
+#define BIGTIFF_HEADER_SIZE 16
+#define BIGTIFF_DIRECTORY_OFFSET_POSITION 8
+
+/**
+ * The tags of the directory, in the ascending order in which they must be stored, and the types of their values.
+ */
+#define TIFF_TAG_IMAGE_WIDTH 256
+#define TIFF_TAG_IMAGE_LENGTH 257
+#define TIFF_TAG_BITS_PER_SAMPLE 258
+#define TIFF_TAG_COMPRESSION 259
+#define TIFF_TAG_PHOTOMETRIC_INTERPRETATION 262
+#define TIFF_TAG_SAMPLES_PER_PIXEL 277
+#define TIFF_TAG_PLANAR_CONFIGURATION 284
+#define TIFF_TAG_TILE_WIDTH 322
+#define TIFF_TAG_TILE_LENGTH 323
+#define TIFF_TAG_TILE_OFFSETS 324
+#define TIFF_TAG_TILE_BYTE_COUNTS 325
+#define TIFF_NUM_TAGS 11
+#define TIFF_TYPE_SHORT 3
+#define TIFF_TYPE_LONG 4
+#define TIFF_TYPE_LONG8 16
+
+/**
+ * The values of the tags: zlib compressed tiles of RGB pixels whose channels are stored together.
+ */
+#define TIFF_COMPRESSION_DEFLATE 8
+#define TIFF_PHOTOMETRIC_RGB 2
+#define TIFF_PLANAR_CONTIGUOUS 1
+#define TIFF_SAMPLES_PER_PIXEL 3
+
+// The header of the zlib stream of every tile: deflate with a window of 32 KiB and the default compression level.
+static const unsigned char ZLIB_HEADER[2] = {0x78, 0x9C};
+
+struct TiffWriter {
+    FILE *file;
+    ImageSize size;
+    size_t num_tiles_x;
+    size_t num_tiles_y;
+    // Protects the file and all members below.
+    pthread_mutex_t lock;
+    // The offset and the size of every tile in the file, row by row. The size is 0 until the tile is written.
+    uint64_t *tile_offsets;
+    uint64_t *tile_sizes;
+    // The offset at which the next tile is appended.
+    uint64_t end_offset;
+};
+
+/**
+ * The tiles of a band that are encoded by the tasks of write_tiff_band.
+ */
+typedef struct {
+    TiffWriter *p_writer;
+    const ImageData *p_band;
+    size_t first_row;
+    // The row of tiles that contains the first row of the band.
+    size_t first_tile_y;
+} TiffBand;
+
+/**
+ * Appends a number to a buffer in little-endian byte order, the byte order of the header.
+ *
+ * @param p_buffer A pointer to the buffer.
+ * @param value The number.
+ * @param num_bytes The number of bytes of the number.
+ * @return Status code.
+ */
+int _append_little_endian(ByteBuffer *p_buffer, uint64_t value, size_t num_bytes) {
+    unsigned char bytes[8];
+    for (size_t i = 0; i < num_bytes; i++) {
+        bytes[i] = (unsigned char)(value >> (8 * i));
+    }
+    return append_to_byte_buffer(p_buffer, bytes, num_bytes);
+}
+
+/**
+ * Appends an entry of the directory. Values that fit into the 8 bytes of the entry are stored in it, all others at the given offset.
+ *
+ * @param p_buffer A pointer to the buffer.
+ * @param tag The tag.
+ * @param type The type of the values.
+ * @param count The number of values.
+ * @param values The values, or NULL if they are stored at the offset.
+ * @param offset The offset of the values in the file if they do not fit into the entry.
+ * @return Status code.
+ */
+int _append_tiff_entry(ByteBuffer *p_buffer, uint16_t tag, uint16_t type, uint64_t count, const uint64_t *values, uint64_t offset) {
+    size_t value_size = type == TIFF_TYPE_SHORT ? 2 : type == TIFF_TYPE_LONG ? 4 : 8;
+    int status = _append_little_endian(p_buffer, tag, 2);
+    if (status == SUCCESS) status = _append_little_endian(p_buffer, type, 2);
+    if (status == SUCCESS) status = _append_little_endian(p_buffer, count, 8);
+    if (status != SUCCESS) return status;
+    if (values == NULL) {
+        return _append_little_endian(p_buffer, offset, 8);
+    }
+    // The values are left-justified in the entry.
+    for (uint64_t i = 0; i < count && status == SUCCESS; i++) {
+        status = _append_little_endian(p_buffer, values[i], value_size);
+    }
+    for (size_t i = (size_t)count * value_size; i < 8 && status == SUCCESS; i++) {
+        status = _append_little_endian(p_buffer, 0, 1);
+    }
+    return status;
+}
+
+int open_tiff_writer(const char *output_path, ImageSize size, TiffWriter **p_p_writer) {
+    if (size.width == 0 || size.height == 0) return ERROR_IMAGE_SIZE_0;
+    if (size.width > UINT32_MAX || size.height > UINT32_MAX) return ERROR_ARITHMETIC_OVERFLOW;
+    size_t num_tiles_x = (size.width + TIFF_TILE_SIZE - 1) / TIFF_TILE_SIZE;
+    size_t num_tiles_y = (size.height + TIFF_TILE_SIZE - 1) / TIFF_TILE_SIZE;
+
+    TiffWriter *p_writer = (TiffWriter *)calloc(1, sizeof(TiffWriter));
+    if (p_writer == NULL) return ERROR_MEMORY_ALLOC;
+    p_writer->size = size;
+    p_writer->num_tiles_x = num_tiles_x;
+    p_writer->num_tiles_y = num_tiles_y;
+    p_writer->tile_offsets = (uint64_t *)calloc(num_tiles_x * num_tiles_y, sizeof(uint64_t));
+    p_writer->tile_sizes = (uint64_t *)calloc(num_tiles_x * num_tiles_y, sizeof(uint64_t));
+    if (p_writer->tile_offsets == NULL || p_writer->tile_sizes == NULL) {
+        free(p_writer->tile_offsets);
+        free(p_writer->tile_sizes);
+        free(p_writer);
+        return ERROR_MEMORY_ALLOC;
+    }
+
+    // The header: little-endian, BigTIFF, 8 byte offsets. The offset of the directory is written when the file is closed.
+    const unsigned char header[BIGTIFF_HEADER_SIZE] = {'I', 'I', 43, 0, 8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    p_writer->file = fopen(output_path, "wb");
+    if (p_writer->file == NULL || fwrite(header, 1, sizeof(header), p_writer->file) != sizeof(header)) {
+        if (p_writer->file != NULL) {
+            fclose(p_writer->file);
+        }
+        free(p_writer->tile_offsets);
+        free(p_writer->tile_sizes);
+        free(p_writer);
+        return ERROR_FILE_ACCESS;
+    }
+    p_writer->end_offset = BIGTIFF_HEADER_SIZE;
+    pthread_mutex_init(&p_writer->lock, NULL);
+    *p_p_writer = p_writer;
+    return SUCCESS;
+}
+
+/**
+ * Encodes a tile of a band and appends it to the file. The pixels are converted from blue, green, red to red, green, blue
+ * and compressed as a zlib stream of their own.
+ *
+ * @param task_index The index of the tile within the band, row by row.
+ * @param worker_index The index of the worker thread, unused.
+ * @param p_context A pointer to the TiffBand.
+ * @return Status code.
+ */
+int _write_tiff_tile(size_t task_index, size_t worker_index, void *p_context) {
+    (void)worker_index;
+    TiffBand *p_tiff_band = (TiffBand *)p_context;
+    TiffWriter *p_writer = p_tiff_band->p_writer;
+    size_t tile_x = task_index % p_writer->num_tiles_x;
+    size_t tile_y = p_tiff_band->first_tile_y + task_index / p_writer->num_tiles_x;
+    size_t first_x = tile_x * TIFF_TILE_SIZE;
+    size_t width = p_writer->size.width - first_x < TIFF_TILE_SIZE ? p_writer->size.width - first_x : TIFF_TILE_SIZE;
+    size_t tile_size = (size_t)TIFF_TILE_SIZE * TIFF_TILE_SIZE * TIFF_SAMPLES_PER_PIXEL;
+
+    // Rows and columns beyond the edges of the image stay black.
+    unsigned char *p_pixels = (unsigned char *)calloc(tile_size, 1);
+    if (p_pixels == NULL) return ERROR_MEMORY_ALLOC;
+    for (size_t row = 0; row < TIFF_TILE_SIZE; row++) {
+        size_t y = tile_y * TIFF_TILE_SIZE + row;
+        if (y >= p_writer->size.height) break;
+        const unsigned char *p_source = get_row_in_image_data(p_tiff_band->p_band, y - p_tiff_band->first_row) + 3 * first_x;
+        unsigned char *p_destination = p_pixels + row * TIFF_TILE_SIZE * TIFF_SAMPLES_PER_PIXEL;
+        for (size_t x = 0; x < width; x++) {
+            p_destination[3 * x] = p_source[3 * x + 2];
+            p_destination[3 * x + 1] = p_source[3 * x + 1];
+            p_destination[3 * x + 2] = p_source[3 * x];
+        }
+    }
+
+    ByteBuffer output;
+    memset(&output, 0, sizeof(ByteBuffer));
+    int status = append_to_byte_buffer(&output, ZLIB_HEADER, sizeof(ZLIB_HEADER));
+    if (status == SUCCESS) {
+        status = deflate_segment(p_pixels, 0, tile_size, true, &output);
+    }
+    if (status == SUCCESS) {
+        uint32_t adler = update_adler32(1, p_pixels, tile_size);
+        unsigned char trailer[4] = {(unsigned char)(adler >> 24), (unsigned char)(adler >> 16), (unsigned char)(adler >> 8), (unsigned char)adler};
+        status = append_to_byte_buffer(&output, trailer, sizeof(trailer));
+    }
+    free(p_pixels);
+
+    // The tiles are appended in the order they are finished, the directory records where each one ended up.
+    if (status == SUCCESS) {
+        pthread_mutex_lock(&p_writer->lock);
+        if (fwrite(output.data, 1, output.size, p_writer->file) != output.size) {
+            status = ERROR_FILE_ACCESS;
+        } else {
+            size_t tile_index = tile_y * p_writer->num_tiles_x + tile_x;
+            p_writer->tile_offsets[tile_index] = p_writer->end_offset;
+            p_writer->tile_sizes[tile_index] = output.size;
+            p_writer->end_offset += output.size;
+        }
+        pthread_mutex_unlock(&p_writer->lock);
+    }
+    free_byte_buffer(&output);
+    return status;
+}
+
+int write_tiff_band(TiffWriter *p_writer, const ImageData *p_band, size_t first_row, ThreadPool *p_thread_pool) {
+    size_t end_row = first_row + p_band->size.height;
+    if (p_band->size.width != p_writer->size.width || first_row % TIFF_TILE_SIZE != 0 || end_row > p_writer->size.height ||
+        (end_row % TIFF_TILE_SIZE != 0 && end_row != p_writer->size.height)) {
+        return GENERIC_ERROR;
+    }
+    TiffBand band = {p_writer, p_band, first_row, first_row / TIFF_TILE_SIZE};
+    size_t num_tile_rows = (end_row + TIFF_TILE_SIZE - 1) / TIFF_TILE_SIZE - band.first_tile_y;
+    size_t num_tiles = num_tile_rows * p_writer->num_tiles_x;
+
+    int status = SUCCESS;
+    if (p_thread_pool != NULL) {
+        status = run_thread_pool(p_thread_pool, num_tiles, _write_tiff_tile, &band, NULL);
+    } else {
+        for (size_t tile_index = 0; tile_index < num_tiles && status == SUCCESS; tile_index++) {
+            status = _write_tiff_tile(tile_index, 0, &band);
+        }
+    }
+    return status;
+}
+
+/**
+ * Builds the directory of the image and the arrays of the offsets and sizes of the tiles that follow it.
+ *
+ * @param p_writer A pointer to the writer.
+ * @param directory_offset The offset of the directory in the file.
+ * @param p_buffer A pointer to the buffer to append the directory to.
+ * @return Status code.
+ */
+int _build_tiff_directory(const TiffWriter *p_writer, uint64_t directory_offset, ByteBuffer *p_buffer) {
+    uint64_t num_tiles = (uint64_t)p_writer->num_tiles_x * p_writer->num_tiles_y;
+    // The arrays of more than one tile follow the directory: its count, its entries and the offset of the next directory.
+    uint64_t offsets_offset = directory_offset + 8 + TIFF_NUM_TAGS * 20 + 8;
+    uint64_t sizes_offset = offsets_offset + 8 * num_tiles;
+    const uint64_t *inline_offsets = num_tiles == 1 ? p_writer->tile_offsets : NULL;
+    const uint64_t *inline_sizes = num_tiles == 1 ? p_writer->tile_sizes : NULL;
+    uint64_t width = p_writer->size.width;
+    uint64_t height = p_writer->size.height;
+    uint64_t bits_per_sample[TIFF_SAMPLES_PER_PIXEL] = {8, 8, 8};
+    uint64_t compression = TIFF_COMPRESSION_DEFLATE;
+    uint64_t photometric_interpretation = TIFF_PHOTOMETRIC_RGB;
+    uint64_t samples_per_pixel = TIFF_SAMPLES_PER_PIXEL;
+    uint64_t planar_configuration = TIFF_PLANAR_CONTIGUOUS;
+    uint64_t tile_size = TIFF_TILE_SIZE;
+
+    int status = _append_little_endian(p_buffer, TIFF_NUM_TAGS, 8);
+    if (status == SUCCESS) status = _append_tiff_entry(p_buffer, TIFF_TAG_IMAGE_WIDTH, TIFF_TYPE_LONG, 1, &width, 0);
+    if (status == SUCCESS) status = _append_tiff_entry(p_buffer, TIFF_TAG_IMAGE_LENGTH, TIFF_TYPE_LONG, 1, &height, 0);
+    if (status == SUCCESS) status = _append_tiff_entry(p_buffer, TIFF_TAG_BITS_PER_SAMPLE, TIFF_TYPE_SHORT, TIFF_SAMPLES_PER_PIXEL, bits_per_sample, 0);
+    if (status == SUCCESS) status = _append_tiff_entry(p_buffer, TIFF_TAG_COMPRESSION, TIFF_TYPE_SHORT, 1, &compression, 0);
+    if (status == SUCCESS) status = _append_tiff_entry(p_buffer, TIFF_TAG_PHOTOMETRIC_INTERPRETATION, TIFF_TYPE_SHORT, 1, &photometric_interpretation, 0);
+    if (status == SUCCESS) status = _append_tiff_entry(p_buffer, TIFF_TAG_SAMPLES_PER_PIXEL, TIFF_TYPE_SHORT, 1, &samples_per_pixel, 0);
+    if (status == SUCCESS) status = _append_tiff_entry(p_buffer, TIFF_TAG_PLANAR_CONFIGURATION, TIFF_TYPE_SHORT, 1, &planar_configuration, 0);
+    if (status == SUCCESS) status = _append_tiff_entry(p_buffer, TIFF_TAG_TILE_WIDTH, TIFF_TYPE_LONG, 1, &tile_size, 0);
+    if (status == SUCCESS) status = _append_tiff_entry(p_buffer, TIFF_TAG_TILE_LENGTH, TIFF_TYPE_LONG, 1, &tile_size, 0);
+    if (status == SUCCESS) status = _append_tiff_entry(p_buffer, TIFF_TAG_TILE_OFFSETS, TIFF_TYPE_LONG8, num_tiles, inline_offsets, offsets_offset);
+    if (status == SUCCESS) status = _append_tiff_entry(p_buffer, TIFF_TAG_TILE_BYTE_COUNTS, TIFF_TYPE_LONG8, num_tiles, inline_sizes, sizes_offset);
+    // There is no further image.
+    if (status == SUCCESS) status = _append_little_endian(p_buffer, 0, 8);
+    for (uint64_t i = 0; i < num_tiles && num_tiles > 1 && status == SUCCESS; i++) {
+        status = _append_little_endian(p_buffer, p_writer->tile_offsets[i], 8);
+    }
+    for (uint64_t i = 0; i < num_tiles && num_tiles > 1 && status == SUCCESS; i++) {
+        status = _append_little_endian(p_buffer, p_writer->tile_sizes[i], 8);
+    }
+    return status;
+}
+
+int close_tiff_writer(TiffWriter *p_writer, uint64_t *p_num_bytes_written) {
+    int status = SUCCESS;
+    size_t num_tiles = p_writer->num_tiles_x * p_writer->num_tiles_y;
+    for (size_t i = 0; i < num_tiles && status == SUCCESS; i++) {
+        if (p_writer->tile_sizes[i] == 0) {
+            status = GENERIC_ERROR;
+        }
+    }
+
+    // The directory starts at a word boundary after the last tile.
+    ByteBuffer directory;
+    memset(&directory, 0, sizeof(ByteBuffer));
+    uint64_t padding = p_writer->end_offset % 8 != 0 ? 8 - p_writer->end_offset % 8 : 0;
+    uint64_t directory_offset = p_writer->end_offset + padding;
+    for (uint64_t i = 0; i < padding && status == SUCCESS; i++) {
+        status = _append_little_endian(&directory, 0, 1);
+    }
+    if (status == SUCCESS) {
+        status = _build_tiff_directory(p_writer, directory_offset, &directory);
+    }
+    if (status == SUCCESS && fwrite(directory.data, 1, directory.size, p_writer->file) != directory.size) {
+        status = ERROR_FILE_ACCESS;
+    }
+    if (status == SUCCESS) {
+        directory.size = 0;
+        status = _append_little_endian(&directory, directory_offset, 8);
+    }
+    if (status == SUCCESS && (fseek(p_writer->file, BIGTIFF_DIRECTORY_OFFSET_POSITION, SEEK_SET) != 0 ||
+                              fwrite(directory.data, 1, directory.size, p_writer->file) != directory.size)) {
+        status = ERROR_FILE_ACCESS;
+    }
+    if (fclose(p_writer->file) != 0 && status == SUCCESS) {
+        status = ERROR_FILE_ACCESS;
+    }
+    if (status == SUCCESS && p_num_bytes_written != NULL) {
+        *p_num_bytes_written = directory_offset + 8 + TIFF_NUM_TAGS * 20 + 8 + (num_tiles > 1 ? 16 * (uint64_t)num_tiles : 0);
+    }
+
+    free_byte_buffer(&directory);
+    pthread_mutex_destroy(&p_writer->lock);
+    free(p_writer->tile_offsets);
+    free(p_writer->tile_sizes);
+    free(p_writer);
+    return status;
+}
+
+int save_tiff(const char *output_path, const ImageData *p_image_data, ThreadPool *p_thread_pool, uint64_t *p_num_bytes_written) {
+    TiffWriter *p_writer;
+    int status = open_tiff_writer(output_path, p_image_data->size, &p_writer);
+    if (status != SUCCESS) return status;
+    status = write_tiff_band(p_writer, p_image_data, 0, p_thread_pool);
+    int status_close = close_tiff_writer(p_writer, p_num_bytes_written);
+    return status != SUCCESS ? status : status_close;
+}
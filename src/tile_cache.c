@@ -0,0 +1,494 @@
+#include "../include/tile_cache.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#include <sys/utime.h>
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+#include "../include/status_manager.h"
+
+// Identifies a tile file and the version of its format.
+#define TILE_FILE_MAGIC "MBTC"
+#define TILE_FILE_VERSION 3
+#define TILE_FILE_EXTENSION ".tile"
+// The serialized key: x, y, spacing, the constant of the Julia set, width, height, iteration depth, render mode, interior checks,
+// precision, formula, power and kernel name.
+#define TILE_KEY_KERNEL_NAME_LENGTH 16
+#define TILE_KEY_SIZE (5 * 8 + 8 * 4 + TILE_KEY_KERNEL_NAME_LENGTH)
+// The magic, the version, the key and the size of the payload.
+#define TILE_HEADER_SIZE (4 + 4 + TILE_KEY_SIZE + 4)
+// The worst case of the payload per pixel: a run of length 1 and a value with 5 bytes each, and a magnitude.
+#define TILE_MAX_BYTES_PER_PIXEL (5 + 5 + 4)
+// The number of characters that a file name in the cache may have in addition to the directory.
+#define TILE_PATH_SUFFIX_LENGTH 64
+// Temporary files that are older are left over from a crashed process and are deleted when the cache is trimmed.
+#define TILE_STALE_TEMP_SECONDS 3600
+
+struct TileCache {
+    char *directory;
+    size_t max_size;
+    // Protects next_temp_id.
+    pthread_mutex_t lock;
+    // Makes the names of the temporary files of this process unique.
+    size_t next_temp_id;
+};
+
+/**
+ * A file of the cache directory, collected to trim the cache.
+ */
+typedef struct {
+    char *name;
+    uint64_t size;
+    time_t modification_time;
+} CacheFile;
+
+/**
+ * Serializes a key into bytes. The kernel name is truncated or padded with zeros.
+ *
+ * @param p_key A pointer to the key.
+ * @param bytes A pointer to store TILE_KEY_SIZE bytes.
+ */
+void _serialize_tile_key(const TileKey *p_key, unsigned char *bytes) {
+    uint32_t values[8] = {(uint32_t)p_key->width, (uint32_t)p_key->height, (uint32_t)p_key->iteration_depth, p_key->render_mode,
+                          p_key->interior_checks, p_key->precision, p_key->formula, p_key->power};
+    memset(bytes, 0, TILE_KEY_SIZE);
+    memcpy(bytes, &p_key->x, 8);
+    memcpy(bytes + 8, &p_key->y, 8);
+    memcpy(bytes + 16, &p_key->spacing, 8);
+    memcpy(bytes + 24, &p_key->julia_real, 8);
+    memcpy(bytes + 32, &p_key->julia_imag, 8);
+    memcpy(bytes + 40, values, sizeof(values));
+    size_t name_length = strlen(p_key->kernel_name);
+    memcpy(bytes + 72, p_key->kernel_name, name_length < TILE_KEY_KERNEL_NAME_LENGTH ? name_length : TILE_KEY_KERNEL_NAME_LENGTH);
+}
+
+/**
+ * Builds the path of the file of a tile from the 64 bit FNV-1a hash of its serialized key.
+ *
+ * @param p_cache A pointer to the cache.
+ * @param key_bytes The serialized key.
+ * @param suffix A string that is appended to the hash, like the file extension.
+ * @param p_p_path A pointer to store the path. Must be freed by the caller.
+ * @return Status code.
+ */
+int _get_tile_file_path(const TileCache *p_cache, const unsigned char *key_bytes, const char *suffix, char **p_p_path) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < TILE_KEY_SIZE; i++) {
+        hash = (hash ^ key_bytes[i]) * 0x100000001B3ULL;
+    }
+    size_t length = strlen(p_cache->directory) + strlen(suffix) + TILE_PATH_SUFFIX_LENGTH;
+    *p_p_path = (char *)malloc(length);
+    if (*p_p_path == NULL) return ERROR_MEMORY_ALLOC;
+    snprintf(*p_p_path, length, "%s/%016" PRIx64 "%s", p_cache->directory, hash, suffix);
+    return SUCCESS;
+}
+
+/**
+ * Appends an unsigned number with 7 bits per byte to a buffer. The highest bit of a byte is set if another byte follows.
+ *
+ * @param value The number.
+ * @param p_buffer A pointer to the position in the buffer, which is advanced.
+ */
+void _write_varint(uint32_t value, unsigned char **p_buffer) {
+    while (value >= 0x80) {
+        *(*p_buffer)++ = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    *(*p_buffer)++ = (unsigned char)value;
+}
+
+/**
+ * Reads an unsigned number that was written by _write_varint.
+ *
+ * @param p_buffer A pointer to the position in the buffer, which is advanced.
+ * @param end The end of the buffer.
+ * @param p_value A pointer to store the number.
+ * @return True if the number was complete and fits into 32 bits.
+ */
+bool _read_varint(const unsigned char **p_buffer, const unsigned char *end, uint32_t *p_value) {
+    uint32_t value = 0;
+    for (unsigned int shift = 0; shift < 35; shift += 7) {
+        if (*p_buffer >= end) return false;
+        unsigned char byte = *(*p_buffer)++;
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            *p_value = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Encodes the iteration data of a tile: the runs of equal numbers of iterations as pairs of length and value,
+ * followed by the magnitudes of all pixels outside of the Mandelbrot set.
+ *
+ * @param p_key A pointer to the key of the tile.
+ * @param iterations The numbers of iterations of the tile.
+ * @param magnitudes The magnitudes of the tile.
+ * @param stride The distance between two rows in elements.
+ * @param payload A buffer for at least TILE_MAX_BYTES_PER_PIXEL bytes per pixel.
+ * @return The size of the payload in bytes.
+ */
+size_t _encode_tile(const TileKey *p_key, const uint32_t *iterations, const float *magnitudes, size_t stride, unsigned char *payload) {
+    unsigned char *p = payload;
+    uint32_t run_value = iterations[0];
+    uint32_t run_length = 0;
+    for (size_t y = 0; y < p_key->height; y++) {
+        for (size_t x = 0; x < p_key->width; x++) {
+            uint32_t value = iterations[y * stride + x];
+            if (value != run_value) {
+                _write_varint(run_length, &p);
+                _write_varint(run_value, &p);
+                run_value = value;
+                run_length = 0;
+            }
+            run_length++;
+        }
+    }
+    _write_varint(run_length, &p);
+    _write_varint(run_value, &p);
+
+    for (size_t y = 0; y < p_key->height; y++) {
+        for (size_t x = 0; x < p_key->width; x++) {
+            if (iterations[y * stride + x] < p_key->iteration_depth) {
+                memcpy(p, &magnitudes[y * stride + x], sizeof(float));
+                p += sizeof(float);
+            }
+        }
+    }
+    return (size_t)(p - payload);
+}
+
+/**
+ * Decodes the iteration data of a tile that was encoded by _encode_tile.
+ *
+ * @param p_key A pointer to the key of the tile.
+ * @param payload The payload.
+ * @param payload_size The size of the payload in bytes.
+ * @param iterations A pointer to store the numbers of iterations of the tile.
+ * @param magnitudes A pointer to store the magnitudes of the tile.
+ * @param stride The distance between two rows in elements.
+ * @return True if the payload was valid.
+ */
+bool _decode_tile(const TileKey *p_key, const unsigned char *payload, size_t payload_size, uint32_t *iterations, float *magnitudes, size_t stride) {
+    const unsigned char *p = payload;
+    const unsigned char *end = payload + payload_size;
+    size_t num_pixels = p_key->width * p_key->height;
+    size_t num_escaped = 0;
+    for (size_t i = 0; i < num_pixels;) {
+        uint32_t run_length, value;
+        if (!_read_varint(&p, end, &run_length) || !_read_varint(&p, end, &value)) return false;
+        if (run_length == 0 || run_length > num_pixels - i || value > p_key->iteration_depth) return false;
+        for (size_t j = i; j < i + run_length; j++) {
+            iterations[(j / p_key->width) * stride + j % p_key->width] = value;
+        }
+        if (value < p_key->iteration_depth) {
+            num_escaped += run_length;
+        }
+        i += run_length;
+    }
+    if ((size_t)(end - p) != num_escaped * sizeof(float)) return false;
+
+    for (size_t y = 0; y < p_key->height; y++) {
+        for (size_t x = 0; x < p_key->width; x++) {
+            if (iterations[y * stride + x] < p_key->iteration_depth) {
+                memcpy(&magnitudes[y * stride + x], p, sizeof(float));
+                p += sizeof(float);
+            } else {
+                magnitudes[y * stride + x] = 0.0f;
+            }
+        }
+    }
+    return true;
+}
+
+int open_tile_cache(const char *directory, size_t max_size, TileCache **p_p_cache) {
+#ifdef _WIN32
+    _mkdir(directory);
+#else
+    mkdir(directory, 0755);
+#endif
+    struct stat directory_stat;
+    if (stat(directory, &directory_stat) != 0 || !S_ISDIR(directory_stat.st_mode)) {
+        return ERROR_FILE_ACCESS;
+    }
+
+    TileCache *p_cache = (TileCache *)malloc(sizeof(TileCache));
+    if (p_cache == NULL) return ERROR_MEMORY_ALLOC;
+    p_cache->directory = (char *)malloc(strlen(directory) + 1);
+    if (p_cache->directory == NULL) {
+        free(p_cache);
+        return ERROR_MEMORY_ALLOC;
+    }
+    strcpy(p_cache->directory, directory);
+    p_cache->max_size = max_size;
+    p_cache->next_temp_id = 0;
+    pthread_mutex_init(&p_cache->lock, NULL);
+    *p_p_cache = p_cache;
+    return SUCCESS;
+}
+
+bool load_cached_tile(TileCache *p_cache, const TileKey *p_key, uint32_t *iterations, float *magnitudes, size_t stride) {
+    unsigned char key_bytes[TILE_KEY_SIZE];
+    _serialize_tile_key(p_key, key_bytes);
+    char *path;
+    if (_get_tile_file_path(p_cache, key_bytes, TILE_FILE_EXTENSION, &path) != SUCCESS) return false;
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        free(path);
+        return false;
+    }
+    unsigned char header[TILE_HEADER_SIZE];
+    unsigned char *payload = NULL;
+    uint32_t version, payload_size = 0;
+    bool found = fread(header, 1, TILE_HEADER_SIZE, file) == TILE_HEADER_SIZE;
+    if (found) {
+        memcpy(&version, header + 4, 4);
+        memcpy(&payload_size, header + 8 + TILE_KEY_SIZE, 4);
+        // A different key with the same hash, or a file of another version, is a miss.
+        found = memcmp(header, TILE_FILE_MAGIC, 4) == 0 && version == TILE_FILE_VERSION && memcmp(header + 8, key_bytes, TILE_KEY_SIZE) == 0 &&
+                payload_size <= p_key->width * p_key->height * TILE_MAX_BYTES_PER_PIXEL;
+    }
+    if (found) {
+        payload = (unsigned char *)malloc(payload_size > 0 ? payload_size : 1);
+        found = payload != NULL && fread(payload, 1, payload_size, file) == payload_size &&
+                _decode_tile(p_key, payload, payload_size, iterations, magnitudes, stride);
+    }
+    fclose(file);
+    free(payload);
+
+    // The modification time of a tile is the time it was last used, so the least recently used tiles are deleted first.
+    if (found) {
+        utime(path, NULL);
+    }
+    free(path);
+    return found;
+}
+
+int store_cached_tile(TileCache *p_cache, const TileKey *p_key, const uint32_t *iterations, const float *magnitudes, size_t stride) {
+    if (p_key->width == 0 || p_key->height == 0) return ERROR_IMAGE_SIZE_0;
+    unsigned char *buffer = (unsigned char *)malloc(TILE_HEADER_SIZE + p_key->width * p_key->height * TILE_MAX_BYTES_PER_PIXEL);
+    if (buffer == NULL) return ERROR_MEMORY_ALLOC;
+
+    uint32_t version = TILE_FILE_VERSION;
+    uint32_t payload_size = (uint32_t)_encode_tile(p_key, iterations, magnitudes, stride, buffer + TILE_HEADER_SIZE);
+    memcpy(buffer, TILE_FILE_MAGIC, 4);
+    memcpy(buffer + 4, &version, 4);
+    _serialize_tile_key(p_key, buffer + 8);
+    memcpy(buffer + 8 + TILE_KEY_SIZE, &payload_size, 4);
+
+    // The temporary file is unique to this process and thread, so no other writer interferes with it.
+    pthread_mutex_lock(&p_cache->lock);
+    size_t temp_id = p_cache->next_temp_id++;
+    pthread_mutex_unlock(&p_cache->lock);
+    char suffix[TILE_PATH_SUFFIX_LENGTH];
+#ifdef _WIN32
+    snprintf(suffix, sizeof(suffix), ".tmp%d_%zu", _getpid(), temp_id);
+#else
+    snprintf(suffix, sizeof(suffix), ".tmp%ld_%zu", (long)getpid(), temp_id);
+#endif
+    char *temp_path = NULL;
+    char *path = NULL;
+    int status = _get_tile_file_path(p_cache, buffer + 8, suffix, &temp_path);
+    if (status == SUCCESS) {
+        status = _get_tile_file_path(p_cache, buffer + 8, TILE_FILE_EXTENSION, &path);
+    }
+    if (status == SUCCESS) {
+        FILE *file = fopen(temp_path, "wb");
+        size_t file_size = TILE_HEADER_SIZE + payload_size;
+        status = file != NULL ? SUCCESS : ERROR_FILE_ACCESS;
+        if (file != NULL && fwrite(buffer, 1, file_size, file) != file_size) {
+            status = ERROR_FILE_ACCESS;
+        }
+        if (file != NULL && fclose(file) != 0) {
+            status = ERROR_FILE_ACCESS;
+        }
+    }
+    // The rename replaces the tile atomically, so readers in other processes never see a partially written file.
+    if (status == SUCCESS) {
+#ifdef _WIN32
+        if (!MoveFileExA(temp_path, path, MOVEFILE_REPLACE_EXISTING)) status = ERROR_FILE_ACCESS;
+#else
+        if (rename(temp_path, path) != 0) status = ERROR_FILE_ACCESS;
+#endif
+    }
+    if (status != SUCCESS && temp_path != NULL) {
+        remove(temp_path);
+    }
+    free(temp_path);
+    free(path);
+    free(buffer);
+    return status;
+}
+
+/**
+ * Checks whether a string ends with a suffix.
+ *
+ * @param str The string.
+ * @param suffix The suffix.
+ * @return True if the string ends with the suffix.
+ */
+bool _ends_with(const char *str, const char *suffix) {
+    size_t length = strlen(str);
+    size_t suffix_length = strlen(suffix);
+    return length >= suffix_length && strcmp(str + length - suffix_length, suffix) == 0;
+}
+
+/**
+ * Appends a file of the cache directory to a growing array of files.
+ *
+ * @param p_p_files A pointer to the array.
+ * @param p_num_files A pointer to the number of files in the array.
+ * @param p_capacity A pointer to the capacity of the array.
+ * @param name The name of the file.
+ * @param size The size of the file in bytes.
+ * @param modification_time The time of the last modification of the file.
+ * @return Status code.
+ */
+int _append_cache_file(CacheFile **p_p_files, size_t *p_num_files, size_t *p_capacity, const char *name, uint64_t size, time_t modification_time) {
+    if (*p_num_files == *p_capacity) {
+        size_t capacity = *p_capacity > 0 ? 2 * *p_capacity : 256;
+        CacheFile *files = (CacheFile *)realloc(*p_p_files, capacity * sizeof(CacheFile));
+        if (files == NULL) return ERROR_MEMORY_ALLOC;
+        *p_p_files = files;
+        *p_capacity = capacity;
+    }
+    CacheFile *p_file = &(*p_p_files)[*p_num_files];
+    p_file->name = (char *)malloc(strlen(name) + 1);
+    if (p_file->name == NULL) return ERROR_MEMORY_ALLOC;
+    strcpy(p_file->name, name);
+    p_file->size = size;
+    p_file->modification_time = modification_time;
+    (*p_num_files)++;
+    return SUCCESS;
+}
+
+/**
+ * Lists the tile files and the temporary files of the cache directory.
+ *
+ * @param p_cache A pointer to the cache.
+ * @param p_p_files A pointer to store the array of files. Must be freed by the caller, including the names.
+ * @param p_num_files A pointer to store the number of files.
+ * @return Status code.
+ */
+int _list_cache_files(const TileCache *p_cache, CacheFile **p_p_files, size_t *p_num_files) {
+    size_t capacity = 0;
+    int status = SUCCESS;
+    *p_p_files = NULL;
+    *p_num_files = 0;
+#ifdef _WIN32
+    size_t length = strlen(p_cache->directory) + TILE_PATH_SUFFIX_LENGTH;
+    char *pattern = (char *)malloc(length);
+    if (pattern == NULL) return ERROR_MEMORY_ALLOC;
+    snprintf(pattern, length, "%s/*", p_cache->directory);
+    WIN32_FIND_DATAA find_data;
+    HANDLE find_handle = FindFirstFileA(pattern, &find_data);
+    free(pattern);
+    if (find_handle == INVALID_HANDLE_VALUE) return ERROR_FILE_ACCESS;
+    do {
+        if (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+        uint64_t size = ((uint64_t)find_data.nFileSizeHigh << 32) | find_data.nFileSizeLow;
+        // FILETIME counts 100 ns intervals since 1601, time_t counts seconds since 1970.
+        uint64_t file_time = ((uint64_t)find_data.ftLastWriteTime.dwHighDateTime << 32) | find_data.ftLastWriteTime.dwLowDateTime;
+        time_t modification_time = (time_t)(file_time / 10000000ULL - 11644473600ULL);
+        status = _append_cache_file(p_p_files, p_num_files, &capacity, find_data.cFileName, size, modification_time);
+    } while (status == SUCCESS && FindNextFileA(find_handle, &find_data));
+    FindClose(find_handle);
+#else
+    DIR *directory = opendir(p_cache->directory);
+    if (directory == NULL) return ERROR_FILE_ACCESS;
+    size_t length = strlen(p_cache->directory) + TILE_PATH_SUFFIX_LENGTH;
+    char *path = (char *)malloc(length);
+    if (path == NULL) status = ERROR_MEMORY_ALLOC;
+    struct dirent *p_entry;
+    while (status == SUCCESS && (p_entry = readdir(directory)) != NULL) {
+        if (strlen(p_entry->d_name) + 2 > TILE_PATH_SUFFIX_LENGTH) continue;
+        snprintf(path, length, "%s/%s", p_cache->directory, p_entry->d_name);
+        struct stat file_stat;
+        // Files that were deleted by another process in the meantime are ignored.
+        if (stat(path, &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) continue;
+        status = _append_cache_file(p_p_files, p_num_files, &capacity, p_entry->d_name, (uint64_t)file_stat.st_size, file_stat.st_mtime);
+    }
+    free(path);
+    closedir(directory);
+#endif
+    return status;
+}
+
+/**
+ * Compares two cache files by the time of their last modification, for sorting them from the least to the most recently used.
+ *
+ * @param p_a A pointer to the first CacheFile.
+ * @param p_b A pointer to the second CacheFile.
+ * @return A negative number, zero or a positive number if the first file is older, as old as or newer than the second file.
+ */
+int _compare_cache_files(const void *p_a, const void *p_b) {
+    time_t a = ((const CacheFile *)p_a)->modification_time;
+    time_t b = ((const CacheFile *)p_b)->modification_time;
+    return (a > b) - (a < b);
+}
+
+/**
+ * Deletes the least recently used tiles until the tiles fit into the size limit of the cache, and temporary files of crashed processes.
+ * Other processes may trim the cache at the same time. A tile that another process has already deleted counts as deleted,
+ * so all processes stop once the cache fits. Only tiles that are written while the cache is trimmed may be left over or deleted too many.
+ *
+ * @param p_cache A pointer to the cache.
+ */
+void _trim_tile_cache(TileCache *p_cache) {
+    CacheFile *files;
+    size_t num_files;
+    if (_list_cache_files(p_cache, &files, &num_files) == SUCCESS) {
+        qsort(files, num_files, sizeof(CacheFile), _compare_cache_files);
+        uint64_t total_size = 0;
+        for (size_t i = 0; i < num_files; i++) {
+            if (_ends_with(files[i].name, TILE_FILE_EXTENSION)) {
+                total_size += files[i].size;
+            }
+        }
+
+        time_t now = time(NULL);
+        size_t length = strlen(p_cache->directory) + TILE_PATH_SUFFIX_LENGTH;
+        char *path = (char *)malloc(length);
+        for (size_t i = 0; i < num_files && path != NULL; i++) {
+            bool is_tile = _ends_with(files[i].name, TILE_FILE_EXTENSION);
+            bool is_stale_temp = strstr(files[i].name, ".tmp") != NULL && now - files[i].modification_time > TILE_STALE_TEMP_SECONDS;
+            if ((is_tile && total_size > p_cache->max_size) || is_stale_temp) {
+                snprintf(path, length, "%s/%s", p_cache->directory, files[i].name);
+                if ((remove(path) == 0 || errno == ENOENT) && is_tile) {
+                    total_size -= files[i].size;
+                }
+            }
+        }
+        free(path);
+    }
+    for (size_t i = 0; i < num_files; i++) {
+        free(files[i].name);
+    }
+    free(files);
+}
+
+void close_tile_cache(TileCache *p_cache) {
+    if (p_cache == NULL) return;
+    _trim_tile_cache(p_cache);
+    pthread_mutex_destroy(&p_cache->lock);
+    free(p_cache->directory);
+    free(p_cache);
+}
@@ -0,0 +1,37 @@
+#!/bin/sh
+# Checks that an image rendered in bands is the same as the image rendered in memory. The configuration is supersampled,
+# so the edges on the borders of the bands must be found across the borders.
+# Usage: tests/banded_render_test.sh <path of the program>
+
+program=${1:-./mandelbrot_renderer}
+directory=$(mktemp -d)
+trap 'rm -rf "$directory"' EXIT
+
+cat > "$directory/config.ini" << EOF
+lower_left_real = -2
+lower_left_imag = -1.5
+upper_right_real = 1
+upper_right_imag = 1.5
+iteration_depth = 1000
+inner_color = 0x000000
+outer_colors = 0xFFFFFF, 0xFFFF00, 0x00FFFF, 0xFF0000
+supersampling = 4
+EOF
+
+status=0
+# The bands of the first render are lower than a tile, the bands of the others are several tiles high.
+for run in "400 300K" "1000 1M"; do
+    set -- $run
+    "$program" "$directory/config.ini" "$1" "$directory/memory.bmp" > /dev/null || exit 1
+    "$program" "$directory/config.ini" "$1" "$directory/banded.bmp" --memory-budget "$2" > /dev/null || exit 1
+    "$program" "$directory/config.ini" "$1" "$directory/mapped.bmp" --mmap --memory-budget "$2" > /dev/null || exit 1
+    for output in banded mapped; do
+        if cmp -s "$directory/memory.bmp" "$directory/$output.bmp"; then
+            echo "PASS: $output, width $1, memory budget $2"
+        else
+            echo "FAIL: $output, width $1, memory budget $2"
+            status=1
+        fi
+    done
+done
+exit $status
@@ -0,0 +1,34 @@
+#!/bin/sh
+# Checks that images computed by worker processes with --workers are the same as images rendered locally. One of the addresses has
+# no worker, so its bands must be computed by the others. The configuration file does not end with a line break.
+# Usage: tests/distributed_render_test.sh <path of the program>
+
+program=${1:-./mandelbrot_renderer}
+directory=$(mktemp -d)
+trap 'kill $first_worker $second_worker 2> /dev/null; rm -rf "$directory"' EXIT
+
+printf '%s\n' "lower_left_real = -2" "lower_left_imag = -1.5" "upper_right_real = 1" "upper_right_imag = 1.5" "iteration_depth = 1000" \
+    "inner_color = 0x000000" "outer_colors = 0xFFFFFF, 0xFFFF00, 0x00FFFF, 0xFF0000" > "$directory/config.ini"
+printf '%s' "supersampling = 4" >> "$directory/config.ini"
+
+# The ports depend on the process ID, so tests that run at the same time do not collide.
+port=$((20000 + $$ % 20000))
+"$program" worker --threads 2 "$port" > /dev/null 2>&1 &
+first_worker=$!
+"$program" worker --threads 2 "$((port + 1))" > /dev/null 2>&1 &
+second_worker=$!
+sleep 1
+workers="localhost:$port,localhost:$((port + 1)),localhost:$((port + 2))"
+
+status=0
+for width in 400 1000; do
+    "$program" "$directory/config.ini" "$width" "$directory/local.bmp" > /dev/null || exit 1
+    "$program" "$directory/config.ini" "$width" "$directory/distributed.bmp" --workers "$workers" > /dev/null || exit 1
+    if cmp -s "$directory/local.bmp" "$directory/distributed.bmp"; then
+        echo "PASS: width $width"
+    else
+        echo "FAIL: width $width"
+        status=1
+    fi
+done
+exit $status
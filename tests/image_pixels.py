@@ -0,0 +1,186 @@
+#!/usr/bin/env python3
+"""Writes the pixels of an image file that the program saved, so images in different formats can be compared with cmp.
+
+The output is a line with the width and the height, followed by the pixels as RGB bytes, row by row from the top to the bottom.
+Only the variants of the formats that the program writes are supported.
+Usage: tests/image_pixels.py <image file> <output file>
+"""
+
+import struct
+import sys
+import zlib
+
+
+def _decode_rle8(data, width, height):
+    """Returns the rows of color indices of RLE8 compressed pixels, from the bottom to the top."""
+    rows = []
+    row = bytearray()
+    position = 0
+    while True:
+        count, value = data[position], data[position + 1]
+        position += 2
+        if count > 0:
+            row += bytes([value]) * count
+        elif value == 0 or value == 1:
+            # The end of a row or of the image.
+            if len(row) != width:
+                raise ValueError('RLE8 row has the wrong length')
+            rows.append(bytes(row))
+            row = bytearray()
+            if value == 1:
+                break
+        elif value == 2:
+            raise ValueError('RLE8 deltas are not supported')
+        else:
+            # An absolute run, padded to an even number of bytes.
+            row += data[position:position + value]
+            position += value + (value & 1)
+    if len(rows) != height:
+        raise ValueError('RLE8 image has the wrong number of rows')
+    return rows
+
+
+def read_bmp(data):
+    """Returns the size and the rows of a BMP file with 24 bits per pixel or 8 bits per pixel, uncompressed or RLE8 compressed."""
+    offset, header_size = struct.unpack_from('<II', data, 10)
+    width, height, _, bits_per_pixel, compression = struct.unpack_from('<iiHHI', data, 18)
+    if bits_per_pixel == 24 and compression == 0:
+        stride = (3 * width + 3) // 4 * 4
+        pixel_rows = [data[offset + y * stride:offset + y * stride + 3 * width] for y in range(height)]
+    elif bits_per_pixel == 8 and compression in (0, 1):
+        num_colors, = struct.unpack_from('<I', data, 46)
+        palette = [data[14 + header_size + 4 * i:14 + header_size + 4 * i + 3] for i in range(num_colors or 256)]
+        if compression == 0:
+            stride = (width + 3) // 4 * 4
+            index_rows = [data[offset + y * stride:offset + y * stride + width] for y in range(height)]
+        else:
+            index_rows = _decode_rle8(data[offset:], width, height)
+        pixel_rows = [b''.join(palette[index] for index in row) for row in index_rows]
+    else:
+        raise ValueError('unsupported BMP file')
+    rows = []
+    # The rows are stored from the bottom to the top and the pixels as BGR.
+    for bgr in reversed(pixel_rows):
+        rgb = bytearray(3 * width)
+        rgb[0::3] = bgr[2::3]
+        rgb[1::3] = bgr[1::3]
+        rgb[2::3] = bgr[0::3]
+        rows.append(bytes(rgb))
+    return width, height, rows
+
+
+def _paeth(left, up, up_left):
+    estimate = left + up - up_left
+    distance_left, distance_up, distance_up_left = abs(estimate - left), abs(estimate - up), abs(estimate - up_left)
+    if distance_left <= distance_up and distance_left <= distance_up_left:
+        return left
+    return up if distance_up <= distance_up_left else up_left
+
+
+def read_png(data):
+    """Returns the size and the rows of a PNG file with 8 bit RGB pixels."""
+    position = 8
+    compressed = bytearray()
+    width = height = None
+    while position < len(data):
+        length, kind = struct.unpack_from('>I4s', data, position)
+        body = data[position + 8:position + 8 + length]
+        if kind == b'IHDR':
+            width, height, bit_depth, color_type, _, _, interlace = struct.unpack('>IIBBBBB', body)
+            if bit_depth != 8 or color_type != 2 or interlace != 0:
+                raise ValueError('unsupported PNG file')
+        elif kind == b'IDAT':
+            compressed += body
+        position += 12 + length
+    raw = zlib.decompress(bytes(compressed))
+    stride = 3 * width
+    rows = []
+    previous = bytearray(stride)
+    for y in range(height):
+        filter_type = raw[y * (stride + 1)]
+        row = bytearray(raw[y * (stride + 1) + 1:(y + 1) * (stride + 1)])
+        for i in range(stride):
+            left = row[i - 3] if i >= 3 else 0
+            up_left = previous[i - 3] if i >= 3 else 0
+            if filter_type == 1:
+                row[i] = (row[i] + left) & 0xFF
+            elif filter_type == 2:
+                row[i] = (row[i] + previous[i]) & 0xFF
+            elif filter_type == 3:
+                row[i] = (row[i] + (left + previous[i]) // 2) & 0xFF
+            elif filter_type == 4:
+                row[i] = (row[i] + _paeth(left, previous[i], up_left)) & 0xFF
+        rows.append(bytes(row))
+        previous = row
+    return width, height, rows
+
+
+def read_tiff(data):
+    """Returns the size and the rows of a tiled BigTIFF file with 8 bit RGB pixels whose tiles are compressed with deflate."""
+    if data[:4] != b'II+\x00':
+        raise ValueError('unsupported TIFF file')
+    directory, = struct.unpack_from('<Q', data, 8)
+    num_entries, = struct.unpack_from('<Q', data, directory)
+    tags = {}
+    for i in range(num_entries):
+        tag, kind, count = struct.unpack_from('<HHQ', data, directory + 8 + 20 * i)
+        value_format = {3: 'H', 4: 'I', 16: 'Q'}[kind]
+        value_size = struct.calcsize(value_format)
+        # Values that do not fit into the entry are stored at the offset in the entry.
+        position = directory + 8 + 20 * i + 12
+        if value_size * count > 8:
+            position, = struct.unpack_from('<Q', data, position)
+        tags[tag] = struct.unpack_from('<%d%s' % (count, value_format), data, position)
+    width, height, tile_size = tags[256][0], tags[257][0], tags[322][0]
+    if tags[258] != (8, 8, 8) or tags[259] != (8,) or tags[323][0] != tile_size:
+        raise ValueError('unsupported TIFF file')
+    tiles_across = (width + tile_size - 1) // tile_size
+    rows = [bytearray(3 * width) for _ in range(height)]
+    for index, (offset, size) in enumerate(zip(tags[324], tags[325])):
+        pixels = zlib.decompress(data[offset:offset + size])
+        x = index % tiles_across * tile_size
+        y = index // tiles_across * tile_size
+        # Tiles at the right and bottom edge are padded.
+        num_columns = min(tile_size, width - x)
+        for row in range(min(tile_size, height - y)):
+            rows[y + row][3 * x:3 * (x + num_columns)] = pixels[3 * tile_size * row:3 * (tile_size * row + num_columns)]
+    return width, height, [bytes(row) for row in rows]
+
+
+def read_ppm(data):
+    """Returns the size and the rows of a binary PPM file with 8 bit channels."""
+    # The header is followed by a single whitespace character, because the pixels may start with bytes that are whitespace.
+    header_end = 0
+    for _ in range(4):
+        while data[header_end:header_end + 1].isspace():
+            header_end += 1
+        while not data[header_end:header_end + 1].isspace():
+            header_end += 1
+    magic, width, height, max_value = data[:header_end].split()
+    if magic != b'P6' or max_value != b'255':
+        raise ValueError('unsupported PPM file')
+    width, height = int(width), int(height)
+    pixels = data[header_end + 1:]
+    return width, height, [pixels[3 * width * y:3 * width * (y + 1)] for y in range(height)]
+
+
+def main():
+    with open(sys.argv[1], 'rb') as file:
+        data = file.read()
+    if data.startswith(b'\x89PNG'):
+        width, height, rows = read_png(data)
+    elif data.startswith(b'P6'):
+        width, height, rows = read_ppm(data)
+    elif data.startswith(b'II+'):
+        width, height, rows = read_tiff(data)
+    elif data.startswith(b'BM'):
+        width, height, rows = read_bmp(data)
+    else:
+        raise ValueError('unknown image format')
+    with open(sys.argv[2], 'wb') as file:
+        file.write(b'%d %d\n' % (width, height))
+        file.writelines(rows)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,38 @@
+#!/bin/sh
+# Checks that the pixels of BMP files with indexed colors, uncompressed and RLE8 compressed, are the same as the pixels of BMP files
+# with 24 bits per pixel. The images have large areas of the same color and detailed areas, so RLE8 writes both runs and literal pixels.
+# The pixels are compared with tests/image_pixels.py, which needs Python 3.
+# Usage: tests/indexed_output_test.sh <path of the program>
+
+program=${1:-./mandelbrot_renderer}
+pixels="python3 $(dirname "$0")/image_pixels.py"
+directory=$(mktemp -d)
+trap 'rm -rf "$directory"' EXIT
+
+cat > "$directory/config.ini" << EOF
+lower_left_real = -2
+lower_left_imag = -1.5
+upper_right_real = 1
+upper_right_imag = 1.5
+iteration_depth = 200
+inner_color = 0x000000
+outer_colors = 0xFFFFFF, 0xFFFF00, 0x00FFFF, 0xFF0000
+EOF
+
+status=0
+# The rows of the first image are not a multiple of 4 bytes long, so they are padded.
+for width in 101 1000; do
+    "$program" "$directory/config.ini" "$width" "$directory/image.bmp" > /dev/null || exit 1
+    $pixels "$directory/image.bmp" "$directory/image.pixels" || exit 1
+    for option in indexed rle; do
+        "$program" "$directory/config.ini" "$width" "$directory/$option.bmp" "--$option" > /dev/null || exit 1
+        $pixels "$directory/$option.bmp" "$directory/$option.pixels" || exit 1
+        if cmp -s "$directory/image.pixels" "$directory/$option.pixels"; then
+            echo "PASS: --$option, width $width"
+        else
+            echo "FAIL: --$option, width $width"
+            status=1
+        fi
+    done
+done
+exit $status
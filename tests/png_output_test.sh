@@ -0,0 +1,36 @@
+#!/bin/sh
+# Checks that the pixels of PNG files are the same as the pixels of BMP files of the same image. The larger images are compressed
+# in several segments, on one thread and on several threads. The pixels are compared with tests/image_pixels.py, which needs Python 3.
+# Usage: tests/png_output_test.sh <path of the program>
+
+program=${1:-./mandelbrot_renderer}
+pixels="python3 $(dirname "$0")/image_pixels.py"
+directory=$(mktemp -d)
+trap 'rm -rf "$directory"' EXIT
+
+cat > "$directory/config.ini" << EOF
+lower_left_real = -2
+lower_left_imag = -1.5
+upper_right_real = 1
+upper_right_imag = 1.5
+iteration_depth = 1000
+inner_color = 0x000000
+outer_colors = 0xFFFFFF, 0xFFFF00, 0x00FFFF, 0xFF0000
+smooth_coloring = 1
+EOF
+
+status=0
+for run in "100 1" "1000 1" "1000 4"; do
+    set -- $run
+    "$program" --threads "$2" "$directory/config.ini" "$1" "$directory/image.bmp" > /dev/null || exit 1
+    "$program" --threads "$2" "$directory/config.ini" "$1" "$directory/image.png" > /dev/null || exit 1
+    $pixels "$directory/image.bmp" "$directory/bmp.pixels" || exit 1
+    $pixels "$directory/image.png" "$directory/png.pixels" || exit 1
+    if cmp -s "$directory/bmp.pixels" "$directory/png.pixels"; then
+        echo "PASS: width $1, $2 threads"
+    else
+        echo "FAIL: width $1, $2 threads"
+        status=1
+    fi
+done
+exit $status
@@ -0,0 +1,70 @@
+#!/bin/sh
+# Checks that images rendered by the render daemon are the same as images rendered on the command line, both when the daemon saves
+# the image and when the client fetches it. The second job reuses the buffers of the first one. The client needs Python 3.
+# Usage: tests/render_daemon_test.sh <path of the program>
+
+program=${1:-./mandelbrot_renderer}
+directory=$(mktemp -d)
+trap 'kill $daemon 2> /dev/null; rm -rf "$directory"' EXIT
+
+cat > "$directory/config.ini" << EOF
+lower_left_real = -2
+lower_left_imag = -1.5
+upper_right_real = 1
+upper_right_imag = 1.5
+iteration_depth = 1000
+inner_color = 0x000000
+outer_colors = 0xFFFFFF, 0xFFFF00, 0x00FFFF, 0xFF0000
+supersampling = 4
+EOF
+
+"$program" daemon "$directory/socket" > /dev/null 2>&1 &
+daemon=$!
+for attempt in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S "$directory/socket" ] && break
+    sleep 0.2
+done
+
+# Sends a job, waits for its result and stores the image. The output path - makes the daemon send the image to the client.
+render() {
+    python3 - "$directory/socket" "$directory/config.ini" "$@" << 'EOF'
+import socket, sys
+socket_path, config_path, width, output_path, image_path = sys.argv[1:]
+connection = socket.socket(socket.AF_UNIX)
+connection.connect(socket_path)
+stream = connection.makefile('rwb')
+with open(config_path, 'rb') as file:
+    stream.write(b'RENDER 0 %s %s\n%sEND\n' % (width.encode(), output_path.encode(), file.read()))
+stream.flush()
+answer = stream.readline().split()
+if answer[0] != b'OK':
+    sys.exit(1)
+stream.write(b'RESULT %s\n' % answer[1])
+stream.flush()
+answer = stream.readline().split()
+if answer[0] == b'DATA':
+    with open(image_path, 'wb') as file:
+        file.write(stream.read(int(answer[1])))
+elif answer[0] != b'DONE':
+    sys.exit(1)
+EOF
+}
+
+status=0
+for run in "400 saved" "1000 saved" "1000 fetched"; do
+    set -- $run
+    "$program" "$directory/config.ini" "$1" "$directory/command_line.bmp" > /dev/null || exit 1
+    rm -f "$directory/daemon.bmp"
+    if [ "$2" = saved ]; then
+        render "$1" "$directory/daemon.bmp" "" || exit 1
+    else
+        render "$1" - "$directory/daemon.bmp" || exit 1
+    fi
+    if cmp -s "$directory/command_line.bmp" "$directory/daemon.bmp"; then
+        echo "PASS: $2, width $1"
+    else
+        echo "FAIL: $2, width $1"
+        status=1
+    fi
+done
+exit $status
@@ -0,0 +1,55 @@
+#!/bin/sh
+# Checks the images that are written to the standard output: the pixels of a PPM image must be the same as the pixels of a BMP file
+# of the same image, and a YUV4MPEG2 stream of an animation must hold as many frames of the right size as the animation has.
+# Nothing else may be written to the standard output. The pixels are compared with tests/image_pixels.py, which needs Python 3.
+# Usage: tests/stdout_stream_test.sh <path of the program>
+
+program=${1:-./mandelbrot_renderer}
+pixels="python3 $(dirname "$0")/image_pixels.py"
+directory=$(mktemp -d)
+trap 'rm -rf "$directory"' EXIT
+
+cat > "$directory/config.ini" << EOF
+lower_left_real = -2
+lower_left_imag = -1.5
+upper_right_real = 1
+upper_right_imag = 1.5
+iteration_depth = 1000
+inner_color = 0x000000
+outer_colors = 0xFFFFFF, 0xFFFF00, 0x00FFFF, 0xFF0000
+smooth_coloring = 1
+EOF
+
+cat > "$directory/keyframes.txt" << EOF
+0 -0.75 0 3
+4 -0.75 0.1 1.5
+EOF
+
+status=0
+for width in 101 1000; do
+    "$program" "$directory/config.ini" "$width" "$directory/image.bmp" > /dev/null || exit 1
+    "$program" "$directory/config.ini" "$width" - > "$directory/image.ppm" 2> /dev/null || exit 1
+    $pixels "$directory/image.bmp" "$directory/bmp.pixels" || exit 1
+    $pixels "$directory/image.ppm" "$directory/ppm.pixels" || exit 1
+    if cmp -s "$directory/bmp.pixels" "$directory/ppm.pixels"; then
+        echo "PASS: PPM, width $width"
+    else
+        echo "FAIL: PPM, width $width"
+        status=1
+    fi
+done
+
+# The frames are 101 pixels wide and high, so the last row and column of the chroma planes are blocks of their own.
+"$program" animate "$directory/config.ini" "$directory/keyframes.txt" 101 "$directory/frame" > /dev/null || exit 1
+"$program" animate "$directory/config.ini" "$directory/keyframes.txt" 101 - > "$directory/frames.y4m" 2> /dev/null || exit 1
+num_frames=$(ls "$directory"/frame_*.bmp | wc -l)
+header=$(head -n 1 "$directory/frames.y4m")
+expected_size=$((${#header} + 1 + num_frames * (6 + 101 * 101 + 2 * 51 * 51)))
+actual_size=$(wc -c < "$directory/frames.y4m")
+if [ "$header" = "YUV4MPEG2 W101 H101 F30:1 Ip A1:1 C420jpeg" ] && [ "$actual_size" -eq "$expected_size" ]; then
+    echo "PASS: YUV4MPEG2, $num_frames frames"
+else
+    echo "FAIL: YUV4MPEG2, $num_frames frames"
+    status=1
+fi
+exit $status
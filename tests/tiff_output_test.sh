@@ -0,0 +1,39 @@
+#!/bin/sh
+# Checks that the pixels of tiled TIFF files, rendered in memory and in bands, are the same as the pixels of BMP files of the same image.
+# The widths and heights are no multiples of the tile size, so the tiles at the right and bottom edge are padded.
+# The pixels are compared with tests/image_pixels.py, which needs Python 3.
+# Usage: tests/tiff_output_test.sh <path of the program>
+
+program=${1:-./mandelbrot_renderer}
+pixels="python3 $(dirname "$0")/image_pixels.py"
+directory=$(mktemp -d)
+trap 'rm -rf "$directory"' EXIT
+
+cat > "$directory/config.ini" << EOF
+lower_left_real = -2
+lower_left_imag = -1.5
+upper_right_real = 1
+upper_right_imag = 1.5
+iteration_depth = 1000
+inner_color = 0x000000
+outer_colors = 0xFFFFFF, 0xFFFF00, 0x00FFFF, 0xFF0000
+smooth_coloring = 1
+EOF
+
+status=0
+for width in 300 1000; do
+    "$program" "$directory/config.ini" "$width" "$directory/image.bmp" > /dev/null || exit 1
+    "$program" "$directory/config.ini" "$width" "$directory/memory.tif" > /dev/null || exit 1
+    "$program" "$directory/config.ini" "$width" "$directory/banded.tif" --memory-budget 4M > /dev/null || exit 1
+    $pixels "$directory/image.bmp" "$directory/image.pixels" || exit 1
+    for output in memory banded; do
+        $pixels "$directory/$output.tif" "$directory/$output.pixels" || exit 1
+        if cmp -s "$directory/image.pixels" "$directory/$output.pixels"; then
+            echo "PASS: $output, width $width"
+        else
+            echo "FAIL: $output, width $width"
+            status=1
+        fi
+    done
+done
+exit $status
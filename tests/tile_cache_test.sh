@@ -0,0 +1,38 @@
+#!/bin/sh
+# Checks that images rendered with a tile cache are the same as images rendered without it, both when the tiles are computed
+# and when they are loaded from the cache. The viewports lie on their pixel grids, so snapping them to the grid does not move them.
+# Usage: tests/tile_cache_test.sh <path of the program>
+
+program=${1:-./mandelbrot_renderer}
+directory=$(mktemp -d)
+trap 'rm -rf "$directory"' EXIT
+
+write_config() {
+    cat > "$directory/$1.ini" << EOF
+lower_left_real = $2
+lower_left_imag = -2
+upper_right_real = $3
+upper_right_imag = 2
+iteration_depth = 1000
+inner_color = 0x000000
+outer_colors = 0xFFFFFF, 0xFFFF00, 0x00FFFF, 0xFF0000
+EOF
+}
+
+# The second viewport is panned by a quarter of its width, so its render loads most of its tiles from the renders of the first one.
+write_config centered -2 2
+write_config panned -1 3
+
+status=0
+for run in "centered 512" "centered 1024" "panned 512" "panned 1024"; do
+    set -- $run
+    "$program" "$directory/$1.ini" "$2" "$directory/uncached.bmp" > /dev/null || exit 1
+    "$program" "$directory/$1.ini" "$2" "$directory/cached.bmp" --cache "$directory/cache" > /dev/null || exit 1
+    if cmp -s "$directory/uncached.bmp" "$directory/cached.bmp"; then
+        echo "PASS: $1, width $2"
+    else
+        echo "FAIL: $1, width $2"
+        status=1
+    fi
+done
+exit $status